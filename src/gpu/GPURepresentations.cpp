@@ -181,6 +181,8 @@ void LowerCacheRowsOpToGPU(ConversionPatternRewriter &rewriter,
                            ArrayRef<Value> operands) {
   auto location = op->getLoc();
   auto cacheRowsOp = AssertOpIsOfType<decisionforest::CacheInputRowsOp>(op);
+  assert (!cacheRowsOp.getFeatureColumns() && "Caching compacted rows is not supported on GPUs");
+  assert (!cacheRowsOp.getBinBoundaries() && "Caching binned rows is not supported on GPUs");
   // Add the required globals to the owning module
   auto owningModule = cacheRowsOp->getParentOfType<mlir::ModuleOp>();
   assert (owningModule);
@@ -24,9 +24,23 @@ namespace decisionforest
 {
 
 class TiledTree;
+class TileShapeToTileIDMap;
+
+// The tile shape maps of the trees of a forest (one per tile size). Shape IDs of large tiles are assigned 
+// in the order in which the tiles are constructed, so every forest that is compiled has its own maps.
+class TileShapeToTileIDMaps
+{
+    std::map<int32_t, std::shared_ptr<TileShapeToTileIDMap>> m_tileSizeToTileShapeMap;
+public:
+    TileShapeToTileIDMap& Get(int32_t tileSize);
+};
 
 enum class PredictionTransformation { kIdentity, kSigmoid, kSoftMax, kUnknown };
-enum class ReductionType { kAdd, kVoting };
+// How the predictions of the trees are combined. kAdd sums the trees (of each class). kAverage divides the 
+// sum of the trees of each class by the number of trees of the class (random forest regressors and 
+// probability averaging classifiers). With kVoting, every tree predicts a class index and the class with 
+// the most votes is the prediction.
+enum class ReductionType { kAdd, kVoting, kAverage };
 enum class FeatureType { kNumerical, kCategorical };
 
 class DecisionTree
@@ -78,6 +92,8 @@ public:
     void SetNodeRightChild(int64_t node, int64_t child) { m_nodes[node].rightChild = child; }
     // Set left child of a node
     void SetNodeLeftChild(int64_t node, int64_t child) { m_nodes[node].leftChild = child; }
+    // Set the threshold of a node
+    void SetNodeThreshold(int64_t node, double threshold) { m_nodes[node].threshold = threshold; }
 
     std::string Serialize() const;
     std::string PrintToString() const;
@@ -98,6 +114,9 @@ public:
     int32_t GetTreeDepth() {
         return GetTreeDepthHelper(0);
     }
+    // Number of levels of splits if the tree is oblivious, i.e. it is complete and all nodes
+    // at a depth have the same feature and threshold. Returns -1 otherwise.
+    int32_t GetObliviousDepth() const;
 
     int32_t NumLeaves() {
         int numNodes = 0;
@@ -124,11 +143,17 @@ public:
 
     void SetClassId(int32_t classId) { m_classId = classId; }
     int32_t GetClassId() const { return m_classId; }
+    // Position of the tree in the model as it was read. Passes that reorder the trees of a forest don't change it.
+    void SetIndexInModel(int64_t index) { m_indexInModel = index; }
+    int64_t GetIndexInModel() const { return m_indexInModel; }
     int32_t NumFeatures();
 
     void InitializeInternalNodeHitCounts();
     int32_t GetSubtreeHitCount(int32_t nodeIndex);
     TiledTree* GetTiledTree();
+    // The map that assigns IDs to the shapes of the tiles of this tree (shared by the trees of a forest)
+    TileShapeToTileIDMap& GetTileShapeToTileIDMap();
+    void SetTileShapeToTileIDMaps(std::shared_ptr<TileShapeToTileIDMaps> tileShapeMaps) { m_tileShapeMaps = tileShapeMaps; }
 private:
     std::vector<Node> m_nodes;
     size_t m_numFeatures = 0;
@@ -137,8 +162,10 @@ private:
     // TODO It looks like some tests aren't setting this property at all! 
     // Adding an initialization to make sure we aren't accessing unitialized memory
     int32_t m_classId = 0;
+    int64_t m_indexInModel = -1;
     
     std::shared_ptr<TiledTree> m_tiledTree = nullptr;
+    std::shared_ptr<TileShapeToTileIDMaps> m_tileShapeMaps = nullptr;
 
     int32_t GetTreeDepthHelper(size_t node) const;
     
@@ -149,7 +176,9 @@ private:
 class DecisionForest
 {
 public:
-    DecisionForest(double initialValue) : m_initialValue(initialValue), m_predictionTransform(PredictionTransformation::kUnknown), m_numClasses(0) {}
+    DecisionForest(double initialValue) 
+      : m_initialValue(initialValue), m_predictionTransform(PredictionTransformation::kUnknown), m_numClasses(0),
+        m_tileShapeMaps(std::make_shared<TileShapeToTileIDMaps>()) {}
     DecisionForest() : DecisionForest(0.0) {}
 
     struct Feature
@@ -159,6 +188,7 @@ public:
     };
 
     void SetReductionType(ReductionType reductionType) { m_reductionType = reductionType; }
+    ReductionType GetReductionType() const { return m_reductionType; }
     void AddFeature(const std::string& featureName, const std::string& type)
     {
         Feature f{featureName, type};
@@ -167,6 +197,8 @@ public:
     DecisionTree& NewTree()
     { 
         m_trees.push_back(std::make_shared<DecisionTree>());
+        m_trees.back()->SetTileShapeToTileIDMaps(m_tileShapeMaps);
+        m_trees.back()->SetIndexInModel(static_cast<int64_t>(m_trees.size()) - 1);
         return *(m_trees.back());
     }
     void EndTree() { }
@@ -199,6 +231,33 @@ public:
     bool IsMultiClassClassifier() { return m_numClasses > 0; }
 
     std::vector<std::shared_ptr<DecisionTree>>& GetTrees() { return m_trees; }
+
+    // Sorted distinct thresholds of each feature. These are only set once the thresholds 
+    // of the forest have been replaced by bin indices (see DoThresholdQuantization). If only
+    // some features are binned (see QuantizeFeatureThresholds), binnedFeatures lists them and
+    // the boundaries are those of these features.
+    void SetFeatureBinBoundaries(const std::vector<std::vector<double>>& boundaries, const std::vector<int32_t>& binnedFeatures={}) {
+        m_featureBinBoundaries = boundaries;
+        m_binnedFeatures = binnedFeatures;
+    }
+    const std::vector<std::vector<double>>& GetFeatureBinBoundaries() const { return m_featureBinBoundaries; }
+    // Empty if all features are binned
+    const std::vector<int32_t>& GetBinnedFeatures() const { return m_binnedFeatures; }
+    bool HasBinnedFeatures() const { return !m_featureBinBoundaries.empty(); }
+    bool IsQuantized() const { return HasBinnedFeatures() && m_binnedFeatures.empty(); }
+
+    // Input column of every feature once the features used by the forest have been renumbered
+    // densely (see DoFeatureCompaction). Empty if the features haven't been compacted.
+    void SetCompactFeatureColumns(const std::vector<int32_t>& columns) { m_compactFeatureColumns = columns; }
+    const std::vector<int32_t>& GetCompactFeatureColumns() const { return m_compactFeatureColumns; }
+    bool IsFeatureCompacted() const { return !m_compactFeatureColumns.empty(); }
+
+    // Depth of the trees if all trees are oblivious and equally deep (see DecisionTree::GetObliviousDepth).
+    // Returns -1 otherwise.
+    int32_t GetObliviousTreeDepth() const;
+
+    // The map that assigns IDs to the shapes of the tiles of the trees of this forest
+    TileShapeToTileIDMap& GetTileShapeToTileIDMap(int32_t tileSize) { return m_tileShapeMaps->Get(tileSize); }
 private:
     std::vector<Feature> m_features;
     std::vector<std::shared_ptr<DecisionTree>> m_trees;
@@ -206,6 +265,13 @@ private:
     double m_initialValue;
     PredictionTransformation m_predictionTransform;
     int32_t m_numClasses;
+    std::vector<std::vector<double>> m_featureBinBoundaries;
+    std::vector<int32_t> m_binnedFeatures;
+    std::vector<int32_t> m_compactFeatureColumns;
+    std::shared_ptr<TileShapeToTileIDMaps> m_tileShapeMaps;
+
+    template<typename FPType>
+    FPType ReducePredictions(std::map<int32_t, std::vector<FPType>>& predictions) const;
 };
 
 inline int32_t DecisionTree::GetTreeDepthHelper(size_t node) const
@@ -216,6 +282,51 @@ inline int32_t DecisionTree::GetTreeDepthHelper(size_t node) const
     return 1 + std::max(GetTreeDepthHelper(n.leftChild), GetTreeDepthHelper(n.rightChild));
 }
 
+inline int32_t DecisionTree::GetObliviousDepth() const
+{
+    if (m_nodes.empty())
+        return -1;
+    std::vector<int64_t> level = { 0 };
+    int32_t depth = 0;
+    while (!m_nodes[level.front()].IsLeaf()) {
+        std::vector<int64_t> nextLevel;
+        const Node& first = m_nodes[level.front()];
+        for (auto nodeIndex : level) {
+            const Node& node = m_nodes[nodeIndex];
+            if (node.IsLeaf() || node.featureIndex != first.featureIndex || node.threshold != first.threshold ||
+                node.featureType != FeatureType::kNumerical)
+                return -1;
+            nextLevel.push_back(node.leftChild);
+            nextLevel.push_back(node.rightChild);
+        }
+        level = std::move(nextLevel);
+        ++depth;
+    }
+    for (auto nodeIndex : level)
+        if (!m_nodes[nodeIndex].IsLeaf())
+            return -1;
+    return depth;
+}
+
+inline TileShapeToTileIDMap& DecisionTree::GetTileShapeToTileIDMap()
+{
+    // Trees that aren't part of a forest have maps of their own
+    if (m_tileShapeMaps.get() == nullptr)
+        m_tileShapeMaps = std::make_shared<TileShapeToTileIDMaps>();
+    return m_tileShapeMaps->Get(m_tilingDescriptor.MaxTileSize());
+}
+
+inline int32_t DecisionForest::GetObliviousTreeDepth() const
+{
+    if (m_trees.empty())
+        return -1;
+    int32_t depth = m_trees.front()->GetObliviousDepth();
+    for (auto& tree : m_trees)
+        if (tree->GetObliviousDepth() != depth)
+            return -1;
+    return depth;
+}
+
 template <typename AttribType, typename GetterType>
 void DecisionTree::GetNodeAttributeArray(std::vector<AttribType>& attributeVec,
                                                                                                      size_t vecIndex, size_t nodeIndex, GetterType get)
@@ -407,6 +518,34 @@ ReturnType argmax(std::vector<FPType>& classProbabilities) {
     return std::distance(classProbabilities.begin(), std::max_element(classProbabilities.begin(), classProbabilities.end()));
 }
 
+// Combines the predictions of the trees of each class (class 0 for single output models) into the 
+// prediction of the forest, before the prediction transformation.
+template<typename FPType>
+FPType DecisionForest::ReducePredictions(std::map<int32_t, std::vector<FPType>>& predictions) const
+{
+    if (m_reductionType == ReductionType::kVoting) {
+        assert (m_numClasses > 0 && "Voting is only supported for classifiers");
+        std::vector<FPType> votes(m_numClasses, 0);
+        for (auto& classPredictions : predictions)
+            for (auto prediction : classPredictions.second)
+                votes.at(static_cast<int32_t>(prediction)) += 1;
+        return argmax<FPType, FPType>(votes);
+    }
+    auto reduce = [&](std::vector<FPType>& treePredictions) -> FPType {
+        if (m_reductionType == ReductionType::kAverage && !treePredictions.empty()) {
+            auto sum = std::accumulate(treePredictions.begin(), treePredictions.end(), 0.0);
+            return m_initialValue + sum / treePredictions.size();
+        }
+        return std::accumulate(treePredictions.begin(), treePredictions.end(), m_initialValue);
+    };
+    if (m_numClasses == 0)
+        return reduce(predictions[0]);
+    std::vector<FPType> classProbabilities(m_numClasses, static_cast<FPType>(m_initialValue));
+    for (auto& classPredictions : predictions)
+        classProbabilities[classPredictions.first] = reduce(classPredictions.second);
+    return argmax<FPType, FPType>(classProbabilities);
+}
+
 inline double DecisionForest::Predict(std::vector<double>& data) const
 {
     std::map<int32_t, std::vector<double>> predictions;
@@ -416,30 +555,15 @@ inline double DecisionForest::Predict(std::vector<double>& data) const
         predictions[tree->GetClassId()].push_back(prediction);
     }
     
-    assert(m_reductionType == ReductionType::kAdd);
-
-    if (m_numClasses == 0) {
-        auto rawPrediction = std::accumulate(predictions[0].begin(), predictions[0].end(), m_initialValue);
-        // std::cout << "Raw prediction : " << rawPrediction << std::endl;
-        if (m_predictionTransform == PredictionTransformation::kIdentity)
-            return rawPrediction;
-        else if (m_predictionTransform == PredictionTransformation::kSigmoid)
-            return sigmoid(rawPrediction);
-        else
-            assert(false);
-        return -1;
-    }
-    else {
-        std::vector<double> classProbabilities(m_numClasses, 0);
-        std::for_each(
-            predictions.begin(),
-            predictions.end(),
-            [&](std::pair<const int32_t, std::vector<double>>& pair) {
-                classProbabilities[pair.first] = std::accumulate(pair.second.begin(), pair.second.end(), m_initialValue);
-            });
-        
-        return argmax<double, double>(classProbabilities);
-    }
+    auto prediction = ReducePredictions(predictions);
+    // The prediction of a classifier is the class with the highest weight (or the most votes)
+    if (m_numClasses > 0 || m_predictionTransform == PredictionTransformation::kIdentity)
+        return prediction;
+    else if (m_predictionTransform == PredictionTransformation::kSigmoid)
+        return sigmoid(prediction);
+    else
+        assert(false);
+    return -1;
 }
 
 inline float DecisionForest::Predict_Float(std::vector<float>& data) const
@@ -451,30 +575,14 @@ inline float DecisionForest::Predict_Float(std::vector<float>& data) const
         predictions[tree->GetClassId()].push_back(prediction);
     }
     
-    assert(m_reductionType == ReductionType::kAdd);
-
-    if (m_numClasses == 0) {
-        auto rawPrediction = std::accumulate(predictions[0].begin(), predictions[0].end(), m_initialValue);
-        if (m_predictionTransform == PredictionTransformation::kIdentity)
-        return rawPrediction;
-        else if (m_predictionTransform == PredictionTransformation::kSigmoid)
-        return sigmoid(rawPrediction);
-        else
+    auto prediction = ReducePredictions(predictions);
+    if (m_numClasses > 0 || m_predictionTransform == PredictionTransformation::kIdentity)
+        return prediction;
+    else if (m_predictionTransform == PredictionTransformation::kSigmoid)
+        return sigmoid(prediction);
+    else
         assert(false);
-        return -1;
-    }
-    else {
-        assert(m_predictionTransform == PredictionTransformation::kSoftMax);
-        std::vector<float> classProbabilities(m_numClasses, 0);
-        std::for_each(
-            predictions.begin(),
-            predictions.end(),
-            [&](std::pair<const int32_t, std::vector<float>>& pair) {
-                classProbabilities[pair.first] = std::accumulate(pair.second.begin(), pair.second.end(), m_initialValue);
-            });
-        
-        return argmax<float, float>(classProbabilities);
-    }
+    return -1;
 }
 
 // Level Order Sorter
@@ -3,6 +3,8 @@
 
 #include <map>
 #include <string>
+#include <numeric>
+#include <algorithm>
 #include <cassert>
 #include "DecisionForest.h"
 
@@ -53,6 +55,7 @@ private:
     void GetThresholds(std::vector<double>::iterator beginIter);
     void GetFeatureIndices(std::vector<int32_t>::iterator beginIter);
     void ComputeTileShapeString(std::string& str, int32_t tileNodeIndex, int32_t stringIndex);
+    void ComputeTileShapeKey(std::string& str, int32_t tileNodeIndex);
 
     int32_t GetTileDepth(std::vector<TiledTreeNode>& tiles) const;
 public:
@@ -68,6 +71,9 @@ public:
     DecisionTree& GetTree();
     const DecisionTree::Node& GetNode(int32_t index) const;
     std::string GetTileShapeString();
+    // Pre-order encoding of the tile shape ('1' for a node, '0' for a missing child). Unlike
+    // the shape string, its length is linear in the tile size.
+    std::string GetTileShapeKey();
     int32_t GetTileShapeID() const { return m_tileShapeID; }
     bool IsLeafTile() const { return m_nodeIndices.size()==1 && GetNode(m_nodeIndices.at(0)).IsLeaf(); }
     int32_t GetTileDepth() const;
@@ -78,26 +84,49 @@ class TiledTreeNode;
 // Routines to compute combinatorial properties of tiles
 class TileShapeToTileIDMap
 {
-    static std::map<int32_t, int32_t> tileSizeToNumberOfShapesMap;
-    static std::map<int32_t, TileShapeToTileIDMap*> tileSizeToTileShapeMapMap;
     int32_t m_tileSize;
     std::map<std::string, int32_t> m_tileStringToTileIDMap;
     int32_t m_currentTileID = 0;
+    // Only used for large tiles. Maps a tile shape ID to the pre-order key of the shape.
+    std::vector<std::string> m_tileIDToTileKey;
     void TileStringGenerator(int32_t numNodes);
     void InitMap();
+    static int32_t PowerOfTwoCeil(int32_t val) {
+        int32_t powerOfTwo = 1;
+        while (powerOfTwo < val)
+            powerOfTwo *= 2;
+        return powerOfTwo;
+    }
+public:
     TileShapeToTileIDMap(int32_t tileSize) 
       : m_tileSize(tileSize)
     {
         InitMap();
     }
 
-public:
+    // Tiles larger than this don't enumerate all their shapes up front (there are Catalan(tileSize) of them)
+    // and don't use a LUT with 2^tileSize entries per shape. Shape IDs are handed out as shapes are 
+    // encountered and the child index is computed from the tile child table instead.
+    static constexpr int32_t kMaxTileSizeWithLUT = 8;
+    static bool UseTileChildTable(int32_t tileSize) { return tileSize > kMaxTileSizeWithLUT; }
+    // Number of entries in each half of a row of the tile child table (a tile has at most tileSize+1 children)
+    static int32_t TileChildTableWidth(int32_t tileSize) { return PowerOfTwoCeil(tileSize + 1); }
+    // Width of the tile child table entries. Each entry has one bit per node of the tile.
+    static int32_t TileChildTableEntryBitWidth(int32_t tileSize) { return std::max(8, PowerOfTwoCeil(tileSize)); }
+
     int32_t GetTileID(TiledTreeNode& tile);
     // Index is (tileShapeID, comparison result)
     std::vector<std::vector<int32_t>> ComputeTileLookUpTable();
+    // Index is (tileShapeID, entry). The first TileChildTableWidth entries of a row are the masks of the nodes 
+    // on the path to each child of the tile and the next TileChildTableWidth entries are the comparison outcomes
+    // those nodes need to have for the walk to reach the child. The child index is the index of the only child
+    // for which (outcomes & mask) == value. Unused entries have a zero mask and a non-zero value so they never match.
+    // If nodeZeroIsMostSignificantBit is set, the outcome of node i is bit (tileSize-1-i) rather than bit i.
+    std::vector<std::vector<int64_t>> ComputeTileChildTable(bool nodeZeroIsMostSignificantBit);
+    // Number of tile shape IDs that have been handed out so far
+    int32_t NumberOfAssignedTileShapes() const { return m_currentTileID; }
     // Number of tile shapes with the given tile size
     static int32_t NumberOfTileShapes(int32_t tileSize);
-    static TileShapeToTileIDMap* Get(int32_t tileSize);
 };
 
 struct TiledTreeStats {
@@ -202,8 +231,11 @@ public:
     std::vector<int32_t> SerializeFeatureIndices();
     std::vector<int32_t> SerializeTileShapeIDs();
 
+    // If hotPathLayout is true, the most frequently hit child of every tile (as given by the hit counts
+    // on the tree's nodes) is laid out right after the tile's children rather than in level order.
     void GetSparseSerialization(std::vector<double>& thresholds, std::vector<int32_t>& featureIndices, 
-                                std::vector<int32_t>& tileShapeIDs, std::vector<int32_t>& childIndices, std::vector<double>& leaves);
+                                std::vector<int32_t>& tileShapeIDs, std::vector<int32_t>& childIndices, std::vector<double>& leaves,
+                                bool hotPathLayout=false);
     void GetSparseSerializationPeeled(std::vector<double>& thresholds, std::vector<int32_t>& featureIndices, 
                                       std::vector<int32_t>& tileShapeIDs, std::vector<int32_t>& childIndices,
                                       std::vector<double>& leaves);
@@ -290,6 +322,48 @@ public:
         }
       }
 
+      void AddToOrder(const QueueEntry& entry) {
+        m_levelOrder.push_back(entry.childNode);
+        MapKey mapKey{entry.parentNodeIndex, entry.childNodeIndex, entry.childNumber};
+        assert (m_nodeIndexMap.find(mapKey) == m_nodeIndexMap.end());
+        m_nodeIndexMap[mapKey] = m_levelOrder.size() - 1;
+        m_levelOrderIndexToOriginalIndexMap[m_levelOrder.size() - 1] = entry.childNodeIndex;
+      }
+
+      // Lays out the children of a tile as one contiguous block (the serialization only stores the index of 
+      // the first child) and then lays out the children's subtrees, most frequently hit child first. The block of 
+      // children of the hottest child of every tile therefore immediately follows the tile's own block of children.
+      void DoHotPathOrderTraversal(const std::vector<LevelOrderSorterNodeType>& nodes, const QueueEntry& entry) {
+        auto& node = entry.childNode;
+        if (node.IsLeafTile())
+          return;
+        std::vector<QueueEntry> children;
+        int32_t childNum=0;
+        for (auto child : node.GetChildren()) {
+          if (child != DecisionTree::INVALID_NODE_INDEX) {
+            children.push_back(QueueEntry{entry.childNodeIndex, child, childNum, nodes.at(child)});
+            AddToOrder(children.back());
+          }
+          ++childNum;
+        }
+        // The hit count of a tile is the hit count of its entry node (-1 for dummy nodes). Tiles hold 
+        // references and can't be assigned, so sort the positions of the children instead.
+        std::vector<size_t> visitOrder(children.size());
+        std::iota(visitOrder.begin(), visitOrder.end(), 0);
+        auto hitCount = [&](size_t i) { return children.at(i).childNode.GetNode(children.at(i).childNode.GetEntryNode()).hitCount; };
+        std::stable_sort(visitOrder.begin(), visitOrder.end(), [&](size_t i1, size_t i2) { return hitCount(i1) > hitCount(i2); });
+        for (auto i : visitOrder)
+          DoHotPathOrderTraversal(nodes, children.at(i));
+      }
+
+      void DoHotPathOrderTraversal(const std::vector<LevelOrderSorterNodeType>& nodes) {
+        int32_t invalidIndex = DecisionTree::INVALID_NODE_INDEX;
+        assert (nodes[0].GetParent() == invalidIndex);
+        QueueEntry rootEntry{invalidIndex, 0, 0, nodes[0]};
+        AddToOrder(rootEntry);
+        DoHotPathOrderTraversal(nodes, rootEntry);
+      }
+
       int32_t GetNewIndex(MapKey& oldIndex) {
         auto iter = m_nodeIndexMap.find(oldIndex);
         assert (iter != m_nodeIndexMap.end());
@@ -324,8 +398,12 @@ public:
         // std::cout << "End RewriteIndices()\n";
       }
     public:
-      LevelOrderTraversal(const std::vector<LevelOrderSorterNodeType>& nodes) {
-        DoLevelOrderTraversal(nodes);
+      // If hotPathOrder is true, the tiles are ordered by DoHotPathOrderTraversal rather than in level order
+      LevelOrderTraversal(const std::vector<LevelOrderSorterNodeType>& nodes, bool hotPathOrder=false) {
+        if (hotPathOrder)
+          DoHotPathOrderTraversal(nodes);
+        else
+          DoLevelOrderTraversal(nodes);
         RewriteIndices();
       }
       std::vector<LevelOrderSorterNodeType>& LevelOrderNodes() { return m_levelOrder; }
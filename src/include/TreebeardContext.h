@@ -64,6 +64,10 @@ class ForestCreator;
 enum class TilingType { kUniform, kProbabilistic, kHybrid };
 
 struct CompilerOptions {
+  // Setting any of the threshold, feature index, node index, tile shape or child index widths to this
+  // value lets the compiler pick the narrowest width that is safe for the model (see SelectAutoTypeWidths)
+  static constexpr int32_t kAutoTypeWidth = -1;
+
   // model parameters
   int32_t numberOfFeatures = -1; // TODO: Currently used only by ONNX.
 
@@ -78,6 +82,12 @@ struct CompilerOptions {
   int32_t featureIndexTypeWidth=16;
   int32_t nodeIndexTypeWidth=16;
   int32_t inputElementTypeWidth=32;
+  // A threshold type width of 16 uses f16 (or bf16 if thresholdTypeIsBFloat16 is set) for the
+  // thresholds and leaves. Features with thresholds that aren't exact in 16 bits are compared at
+  // the precision of the inputs instead (see ForestCreator::CheckHalfPrecisionThresholds). If
+  // fallbackTo32BitThresholds is cleared, such thresholds fail the compilation.
+  bool thresholdTypeIsBFloat16=false;
+  bool fallbackTo32BitThresholds=true;
   int32_t tileShapeBitWidth=16;
   int32_t childIndexBitWidth=16;
   TilingType tilingType=TilingType::kUniform;
@@ -88,6 +98,28 @@ struct CompilerOptions {
   mlir::decisionforest::ScheduleManipulator *scheduleManipulator=nullptr;
   std::string statsProfileCSVPath = "";
   int32_t numberOfCores = -1;
+  int32_t prefetchDistance = -1;
+  bool quantizeModel = false;
+  bool simplifyForest = false;
+  bool compactFeatures = false;
+  // Walk the trees of each batch on numberOfCores cores instead of splitting the batch between them
+  bool parallelizeTrees = false;
+  // Run parallel loops on Treebeard's work stealing task runtime instead of with OpenMP
+  bool useWorkStealingRuntime = false;
+  // Copy the model onto every NUMA node and have each thread read the copy on its node. modelHugePages 
+  // is the TreeBeard::runtime::ModelHugePages the copies are allocated on (see runtime/ModelReplicas.h).
+  bool replicateModelPerNUMANode = false;
+  int32_t modelHugePages = 0;
+  // Walk forests of equally deep oblivious trees (CatBoost models) without any branches when the trees aren't tiled
+  bool specializeObliviousTrees = true;
+  // Count how often each leaf is reached so the inference runner can write a probability profile of the
+  // rows it predicted (see InferenceRunnerBase::WriteLeafHitCountProfile). Only supported for untiled trees.
+  bool instrumentLeafHitCounts = false;
+  // Compute the exp of the prediction transforms with a polynomial approximation (within 2 ULP) instead of libm
+  bool useFastApproximateTransforms = false;
+  // Peel the first levels of the walks of probabilistically tiled trees (also done for every model when
+  // mlir::decisionforest::PeeledCodeGenForProbabiltyBasedTiling is set). Needs the sparse representation.
+  bool peelProbabilisticallyTiledWalks = false;
 
   CompilerOptions() { }
   CompilerOptions(int32_t thresholdWidth, int32_t returnWidth, bool isReturnTypeFloat, int32_t featureIndexWidth, 
@@ -102,6 +134,26 @@ struct CompilerOptions {
   CompilerOptions(const std::string& configJSONFilePath);
 
   void SetPipelineSize(int32_t pipelineSize) { this->pipelineSize = pipelineSize; }
+  void SetPrefetchDistance(int32_t prefetchDistance) { this->prefetchDistance = prefetchDistance; }
+  void SetQuantizeModel(bool quantizeModel) { this->quantizeModel = quantizeModel; }
+  void SetSimplifyForest(bool simplifyForest) { this->simplifyForest = simplifyForest; }
+  void SetCompactFeatures(bool compactFeatures) { this->compactFeatures = compactFeatures; }
+  void SetParallelizeTrees(bool parallelizeTrees) { this->parallelizeTrees = parallelizeTrees; }
+  void SetUseWorkStealingRuntime(bool useWorkStealingRuntime) { this->useWorkStealingRuntime = useWorkStealingRuntime; }
+  void SetReplicateModelPerNUMANode(bool replicate, int32_t hugePages) { 
+    this->replicateModelPerNUMANode = replicate;
+    this->modelHugePages = hugePages;
+  }
+  void SetSpecializeObliviousTrees(bool specialize) { this->specializeObliviousTrees = specialize; }
+  void SetInstrumentLeafHitCounts(bool instrument) { this->instrumentLeafHitCounts = instrument; }
+  void SetThresholdTypeIsBFloat16(bool isBFloat16) { this->thresholdTypeIsBFloat16 = isBFloat16; }
+  void SetFallbackTo32BitThresholds(bool fallback) { this->fallbackTo32BitThresholds = fallback; }
+  void SetUseFastApproximateTransforms(bool useFastTransforms) { this->useFastApproximateTransforms = useFastTransforms; }
+  void SetPeelProbabilisticallyTiledWalks(bool peelWalks) { this->peelProbabilisticallyTiledWalks = peelWalks; }
+  void SetAutoTypeWidths() {
+    thresholdTypeWidth = featureIndexTypeWidth = nodeIndexTypeWidth = kAutoTypeWidth;
+    tileShapeBitWidth = childIndexBitWidth = kAutoTypeWidth;
+  }
 };
 
 void InitializeMLIRContext(mlir::MLIRContext& context);
@@ -1,12 +1,16 @@
 #include "ForestCreatorFactory.h"
 #include "xgboostparser.h"
 #include "onnxmodelparser.h"
+#include "lightgbmparser.h"
+#include "catboostparser.h"
 
 namespace TreeBeard
 {
 
 REGISTER_FOREST_CREATOR(xgboost_json, ConstructXGBoostJSONParser)
 REGISTER_FOREST_CREATOR(onnx_file, ConstructONNXFileParser)
+REGISTER_FOREST_CREATOR(lightgbm_text, ConstructLightGBMTextParser)
+REGISTER_FOREST_CREATOR(catboost_json, ConstructCatBoostJSONParser)
 
 // ===---------------------------------------------------=== //
 // ForestCreatorFactory Methods
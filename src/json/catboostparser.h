@@ -0,0 +1,212 @@
+#ifndef _CATBOOST_PARSER_H_
+#define _CATBOOST_PARSER_H_
+
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <set>
+#include "forestcreator.h"
+#include "TreebeardContext.h"
+
+namespace TreeBeard
+{
+
+// Reads models saved by CatBoost's save_model with format="json".
+//
+// CatBoost trees are oblivious trees. All nodes at a depth have the same split and a tree is stored
+// as its list of splits and the values of its 2^depth leaves. split[i] sets bit i of the index of the
+// leaf if feature > border. Levels are emitted from the last split to the first, so that the leaves
+// of the complete tree are in the order CatBoost stores them. Trees that are shallower than the
+// deepest tree get additional levels at the top whose children are identical copies. All trees of
+// the forest are therefore oblivious trees of the same depth and are walked without any branches
+// (see TraverseObliviousTreesOp).
+class CatBoostJSONParser : public ForestCreator
+{
+    struct CatBoostTree {
+        // Index of the feature in float_features and the border of each split
+        std::vector<int32_t> splitFeatures;
+        std::vector<double> borders;
+        std::vector<double> leafValues;
+    };
+
+    struct FloatFeature {
+        int32_t flatFeatureIndex;
+        bool nanGoesLeft;
+    };
+
+    json m_json;
+    std::vector<FloatFeature> m_floatFeatures;
+    std::vector<CatBoostTree> m_trees;
+    int32_t m_numDimensions = 1;
+    int32_t m_depth = 0;
+    // Predictions are scale*sum(leaves) + bias. The scale is folded into the leaves.
+    double m_scale = 1.0;
+    std::vector<double> m_bias;
+
+    void ReadModelFile(const std::string& modelPath) {
+        std::ifstream fin(modelPath);
+        assert (fin && "Could not open CatBoost model file");
+        fin >> m_json;
+        assert (m_json.contains("oblivious_trees") && "Not a CatBoost JSON model (or the model has non-symmetric trees)");
+
+        auto& featuresInfo = m_json["features_info"];
+        assert ((!featuresInfo.contains("categorical_features") || featuresInfo["categorical_features"].empty()) &&
+                "Categorical features are not supported");
+        assert ((!m_json.contains("ctr_data") || m_json["ctr_data"].empty()) && "CTR features are not supported");
+        for (auto& featureJSON : featuresInfo["float_features"]) {
+            auto nanTreatment = featureJSON.contains("nan_value_treatment") ? featureJSON["nan_value_treatment"].get<std::string>() : "AsIs";
+            // "feature > border" is false for NaNs unless they are treated as true
+            m_floatFeatures.push_back({ featureJSON["flat_feature_index"].get<int32_t>(), nanTreatment != "AsTrue" });
+        }
+
+        for (auto& treeJSON : m_json["oblivious_trees"]) {
+            CatBoostTree tree;
+            for (auto& splitJSON : treeJSON["splits"]) {
+                assert (splitJSON["split_type"].get<std::string>() == "FloatFeature" && "Only splits on float features are supported");
+                tree.splitFeatures.push_back(splitJSON["float_feature_index"].get<int32_t>());
+                // CatBoost compares float features with float borders
+                tree.borders.push_back(static_cast<float>(splitJSON["border"].get<double>()));
+            }
+            tree.leafValues = treeJSON["leaf_values"].get<std::vector<double>>();
+            m_depth = std::max(m_depth, static_cast<int32_t>(tree.splitFeatures.size()));
+            m_trees.push_back(tree);
+        }
+        assert (!m_trees.empty());
+        auto& firstTree = m_trees.front();
+        m_numDimensions = static_cast<int32_t>(firstTree.leafValues.size() >> firstTree.splitFeatures.size());
+        for (auto& tree : m_trees)
+            assert (tree.leafValues.size() == (size_t(m_numDimensions) << tree.splitFeatures.size()));
+
+        m_bias.assign(m_numDimensions, 0.0);
+        if (m_json.contains("scale_and_bias")) {
+            auto& scaleAndBias = m_json["scale_and_bias"];
+            m_scale = scaleAndBias[0].get<double>();
+            if (scaleAndBias[1].is_array())
+                m_bias = scaleAndBias[1].get<std::vector<double>>();
+            else
+                m_bias.assign(m_numDimensions, scaleAndBias[1].get<double>());
+            // A single bias is added to all dimensions
+            if (m_bias.size() == 1)
+                m_bias.assign(m_numDimensions, m_bias.front());
+            assert (static_cast<int32_t>(m_bias.size()) == m_numDimensions);
+        }
+    }
+
+    std::string GetLossFunction() {
+        auto& modelInfo = m_json["model_info"];
+        assert (modelInfo.contains("params") && "The CatBoost model doesn't have its training parameters");
+        // Some CatBoost versions store the parameters as a string that holds the JSON
+        auto params = modelInfo["params"].is_string() ? json::parse(modelInfo["params"].get<std::string>()) : modelInfo["params"];
+        return params["loss_function"]["type"].get<std::string>();
+    }
+
+    void SetLossFunction(const std::string& lossFunction) {
+        using mlir::decisionforest::PredictionTransformation;
+        if (lossFunction == "Logloss" || lossFunction == "CrossEntropy")
+            this->m_forest->SetPredictionTransformation(PredictionTransformation::kSigmoid);
+        // The class with the largest score also has the largest probability with one-vs-all losses
+        else if (lossFunction == "MultiClass" || lossFunction == "MultiClassOneVsAll")
+            this->m_forest->SetPredictionTransformation(PredictionTransformation::kSoftMax);
+        else if (lossFunction == "RMSE" || lossFunction == "MAE" || lossFunction == "Quantile" || lossFunction == "MAPE" ||
+                 lossFunction == "Huber" || lossFunction == "Expectile" || lossFunction == "Lq" || lossFunction == "QueryRMSE" ||
+                 lossFunction == "YetiRank" || lossFunction == "PairLogit")
+            this->m_forest->SetPredictionTransformation(PredictionTransformation::kIdentity);
+        else
+            assert (false && "Unsupported CatBoost loss function");
+    }
+
+    // NaNs go left at every split with ULE and right with OLE. Oblivious trees can't have the additional
+    // splits that would send the NaNs of some features the other way.
+    bool NaNsGoLeft() {
+        std::set<bool> nanDirections;
+        for (auto& tree : m_trees)
+            for (auto feature : tree.splitFeatures)
+                nanDirections.insert(m_floatFeatures.at(feature).nanGoesLeft);
+        assert (nanDirections.size() <= 1 && "All features need to have the same nan_value_treatment");
+        return nanDirections.empty() || *nanDirections.begin();
+    }
+
+    // Emit the tree for one dimension of a CatBoost tree. Nodes are created one level at a time so the
+    // index of each node is its position in the complete tree.
+    void EmitTree(const CatBoostTree& tree, int32_t dimension, double leafOffset) {
+        int32_t treeDepth = static_cast<int32_t>(tree.splitFeatures.size());
+        int32_t numPaddingLevels = m_depth - treeDepth;
+        for (int32_t level = 0; level < m_depth; ++level) {
+            // Padding levels repeat the first split of the tree (both children are the same anyway). 
+            // Trees without splits are padded with splits on the first feature.
+            int32_t split = level < numPaddingLevels ? treeDepth - 1 : m_depth - 1 - level;
+            auto feature = split < 0 ? m_floatFeatures.front().flatFeatureIndex : m_floatFeatures.at(tree.splitFeatures.at(split)).flatFeatureIndex;
+            auto border = split < 0 ? 0.0 : tree.borders.at(split);
+            for (int64_t i = 0; i < (int64_t(1) << level); ++i)
+                this->NewNode(border, feature);
+        }
+        for (int64_t leaf = 0; leaf < (int64_t(1) << m_depth); ++leaf) {
+            // The padding levels are the high bits of the position of the leaf
+            auto leafIndex = leaf & ((int64_t(1) << treeDepth) - 1);
+            this->NewNode(m_scale*tree.leafValues.at(leafIndex*m_numDimensions + dimension) + leafOffset, -1);
+        }
+        int64_t numInternalNodes = (int64_t(1) << m_depth) - 1;
+        for (int64_t node = 0; node < numInternalNodes; ++node) {
+            this->SetNodeLeftChild(node, 2*node + 1);
+            this->SetNodeRightChild(node, 2*node + 2);
+            this->SetNodeParent(2*node + 1, node);
+            this->SetNodeParent(2*node + 2, node);
+        }
+        this->SetNodeParent(0, -1);
+    }
+
+public:
+    CatBoostJSONParser(TreebeardContext& tbContext)
+        : ForestCreator(tbContext.serializer,
+                        tbContext.context,
+                        tbContext.options.batchSize,
+                        0.0,
+                        tbContext.options.statsProfileCSVPath,
+                        GetThresholdType(tbContext.options, tbContext.context),
+                        GetIntegerType(tbContext.options.featureIndexTypeWidth, tbContext.context),
+                        GetIntegerType(tbContext.options.nodeIndexTypeWidth, tbContext.context),
+                        GetReturnType(tbContext.options, tbContext.context),
+                        GetInputElementType(tbContext.options, tbContext.context))
+    {
+        ReadModelFile(tbContext.modelPath);
+    }
+
+    void ConstructForest() override {
+        if (m_numDimensions > 1)
+            this->SetNumberOfClasses(m_numDimensions);
+        SetLossFunction(GetLossFunction());
+
+        int32_t numFeatures = 0;
+        for (auto& feature : m_floatFeatures)
+            numFeatures = std::max(numFeatures, feature.flatFeatureIndex + 1);
+        for (int32_t i=0 ; i<numFeatures ; ++i)
+            this->AddFeature(std::to_string(i), "float");
+
+        this->SetPredicateType(NaNsGoLeft() ? mlir::arith::CmpFPredicate::ULE : mlir::arith::CmpFPredicate::OLE);
+        // The bias of each class is added to the leaves of the first tree of the class
+        if (m_numDimensions == 1)
+            this->SetInitialOffset(m_bias.front());
+
+        for (size_t i=0 ; i<m_trees.size() ; ++i) {
+            for (int32_t dimension=0 ; dimension<m_numDimensions ; ++dimension) {
+                this->NewTree();
+                this->SetTreeNumberOfFeatures(numFeatures);
+                double leafOffset = (m_numDimensions > 1 && i == 0) ? m_bias.at(dimension) : 0.0;
+                EmitTree(m_trees[i], dimension, leafOffset);
+                if (m_numDimensions > 1)
+                    this->SetTreeClassId(dimension);
+                this->EndTree();
+            }
+        }
+    }
+};
+
+inline std::shared_ptr<ForestCreator> ConstructCatBoostJSONParser(TreebeardContext& tbContext) {
+    return std::make_shared<CatBoostJSONParser>(tbContext);
+}
+
+} // namespace TreeBeard
+
+#endif // _CATBOOST_PARSER_H_
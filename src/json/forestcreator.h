@@ -4,12 +4,16 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
 #include "json.hpp"
 #include "DecisionForest.h"
 #include "TreeTilingUtils.h"
 #include "Dialect.h"
 #include "StatsUtils.h"
 #include "ModelSerializers.h"
+#include "Logger.h"
 
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Builders.h"
@@ -20,8 +24,12 @@
 #include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/APFloat.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "LIRLoweringHelpers.h"
+#include "TreebeardContext.h"
 
 using json = nlohmann::json;
 
@@ -34,6 +42,26 @@ using json = nlohmann::json;
 namespace TreeBeard
 {
 
+// There are no host types for the 16-bit floating point types. Models with 16-bit thresholds 
+// are parsed with these types as the threshold type and values are held as floats on the host.
+// Only the generated code stores them in 16 bits.
+struct Float16 {
+    float value = 0.0f;
+    Float16() { }
+    Float16(float val) : value(val) { }
+    operator float() const { return value; }
+};
+
+struct BFloat16 {
+    float value = 0.0f;
+    BFloat16() { }
+    BFloat16(float val) : value(val) { }
+    operator float() const { return value; }
+};
+
+inline void from_json(const json& j, Float16& val) { val.value = j.get<float>(); }
+inline void from_json(const json& j, BFloat16& val) { val.value = j.get<float>(); }
+
 template<typename T>
 mlir::Type GetMLIRType(const T& val, mlir::OpBuilder& builder) {
     assert (false);
@@ -65,6 +93,16 @@ inline mlir::Type GetMLIRType(const double& val, mlir::OpBuilder& builder) {
     return builder.getF64Type();
 }
 
+template<>
+inline mlir::Type GetMLIRType(const Float16& val, mlir::OpBuilder& builder) {
+    return builder.getF16Type();
+}
+
+template<>
+inline mlir::Type GetMLIRType(const BFloat16& val, mlir::OpBuilder& builder) {
+    return builder.getBF16Type();
+}
+
 template<typename T>
 mlir::Type GetMLIRType(const T& val, mlir::MLIRContext& context) {
     assert (false);
@@ -96,6 +134,16 @@ inline mlir::Type GetMLIRType(const double& val, mlir::MLIRContext& context) {
     return mlir::Float64Type::get(&context);
 }
 
+template<>
+inline mlir::Type GetMLIRType(const Float16& val, mlir::MLIRContext& context) {
+    return mlir::Float16Type::get(&context);
+}
+
+template<>
+inline mlir::Type GetMLIRType(const BFloat16& val, mlir::MLIRContext& context) {
+    return mlir::BFloat16Type::get(&context);
+}
+
 inline mlir::Type GetMLIRTypeFromString(const std::string& typestr, mlir::OpBuilder& builder)
 {
     if (typestr == "float")
@@ -153,6 +201,50 @@ protected:
     // Set left child of a node
     void SetNodeLeftChild(int64_t node, int64_t child) { m_currentTree->SetNodeLeftChild(node, child); }
     void SetPredicateType(mlir::arith::CmpFPredicate value) { m_cmpPredicate = value; }
+
+    int64_t GetMaxNumberOfNodesInATree() {
+        int64_t maxNumNodes = 0;
+        for (auto& tree : m_forest->GetTrees())
+            maxNumNodes = std::max(maxNumNodes, static_cast<int64_t>(tree->GetNodes().size()));
+        return maxNumNodes;
+    }
+
+    // Types of the forest for parsers that read the widths from the compiler options
+    static mlir::Type GetThresholdType(CompilerOptions& options, mlir::MLIRContext& context) {
+        if (options.thresholdTypeWidth == 16)
+            return options.thresholdTypeIsBFloat16 ? GetMLIRType(BFloat16(), context) : GetMLIRType(Float16(), context);
+        if (options.thresholdTypeWidth == 32)
+            return GetMLIRType(float(), context);
+        // Auto widths are parsed at full precision and narrowed once the forest has been analyzed
+        assert (options.thresholdTypeWidth == 64 || options.thresholdTypeWidth == CompilerOptions::kAutoTypeWidth);
+        return GetMLIRType(double(), context);
+    }
+
+    static mlir::Type GetIntegerType(int32_t width, mlir::MLIRContext& context) {
+        if (width == CompilerOptions::kAutoTypeWidth)
+            width = 32;
+        assert (width == 8 || width == 16 || width == 32 || width == 64);
+        return mlir::IntegerType::get(&context, width);
+    }
+
+    static mlir::Type GetReturnType(CompilerOptions& options, mlir::MLIRContext& context) {
+        if (!options.returnTypeFloatType)
+            return GetIntegerType(options.returnTypeWidth, context);
+        assert (options.returnTypeWidth == 32 || options.returnTypeWidth == 64);
+        return options.returnTypeWidth == 32 ? GetMLIRType(float(), context) : GetMLIRType(double(), context);
+    }
+
+    static mlir::Type GetInputElementType(CompilerOptions& options, mlir::MLIRContext& context) {
+        assert (options.inputElementTypeWidth == 32 || options.inputElementTypeWidth == 64);
+        return options.inputElementTypeWidth == 32 ? GetMLIRType(float(), context) : GetMLIRType(double(), context);
+    }
+
+    static bool IsExactlyRepresentable(double value, const llvm::fltSemantics& semantics) {
+        llvm::APFloat apValue(value);
+        bool losesInfo = false;
+        auto status = apValue.convert(semantics, llvm::APFloat::rmNearestTiesToEven, &losesInfo);
+        return !losesInfo && (status == llvm::APFloat::opOK);
+    }
     mlir::Type GetInputRowType() {
         const auto& features = m_forest->GetFeatures();
         int64_t shape[] = { static_cast<int64_t>(features.size()) };
@@ -211,7 +303,7 @@ protected:
 
         auto forestType = mlir::decisionforest::TreeEnsembleType::get(m_returnType,
                                                                       m_forest->NumTrees(), GetInputRowType(),
-                                                                      mlir::decisionforest::ReductionType::kAdd, treeType);
+                                                                      m_forest->GetReductionType(), treeType);
         return forestType;
     }
 public:
@@ -277,6 +369,122 @@ public:
     }
 
     mlir::decisionforest::Schedule* GetSchedule() { return m_schedule; }
+
+    // A threshold that is rounded when it is stored in a 16-bit type can send rows down a 
+    // different path through the tree. If fallBackTo32Bits is set, the thresholds of the features
+    // that have such thresholds are replaced by bin indices (small integers that are exact in 16 
+    // bits) and these features are binned at the precision of the inputs before the trees are 
+    // walked. The thresholds of the other features stay in 16 bits. Otherwise, the compilation 
+    // fails. The thresholds of quantized models are stored as integer bin indices and are exact.
+    // Returns the number of inexact thresholds.
+    int64_t CheckHalfPrecisionThresholds(bool thresholdsWillBeQuantized, bool fallBackTo32Bits) {
+        auto thresholdType = m_thresholdType.cast<mlir::FloatType>();
+        if (thresholdType.getWidth() != 16 || thresholdsWillBeQuantized)
+            return 0;
+        auto& semantics = thresholdType.getFloatSemantics();
+
+        std::map<int32_t, std::set<double>> inexactFeatureThresholds;
+        int64_t numInexactThresholds = 0;
+        for (auto& tree : m_forest->GetTrees()) {
+            for (auto& node : tree->GetNodes()) {
+                if (node.IsLeaf() || IsExactlyRepresentable(node.threshold, semantics))
+                    continue;
+                ++numInexactThresholds;
+                inexactFeatureThresholds[node.featureIndex];
+            }
+        }
+        if (numInexactThresholds == 0)
+            return 0;
+
+        std::vector<int32_t> binnedFeatures;
+        for (auto& tree : m_forest->GetTrees()) {
+            for (auto& node : tree->GetNodes()) {
+                auto featureThresholdsIter = inexactFeatureThresholds.find(node.featureIndex);
+                if (!node.IsLeaf() && featureThresholdsIter != inexactFeatureThresholds.end())
+                    featureThresholdsIter->second.insert(node.threshold);
+            }
+        }
+        std::string message = std::to_string(numInexactThresholds) + " thresholds of features";
+        bool binIndicesAreExact = true;
+        for (auto& featureThresholds : inexactFeatureThresholds) {
+            binnedFeatures.push_back(featureThresholds.first);
+            message += " " + std::to_string(featureThresholds.first);
+            // The largest bin index of a feature is the number of its distinct thresholds
+            binIndicesAreExact = binIndicesAreExact && IsExactlyRepresentable(static_cast<double>(featureThresholds.second.size()), semantics);
+        }
+        message += " are not exactly representable with 16 bits";
+        if (!fallBackTo32Bits) {
+            TreeBeard::Logging::Log(message);
+            llvm::report_fatal_error(llvm::Twine(message));
+        }
+
+        if (binIndicesAreExact) {
+            TreeBeard::Logging::Log(message + ". Binning these features.");
+            mlir::decisionforest::QuantizeFeatureThresholds(*m_forest, binnedFeatures);
+        }
+        else {
+            // Some feature has too many distinct thresholds to number its bins in 16 bits
+            TreeBeard::Logging::Log(message + ". Using 32-bit thresholds.");
+            m_thresholdType = m_builder.getF32Type();
+        }
+        return numInexactThresholds;
+    }
+
+    // The narrowest of the 8, 16, 32 and 64-bit signed integer types that can hold maxValue
+    static int32_t GetNarrowestIntegerWidth(int64_t maxValue) {
+        for (int32_t width : { 8, 16, 32 }) {
+            if (maxValue < (int64_t(1) << (width-1)))
+                return width;
+        }
+        return 64;
+    }
+
+    // The Select* methods below are used when a type width is left for the compiler to pick. Each 
+    // one chooses the narrowest type that is safe for the constructed forest, uses it for the model 
+    // and returns its width.
+    int32_t SelectFeatureIndexType() {
+        int64_t maxFeatureIndex = static_cast<int64_t>(m_forest->GetFeatures().size()) - 1;
+        for (auto& tree : m_forest->GetTrees()) {
+            for (auto& node : tree->GetNodes()) {
+                if (!node.IsLeaf())
+                    maxFeatureIndex = std::max(maxFeatureIndex, static_cast<int64_t>(node.featureIndex));
+            }
+        }
+        auto width = GetNarrowestIntegerWidth(std::max(maxFeatureIndex, int64_t(0)));
+        m_featureIndexType = m_builder.getIntegerType(width);
+        return width;
+    }
+
+    int32_t SelectNodeIndexType() {
+        auto width = GetNarrowestIntegerWidth(GetMaxNumberOfNodesInATree());
+        m_nodeIndexType = m_builder.getIntegerType(width);
+        return width;
+    }
+
+    // Child indices index the tiles and the leaves of a tree in the sparse representation. Every tile 
+    // contains at least one node of the tree and a leaf tile is expanded into at most tileSize+1 entries 
+    // of the leaves array, so (tileSize+2) times the number of nodes bounds the indices.
+    int32_t SelectChildIndexBitWidth(int32_t tileSize) {
+        m_childIndexBitWidth = GetNarrowestIntegerWidth(GetMaxNumberOfNodesInATree() * (tileSize + 2));
+        return m_childIndexBitWidth;
+    }
+
+    // The thresholds are extended to the input element type before they are compared, so f32 thresholds
+    // give exactly the same comparisons as f64 thresholds if every threshold is exactly representable in 
+    // f32. The leaves are stored in the same type and must be exact too so that predictions don't change.
+    int32_t SelectThresholdType() {
+        for (auto& tree : m_forest->GetTrees()) {
+            for (auto& node : tree->GetNodes()) {
+                if (!IsExactlyRepresentable(node.threshold, llvm::APFloat::IEEEsingle())) {
+                    m_thresholdType = m_builder.getF64Type();
+                    return 64;
+                }
+            }
+        }
+        m_thresholdType = m_builder.getF32Type();
+        return 32;
+    }
+
     const std::string& GetModelGlobalsJSONFilePath() { return m_serializer->GetFilePath(); }
 
     virtual void ConstructForest() = 0;
@@ -293,6 +501,7 @@ public:
         AddConstIntegerGetFunction("GetRowSize", m_forest->GetFeatures().size());
         AddConstIntegerGetFunction("GetInputTypeBitWidth", m_inputElementType.getIntOrFloatBitWidth());
         AddConstIntegerGetFunction("GetReturnTypeBitWidth", m_returnType.getIntOrFloatBitWidth());
+        AddConstIntegerGetFunction("GetNumberOfClasses", m_forest->GetNumClasses());
 
         mlir::func::FuncOp function(GetFunctionPrototype());
         if (!function)
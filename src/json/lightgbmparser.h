@@ -0,0 +1,371 @@
+#ifndef _LIGHTGBM_PARSER_H_
+#define _LIGHTGBM_PARSER_H_
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include "forestcreator.h"
+#include "TreebeardContext.h"
+
+namespace TreeBeard
+{
+
+// Reads models saved by LightGBM's Booster.save_model (the text model format).
+//
+// A LightGBM split sends a row left if feature <= threshold. The decision_type of a split also says
+// whether it is categorical, which way missing values go (the default-left bit) and what counts as
+// missing (nothing, zeros or NaNs). All splits of a Treebeard forest are compared with the same
+// predicate, so every LightGBM split is rewritten into a chain of numerical splits that send each
+// range of feature values to the child LightGBM sends it to (see EmitSplit). NaNs take the same
+// direction at every split of the forest (left with ULE and right with OLE). The predicate that
+// matches most splits is used and a split that sends NaNs the other way gets an additional split
+// that separates the NaNs. Since the NaN side of such a split knows the feature is NaN, the copy of
+// the subtree it leads to skips all splits on that feature.
+class LightGBMTextParser : public ForestCreator
+{
+    // Masks of the decision_type of a split (see Tree::Decision in LightGBM's tree.h)
+    static constexpr int32_t kCategoricalMask = 1;
+    static constexpr int32_t kDefaultLeftMask = 2;
+    enum MissingType { kMissingNone = 0, kMissingZero = 1, kMissingNaN = 2 };
+    // Values in [-kZeroThreshold, kZeroThreshold] are zeros for splits with the zero missing type
+    static constexpr float kZeroThreshold = 1e-35f;
+
+    struct LightGBMTree {
+        int32_t numLeaves = 0;
+        std::vector<int32_t> splitFeatures;
+        std::vector<double> thresholds;
+        std::vector<int32_t> decisionTypes;
+        // Children >= 0 are splits and negative children are leaves (~child is the leaf index)
+        std::vector<int32_t> leftChildren;
+        std::vector<int32_t> rightChildren;
+        std::vector<double> leafValues;
+        std::vector<int32_t> categoryBoundaries;
+        std::vector<uint32_t> categoryThresholds;
+    };
+
+    // The (non-NaN) feature values of a split are split into ranges that all go to the same child.
+    // Range i is (upperBounds[i-1], upperBounds[i]] and the last upper bound is +inf.
+    struct SplitRoutes {
+        std::vector<double> upperBounds;
+        std::vector<bool> goesLeft;
+        bool nanGoesLeft;
+    };
+
+    std::map<std::string, std::string> m_header;
+    std::vector<LightGBMTree> m_trees;
+    bool m_nanGoesLeft = false;
+    // Binary models compute sigmoid(scale*score). The scale is folded into the leaves.
+    double m_leafScale = 1.0;
+    bool m_floatInputs = true;
+
+    template<typename T>
+    static std::vector<T> ParseValues(const std::string& valuesString) {
+        std::vector<T> values;
+        std::stringstream valueStream(valuesString);
+        std::string value;
+        while (valueStream >> value)
+            values.push_back(static_cast<T>(std::stod(value)));
+        return values;
+    }
+
+    static std::vector<std::string> SplitWords(const std::string& str) {
+        std::vector<std::string> words;
+        std::stringstream wordStream(str);
+        std::string word;
+        while (wordStream >> word)
+            words.push_back(word);
+        return words;
+    }
+
+    void ReadModelFile(const std::string& modelPath) {
+        std::ifstream fin(modelPath);
+        assert (fin && "Could not open LightGBM model file");
+        std::string line;
+        std::map<std::string, std::string> *section = &m_header;
+        std::vector<std::map<std::string, std::string>> treeSections;
+        while (std::getline(fin, line)) {
+            if (line == "end of trees")
+                break;
+            if (line.rfind("Tree=", 0) == 0) {
+                treeSections.push_back({});
+                section = &treeSections.back();
+                continue;
+            }
+            auto separator = line.find('=');
+            if (separator == std::string::npos)
+                (*section)[line] = "";
+            else
+                (*section)[line.substr(0, separator)] = line.substr(separator+1);
+        }
+        assert (m_header.count("tree") && "Not a LightGBM text model");
+        for (auto& treeSection : treeSections)
+            m_trees.push_back(ReadTree(treeSection));
+    }
+
+    static LightGBMTree ReadTree(std::map<std::string, std::string>& treeSection) {
+        assert ((!treeSection.count("is_linear") || treeSection["is_linear"] == "0") && "Linear trees are not supported");
+        LightGBMTree tree;
+        tree.numLeaves = std::stoi(treeSection["num_leaves"]);
+        // The saved leaf values are already multiplied by the shrinkage (learning rate) of the tree
+        tree.leafValues = ParseValues<double>(treeSection["leaf_value"]);
+        assert (static_cast<int32_t>(tree.leafValues.size()) == tree.numLeaves);
+        if (tree.numLeaves == 1)
+            return tree;
+        tree.splitFeatures = ParseValues<int32_t>(treeSection["split_feature"]);
+        tree.thresholds = ParseValues<double>(treeSection["threshold"]);
+        tree.decisionTypes = ParseValues<int32_t>(treeSection["decision_type"]);
+        tree.leftChildren = ParseValues<int32_t>(treeSection["left_child"]);
+        tree.rightChildren = ParseValues<int32_t>(treeSection["right_child"]);
+        if (std::stoi(treeSection["num_cat"]) > 0) {
+            tree.categoryBoundaries = ParseValues<int32_t>(treeSection["cat_boundaries"]);
+            tree.categoryThresholds = ParseValues<uint32_t>(treeSection["cat_threshold"]);
+        }
+        auto numSplits = static_cast<size_t>(tree.numLeaves - 1);
+        assert (tree.splitFeatures.size() == numSplits && tree.thresholds.size() == numSplits &&
+                tree.decisionTypes.size() == numSplits && tree.leftChildren.size() == numSplits &&
+                tree.rightChildren.size() == numSplits);
+        return tree;
+    }
+
+    static bool IsCategorical(const LightGBMTree& tree, int32_t split) { return tree.decisionTypes.at(split) & kCategoricalMask; }
+    static bool IsDefaultLeft(const LightGBMTree& tree, int32_t split) { return tree.decisionTypes.at(split) & kDefaultLeftMask; }
+    static int32_t GetMissingType(const LightGBMTree& tree, int32_t split) { return (tree.decisionTypes.at(split) >> 2) & 3; }
+
+    // Where LightGBM sends a row whose feature value is x (not NaN)
+    static bool GoesLeft(const LightGBMTree& tree, int32_t split, double x) {
+        if (IsCategorical(tree, split)) {
+            auto categoriesIndex = static_cast<int32_t>(tree.thresholds.at(split));
+            auto begin = tree.categoryBoundaries.at(categoriesIndex);
+            int64_t numCategories = 32 * (tree.categoryBoundaries.at(categoriesIndex+1) - begin);
+            // Values are truncated to the category, so only values <= -1 are negative categories
+            if (x <= -1 || x >= numCategories)
+                return false;
+            auto category = static_cast<int64_t>(x);
+            return (tree.categoryThresholds.at(begin + category/32) >> (category%32)) & 1;
+        }
+        if (GetMissingType(tree, split) == kMissingZero && x >= -kZeroThreshold && x <= kZeroThreshold)
+            return IsDefaultLeft(tree, split);
+        return x <= tree.thresholds.at(split);
+    }
+
+    static bool NaNGoesLeft(const LightGBMTree& tree, int32_t split) {
+        // LightGBM's CategoricalDecision sends NaNs right whatever the missing type, even when the
+        // bitset holds category 0
+        if (IsCategorical(tree, split))
+            return false;
+        // NaNs are zeros unless the missing type is NaN
+        if (GetMissingType(tree, split) == kMissingNone)
+            return 0.0 <= tree.thresholds.at(split);
+        return IsDefaultLeft(tree, split);
+    }
+
+    SplitRoutes GetSplitRoutes(const LightGBMTree& tree, int32_t split) const {
+        // The values at which the child a value goes to can change. The boundaries are exact in 32 bits so
+        // that they can be stored in the threshold type.
+        const float negativeInfinity = -std::numeric_limits<float>::infinity();
+        std::vector<double> boundaries;
+        if (IsCategorical(tree, split)) {
+            auto categoriesIndex = static_cast<int32_t>(tree.thresholds.at(split));
+            int64_t numCategories = 32 * (tree.categoryBoundaries.at(categoriesIndex+1) - tree.categoryBoundaries.at(categoriesIndex));
+            boundaries.push_back(-1.0);
+            // Category k is the range [k, k+1) (category 0 is (-1, 1))
+            for (int64_t category=0 ; category<numCategories ; ++category)
+                boundaries.push_back(std::nextafter(static_cast<float>(category+1), negativeInfinity));
+        }
+        else {
+            auto threshold = tree.thresholds.at(split);
+            // LightGBM compares with a double threshold. For float inputs, "x <= threshold" is the same as comparing
+            // with the largest float that is not larger than the threshold, which doesn't change when the
+            // threshold is narrowed to a float.
+            if (m_floatInputs) {
+                auto floatThreshold = static_cast<float>(threshold);
+                if (floatThreshold > threshold)
+                    floatThreshold = std::nextafter(floatThreshold, negativeInfinity);
+                threshold = floatThreshold;
+            }
+            boundaries.push_back(threshold);
+            if (GetMissingType(tree, split) == kMissingZero) {
+                boundaries.push_back(std::nextafter(-kZeroThreshold, negativeInfinity));
+                boundaries.push_back(kZeroThreshold);
+            }
+        }
+        boundaries.push_back(std::numeric_limits<double>::infinity());
+        std::sort(boundaries.begin(), boundaries.end());
+        boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+        // Every range goes the same way as its upper bound. Adjacent ranges that go the same way are merged.
+        SplitRoutes routes;
+        for (auto boundary : boundaries) {
+            auto goesLeft = GoesLeft(tree, split, boundary);
+            if (!routes.goesLeft.empty() && routes.goesLeft.back() == goesLeft)
+                routes.upperBounds.back() = boundary;
+            else {
+                routes.upperBounds.push_back(boundary);
+                routes.goesLeft.push_back(goesLeft);
+            }
+        }
+        routes.nanGoesLeft = NaNGoesLeft(tree, split);
+        return routes;
+    }
+
+    void SetChildren(int64_t node, int64_t leftChild, int64_t rightChild) {
+        this->SetNodeLeftChild(node, leftChild);
+        this->SetNodeParent(leftChild, node);
+        this->SetNodeRightChild(node, rightChild);
+        this->SetNodeParent(rightChild, node);
+    }
+
+    // Emits the subtree rooted at a LightGBM split or leaf. nanFeatures are the features that are known to
+    // be NaN on the path to the subtree.
+    int64_t EmitSubtree(const LightGBMTree& tree, int32_t child, std::set<int32_t>& nanFeatures) {
+        if (child < 0)
+            return this->NewNode(tree.leafValues.at(~child) * m_leafScale, -1);
+        auto feature = tree.splitFeatures.at(child);
+        if (nanFeatures.count(feature)) {
+            auto nanChild = NaNGoesLeft(tree, child) ? tree.leftChildren.at(child) : tree.rightChildren.at(child);
+            return EmitSubtree(tree, nanChild, nanFeatures);
+        }
+        auto routes = GetSplitRoutes(tree, child);
+        return EmitSplit(tree, child, routes, 0, nanFeatures);
+    }
+
+    // Emits the chain of splits for the ranges of a LightGBM split starting at rangeIndex. A split
+    // "x <= upperBounds[i]" sends range i to its child and the larger values to the rest of the chain.
+    int64_t EmitSplit(const LightGBMTree& tree, int32_t split, const SplitRoutes& routes, size_t rangeIndex, std::set<int32_t>& nanFeatures) {
+        if (rangeIndex == routes.upperBounds.size() - 1)
+            return EmitRange(tree, split, routes, rangeIndex, nanFeatures);
+        // Nodes are created before their children so that the root is the first node of the tree
+        auto node = this->NewNode(routes.upperBounds.at(rangeIndex), tree.splitFeatures.at(split));
+        auto rangeSubtree = EmitRange(tree, split, routes, rangeIndex, nanFeatures);
+        auto largerValuesSubtree = EmitSplit(tree, split, routes, rangeIndex+1, nanFeatures);
+        SetChildren(node, rangeSubtree, largerValuesSubtree);
+        return node;
+    }
+
+    int64_t EmitRange(const LightGBMTree& tree, int32_t split, const SplitRoutes& routes, size_t rangeIndex, std::set<int32_t>& nanFeatures) {
+        auto childOf = [&](bool goesLeft) { return goesLeft ? tree.leftChildren.at(split) : tree.rightChildren.at(split); };
+        auto rangeChild = childOf(routes.goesLeft.at(rangeIndex));
+        // NaNs end up in the first range of the chain with ULE and in the last range with OLE
+        bool nanReachesRange = m_nanGoesLeft ? rangeIndex == 0 : rangeIndex == routes.upperBounds.size() - 1;
+        if (!nanReachesRange || routes.goesLeft.at(rangeIndex) == routes.nanGoesLeft)
+            return EmitSubtree(tree, rangeChild, nanFeatures);
+
+        // With OLE, "x <= +inf" is only false for NaNs. With ULE, "x <= -inf" is only true for NaNs and -inf,
+        // so -inf is treated like a NaN at these splits.
+        auto feature = tree.splitFeatures.at(split);
+        auto infinity = std::numeric_limits<double>::infinity();
+        auto node = this->NewNode(m_nanGoesLeft ? -infinity : infinity, feature);
+        auto rangeSubtree = EmitSubtree(tree, rangeChild, nanFeatures);
+        nanFeatures.insert(feature);
+        auto nanSubtree = EmitSubtree(tree, childOf(routes.nanGoesLeft), nanFeatures);
+        nanFeatures.erase(feature);
+        if (m_nanGoesLeft)
+            SetChildren(node, nanSubtree, rangeSubtree);
+        else
+            SetChildren(node, rangeSubtree, nanSubtree);
+        return node;
+    }
+
+    // NaNs go left at every split with ULE and right with OLE. Pick the predicate that needs the fewest
+    // additional splits to send NaNs the right way.
+    void SelectNaNDirection() {
+        int64_t numULESeparations = 0, numOLESeparations = 0;
+        for (auto& tree : m_trees) {
+            for (int32_t split=0 ; split<tree.numLeaves-1 ; ++split) {
+                auto routes = GetSplitRoutes(tree, split);
+                if (routes.goesLeft.front() != routes.nanGoesLeft)
+                    ++numULESeparations;
+                if (routes.goesLeft.back() != routes.nanGoesLeft)
+                    ++numOLESeparations;
+            }
+        }
+        m_nanGoesLeft = numULESeparations < numOLESeparations;
+    }
+
+    void SetObjective(const std::string& objectiveString) {
+        using mlir::decisionforest::PredictionTransformation;
+        auto objectiveWords = SplitWords(objectiveString);
+        assert (!objectiveWords.empty());
+        auto& objective = objectiveWords.front();
+        for (auto& word : objectiveWords) {
+            assert (word != "sqrt" && "Regression with sqrt transformed labels is not supported");
+            if (objective == "binary" && word.rfind("sigmoid:", 0) == 0)
+                m_leafScale = std::stod(word.substr(std::string("sigmoid:").size()));
+        }
+        if (objective == "binary" || objective == "cross_entropy" || objective == "xentropy")
+            this->m_forest->SetPredictionTransformation(PredictionTransformation::kSigmoid);
+        // The class with the largest score also has the largest probability with one-vs-all objectives
+        else if (objective == "multiclass" || objective == "softmax" || objective == "multiclassova" || objective == "ova")
+            this->m_forest->SetPredictionTransformation(PredictionTransformation::kSoftMax);
+        else if (objective == "regression" || objective == "regression_l1" || objective == "huber" || objective == "fair" ||
+                 objective == "quantile" || objective == "mape" || objective == "lambdarank" || objective == "rank_xendcg")
+            this->m_forest->SetPredictionTransformation(PredictionTransformation::kIdentity);
+        else
+            assert (false && "Unsupported LightGBM objective");
+    }
+
+public:
+    LightGBMTextParser(TreebeardContext& tbContext)
+        : ForestCreator(tbContext.serializer,
+                        tbContext.context,
+                        tbContext.options.batchSize,
+                        0.0,
+                        tbContext.options.statsProfileCSVPath,
+                        GetThresholdType(tbContext.options, tbContext.context),
+                        GetIntegerType(tbContext.options.featureIndexTypeWidth, tbContext.context),
+                        GetIntegerType(tbContext.options.nodeIndexTypeWidth, tbContext.context),
+                        GetReturnType(tbContext.options, tbContext.context),
+                        GetInputElementType(tbContext.options, tbContext.context))
+    {
+        m_floatInputs = tbContext.options.inputElementTypeWidth == 32;
+        ReadModelFile(tbContext.modelPath);
+    }
+
+    void ConstructForest() override {
+        auto numClasses = std::stoi(m_header["num_class"]);
+        auto numTreesPerIteration = std::stoi(m_header["num_tree_per_iteration"]);
+        // Trees are stored one iteration at a time with one tree per class in each iteration
+        if (numClasses > 1) {
+            assert (numTreesPerIteration == numClasses);
+            this->SetNumberOfClasses(numClasses);
+        }
+        SetObjective(m_header["objective"]);
+        // Random forests (the rf boosting type) average the trees
+        if (m_header.count("average_output"))
+            this->SetReductionType(mlir::decisionforest::ReductionType::kAverage);
+
+        auto numFeatures = std::stoi(m_header["max_feature_idx"]) + 1;
+        auto featureNames = SplitWords(m_header["feature_names"]);
+        for (int32_t i=0 ; i<numFeatures ; ++i)
+            this->AddFeature(i < static_cast<int32_t>(featureNames.size()) ? featureNames[i] : std::to_string(i), "float");
+
+        SelectNaNDirection();
+        this->SetPredicateType(m_nanGoesLeft ? mlir::arith::CmpFPredicate::ULE : mlir::arith::CmpFPredicate::OLE);
+
+        for (size_t i=0 ; i<m_trees.size() ; ++i) {
+            this->NewTree();
+            this->SetTreeNumberOfFeatures(numFeatures);
+            std::set<int32_t> nanFeatures;
+            // A tree with a single leaf has no splits. Its leaf is leaf ~(-1) = 0.
+            auto root = EmitSubtree(m_trees[i], m_trees[i].numLeaves == 1 ? -1 : 0, nanFeatures);
+            this->SetNodeParent(root, -1);
+            if (numClasses > 1)
+                this->SetTreeClassId(i % numTreesPerIteration);
+            this->EndTree();
+        }
+    }
+};
+
+inline std::shared_ptr<ForestCreator> ConstructLightGBMTextParser(TreebeardContext& tbContext) {
+    return std::make_shared<LightGBMTextParser>(tbContext);
+}
+
+} // namespace TreeBeard
+
+#endif // _LIGHTGBM_PARSER_H_
@@ -154,7 +154,7 @@ protected:
 
         auto forestType = mlir::decisionforest::TreeEnsembleType::get(GetMLIRType(ReturnType(), m_builder),
                                                                       m_forest->NumTrees(), GetInputRowType(), 
-                                                                      mlir::decisionforest::ReductionType::kAdd, treeType);
+                                                                      m_forest->GetReductionType(), treeType);
         return forestType;
     }
 public:
@@ -12,6 +12,9 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <map>
+#include <set>
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include <fstream>
@@ -44,6 +47,8 @@ namespace TreeBeard
     const int64_t *targetClassIds=nullptr;
     const float *targetWeights=nullptr;
     int64_t numWeights=0;
+    // SUM or AVERAGE aggregation of the tree predictions
+    mlir::decisionforest::ReductionType reductionType=mlir::decisionforest::ReductionType::kAdd;
 
     static struct OnnxModelParseResult parseONNXFile(const std::string &modelPath) {
         std::ifstream input(modelPath, std::ios::ate | std::ios::binary);
@@ -91,9 +96,14 @@ namespace TreeBeard
         for (int i = 0; i < numberOfAttributes; i++) {
         const auto &attribute = node.attribute(i);
         if (attribute.name() == "base_values") {
-            assert(attribute.floats_size() == 1 &&
+            // Classifiers have a base value per class
+            assert(attribute.floats_size() >= 1 &&
+                std::all_of(attribute.floats().begin(), attribute.floats().end(), [&](float v) { return v == attribute.floats(0); }) &&
                 "Only one base value is supported");
             baseValue = attribute.floats().data()[0];
+        } else if (attribute.name() == "aggregate_function") {
+            assert((attribute.s() == "SUM" || attribute.s() == "AVERAGE") && "Only SUM and AVERAGE aggregation is supported");
+            reductionType = attribute.s() == "AVERAGE" ? mlir::decisionforest::ReductionType::kAverage : mlir::decisionforest::ReductionType::kAdd;
         } else if (attribute.name() == "post_transform") {
             if (attribute.s() == "NONE") {
             predTransform =
@@ -153,17 +163,22 @@ namespace TreeBeard
             treeIds = attribute.ints().data();
         } else if (attribute.name() == "nodes_values") {
             thresholds = attribute.floats().data();
-        } else if (attribute.name() == "target_ids") {
+        } else if (attribute.name() == "target_ids" || attribute.name() == "class_ids") {
+            // TreeEnsembleClassifier calls the leaf weights class_* instead of target_*
             targetClassIds = attribute.ints().data();
-        } else if (attribute.name() == "target_nodeids") {
+        } else if (attribute.name() == "target_nodeids" || attribute.name() == "class_nodeids") {
             targetClassNodeId = attribute.ints().data();
-        } else if (attribute.name() == "target_treeids") {
+        } else if (attribute.name() == "target_treeids" || attribute.name() == "class_treeids") {
             targetClassTreeId = attribute.ints().data();
-        } else if (attribute.name() == "target_weights") {
+        } else if (attribute.name() == "target_weights" || attribute.name() == "class_weights") {
             targetWeights = attribute.floats().data();
             numWeights = attribute.floats_size();
         } else if (attribute.name() == "n_targets") {
             numberOfClasses = isEnsembleClassifier ? attribute.i() : 0;
+        } else if (attribute.name() == "classlabels_int64s") {
+            numberOfClasses = attribute.ints_size();
+        } else if (attribute.name() == "classlabels_strings") {
+            numberOfClasses = attribute.strings_size();
         } else {
             std::cout << "Unknown attribute : " << attribute.name() << std::endl;
         }
@@ -197,6 +212,8 @@ namespace TreeBeard
     struct _ONNXTreeNode {
         int64_t featureId;
         ThresholdType threshold;
+        // Weight of every class of a leaf of a classifier
+        std::map<int64_t, ThresholdType> classWeights;
         std::shared_ptr<struct _ONNXTreeNode> leftChild = nullptr;
         std::shared_ptr<struct _ONNXTreeNode> rightChild = nullptr;
     };
@@ -210,9 +227,15 @@ namespace TreeBeard
         private:
             std::vector<std::shared_ptr<ONNXTreeNode<ValueType>>> _trees;
             std::unordered_map<int64_t, std::set<int64_t>> _treeToClassIdMap;
-            bool _isClassifier;
+            bool _isClassifier = false;
             std::vector<int64_t> _classIds;
             int32_t numberOfFeatures = -1;
+            // Random forest classifiers (from sklearn for example) store the class probabilities in every leaf
+            // instead of building a tree per class
+            bool _hasClassDistributionLeaves = false;
+            // If all leaves of such a forest predict one class with the same weight, the prediction is the
+            // class most trees vote for
+            bool _isVotingForest = false;
 
             
             void GatherForestInformationFromParseResult(const OnnxModelParseResult& parsedModel)
@@ -268,9 +291,6 @@ namespace TreeBeard
                 this->m_forest->SetPredictionTransformation(parsedModel.predTransform);
                 this->SetPredicateType(parsedModel.nodeMode);
 
-                // #TODOSampath - Revisit this hardcoding.
-                this->SetReductionType(mlir::decisionforest::ReductionType::kAdd);
-
                 int64_t currTreeId = -1;
                 for (int64_t i = 0; i < parsedModel.numNodes; i++) {
                     if (currTreeId == -1 || parsedModel.treeIds[i] != currTreeId) {
@@ -281,7 +301,6 @@ namespace TreeBeard
 
                 // ONNX uses weights instead of threshould of leaves to compute final prediction. Treebeard uses leaf threshold value.
                 // setting threshld value of leaves to weights to compute final prediction.
-                // ONNX also uses different class IDs for each leaf node which treebeard currently doesn't support. We are just storing the data for now.
                 for (int64_t i = 0; i < parsedModel.numWeights; i++) {
                     ONNXTreeKey key = {parsedModel.targetClassTreeId[i], parsedModel.targetClassNodeId[i]};
                     auto node = nodeMap.find(key);
@@ -289,27 +308,66 @@ namespace TreeBeard
                     if (node != nodeMap.end()) {
                         _treeToClassIdMap[parsedModel.targetClassTreeId[i]].insert(parsedModel.targetClassIds[i]);
                         node->second->threshold = parsedModel.targetWeights[i];
+                        node->second->classWeights[parsedModel.targetClassIds[i]] += parsedModel.targetWeights[i];
                     }
                     else {
                         assert(false && "Key not found");
                     }
                 }
 
+                for (auto& treeClassIds : _treeToClassIdMap)
+                    if (_isClassifier && treeClassIds.second.size() > 1)
+                        _hasClassDistributionLeaves = true;
+                if (_hasClassDistributionLeaves) {
+                    // Every leaf of a fully grown random forest has a single class with the same weight. The 
+                    // sum of the weights of a class is then proportional to the number of trees that vote for it.
+                    std::set<ValueType> leafWeights;
+                    _isVotingForest = true;
+                    for (auto& keyAndNode : nodeMap) {
+                        auto& node = keyAndNode.second;
+                        if (node->leftChild || node->rightChild)
+                            continue;
+                        int32_t numClassesWithWeight = 0;
+                        for (auto& classWeight : node->classWeights) {
+                            if (classWeight.second == 0)
+                                continue;
+                            ++numClassesWithWeight;
+                            leafWeights.insert(classWeight.second);
+                            node->threshold = classWeight.first;
+                        }
+                        _isVotingForest = _isVotingForest && numClassesWithWeight == 1;
+                    }
+                    _isVotingForest = _isVotingForest && leafWeights.size() == 1 && parsedModel.baseValue == 0;
+                }
+
+                if (_isVotingForest)
+                    this->SetReductionType(mlir::decisionforest::ReductionType::kVoting);
+                else
+                    this->SetReductionType(parsedModel.reductionType);
+
                 for (int32_t featureId = 0; featureId < this->numberOfFeatures; featureId++) {
                     this->AddFeature(std::to_string(featureId), sizeof(ValueType) == sizeof(double) ? "double" : "float");
                 }
             }
 
-            int64_t constructSingleTree(const std::shared_ptr<ONNXTreeNode<ValueType>>& parent)
+            // The leaves of the tree constructed for a class (classId != -1) of a forest with class distribution 
+            // leaves predict the weight of that class
+            int64_t constructSingleTree(const std::shared_ptr<ONNXTreeNode<ValueType>>& parent, int64_t classId = -1)
             {
                 if (parent) {
-                    auto rootIndex = this->NewNode(parent->threshold, parent->featureId);
-                    auto leftChildIndex = constructSingleTree(parent->leftChild);
+                    auto threshold = parent->threshold;
+                    bool isLeaf = !parent->leftChild && !parent->rightChild;
+                    if (isLeaf && classId != -1) {
+                        auto classWeight = parent->classWeights.find(classId);
+                        threshold = classWeight == parent->classWeights.end() ? 0 : classWeight->second;
+                    }
+                    auto rootIndex = this->NewNode(threshold, parent->featureId);
+                    auto leftChildIndex = constructSingleTree(parent->leftChild, classId);
                     if (leftChildIndex != -1) {
                         this->SetNodeLeftChild(rootIndex, leftChildIndex);
                         this->SetNodeParent(leftChildIndex, rootIndex);
                     }
-                    auto rightChildIndex = constructSingleTree(parent->rightChild);
+                    auto rightChildIndex = constructSingleTree(parent->rightChild, classId);
                     if (rightChildIndex != -1) {
                         this->SetNodeRightChild(rootIndex, rightChildIndex);
                         this->SetNodeParent(rightChildIndex, rootIndex);
@@ -343,6 +401,22 @@ namespace TreeBeard
 
             void ConstructForest() override
             {
+                // Forests with class distribution leaves are split into a tree per class that predicts the 
+                // weight of the class. The class weights are then summed (or averaged) like those of a 
+                // forest with a tree per class.
+                if (_hasClassDistributionLeaves && !_isVotingForest) {
+                    for (int32_t classId = 0; classId < this->m_forest->GetNumClasses(); classId++) {
+                        for (const auto& tree : _trees) {
+                            this->NewTree();
+                            auto rootIndex = constructSingleTree(tree, classId);
+                            this->SetNodeParent(rootIndex, -1);
+                            this->SetTreeClassId(classId);
+                            this->EndTree();
+                        }
+                    }
+                    return;
+                }
+
                 int64_t treeIdIndex = 0;
                 for (const auto& tree : _trees) {
                     this->NewTree();
@@ -351,7 +425,7 @@ namespace TreeBeard
                     // Root has no parent, setting to -1
                     this->SetNodeParent(rootIndex, -1);
 
-                    if (_isClassifier) {
+                    if (_isClassifier && !_isVotingForest) {
                         assert(_treeToClassIdMap[treeIdIndex].size() == 1 && "ONNX classifier with multiple class IDs per tree is not supported");
                         this->SetTreeClassId(*_treeToClassIdMap[treeIdIndex].begin());
                     }
@@ -380,8 +454,8 @@ namespace TreeBeard
       mlir::ModuleOp module = TreeBeard::ConstructLLVMDialectModuleFromForestCreator(tbContext, onnxModelParser);
 
       auto *inferenceRunner = new mlir::decisionforest::InferenceRunner(
-          tbContext.serializer, module, optionsPtr->tileSize,
-          optionsPtr->thresholdTypeWidth, optionsPtr->featureIndexTypeWidth);
+          tbContext.serializer, module, tbContext.options.tileSize,
+          tbContext.options.thresholdTypeWidth, tbContext.options.featureIndexTypeWidth);
       return inferenceRunner;
     }
 
@@ -12,11 +12,188 @@ template<typename ThresholdType=double, typename ReturnType=double, typename Fea
          typename NodeIndexType=int32_t, typename InputElementType=double>
 class XGBoostJSONParser : public ForestCreator
 {
-    json m_json;
-    void ConstructSingleTree(json& treeJSON);
-    void ConstructTreesFromBooster(json& boosterJSON);
+    // The arrays of a tree that are needed to construct it (see AddTree)
+    struct XGBoostTree {
+        std::vector<int32_t> leftChildren;
+        std::vector<int32_t> rightChildren;
+        std::vector<int32_t> parents;
+        std::vector<int32_t> splitIndices;
+        std::vector<double> splitConditions;
+        size_t numBaseWeights = 0;
+        int32_t numFeatures = 0;
+        size_t numNodes = 0;
+
+        void Clear() {
+            leftChildren.clear();
+            rightChildren.clear();
+            parents.clear();
+            splitIndices.clear();
+            splitConditions.clear();
+            numBaseWeights = 0;
+            numFeatures = 0;
+            numNodes = 0;
+        }
+    };
+
+    // Reads the model one value at a time instead of building a DOM of the whole model, which takes
+    // several times the size of the model file. Each tree is added to the forest as soon as its object
+    // ends and so only the arrays of one tree are held at any time. The same events are generated for
+    // JSON and UBJSON models.
+    class SAXHandler : public nlohmann::json_sax<json> {
+        enum class ArrayKind { kOther, kTrees, kTreeInfo, kFeatureNames, kFeatureTypes, kLeftChildren, kRightChildren,
+                               kParents, kSplitIndices, kSplitConditions, kBaseWeights };
+        // An open object (with the last key read in it) or array
+        struct Scope {
+            bool isArray;
+            ArrayKind arrayKind;
+            std::string key;
+        };
+
+        XGBoostJSONParser& m_parser;
+        std::vector<Scope> m_scopes;
+        XGBoostTree m_tree;
+
+        // Keys of the enclosing objects, for example "learner/objective/name"
+        std::string Path() const {
+            std::string path;
+            for (auto& scope : m_scopes) {
+                if (scope.isArray)
+                    continue;
+                if (!path.empty())
+                    path += "/";
+                path += scope.key;
+            }
+            return path;
+        }
+
+        static ArrayKind GetArrayKind(const std::string& path) {
+            static const std::map<std::string, ArrayKind> arrayKinds = {
+                { "learner/gradient_booster/model/trees", ArrayKind::kTrees },
+                { "learner/gradient_booster/model/tree_info", ArrayKind::kTreeInfo },
+                { "learner/feature_names", ArrayKind::kFeatureNames },
+                { "learner/feature_types", ArrayKind::kFeatureTypes },
+                { "learner/gradient_booster/model/trees/left_children", ArrayKind::kLeftChildren },
+                { "learner/gradient_booster/model/trees/right_children", ArrayKind::kRightChildren },
+                { "learner/gradient_booster/model/trees/parents", ArrayKind::kParents },
+                { "learner/gradient_booster/model/trees/split_indices", ArrayKind::kSplitIndices },
+                { "learner/gradient_booster/model/trees/split_conditions", ArrayKind::kSplitConditions },
+                { "learner/gradient_booster/model/trees/base_weights", ArrayKind::kBaseWeights },
+            };
+            auto mapIter = arrayKinds.find(path);
+            return mapIter == arrayKinds.end() ? ArrayKind::kOther : mapIter->second;
+        }
+
+        bool IsInArray(ArrayKind kind) const { return !m_scopes.empty() && m_scopes.back().isArray && m_scopes.back().arrayKind == kind; }
+
+        bool Number(double value) {
+            if (m_scopes.empty())
+                return true;
+            auto& scope = m_scopes.back();
+            if (!scope.isArray)
+                return true;
+            switch (scope.arrayKind) {
+                case ArrayKind::kTreeInfo: treeInfo.push_back(static_cast<int32_t>(value)); break;
+                case ArrayKind::kLeftChildren: m_tree.leftChildren.push_back(static_cast<int32_t>(value)); break;
+                case ArrayKind::kRightChildren: m_tree.rightChildren.push_back(static_cast<int32_t>(value)); break;
+                case ArrayKind::kParents: m_tree.parents.push_back(static_cast<int32_t>(value)); break;
+                case ArrayKind::kSplitIndices: m_tree.splitIndices.push_back(static_cast<int32_t>(value)); break;
+                case ArrayKind::kSplitConditions: m_tree.splitConditions.push_back(value); break;
+                case ArrayKind::kBaseWeights: ++m_tree.numBaseWeights; break;
+                default: break;
+            }
+            return true;
+        }
+    public:
+        std::vector<std::string> featureNames;
+        std::vector<std::string> featureTypes;
+        std::vector<int32_t> treeInfo;
+        std::string baseScore;
+        std::string numClass = "0";
+        std::string objectiveName;
+        size_t numTrees = 0;
+        size_t numTreesRead = 0;
+
+        SAXHandler(XGBoostJSONParser& parser) : m_parser(parser) { }
+
+        bool null() override { return true; }
+        bool boolean(bool val) override { return true; }
+        bool number_integer(number_integer_t val) override { return Number(static_cast<double>(val)); }
+        bool number_unsigned(number_unsigned_t val) override { return Number(static_cast<double>(val)); }
+        bool number_float(number_float_t val, const string_t& s) override { return Number(val); }
+        bool binary(binary_t& val) override { return true; }
+
+        bool string(string_t& val) override {
+            if (IsInArray(ArrayKind::kFeatureNames))
+                featureNames.push_back(val);
+            else if (IsInArray(ArrayKind::kFeatureTypes))
+                featureTypes.push_back(val);
+            else if (!m_scopes.empty() && !m_scopes.back().isArray) {
+                // The parameters of XGBoost models are all stored as strings
+                auto path = Path();
+                if (path == "learner/learner_model_param/base_score")
+                    baseScore = val;
+                else if (path == "learner/learner_model_param/num_class")
+                    numClass = val;
+                else if (path == "learner/objective/name")
+                    objectiveName = val;
+                else if (path == "learner/gradient_booster/model/gbtree_model_param/num_trees")
+                    numTrees = static_cast<size_t>(std::stoi(val));
+                else if (path == "learner/gradient_booster/model/trees/tree_param/num_feature")
+                    m_tree.numFeatures = std::stoi(val);
+                else if (path == "learner/gradient_booster/model/trees/tree_param/num_nodes")
+                    m_tree.numNodes = static_cast<size_t>(std::stoi(val));
+            }
+            return true;
+        }
+
+        bool start_object(std::size_t elements) override {
+            if (IsInArray(ArrayKind::kTrees))
+                m_tree.Clear();
+            m_scopes.push_back(Scope{ false, ArrayKind::kOther, "" });
+            return true;
+        }
+
+        bool key(string_t& val) override {
+            m_scopes.back().key = val;
+            return true;
+        }
+
+        bool end_object() override {
+            m_scopes.pop_back();
+            if (IsInArray(ArrayKind::kTrees)) {
+                m_parser.AddTree(m_tree);
+                ++numTreesRead;
+            }
+            return true;
+        }
+
+        bool start_array(std::size_t elements) override {
+            m_scopes.push_back(Scope{ true, GetArrayKind(Path()), "" });
+            return true;
+        }
+
+        bool end_array() override {
+            m_scopes.pop_back();
+            return true;
+        }
+
+        bool parse_error(std::size_t position, const std::string& lastToken, const nlohmann::detail::exception& ex) override {
+            assert (false && "Could not parse the XGBoost model");
+            return false;
+        }
+    };
+
+    std::string m_modelFilePath;
+    void AddTree(XGBoostTree& tree);
     static constexpr double_t INITIAL_VALUE = 0;
 
+    // Models saved with the .ubj extension are in UBJSON (binary JSON) and all others are in JSON
+    static bool IsUBJSONFile(const std::string& filename) {
+        const std::string ubjsonExtension = ".ubj";
+        return filename.size() >= ubjsonExtension.size() &&
+               filename.compare(filename.size() - ubjsonExtension.size(), ubjsonExtension.size(), ubjsonExtension) == 0;
+    }
+
 public:
     XGBoostJSONParser(mlir::MLIRContext& context, 
                       const std::string& filename,
@@ -31,11 +208,9 @@ public:
           GetMLIRType(FeatureIndexType(), context),
           GetMLIRType(NodeIndexType(), context),
           GetMLIRType(ReturnType(), context),
-          GetMLIRType(InputElementType(), context))
+          GetMLIRType(InputElementType(), context)),
+        m_modelFilePath(filename)
     {
-        std::ifstream fin(filename);
-        assert (fin);
-        fin >> m_json;
     }
     
     XGBoostJSONParser(mlir::MLIRContext& context,
@@ -53,11 +228,9 @@ public:
           GetMLIRType(FeatureIndexType(), context),
           GetMLIRType(NodeIndexType(), context),
           GetMLIRType(ReturnType(), context),
-          GetMLIRType(InputElementType(), context))
+          GetMLIRType(InputElementType(), context)),
+        m_modelFilePath(filename)
     {
-        std::ifstream fin(filename);
-        assert (fin);
-        fin >> m_json;
     }
 
     void ConstructForest() override;
@@ -116,106 +289,77 @@ inline mlir::decisionforest::PredictionTransformation GetPredictionTransformType
 template<typename ThresholdType, typename ReturnType, typename FeatureIndexType, typename NodeIndexType, typename InputElementType>
 void XGBoostJSONParser<ThresholdType, ReturnType, FeatureIndexType, NodeIndexType, InputElementType>::ConstructForest()
 {
-    auto& learnerJSON = m_json["learner"];
-    auto& featureNamesJSON = learnerJSON["feature_names"];
-    auto& featureTypesJSON = learnerJSON["feature_types"];
-    
+    // The trees are added to the forest while the model is read
+    std::ifstream fin(m_modelFilePath, std::ios::binary);
+    assert (fin);
+    SAXHandler saxHandler(*this);
+    auto inputFormat = IsUBJSONFile(m_modelFilePath) ? json::input_format_t::ubjson : json::input_format_t::json;
+    bool parsed = json::sax_parse(fin, &saxHandler, inputFormat);
+    assert (parsed);
+
     // Set the base score for current objective type
-    auto baseScoreStr = learnerJSON["learner_model_param"]["base_score"].get<std::string>();
-    auto baseScore = std::stod(baseScoreStr);
-    auto objectiveName = learnerJSON["objective"]["name"].get<std::string>();
+    auto baseScore = std::stod(saxHandler.baseScore);
+    auto& objectiveName = saxHandler.objectiveName;
     this->SetInitialOffset(TransformBaseScore(objectiveName, baseScore));
-    this->SetNumberOfClasses(std::stoi(learnerJSON["learner_model_param"]["num_class"].get<std::string>()));
+    this->SetNumberOfClasses(std::stoi(saxHandler.numClass));
     this->m_forest->SetPredictionTransformation(GetPredictionTransformType(objectiveName));
     
-    // Assert is not valid since feature_names is not required. 
-    // assert(featureNamesJSON.size() == featureTypesJSON.size());
-    for (size_t i = 0; i<featureTypesJSON.size() ; ++i)
+    // feature_names is not required and so there may be no names.
+    for (size_t i = 0; i<saxHandler.featureTypes.size() ; ++i)
     {
         std::string name;
-        if (featureNamesJSON.size() == 0)
+        if (saxHandler.featureNames.size() == 0)
             name = std::to_string(i);
         else
-            name = featureNamesJSON[i].get<std::string>();
-        auto featureType = featureTypesJSON[i].get<std::string>();
-        this->AddFeature(name, featureType); //TODO hardcoded feature type
+            name = saxHandler.featureNames[i];
+        this->AddFeature(name, saxHandler.featureTypes[i]); //TODO hardcoded feature type
     }
 
-    ConstructTreesFromBooster(learnerJSON["gradient_booster"]);
-}
-// We asumme the gradient booster is a gbtree
-/*
-    "required": [
-    "name",
-    "model"
-    ]
-*/
-// Name is a const string string "gbtree"
-
-template<typename ThresholdType, typename ReturnType, typename FeatureIndexType, typename NodeIndexType, typename InputElementType>
-void XGBoostJSONParser<ThresholdType, ReturnType, FeatureIndexType, NodeIndexType, InputElementType>::ConstructTreesFromBooster(json& boosterJSON)
-{
-    auto& modelJSON = boosterJSON["model"];
-    size_t numTrees = static_cast<size_t>(std::stoi(modelJSON["gbtree_model_param"]["num_trees"].get<std::string>()));
-    auto& treesJSON = modelJSON["trees"];
-    auto& treeInfoJSON = modelJSON["tree_info"];
-
-    assert (numTrees == treesJSON.size());
-    assert (numTrees == treeInfoJSON.size());
-
-    int32_t treeIndex = 0;
-    for (auto& treeJSON : treesJSON)
-    {
-        this->NewTree();
-        ConstructSingleTree(treeJSON);
-        this->SetTreeClassId(treeInfoJSON[treeIndex++]);
-        this->EndTree();
+    // tree_info holds the class of each tree
+    assert (saxHandler.numTrees == saxHandler.numTreesRead);
+    assert (saxHandler.numTrees == saxHandler.treeInfo.size());
+    for (size_t i = 0; i < saxHandler.treeInfo.size() ; ++i) {
+        auto classId = saxHandler.treeInfo[i];
+        assert (!this->m_forest->IsMultiClassClassifier() || classId < this->m_forest->GetNumClasses());
+        this->m_forest->GetTree(i).SetClassId(classId);
     }
 }
 
 template<typename ThresholdType, typename ReturnType, typename FeatureIndexType, typename NodeIndexType, typename InputElementType>
-void XGBoostJSONParser<ThresholdType, ReturnType, FeatureIndexType, NodeIndexType, InputElementType>::ConstructSingleTree(json& treeJSON)
+void XGBoostJSONParser<ThresholdType, ReturnType, FeatureIndexType, NodeIndexType, InputElementType>::AddTree(XGBoostTree& tree)
 {
     // TODO what is "base_weights", "categories", "categories_nodes", 
     // "categories_segments", "categories_sizes"?
-    size_t numNodes = treeJSON["base_weights"].size();
     // TODO ignoring "default_left"
-    // auto treeID = treeJSON["id"].get<int>();
-    
-    auto& left_children = treeJSON["left_children"];
-    auto& right_childen = treeJSON["right_children"];
-    auto& parents = treeJSON["parents"];
-    auto& split_conditions = treeJSON["split_conditions"];
-    auto& split_indices = treeJSON["split_indices"];
-    // auto& split_type = treeJSON["split_type"]; // 0 is Numerical and 1 is Categorical
-    auto num_features = std::stoi(treeJSON["tree_param"]["num_feature"].get<std::string>());
-    auto num_nodes = static_cast<size_t>(std::stoi(treeJSON["tree_param"]["num_nodes"].get<std::string>()));
-    assert (numNodes == num_nodes);
-    assert (left_children.size() == num_nodes);
-    assert (left_children.size() == right_childen.size() && 
-            left_children.size() == parents.size());
-    this->SetTreeNumberOfFeatures(num_features);
+    auto num_nodes = tree.numNodes;
+    assert (tree.numBaseWeights == num_nodes);
+    assert (tree.leftChildren.size() == num_nodes);
+    assert (tree.leftChildren.size() == tree.rightChildren.size() && 
+            tree.leftChildren.size() == tree.parents.size());
+    assert (tree.splitConditions.size() == num_nodes && tree.splitIndices.size() == num_nodes);
+    this->NewTree();
+    this->SetTreeNumberOfFeatures(tree.numFeatures);
 
     std::vector<NodeIndexType> nodes;
     for (size_t i=0 ; i< num_nodes ; ++i)
     {
-        // assert (split_type[i].get<int>() == 0); // only numerical splits for now
-        auto node = this->NewNode(split_conditions[i].get<ThresholdType>(), split_indices[i].get<FeatureIndexType>());
+        auto node = this->NewNode(static_cast<ThresholdType>(tree.splitConditions[i]), static_cast<FeatureIndexType>(tree.splitIndices[i]));
         nodes.push_back(node);
     }
     for (size_t i=0 ; i< num_nodes ; ++i)
     {
-        auto leftChildIndex = left_children[i].get<int>();
+        auto leftChildIndex = tree.leftChildren[i];
         if (leftChildIndex != -1)
             this->SetNodeLeftChild(nodes[i], nodes[leftChildIndex]);
-        auto rightChildIndex = right_childen[i].get<int>();
+        auto rightChildIndex = tree.rightChildren[i];
         if (rightChildIndex != -1)
             this->SetNodeRightChild(nodes[i], nodes[rightChildIndex]);
-        if (parents[i].get<int>() == 2147483647)
+        if (tree.parents[i] == 2147483647)
             this->SetNodeParent(nodes[i],  -1);
         else
-            this->SetNodeParent(nodes[i], nodes[parents[i].get<int>()]);
+            this->SetNodeParent(nodes[i], nodes[tree.parents[i]]);
     }
+    this->EndTree();
 }
 
 std::shared_ptr<ForestCreator> ConstructXGBoostJSONParser(TreebeardContext& tbContext);
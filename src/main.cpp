@@ -7,6 +7,7 @@
 #include "TestUtilsCommon.h"
 #include "CompileUtils.h"
 #include "StatsUtils.h"
+#include "StreamingInference.h"
 #include "ModelSerializers.h"
 #include "Representations.h"
 
@@ -95,7 +96,7 @@ bool DumpLLVMIfNeeded(int argc, char *argv[]) {
     }
   if (!dumpLLVMToFile)
     return false;
-  std::string xgboostFile, llvmIRFile, modelGlobalsJSONFile, compilerConfigJSONFile, onnxModelFile;
+  std::string xgboostFile, llvmIRFile, modelGlobalsJSONFile, compilerConfigJSONFile, onnxModelFile, lightGBMModelFile, catBoostModelFile;
   int32_t thresholdTypeWidth=32, returnTypeWidth=32, featureIndexTypeWidth=16, tileShapeBitWidth=16, childIndexBitWidth=16;
   int32_t nodeIndexTypeWidth=32, inputElementTypeWidth=32, batchSize=4, tileSize=1;
   bool invertLoops = false, isReturnTypeFloat=true;
@@ -120,6 +121,20 @@ bool DumpLLVMIfNeeded(int argc, char *argv[]) {
       onnxModelFile = argv[i+1];
       i += 2;
     }
+    else if (ContainsString(argv[i], "-lightgbm")) {
+      assert ((i+1) < argc);
+      assert (lightGBMModelFile.empty());
+      assert (xgboostFile.empty() && onnxModelFile.empty());
+      lightGBMModelFile = argv[i+1];
+      i += 2;
+    }
+    else if (ContainsString(argv[i], "-catboost")) {
+      assert ((i+1) < argc);
+      assert (catBoostModelFile.empty());
+      assert (xgboostFile.empty() && onnxModelFile.empty() && lightGBMModelFile.empty());
+      catBoostModelFile = argv[i+1];
+      i += 2;
+    }
     else if (ContainsString(argv[i], "-globalValuesJSON")) {
       assert ((i+1) < argc);
       assert (modelGlobalsJSONFile.empty());
@@ -173,7 +188,7 @@ bool DumpLLVMIfNeeded(int argc, char *argv[]) {
     else
       ++i;
   }
-  assert ((!xgboostFile.empty() || !onnxModelFile.empty()) && !llvmIRFile.empty());
+  assert ((!xgboostFile.empty() || !onnxModelFile.empty() || !lightGBMModelFile.empty() || !catBoostModelFile.empty()) && !llvmIRFile.empty());
   mlir::decisionforest::ScheduleManipulationFunctionWrapper scheduleManipulator(mlir::decisionforest::OneTreeAtATimeSchedule);
   // TreeBeard::test::ScheduleManipulationFunctionWrapper scheduleManipulator(TreeBeard::test::TileTreeDimensionSchedule<10>);
 
@@ -205,6 +220,14 @@ bool DumpLLVMIfNeeded(int argc, char *argv[]) {
     tbContext.modelPath = xgboostFile;
     TreeBeard::ConvertXGBoostJSONToLLVMIR(tbContext, llvmIRFile);
   }
+  else if (!lightGBMModelFile.empty()) {
+    tbContext.modelPath = lightGBMModelFile;
+    TreeBeard::ConvertLightGBMTextToLLVMIR(tbContext, llvmIRFile);
+  }
+  else if (!catBoostModelFile.empty()) {
+    tbContext.modelPath = catBoostModelFile;
+    TreeBeard::ConvertCatBoostJSONToLLVMIR(tbContext, llvmIRFile);
+  }
   else {
     tbContext.modelPath = onnxModelFile;
     TreeBeard::ConvertONNXModelToLLVMIR(tbContext, llvmIRFile);
@@ -224,12 +247,38 @@ bool RunInferenceFromSO(int argc, char *argv[]) {
     }
   if (!runInferenceFromSO)
     return false;
-  std::string jsonFile, soPath, inputCSVFile, modelGlobalsJSONFile;
+  std::string jsonFile, soPath, inputCSVFile, modelGlobalsJSONFile, outputFile;
   int32_t thresholdTypeWidth=32, returnTypeWidth=32, featureIndexTypeWidth=16, tileShapeBitWidth=16, childIndexBitWidth=16;
   int32_t nodeIndexTypeWidth=32, inputElementTypeWidth=32, batchSize=4, tileSize=1;
   bool isReturnTypeFloat = true;
+  TreeBeard::StreamingInferenceOptions streamingOptions;
   for (int32_t i=0 ; i<argc ; ) {
-    if (ContainsString(argv[i], "-so")) {
+    // Predictions are only written out (by streaming the input through the model) if an output file is given
+    if (EqualsString(argv[i], "-o")) {
+      assert ((i+1) < argc);
+      assert (outputFile.empty());
+      outputFile = argv[i+1];
+      i += 2;
+    }
+    else if (EqualsString(argv[i], "--binaryInput")) {
+      streamingOptions.inputFormat = TreeBeard::StreamingFileFormat::kBinary;
+      i += 1;
+    }
+    else if (EqualsString(argv[i], "--binaryOutput")) {
+      streamingOptions.outputFormat = TreeBeard::StreamingFileFormat::kBinary;
+      i += 1;
+    }
+    else if (EqualsString(argv[i], "--csvHasPredictionColumn")) {
+      streamingOptions.csvHasPredictionColumn = true;
+      i += 1;
+    }
+    else if (EqualsString(argv[i], "-numWorkers")) {
+      ReadIntegerFromCommandLineArgument(argc, argv, i, streamingOptions.numberOfWorkers);
+    }
+    else if (EqualsString(argv[i], "-batchesPerChunk")) {
+      ReadIntegerFromCommandLineArgument(argc, argv, i, streamingOptions.batchesPerChunk);
+    }
+    else if (ContainsString(argv[i], "-so")) {
       assert ((i+1) < argc);
       assert (soPath.empty());
       soPath = argv[i+1];
@@ -290,7 +339,10 @@ bool RunInferenceFromSO(int argc, char *argv[]) {
   TreeBeard::CompilerOptions options(thresholdTypeWidth, returnTypeWidth, isReturnTypeFloat, featureIndexTypeWidth,
                                      nodeIndexTypeWidth, inputElementTypeWidth, batchSize, tileSize, tileShapeBitWidth, 
                                      childIndexBitWidth, TreeBeard::TilingType::kUniform, false, false, nullptr);
-  TreeBeard::RunInferenceUsingSO(soPath, modelGlobalsJSONFile, inputCSVFile, options);
+  if (outputFile.empty())
+    TreeBeard::RunInferenceUsingSO(soPath, modelGlobalsJSONFile, inputCSVFile, options);
+  else
+    TreeBeard::RunStreamingInferenceUsingSO(soPath, modelGlobalsJSONFile, inputCSVFile, outputFile, options, streamingOptions);
   return true;
 }
 
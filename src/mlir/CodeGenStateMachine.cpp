@@ -51,17 +51,35 @@ namespace decisionforest
       return index;
     }
 
+    // Issue a prefetch for the tile at tileIndex. The tile index is only a hint to the hardware and 
+    // prefetches don't fault, so this is safe even when tileIndex points past the tiles of the tree
+    // (for example, when it is the index of a leaf in the sparse representation).
+    void GenerateTilePrefetch(ConversionPatternRewriter &rewriter, Location location, Value treeMemref, Value tileIndex) {
+      rewriter.create<memref::PrefetchOp>(location, treeMemref, ValueRange{tileIndex}, 
+                                          false /*isWrite*/, 3 /*localityHint*/, true /*isDataCache*/);
+    }
+
     mlir::arith::CmpFPredicate negateComparisonPredicate(mlir::arith::CmpFPredicateAttr cmpPredAttr) {
+      // The negation of an unordered predicate is ordered (and vice versa) so that NaNs take the
+      // same branch as they do with the original predicate
       auto cmpPred = cmpPredAttr.getValue();
       switch (cmpPred)
       {
         case arith::CmpFPredicate::ULT:
-          return arith::CmpFPredicate::UGE;
+          return arith::CmpFPredicate::OGE;
         case arith::CmpFPredicate::UGE:
-          return arith::CmpFPredicate::ULT;
+          return arith::CmpFPredicate::OLT;
         case arith::CmpFPredicate::UGT:
-          return arith::CmpFPredicate::ULE;
+          return arith::CmpFPredicate::OLE;
         case arith::CmpFPredicate::ULE:
+          return arith::CmpFPredicate::OGT;
+        case arith::CmpFPredicate::OLT:
+          return arith::CmpFPredicate::UGE;
+        case arith::CmpFPredicate::OGE:
+          return arith::CmpFPredicate::ULT;
+        case arith::CmpFPredicate::OGT:
+          return arith::CmpFPredicate::ULE;
+        case arith::CmpFPredicate::OLE:
           return arith::CmpFPredicate::UGT;
         default:
           assert(false && "Unknown comparison predicate");
@@ -77,7 +95,8 @@ namespace decisionforest
                                                                      Type resultType, 
                                                                      std::shared_ptr<IRepresentation> representation,
                                                                      Value tree,
-                                                                     mlir::arith::CmpFPredicateAttr cmpPredicateAttr) {
+                                                                     mlir::arith::CmpFPredicateAttr cmpPredicateAttr,
+                                                                     bool prefetchNextTile) {
       m_rowMemref = rowMemref;
       m_nodeToTraverse = node;
       m_resultType = resultType;
@@ -85,6 +104,7 @@ namespace decisionforest
       m_representation = representation;
       m_tree = tree;
       m_cmpPredicateAttr = cmpPredicateAttr;
+      m_prefetchNextTile = prefetchNextTile;
     }
 
     bool ScalarTraverseTileCodeGenerator::EmitNext(ConversionPatternRewriter& rewriter, Location& location) {
@@ -145,12 +165,12 @@ namespace decisionforest
           break;
         case kCompare:
           {
-            // TODO we need a cast here to make sure the threshold and the row element are the same type. The op expects both operands to be the same type.
+            auto threshold = ExtendToFloatType(rewriter, location, m_loadThresholdOp, m_loadFeatureOp.getType());
             auto comparison = rewriter.create<arith::CmpFOp>(
                 location,
                 negateComparisonPredicate(m_cmpPredicateAttr),
                 static_cast<Value>(m_loadFeatureOp),
-                static_cast<Value>(m_loadThresholdOp));
+                threshold);
             
             // auto threadIdx = GetThreadID(traverseTileOpPtr);
             // rewriter.create<gpu::PrintfOp>(location, 
@@ -165,6 +185,8 @@ namespace decisionforest
           {
             auto comparisonResultIndex = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), static_cast<Value>(m_comparisonUnsigned));
             Value newIndex = m_representation->GenerateMoveToChild(location, rewriter, m_nodeIndex, comparisonResultIndex, 1, m_extraLoads);
+            if (m_prefetchNextTile)
+              GenerateTilePrefetch(rewriter, location, m_representation->GetThresholdsMemref(m_tree), newIndex);
 
             // TODO_Ashwin Remove the reference to the memref below
             // node = indexToNode(index)
@@ -203,7 +225,8 @@ namespace decisionforest
                                                                      Type resultType,
                                                                      std::shared_ptr<IRepresentation> representation, 
                                                                      std::function<Value(Value)> getLutFunc,
-                                                                     mlir::arith::CmpFPredicateAttr cmpPredicateAttr) {
+                                                                     mlir::arith::CmpFPredicateAttr cmpPredicateAttr,
+                                                                     bool prefetchNextTile) {
       m_tree = tree;
       m_rowMemref = rowMemref;
       m_nodeToTraverse = node;
@@ -212,6 +235,7 @@ namespace decisionforest
       m_representation = representation;
       m_getLutFunc = getLutFunc;
       m_cmpPredicateAttr = cmpPredicateAttr;
+      m_prefetchNextTile = prefetchNextTile;
 
       auto featureIndexType = m_representation->GetIndexFieldType();
       m_featureIndexVectorType = featureIndexType.cast<VectorType>();
@@ -347,11 +371,12 @@ namespace decisionforest
           break;  
         case kCompare:
           {
+            auto thresholds = ExtendToFloatType(rewriter, location, m_loadThresholdOp, m_features.getType());
             auto comparison = rewriter.create<
                                         arith::CmpFOp>(location,
                                                        m_cmpPredicateAttr.getValue(),
                                                        static_cast<Value>(m_features),
-                                                       static_cast<Value>(m_loadThresholdOp));
+                                                       thresholds);
             if (decisionforest::UseBitcastForComparisonOutcome)
               m_comparisonIndex = ReduceComparisonResultVectorToInt_Bitcast(comparison, m_tileSize, rewriter, location);
             else
@@ -367,12 +392,20 @@ namespace decisionforest
           break;
         case kNextNode:
           {
-            // Load the child index from the LUT
-            auto lutValue = m_getLutFunc(m_tree);
-            auto childIndexInt = rewriter.create<memref::LoadOp>(location, lutValue, ValueRange{m_loadTileShapeIndexOp, m_comparisonIndex});
-            auto childIndex = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), static_cast<Value>(childIndexInt));
+            Value childIndex;
+            if (TileShapeToTileIDMap::UseTileChildTable(m_tileSize)) {
+              childIndex = GenerateChildIndexFromTileChildTable(rewriter, location);
+            }
+            else {
+              // Load the child index from the LUT
+              auto lutValue = m_getLutFunc(m_tree);
+              auto childIndexInt = rewriter.create<memref::LoadOp>(location, lutValue, ValueRange{m_loadTileShapeIndexOp, m_comparisonIndex});
+              childIndex = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), static_cast<Value>(childIndexInt));
+            }
 
             Value newIndex = m_representation->GenerateMoveToChild(location, rewriter, m_nodeIndex, childIndex, m_tileSize, m_extraLoads);
+            if (m_prefetchNextTile)
+              GenerateTilePrefetch(rewriter, location, m_representation->GetThresholdsMemref(m_tree), newIndex);
             
             // node = indexToNode(index)
             // TODO_Ashwin Remove memref reference
@@ -394,6 +427,39 @@ namespace decisionforest
       return true;
     }
 
+    // Large tiles don't have a LUT. Instead, a row of the tile child table has the mask of the nodes on the path 
+    // to each child of the tile and the comparison outcomes those nodes need to have. All children are checked 
+    // with one vector compare and the child index is the position of the only child whose path matches.
+    //   matches = (broadcast(outcomes) & childTable[shape, 0:W]) == childTable[shape, W:2W]
+    //   childIndex = cttz(bitcast(matches))
+    Value VectorTraverseTileCodeGenerator::GenerateChildIndexFromTileChildTable(ConversionPatternRewriter& rewriter, Location location) {
+      auto childTable = m_getLutFunc(m_tree);
+      auto tableWidth = TileShapeToTileIDMap::TileChildTableWidth(m_tileSize);
+      auto entryType = childTable.getType().cast<MemRefType>().getElementType();
+      auto entryVectorType = VectorType::get(tableWidth, entryType);
+
+      auto zeroIndexConst = rewriter.create<arith::ConstantIndexOp>(location, 0);
+      auto tableWidthConst = rewriter.create<arith::ConstantIndexOp>(location, tableWidth);
+      auto pathMasks = rewriter.create<vector::LoadOp>(location, entryVectorType, childTable, 
+                                                       ValueRange{m_loadTileShapeIndexOp, static_cast<Value>(zeroIndexConst)});
+      auto pathOutcomes = rewriter.create<vector::LoadOp>(location, entryVectorType, childTable, 
+                                                          ValueRange{m_loadTileShapeIndexOp, static_cast<Value>(tableWidthConst)});
+
+      auto comparisonOutcomes = rewriter.create<arith::IndexCastOp>(location, entryType, m_comparisonIndex);
+      auto comparisonOutcomesVector = rewriter.create<vector::BroadcastOp>(location, entryVectorType, static_cast<Value>(comparisonOutcomes));
+      auto maskedOutcomes = rewriter.create<arith::AndIOp>(location, static_cast<Value>(comparisonOutcomesVector), static_cast<Value>(pathMasks));
+      auto matches = rewriter.create<arith::CmpIOp>(location, arith::CmpIPredicate::eq, 
+                                                    static_cast<Value>(maskedOutcomes), static_cast<Value>(pathOutcomes));
+
+      auto matchBitsType = rewriter.getIntegerType(tableWidth);
+      auto matchBitsVector = rewriter.create<vector::BitCastOp>(location, VectorType::get(1, matchBitsType), static_cast<Value>(matches));
+      auto zeroConst = rewriter.create<arith::ConstantIntOp>(location, int64_t(0), rewriter.getI32Type());
+      auto matchBits = rewriter.create<vector::ExtractElementOp>(location, static_cast<Value>(matchBitsVector), static_cast<Value>(zeroConst));
+      auto childIndexInt = rewriter.create<math::CountTrailingZerosOp>(location, static_cast<Value>(matchBits));
+      auto childIndex = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), static_cast<Value>(childIndexInt));
+      return childIndex;
+    }
+
     std::vector<Value> VectorTraverseTileCodeGenerator::GetResult() {
       assert (m_state == kDone);
       std::vector<Value> results;
@@ -555,11 +621,12 @@ namespace decisionforest
           break;  
         case kCompare:
           {
+            auto thresholds = ExtendToFloatType(rewriter, location, m_loadThresholdOp, m_features.getType());
             auto comparison = rewriter.create<
                                         arith::CmpFOp>(location,
                                                        m_cmpPredicateAttr.getValue(),
                                                        static_cast<Value>(m_features),
-                                                       static_cast<Value>(m_loadThresholdOp));
+                                                       thresholds);
             if (decisionforest::UseBitcastForComparisonOutcome)
               m_comparisonIndex = ReduceComparisonResultVectorToInt_Bitcast(comparison, m_tileSize, rewriter, location);
             else
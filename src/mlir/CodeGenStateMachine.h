@@ -23,6 +23,9 @@ namespace mlir
 {
 namespace decisionforest
 {
+    // The predicate that is true when the original one is false (the walk goes right when it's true)
+    mlir::arith::CmpFPredicate negateComparisonPredicate(mlir::arith::CmpFPredicateAttr cmpPredAttr);
+
     class ICodeGeneratorStateMachine {
     public:
         // Returns false if there's no code to emit.
@@ -94,12 +97,14 @@ class ScalarTraverseTileCodeGenerator : public ICodeGeneratorStateMachine {
     std::vector<mlir::Value> m_extraLoads;
     Value m_tree;
     mlir::arith::CmpFPredicateAttr m_cmpPredicateAttr;
+    bool m_prefetchNextTile;
   public:
     ScalarTraverseTileCodeGenerator(Value rowMemref, Value node, 
                                     Type resultType,
                                     std::shared_ptr<IRepresentation> representation,
                                     Value tree,
-                                    mlir::arith::CmpFPredicateAttr cmpPredicateAttr);
+                                    mlir::arith::CmpFPredicateAttr cmpPredicateAttr,
+                                    bool prefetchNextTile = false);
     bool EmitNext(ConversionPatternRewriter& rewriter, Location& location) override;
     std::vector<Value> GetResult() override;
 };
@@ -130,6 +135,9 @@ class VectorTraverseTileCodeGenerator : public ICodeGeneratorStateMachine {
 
     std::function<Value(Value)> m_getLutFunc;
     mlir::arith::CmpFPredicateAttr m_cmpPredicateAttr;
+    bool m_prefetchNextTile;
+
+    Value GenerateChildIndexFromTileChildTable(ConversionPatternRewriter& rewriter, Location location);
   public:
     VectorTraverseTileCodeGenerator(Value tree, 
                                     Value rowMemref,
@@ -137,7 +145,8 @@ class VectorTraverseTileCodeGenerator : public ICodeGeneratorStateMachine {
                                     Type resultType, 
                                     std::shared_ptr<IRepresentation> representation,
                                     std::function<Value(Value)> getLutFunc,
-                                    mlir::arith::CmpFPredicateAttr cmpPredicateAttr);
+                                    mlir::arith::CmpFPredicateAttr cmpPredicateAttr,
+                                    bool prefetchNextTile = false);
     bool EmitNext(ConversionPatternRewriter& rewriter, Location& location) override;
     std::vector<Value> GetResult() override;
 };
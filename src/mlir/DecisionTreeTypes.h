@@ -486,6 +486,16 @@ public:
         return true;
     }
     bool isSubsetEnsemble() const { return getImpl()->m_ensembleSubset; }
+    // The type of the ensemble after its trees are reordered. treeOrder[i] is the index of the tree that is moved to position i.
+    TreeEnsembleType getReorderedType(const std::vector<size_t>& treeOrder) const {
+        assert (treeOrder.size() == getNumberOfTrees());
+        if (doAllTreesHaveSameType())
+            return *this;
+        std::vector<Type> treeTypes;
+        for (auto treeIndex : treeOrder)
+            treeTypes.push_back(getImpl()->m_treeTypes.at(treeIndex));
+        return TreeEnsembleType::get(getResultType(), getNumberOfTrees(), getRowType(), getReductionType(), treeTypes);
+    }
     void print(mlir::DialectAsmPrinter &printer) { getImpl()->print(printer); }
 };
 
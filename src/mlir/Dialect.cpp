@@ -19,6 +19,8 @@ bool mlir::decisionforest::EnablePerfNotificationListener = false;
 bool mlir::decisionforest::UseBitcastForComparisonOutcome = true;
 bool mlir::decisionforest::UseSparseTreeRepresentation = false;
 bool mlir::decisionforest::PeeledCodeGenForProbabiltyBasedTiling = false;
+bool mlir::decisionforest::UseLeafDictionaryCompression = false;
+bool mlir::decisionforest::UseHotPathSparseLayout = false;
 
 void TreeTypeStorage::print(mlir::DialectAsmPrinter &printer) {
     printer << "TreeType(returnType:" << m_resultType 
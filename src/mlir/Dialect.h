@@ -43,21 +43,59 @@ extern bool EnablePerfNotificationListener;
 extern bool UseBitcastForComparisonOutcome;
 extern bool UseSparseTreeRepresentation;
 extern bool PeeledCodeGenForProbabiltyBasedTiling;
+extern bool UseLeafDictionaryCompression;
+// Lay out the tiles of each tree in the sparse representation so that the most frequently hit child
+// of every tile follows it (uses the hit counts from the probability profile)
+extern bool UseHotPathSparseLayout;
+
+// Functions added to every module when the prediction function is lowered. They return the 
+// PredictionFunctionArguments the prediction function takes and the number of trees of the forest.
+const std::string kPredictionFunctionArgumentsFunctionName = "GetPredictionFunctionArguments";
+const std::string kNumberOfTreesFunctionName = "GetNumberOfTrees";
+// Single row entry point of modules compiled for a batch size of 1 on the CPU. It takes a pointer to 
+// the row and returns the prediction (ReturnType Predict(const InputElementType* row)).
+const std::string kSingleRowPredictFunctionName = "Predict";
+// Functions of modules compiled with replicateModelPerNUMANode that copy the initialized model buffers 
+// onto every NUMA node and free the copies.
+const std::string kInitModelReplicasFunctionName = "Init_ModelReplicas";
+const std::string kReleaseModelReplicasFunctionName = "Release_ModelReplicas";
+// Exported globals of modules compiled with instrumentLeafHitCounts. leafHitCounts has a counter for every node
+// of the model buffer, which is incremented whenever a tree walk ends at the node. leafHitCountLayout lists the
+// counters of the leaves in the order of the probability profile CSV (see TreeBeard::Profile::ReadProbabilityProfile) : 
+// [numTrees, numCounters] followed by [numLeaves, (counterIndex, depth) of every leaf] for each tree.
+const std::string kLeafHitCountsGlobalName = "leafHitCounts";
+const std::string kLeafHitCountLayoutGlobalName = "leafHitCountLayout";
 
 void populateDebugOpLoweringPatterns(RewritePatternSet& patterns, LLVMTypeConverter& typeConverter);
 
-void LowerFromHighLevelToMidLevelIR(mlir::MLIRContext& context, mlir::ModuleOp module);
-void LowerEnsembleToMemrefs(mlir::MLIRContext& context, mlir::ModuleOp module, std::shared_ptr<IModelSerializer> serializer, std::shared_ptr<IRepresentation> representation);
+// Walks of oblivious trees are lowered to a single branch free traversal if specializeObliviousTrees is set
+// (see TraverseObliviousTreesOp). Only the CPU lowering of the ensemble to memrefs can lower these traversals.
+// If useFastApproximateTransforms is set, the prediction transforms use a polynomial approximation of exp (within 
+// 2 ULP) instead of libm.
+void LowerFromHighLevelToMidLevelIR(mlir::MLIRContext& context, mlir::ModuleOp module, bool specializeObliviousTrees=false,
+                                    bool useFastApproximateTransforms=false);
+// If instrumentLeafHitCounts is set, every walk also counts the leaf it ends at (see kLeafHitCountsGlobalName).
+// Instrumentation is only supported for untiled trees in the array representation.
+void LowerEnsembleToMemrefs(mlir::MLIRContext& context, mlir::ModuleOp module, std::shared_ptr<IModelSerializer> serializer, 
+                            std::shared_ptr<IRepresentation> representation, bool instrumentLeafHitCounts=false);
 void ConvertNodeTypeToIndexType(mlir::MLIRContext& context, mlir::ModuleOp module);
-void LowerToLLVM(mlir::MLIRContext& context, mlir::ModuleOp module, std::shared_ptr<IRepresentation> representation);
+void LowerToLLVM(mlir::MLIRContext& context, mlir::ModuleOp module, std::shared_ptr<IRepresentation> representation, bool useWorkStealingRuntime=false,
+                 bool replicateModelPerNUMANode=false, int32_t modelHugePages=0);
 int dumpLLVMIR(mlir::ModuleOp module, bool dumpAsm = false);
 int dumpLLVMIRToFile(mlir::ModuleOp module, const std::string& filename);
 
 // Optimizing passes
 void DoUniformTiling(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t tileSize, int32_t tileShapeBitWidth, bool makeAllLeavesSameDepth);
-void DoProbabilityBasedTiling(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t tileSize, int32_t tileShapeBitWidth);
-void DoHybridTiling(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t tileSize, int32_t tileShapeBitWidth);
-void DoReorderTreesByDepth(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t pipelineSize=-1, int32_t numCores=-1);
+// The walks of probabilistically tiled trees are peeled if peelWalks or PeeledCodeGenForProbabiltyBasedTiling is set
+void DoProbabilityBasedTiling(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t tileSize, int32_t tileShapeBitWidth, bool peelWalks=false);
+void DoHybridTiling(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t tileSize, int32_t tileShapeBitWidth, bool peelWalks=false);
+void DoReorderTreesByDepth(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t pipelineSize=-1, int32_t numCores=-1, int32_t prefetchDistance=-1);
+void DoThresholdQuantization(mlir::MLIRContext& context, mlir::ModuleOp module);
+// Replaces the thresholds of the given features (and only of these) with bin indices
+void QuantizeFeatureThresholds(DecisionForest& forest, const std::vector<int32_t>& features);
+void DoForestSimplification(mlir::MLIRContext& context, mlir::ModuleOp module);
+void DoFeatureCompaction(mlir::MLIRContext& context, mlir::ModuleOp module);
+void DoTreeParallelization(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t numberOfCores);
 
 #ifdef TREEBEARD_GPU_SUPPORT
 
@@ -9,6 +9,10 @@
 #include "Logger.h"
 #include "TreebeardContext.h"
 #include "TiledTree.h"
+#include "TaskRuntime.h"
+#include "ModelReplicas.h"
+#include "llvm/ExecutionEngine/JITSymbol.h"
+#include "llvm/ExecutionEngine/Orc/Mangling.h"
 
 namespace 
 {
@@ -61,6 +65,104 @@ void InferenceRunnerBase::Init() {
   InitIntegerField("GetRowSize", m_rowSize);
   InitIntegerField("GetInputTypeBitWidth", m_inputElementBitWidth);
   InitIntegerField("GetReturnTypeBitWidth", m_returnTypeBitWidth);
+  InitIntegerField(kNumberOfTreesFunctionName, m_numTrees);
+  int32_t predictionFunctionArguments;
+  InitIntegerField(kPredictionFunctionArgumentsFunctionName, predictionFunctionArguments);
+  m_predictionFunctionArguments = static_cast<PredictionFunctionArguments>(predictionFunctionArguments);
+  // The class scores are sized by the number of classes
+  if (m_predictionFunctionArguments == PredictionFunctionArguments::kClassScores)
+    InitNumberOfClasses();
+}
+
+void InferenceRunnerBase::InitNumberOfClasses() {
+  if (m_numClasses != -1)
+    return;
+  InitIntegerField("GetNumberOfClasses", m_numClasses);
+}
+
+void InferenceRunnerBase::InitSingleRowPredict() {
+  if (m_singleRowPredictFuncPtr || m_batchSize != 1)
+    return;
+  m_singleRowPredictFuncPtr = GetFunctionAddress(kSingleRowPredictFunctionName);
+}
+
+void InferenceRunnerBase::InitModelReplicas() {
+  using ReplicaFunc_t = void(*)();
+  auto initModelReplicas = reinterpret_cast<ReplicaFunc_t>(GetFunctionAddress(kInitModelReplicasFunctionName));
+  if (!initModelReplicas)
+    return;
+  initModelReplicas();
+  m_releaseModelReplicasFuncPtr = GetFunctionAddress(kReleaseModelReplicasFunctionName);
+  if (TreeBeard::Logging::loggingOptions.logGenCodeStats) {
+    std::vector<int64_t> bytesPerNode(TreeBeard::runtime::GetNumberOfNUMANodes());
+    TreebeardGetReplicaMemoryUsage(bytesPerNode.data(), bytesPerNode.size());
+    for (size_t node=0 ; node<bytesPerNode.size() ; ++node)
+      TreeBeard::Logging::Log("Model replica memory on node " + std::to_string(node) + " : " + std::to_string(bytesPerNode.at(node)));
+  }
+}
+
+void InferenceRunnerBase::ReleaseModelReplicas() {
+  using ReplicaFunc_t = void(*)();
+  if (m_releaseModelReplicasFuncPtr)
+    reinterpret_cast<ReplicaFunc_t>(m_releaseModelReplicasFuncPtr)();
+  m_releaseModelReplicasFuncPtr = nullptr;
+}
+
+void InferenceRunnerBase::InitLeafHitCounts() {
+  if (m_leafHitCounts)
+    return;
+  m_leafHitCounts = reinterpret_cast<int64_t*>(GetFunctionAddress(kLeafHitCountsGlobalName));
+  m_leafHitCountLayout = reinterpret_cast<const int64_t*>(GetFunctionAddress(kLeafHitCountLayoutGlobalName));
+}
+
+void InferenceRunnerBase::WriteLeafHitCountProfile(std::ostream& os) {
+  InitLeafHitCounts();
+  assert (m_leafHitCounts && m_leafHitCountLayout && "Module was not compiled with instrumentLeafHitCounts");
+  int64_t numTrees = m_leafHitCountLayout[0];
+  const int64_t *treeLayout = m_leafHitCountLayout + 2;
+  // Every row reaches exactly one leaf of the first tree
+  int64_t numRows = 0;
+  for (int64_t j=0 ; j<treeLayout[0] ; ++j)
+    numRows += m_leafHitCounts[treeLayout[1 + 2*j]];
+  os << numTrees << ", " << numRows << std::endl;
+  for (int64_t i=0 ; i<numTrees ; ++i) {
+    int64_t numLeaves = treeLayout[0];
+    for (int64_t j=0 ; j<numLeaves ; ++j) {
+      auto hitCount = m_leafHitCounts[treeLayout[1 + 2*j]];
+      // Like the profiles computed by TreeBeard::Profile, leaves that are never reached have an unknown depth
+      auto depth = hitCount == 0 ? -1 : treeLayout[2 + 2*j];
+      os << (j == 0 ? "" : ", ") << hitCount << ", " << depth;
+    }
+    os << std::endl;
+    treeLayout += 1 + 2*numLeaves;
+  }
+}
+
+void InferenceRunnerBase::WriteLeafHitCountProfile(const std::string& statsCSVPath) {
+  std::ofstream fout(statsCSVPath);
+  assert (fout && "Could not open the profile file");
+  WriteLeafHitCountProfile(fout);
+}
+
+void InferenceRunnerBase::ResetLeafHitCounts() {
+  InitLeafHitCounts();
+  assert (m_leafHitCounts && m_leafHitCountLayout && "Module was not compiled with instrumentLeafHitCounts");
+  std::fill(m_leafHitCounts, m_leafHitCounts + m_leafHitCountLayout[1], 0);
+}
+
+std::vector<std::vector<int64_t>> InferenceRunnerBase::GetLeafHitCounts() {
+  InitLeafHitCounts();
+  assert (m_leafHitCounts && m_leafHitCountLayout && "Module was not compiled with instrumentLeafHitCounts");
+  int64_t numTrees = m_leafHitCountLayout[0];
+  const int64_t *treeLayout = m_leafHitCountLayout + 2;
+  std::vector<std::vector<int64_t>> leafHitCounts(numTrees);
+  for (int64_t i=0 ; i<numTrees ; ++i) {
+    int64_t numLeaves = treeLayout[0];
+    for (int64_t j=0 ; j<numLeaves ; ++j)
+      leafHitCounts[i].push_back(m_leafHitCounts[treeLayout[1 + 2*j]]);
+    treeLayout += 1 + 2*numLeaves;
+  }
+  return leafHitCounts;
 }
 
 int32_t InferenceRunnerBase::RunInference_CustomImpl(double *input, double *returnValue) {
@@ -96,9 +198,13 @@ SharedObjectInferenceRunner::SharedObjectInferenceRunner(std::shared_ptr<IModelS
 {
   m_so = dlopen(soPath.c_str(), RTLD_NOW);
   Init();
+  // GetFunctionAddress asserts that the function exists
+  if (dlsym(m_so, kInitModelReplicasFunctionName.c_str()))
+    InitModelReplicas();
 }
 
 SharedObjectInferenceRunner::~SharedObjectInferenceRunner() {
+  ReleaseModelReplicas();
   dlclose(m_so);
 }
 
@@ -144,6 +250,17 @@ llvm::Expected<std::unique_ptr<mlir::ExecutionEngine>> InferenceRunner::CreateEx
   options.enablePerfNotificationListener = EnablePerfNotificationListener;
   auto maybeEngine = mlir::ExecutionEngine::create(module, options);
   assert(maybeEngine && "failed to construct an execution engine");
+  // The task runtime and the model replica functions are linked into this binary, but their symbols 
+  // aren't necessarily visible to the JIT's lookup in the current process (eg. when the runtime 
+  // library is loaded by Python).
+  maybeEngine.get()->registerSymbols([](llvm::orc::MangleAndInterner interner) {
+    llvm::orc::SymbolMap symbolMap;
+    symbolMap[interner(TreeBeard::runtime::kParallelForFunctionName)] = llvm::JITEvaluatedSymbol::fromPointer(&TreebeardParallelFor);
+    symbolMap[interner(TreeBeard::runtime::kGetLocalReplicaFunctionName)] = llvm::JITEvaluatedSymbol::fromPointer(&TreebeardGetLocalReplica);
+    symbolMap[interner(TreeBeard::runtime::kReplicateBufferFunctionName)] = llvm::JITEvaluatedSymbol::fromPointer(&TreebeardReplicateBuffer);
+    symbolMap[interner(TreeBeard::runtime::kReleaseReplicasFunctionName)] = llvm::JITEvaluatedSymbol::fromPointer(&TreebeardReleaseReplicas);
+    return symbolMap;
+  });
   return maybeEngine;
 }
 
@@ -156,6 +273,11 @@ InferenceRunner::InferenceRunner(std::shared_ptr<IModelSerializer> serializer,
    m_maybeEngine(CreateExecutionEngine(module)), m_engine(m_maybeEngine.get()), m_module(module)
 {
   Init();
+  InitModelReplicas();
+}
+
+InferenceRunner::~InferenceRunner() {
+  ReleaseModelReplicas();
 }
 
 void *InferenceRunner::GetFunctionAddress(const std::string& functionName) {
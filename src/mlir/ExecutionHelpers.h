@@ -1,6 +1,12 @@
 #ifndef _EXECUTIONHELPERS_H_
 #define _EXECUTIONHELPERS_H_
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <vector>
+
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/ExecutionEngine/OptUtils.h"
 #include "mlir/IR/AsmState.h"
@@ -52,14 +58,35 @@ protected:
   int32_t m_rowSize;
   void *m_inferenceFuncPtr;
   LUTMemrefType m_lutMemref;
+  int32_t m_numClasses = -1;
+  int32_t m_numTrees = -1;
+  PredictionFunctionArguments m_predictionFunctionArguments = PredictionFunctionArguments::kNone;
+  void *m_singleRowPredictFuncPtr = nullptr;
+  void *m_releaseModelReplicasFuncPtr = nullptr;
+  int64_t *m_leafHitCounts = nullptr;
+  const int64_t *m_leafHitCountLayout = nullptr;
 
   virtual void* GetFunctionAddress(const std::string& functionName) = 0;
   void InitIntegerField(const std::string& functionName, int32_t& field);
   
   virtual void Init();
+  // The number of classes is only needed to size the class scores. Looked up on first use.
+  void InitNumberOfClasses();
+  // The single row entry point only exists in modules compiled for a batch size of 1. Also looked up on first use.
+  void InitSingleRowPredict();
+  // Copies the model onto every NUMA node if the module was compiled with replicateModelPerNUMANode. 
+  // Needs to be called after the model buffers are initialized.
+  void InitModelReplicas();
+  void ReleaseModelReplicas();
+  // The leaf hit counters only exist in modules compiled with instrumentLeafHitCounts. Also looked up on first use.
+  void InitLeafHitCounts();
   
   template<typename InputElementType, typename ReturnType>
   int32_t RunInference_Default(InputElementType *input, ReturnType *returnValue) {
+    if (m_predictionFunctionArguments == PredictionFunctionArguments::kClassScores)
+      return CallPredictionFunctionWithClassScores<InputElementType, ReturnType>(input, returnValue, nullptr, PredictionOutputMode::kPrediction);
+    if (m_predictionFunctionArguments == PredictionFunctionArguments::kTreeRange)
+      return CallPredictionFunctionWithTreeRange<InputElementType, ReturnType>(input, returnValue, 0, m_numTrees);
     
     typedef Memref<ReturnType, 1> (*InferenceFunc_t)(InputElementType*, InputElementType*, int64_t, int64_t, int64_t, int64_t, int64_t, 
                                                      ReturnType*, ReturnType*, int64_t, int64_t, int64_t);
@@ -73,6 +100,35 @@ protected:
     return 0;
   }
 
+  // The prediction function of a multi-class model also takes the batchSize x numClasses scores memref and the 
+  // output mode. The scores are only written for kMargins and kProbabilities and the result only for kPrediction.
+  template<typename InputElementType, typename ReturnType>
+  int32_t CallPredictionFunctionWithClassScores(InputElementType *input, ReturnType *returnValue, InputElementType *scores, PredictionOutputMode outputMode) {
+    typedef Memref<ReturnType, 1> (*InferenceFunc_t)(InputElementType*, InputElementType*, int64_t, int64_t, int64_t, int64_t, int64_t, 
+                                                     ReturnType*, ReturnType*, int64_t, int64_t, int64_t,
+                                                     InputElementType*, InputElementType*, int64_t, int64_t, int64_t, int64_t, int64_t, int32_t);
+    auto inferenceFuncPtr = reinterpret_cast<InferenceFunc_t>(m_inferenceFuncPtr);
+    int64_t rowSize = m_rowSize, offset = 0, stride = 1, numClasses = m_numClasses;
+    int64_t resultLen = m_batchSize;
+    inferenceFuncPtr(input, input, offset, m_batchSize, rowSize, rowSize, stride, 
+                     returnValue, returnValue, offset, resultLen, stride,
+                     scores, scores, offset, m_batchSize, numClasses, numClasses, stride, static_cast<int32_t>(outputMode));
+    return 0;
+  }
+
+  // The prediction function of a model compiled for anytime prediction also takes the [start, end) range of trees to walk
+  template<typename InputElementType, typename ReturnType>
+  int32_t CallPredictionFunctionWithTreeRange(InputElementType *input, ReturnType *returnValue, int64_t startTree, int64_t endTree) {
+    typedef Memref<ReturnType, 1> (*InferenceFunc_t)(InputElementType*, InputElementType*, int64_t, int64_t, int64_t, int64_t, int64_t, 
+                                                     ReturnType*, ReturnType*, int64_t, int64_t, int64_t, int64_t, int64_t);
+    auto inferenceFuncPtr = reinterpret_cast<InferenceFunc_t>(m_inferenceFuncPtr);
+    int64_t rowSize = m_rowSize, offset = 0, stride = 1;
+    int64_t resultLen = m_batchSize;
+    inferenceFuncPtr(input, input, offset, m_batchSize, rowSize, rowSize, stride, 
+                     returnValue, returnValue, offset, resultLen, stride, startTree, endTree);
+    return 0;
+  }
+
   bool SerializerHasCustomPredictionMethod();
   int32_t RunInference_CustomImpl(double *input, double* returnValue);
 
@@ -108,6 +164,89 @@ public:
     }
     return 0;
   }
+
+  int32_t GetNumberOfClasses() { InitNumberOfClasses(); return m_numClasses; }
+
+  // Predicts a single row by calling the single row entry point of a module compiled for a batch size of 1. 
+  // The row is passed as a bare pointer and the prediction is returned by value, so none of the memref 
+  // descriptors of RunInference are built.
+  template<typename InputElementType, typename ReturnType>
+  int32_t RunSingleRowInference(const InputElementType *row, ReturnType *returnValue) {
+    InitSingleRowPredict();
+    assert (m_singleRowPredictFuncPtr && "Module has no single row entry point (the batch size must be 1 and the result a float)");
+    assert (sizeof(InputElementType)*8 == m_inputElementBitWidth && sizeof(ReturnType)*8 == m_returnTypeBitWidth);
+    typedef ReturnType (*SingleRowPredictFunc_t)(const InputElementType*);
+    *returnValue = reinterpret_cast<SingleRowPredictFunc_t>(m_singleRowPredictFuncPtr)(row);
+    return 0;
+  }
+
+  // Runs the prediction function on a batch of a multi-class model and writes the batchSize x numClasses
+  // class margins (or the softmax of the margins if computeProbabilities is set) into scores. The generated
+  // code writes the scores directly, so concurrent calls on the same runner are safe.
+  template<typename InputElementType>
+  int32_t RunInferenceForClassScores(InputElementType *input, InputElementType *scores, bool computeProbabilities) {
+    InitNumberOfClasses();
+    assert (m_predictionFunctionArguments == PredictionFunctionArguments::kClassScores && 
+            "Module does not compute class scores (not a multi-class model or not compiled for the CPU)");
+    assert (sizeof(InputElementType)*8 == m_inputElementBitWidth);
+    // The class isn't computed in these modes, so the result memref isn't accessed
+    auto outputMode = computeProbabilities ? PredictionOutputMode::kProbabilities : PredictionOutputMode::kMargins;
+    return CallPredictionFunctionWithClassScores<InputElementType, int8_t>(input, nullptr, scores, outputMode);
+  }
+
+  // Anytime prediction. Walks the first maxTrees trees of the forest (all the trees if maxTrees is negative) 
+  // treeGroupSize trees at a time and writes the margins of the walked trees into margins. If timeBudgetNanoseconds 
+  // is not negative, no more groups are started once the budget is used up (at least one group is always walked). 
+  // Returns the number of trees walked. Every group is a call to the prediction function with the tree range 
+  // of the group as arguments, so concurrent calls on the same runner are safe.
+  template<typename InputElementType>
+  int64_t RunAnytimeInference(InputElementType *input, InputElementType *margins, int64_t maxTrees, 
+                              int64_t timeBudgetNanoseconds, int64_t treeGroupSize) {
+    auto startTime = std::chrono::steady_clock::now();
+    assert (m_predictionFunctionArguments == PredictionFunctionArguments::kTreeRange && "Module was not compiled for anytime prediction");
+    assert (sizeof(InputElementType)*8 == m_inputElementBitWidth && m_returnTypeBitWidth == m_inputElementBitWidth);
+    assert (treeGroupSize > 0 && "Tree group size must be positive");
+
+    int64_t treeLimit = maxTrees < 0 ? m_numTrees : std::min(maxTrees, static_cast<int64_t>(m_numTrees));
+    std::vector<InputElementType> groupMargins(m_batchSize);
+    int64_t treesWalked = 0;
+    do {
+      auto groupEnd = std::min(treesWalked + treeGroupSize, treeLimit);
+      // Only the first group adds the initial offset of the model
+      if (treesWalked == 0) {
+        CallPredictionFunctionWithTreeRange<InputElementType, InputElementType>(input, margins, treesWalked, groupEnd);
+      }
+      else {
+        CallPredictionFunctionWithTreeRange<InputElementType, InputElementType>(input, groupMargins.data(), treesWalked, groupEnd);
+        for (int32_t i=0 ; i<m_batchSize ; ++i)
+          margins[i] += groupMargins[i];
+      }
+      treesWalked = groupEnd;
+      if (timeBudgetNanoseconds >= 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+        if (elapsed.count() >= timeBudgetNanoseconds)
+          break;
+      }
+    } while (treesWalked < treeLimit);
+    return treesWalked;
+  }
+
+  // Writes how often each leaf was reached by the rows predicted since the module was loaded (or since the 
+  // last call to ResetLeafHitCounts) in the probability profile format that statsProfileCSVPath takes. 
+  // The module must be compiled with instrumentLeafHitCounts.
+  void WriteLeafHitCountProfile(std::ostream& os);
+  void WriteLeafHitCountProfile(const std::string& statsCSVPath);
+  void ResetLeafHitCounts();
+  // The leaf hit counts of every tree in the order they are written to the profile
+  std::vector<std::vector<int64_t>> GetLeafHitCounts();
+
+  template<typename InputElementType, typename ReturnType>
+  int32_t RunInference(InputElementType *input, void *output, PredictionOutputMode outputMode) {
+    if (outputMode == PredictionOutputMode::kPrediction)
+      return RunInference<InputElementType, ReturnType>(input, reinterpret_cast<ReturnType*>(output));
+    return RunInferenceForClassScores<InputElementType>(input, reinterpret_cast<InputElementType*>(output), 
+                                                        outputMode == PredictionOutputMode::kProbabilities);
+  }
 };
 
 class InferenceRunner : public InferenceRunnerBase {
@@ -124,6 +263,7 @@ public:
                   int32_t tileSize, 
                   int32_t thresholdSize,
                   int32_t featureIndexSize);
+  ~InferenceRunner();
 };
 
 class SharedObjectInferenceRunner : public InferenceRunnerBase{
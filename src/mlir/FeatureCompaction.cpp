@@ -0,0 +1,145 @@
+// Implementation of a transformation that renumbers the features used by a forest densely.
+// Wide models often only test a fraction of the input columns. The used features are sorted
+// by how often they are accessed (most frequently accessed first) and the feature indices in
+// the trees are replaced by the position of the feature in this order. The used columns of the
+// input rows are copied into a compact buffer before the trees are walked (see CacheInputRowsOp
+// and GenerateInputCompaction in LowerToMidLevelIR.cpp) so that the features a row's walks read
+// are in a few cache lines.
+
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Math/IR/Math.h"
+
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassManager.h"
+#include "Dialect.h"
+#include "Logger.h"
+
+namespace mlir {
+namespace decisionforest {
+
+struct FeatureCompactionPass : public PassWrapper<FeatureCompactionPass, OperationPass<mlir::ModuleOp>> {
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<AffineDialect, memref::MemRefDialect, scf::SCFDialect, math::MathDialect>();
+  }
+
+  // The number of times each node is expected to be visited. With a profile, this is the number
+  // of profiled inputs that reach the node. Otherwise, a node at depth d is reached by 2^-d of the
+  // inputs (every split sends half its inputs each way).
+  std::vector<double> GetNodeAccessFrequencies(DecisionTree& tree) {
+    auto& nodes = tree.GetNodes();
+    bool hasProfile = std::any_of(nodes.begin(), nodes.end(), [](const DecisionTree::Node& n) { return n.IsLeaf() && n.hitCount > 0; });
+    std::vector<double> frequencies(nodes.size(), 0.0);
+    if (hasProfile) {
+      for (size_t i=0 ; i<nodes.size() ; ++i)
+        frequencies.at(i) = tree.GetSubtreeHitCount(i);
+      return frequencies;
+    }
+    std::vector<std::pair<int64_t, double>> nodeStack{ {0, 1.0} };
+    while (!nodeStack.empty()) {
+      auto entry = nodeStack.back();
+      nodeStack.pop_back();
+      frequencies.at(entry.first) = entry.second;
+      auto& node = nodes.at(entry.first);
+      if (node.IsLeaf())
+        continue;
+      nodeStack.push_back({node.leftChild, entry.second/2});
+      nodeStack.push_back({node.rightChild, entry.second/2});
+    }
+    return frequencies;
+  }
+
+  void CompactFeatures(DecisionForest& forest, int64_t numFeatures) {
+    // The trees may be shared with other copies of the forest. Don't modify them in place.
+    for (auto& tree : forest.GetTrees())
+      tree = std::make_shared<DecisionTree>(*tree);
+
+    std::map<int32_t, double> featureFrequencies;
+    for (auto& tree : forest.GetTrees()) {
+      auto frequencies = GetNodeAccessFrequencies(*tree);
+      auto& nodes = tree->GetNodes();
+      for (size_t i=0 ; i<nodes.size() ; ++i) {
+        if (nodes.at(i).IsLeaf())
+          continue;
+        assert (nodes.at(i).featureIndex >= 0 && nodes.at(i).featureIndex < numFeatures);
+        featureFrequencies[nodes.at(i).featureIndex] += frequencies.at(i);
+      }
+    }
+    // A forest of single leaf trees doesn't read any features.
+    if (featureFrequencies.empty())
+      return;
+
+    std::vector<int32_t> columns;
+    for (auto& featureFrequency : featureFrequencies)
+      columns.push_back(featureFrequency.first);
+    std::stable_sort(columns.begin(), columns.end(), [&](int32_t f1, int32_t f2) {
+      return featureFrequencies[f1] > featureFrequencies[f2];
+    });
+    std::map<int32_t, int32_t> compactIndices;
+    for (size_t i=0 ; i<columns.size() ; ++i)
+      compactIndices[columns.at(i)] = static_cast<int32_t>(i);
+
+    for (auto& tree : forest.GetTrees()) {
+      auto nodes = tree->GetNodes();
+      for (auto& node : nodes) {
+        if (!node.IsLeaf())
+          node.featureIndex = compactIndices.at(node.featureIndex);
+      }
+      tree->SetNodes(nodes);
+    }
+    forest.SetCompactFeatureColumns(columns);
+
+    // Features that are binned always have thresholds, so they are all renumbered
+    if (forest.HasBinnedFeatures()) {
+      std::vector<int32_t> binnedFeatures;
+      for (auto feature : forest.GetBinnedFeatures())
+        binnedFeatures.push_back(compactIndices.at(feature));
+      forest.SetFeatureBinBoundaries(forest.GetFeatureBinBoundaries(), binnedFeatures);
+    }
+
+    if (TreeBeard::Logging::loggingOptions.logGenCodeStats) {
+      TreeBeard::Logging::Log("Features used by the forest : " + std::to_string(columns.size()) + " of " + std::to_string(numFeatures));
+    }
+  }
+
+  void runOnOperation() final {
+    auto module = getOperation();
+    module.walk([&](mlir::decisionforest::PredictForestOp predictForestOp) {
+      auto& forest = predictForestOp.getEnsemble().GetDecisionForest();
+      if (forest.IsFeatureCompacted())
+        return;
+      assert (forest.NumTrees() > 0 && forest.GetTree(0).TilingDescriptor().MaxTileSize() == 1 && "Features must be compacted before the forest is tiled");
+      assert (!forest.IsQuantized() && "Features must be compacted before the forest is quantized");
+
+      auto dataType = predictForestOp.getData().getType().cast<MemRefType>();
+      CompactFeatures(forest, dataType.getShape()[1]);
+    });
+  }
+};
+
+} // namespace decisionforest
+} // namespace mlir
+
+namespace mlir
+{
+namespace decisionforest
+{
+void DoFeatureCompaction(mlir::MLIRContext& context, mlir::ModuleOp module) {
+  mlir::PassManager pm(&context);
+  pm.addPass(std::make_unique<FeatureCompactionPass>());
+
+  if (mlir::failed(pm.run(module))) {
+    llvm::errs() << "Feature compaction failed.\n";
+  }
+}
+
+} // decisionforest
+} // mlir
@@ -0,0 +1,355 @@
+// Implementation of a transformation that simplifies the trees of a forest before it is tiled.
+// * Branches that can't be reached given the conditions of their ancestors on the same feature are removed.
+// * Splits whose children are leaves with the same value are replaced by a single leaf.
+// * Trees that are a single leaf are folded into the initial offset of the forest (or into the leaves
+//   of another tree of the same class for multi-class models).
+// * Trees of the same class with identical splits are merged into one tree whose leaves are the sums
+//   of the leaves of the merged trees.
+
+#include <map>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <cassert>
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Math/IR/Math.h"
+
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "Dialect.h"
+#include "Logger.h"
+
+namespace mlir {
+namespace decisionforest {
+
+namespace
+{
+
+struct ForestSimplificationStats {
+  int64_t numUnreachableNodesRemoved = 0;
+  int64_t numSplitsCollapsed = 0;
+  int64_t numConstantTreesFolded = 0;
+  int64_t numTreesMerged = 0;
+};
+
+// Rebuilds the nodes of a tree in pre-order, dropping the branches that can't be reached and replacing splits
+// whose children are leaves with the same value by a leaf.
+class TreeSimplifier {
+  // The values of a feature that can reach a node are in [lo, hi) (and possibly NaN)
+  struct FeatureRange {
+    double lo = -std::numeric_limits<double>::infinity();
+    double hi = std::numeric_limits<double>::infinity();
+    bool nanPossible = true;
+  };
+
+  const std::vector<DecisionTree::Node>& m_nodes;
+  arith::CmpFPredicate m_predicate;
+  ForestSimplificationStats& m_stats;
+  std::vector<DecisionTree::Node> m_newNodes;
+  std::map<int32_t, FeatureRange> m_featureRanges;
+
+  // NaNs go left with ULT and right with OLT. For other predicates, we don't try to find unreachable branches.
+  bool CanRemoveUnreachableBranches() {
+    return m_predicate == arith::CmpFPredicate::ULT || m_predicate == arith::CmpFPredicate::OLT;
+  }
+
+  int64_t CountSubtreeNodes(int64_t nodeIndex) {
+    auto& node = m_nodes.at(nodeIndex);
+    if (node.IsLeaf())
+      return 1;
+    return 1 + CountSubtreeNodes(node.leftChild) + CountSubtreeNodes(node.rightChild);
+  }
+
+  int64_t SimplifySubtree(int64_t nodeIndex, int64_t parent, int32_t depth) {
+    auto& node = m_nodes.at(nodeIndex);
+    if (node.IsLeaf()) {
+      auto newNode = node;
+      newNode.parent = parent;
+      if (newNode.depth != -1)
+        newNode.depth = depth;
+      m_newNodes.push_back(newNode);
+      return static_cast<int64_t>(m_newNodes.size()) - 1;
+    }
+
+    auto currentRange = m_featureRanges.count(node.featureIndex) ? m_featureRanges[node.featureIndex] : FeatureRange();
+    FeatureRange leftRange = currentRange, rightRange = currentRange;
+    leftRange.hi = std::min(currentRange.hi, node.threshold);
+    rightRange.lo = std::max(currentRange.lo, node.threshold);
+    if (m_predicate == arith::CmpFPredicate::ULT)
+      rightRange.nanPossible = false;
+    else
+      leftRange.nanPossible = false;
+
+    if (CanRemoveUnreachableBranches() && std::isfinite(node.threshold)) {
+      bool leftReachable = leftRange.lo < leftRange.hi || leftRange.nanPossible;
+      bool rightReachable = rightRange.lo < rightRange.hi || rightRange.nanPossible;
+      assert (leftReachable || rightReachable);
+      // The condition of this node is implied by its ancestors. Replace the node by the child that is taken.
+      if (!rightReachable) {
+        m_stats.numUnreachableNodesRemoved += 1 + CountSubtreeNodes(node.rightChild);
+        return SimplifySubtree(node.leftChild, parent, depth);
+      }
+      if (!leftReachable) {
+        m_stats.numUnreachableNodesRemoved += 1 + CountSubtreeNodes(node.leftChild);
+        return SimplifySubtree(node.rightChild, parent, depth);
+      }
+    }
+
+    auto newNodeIndex = static_cast<int64_t>(m_newNodes.size());
+    auto newNode = node;
+    newNode.parent = parent;
+    m_newNodes.push_back(newNode);
+
+    m_featureRanges[node.featureIndex] = leftRange;
+    auto leftChild = SimplifySubtree(node.leftChild, newNodeIndex, depth + 1);
+    m_featureRanges[node.featureIndex] = rightRange;
+    auto rightChild = SimplifySubtree(node.rightChild, newNodeIndex, depth + 1);
+    m_featureRanges[node.featureIndex] = currentRange;
+
+    auto& newLeftChild = m_newNodes.at(leftChild);
+    auto& newRightChild = m_newNodes.at(rightChild);
+    if (newLeftChild.IsLeaf() && newRightChild.IsLeaf() && newLeftChild.threshold == newRightChild.threshold) {
+      // Both the children were just added and so are the last two nodes.
+      auto leaf = newLeftChild;
+      leaf.hitCount += newRightChild.hitCount;
+      leaf.parent = parent;
+      if (leaf.depth != -1)
+        leaf.depth = depth;
+      m_newNodes.resize(newNodeIndex);
+      m_newNodes.push_back(leaf);
+      ++m_stats.numSplitsCollapsed;
+      return newNodeIndex;
+    }
+    m_newNodes.at(newNodeIndex).leftChild = leftChild;
+    m_newNodes.at(newNodeIndex).rightChild = rightChild;
+    return newNodeIndex;
+  }
+public:
+  TreeSimplifier(const std::vector<DecisionTree::Node>& nodes, arith::CmpFPredicate predicate, ForestSimplificationStats& stats)
+    : m_nodes(nodes), m_predicate(predicate), m_stats(stats)
+  { }
+
+  std::vector<DecisionTree::Node> Run() {
+    assert (m_nodes.size() > 0 && m_nodes.at(0).parent == DecisionTree::INVALID_NODE_INDEX);
+    SimplifySubtree(0, DecisionTree::INVALID_NODE_INDEX, 0);
+    return m_newNodes;
+  }
+};
+
+// A string that is the same for two trees iff they have the same splits. Since the nodes of simplified trees
+// are in pre-order, trees with the same key also have the same node indices.
+std::string GetTreeStructureKey(DecisionTree& tree) {
+  std::stringstream strStream;
+  strStream << tree.GetClassId() << ":";
+  for (auto& node : tree.GetNodes()) {
+    if (node.IsLeaf())
+      strStream << "L";
+    else
+      strStream << "(" << node.featureIndex << "," << std::hexfloat << node.threshold << std::defaultfloat << ","
+                << node.leftChild << "," << node.rightChild << ")";
+  }
+  return strStream.str();
+}
+
+void AddToLeaves(DecisionTree& tree, const std::vector<DecisionTree::Node>& leafValues) {
+  auto nodes = tree.GetNodes();
+  assert (nodes.size() == leafValues.size());
+  for (size_t i=0 ; i<nodes.size() ; ++i) {
+    if (nodes.at(i).IsLeaf())
+      nodes.at(i).threshold += leafValues.at(i).threshold;
+  }
+  tree.SetNodes(nodes);
+}
+
+void AddToLeaves(DecisionTree& tree, double value) {
+  auto nodes = tree.GetNodes();
+  for (auto& node : nodes) {
+    if (node.IsLeaf())
+      node.threshold += value;
+  }
+  tree.SetNodes(nodes);
+}
+
+// Folds trees that are a single leaf into the initial offset or into another tree of the same class.
+bool FoldConstantTrees(DecisionForest& forest, ForestSimplificationStats& stats) {
+  auto& trees = forest.GetTrees();
+  std::vector<std::shared_ptr<DecisionTree>> newTrees;
+  bool changed = false;
+  for (size_t i=0 ; i<trees.size() ; ++i) {
+    auto& tree = trees.at(i);
+    if (tree->GetNodes().size() != 1) {
+      newTrees.push_back(tree);
+      continue;
+    }
+    auto leafValue = tree->GetNodes().at(0).threshold;
+    if (!forest.IsMultiClassClassifier()) {
+      // Always keep at least one tree
+      if (newTrees.empty() && i == trees.size()-1) {
+        newTrees.push_back(tree);
+        continue;
+      }
+      forest.SetInitialOffset(forest.GetInitialOffset() + leafValue);
+    }
+    else {
+      // The initial offset is added to every class. Find another tree of the same class to fold this tree into.
+      std::shared_ptr<DecisionTree> foldTarget;
+      for (auto& otherTree : newTrees)
+        if (otherTree->GetClassId() == tree->GetClassId())
+          foldTarget = otherTree;
+      for (size_t j=i+1 ; j<trees.size() && !foldTarget ; ++j)
+        if (trees.at(j)->GetClassId() == tree->GetClassId())
+          foldTarget = trees.at(j);
+      if (!foldTarget) {
+        newTrees.push_back(tree);
+        continue;
+      }
+      AddToLeaves(*foldTarget, leafValue);
+    }
+    ++stats.numConstantTreesFolded;
+    changed = true;
+  }
+  trees = newTrees;
+  return changed;
+}
+
+// Merges trees of the same class that have the same splits by adding up their leaves.
+bool MergeIdenticalTrees(DecisionForest& forest, ForestSimplificationStats& stats) {
+  auto& trees = forest.GetTrees();
+  std::vector<std::shared_ptr<DecisionTree>> newTrees;
+  std::map<std::string, std::shared_ptr<DecisionTree>> structureMap;
+  for (auto& tree : trees) {
+    auto key = GetTreeStructureKey(*tree);
+    auto iter = structureMap.find(key);
+    if (iter == structureMap.end()) {
+      structureMap[key] = tree;
+      newTrees.push_back(tree);
+      continue;
+    }
+    // The inputs are routed the same way through both trees and so the hit counts are the same.
+    AddToLeaves(*iter->second, tree->GetNodes());
+    ++stats.numTreesMerged;
+  }
+  bool changed = newTrees.size() != trees.size();
+  trees = newTrees;
+  return changed;
+}
+
+ForestSimplificationStats SimplifyForest(DecisionForest& forest, arith::CmpFPredicate predicate) {
+  ForestSimplificationStats stats;
+  // The trees may be shared with other copies of the forest. Don't modify them in place.
+  auto& trees = forest.GetTrees();
+  for (auto& tree : trees)
+    tree = std::make_shared<DecisionTree>(*tree);
+
+  // Merging trees can make sibling leaves equal. Repeat until nothing changes.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto& tree : trees) {
+      auto simplifiedNodes = TreeSimplifier(tree->GetNodes(), predicate, stats).Run();
+      // Simplification only ever removes nodes
+      changed = changed || simplifiedNodes.size() != tree->GetNodes().size();
+      tree->SetNodes(simplifiedNodes);
+    }
+    changed = FoldConstantTrees(forest, stats) || changed;
+    changed = MergeIdenticalTrees(forest, stats) || changed;
+  }
+  return stats;
+}
+
+} // anonymous namespace
+
+struct SimplifyForestPattern : public RewritePattern {
+  SimplifyForestPattern(MLIRContext *ctx)
+    : RewritePattern(mlir::decisionforest::PredictForestOp::getOperationName(), 1 /*benefit*/, ctx)
+  {}
+
+  LogicalResult matchAndRewrite(Operation *op, PatternRewriter &rewriter) const final {
+    auto predictForestOp = llvm::dyn_cast<mlir::decisionforest::PredictForestOp>(op);
+    assert(predictForestOp);
+    if (!predictForestOp)
+      return mlir::failure();
+
+    auto forestAttribute = predictForestOp.getEnsemble();
+    auto forest = forestAttribute.GetDecisionForest();
+    auto forestType = forestAttribute.getType().cast<decisionforest::TreeEnsembleType>();
+    // Leaves of different trees can only be combined if the predictions of the trees are added up
+    if (forestType.getReductionType() != decisionforest::ReductionType::kAdd)
+      return mlir::failure();
+    assert (forest.NumTrees() > 0 && forest.GetTree(0).TilingDescriptor().MaxTileSize() == 1 && "Forest must be simplified before it is tiled");
+    assert (!forest.IsQuantized() && "Forest must be simplified before it is quantized");
+
+    auto numTrees = static_cast<int64_t>(forest.NumTrees());
+    int64_t numNodes = 0;
+    for (auto& tree : forest.GetTrees())
+      numNodes += tree->GetNodes().size();
+    auto stats = SimplifyForest(forest, predictForestOp.getPredicate());
+    int64_t newNumNodes = 0;
+    for (auto& tree : forest.GetTrees())
+      newNumNodes += tree->GetNodes().size();
+    if (newNumNodes == numNodes && static_cast<int64_t>(forest.NumTrees()) == numTrees)
+      return mlir::failure();
+
+    if (TreeBeard::Logging::loggingOptions.logGenCodeStats) {
+      TreeBeard::Logging::Log("Forest simplification : " + std::to_string(numTrees) + " -> " + std::to_string(forest.NumTrees()) +
+                              " trees, " + std::to_string(numNodes) + " -> " + std::to_string(newNumNodes) + " nodes");
+      TreeBeard::Logging::Log("\tUnreachable nodes removed : " + std::to_string(stats.numUnreachableNodesRemoved) +
+                              ", Splits collapsed : " + std::to_string(stats.numSplitsCollapsed) +
+                              ", Constant trees folded : " + std::to_string(stats.numConstantTreesFolded) +
+                              ", Trees merged : " + std::to_string(stats.numTreesMerged));
+    }
+
+    predictForestOp.getSchedule().GetSchedule()->SetForestSize(forest.NumTrees());
+    auto newForestType = decisionforest::TreeEnsembleType::get(forestType.getResultType(), forest.NumTrees(),
+                                                               forestType.getRowType(), forestType.getReductionType(),
+                                                               forestType.getTreeType(0));
+    auto newForestAttribute = decisionforest::DecisionForestAttribute::get(newForestType, forest);
+    auto simplifiedPredictForestOp = rewriter.create<decisionforest::PredictForestOp>(op->getLoc(),
+                                                                                      predictForestOp.getResult().getType(),
+                                                                                      newForestAttribute,
+                                                                                      predictForestOp.getPredicateAttr(),
+                                                                                      predictForestOp.getData(),
+                                                                                      predictForestOp.getResult(),
+                                                                                      predictForestOp.getSchedule());
+    rewriter.replaceOp(op, static_cast<Value>(simplifiedPredictForestOp));
+    return mlir::success();
+  }
+};
+
+struct ForestSimplificationPass : public PassWrapper<ForestSimplificationPass, OperationPass<mlir::ModuleOp>> {
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<AffineDialect, memref::MemRefDialect, scf::SCFDialect, math::MathDialect>();
+  }
+  void runOnOperation() final {
+    RewritePatternSet patterns(&getContext());
+    patterns.add<SimplifyForestPattern>(&getContext());
+
+    if (failed(applyPatternsAndFoldGreedily(getOperation(), std::move(patterns))))
+        signalPassFailure();
+  }
+};
+
+} // namespace decisionforest
+} // namespace mlir
+
+namespace mlir
+{
+namespace decisionforest
+{
+void DoForestSimplification(mlir::MLIRContext& context, mlir::ModuleOp module) {
+  mlir::PassManager pm(&context);
+  pm.addPass(std::make_unique<ForestSimplificationPass>());
+
+  if (mlir::failed(pm.run(module))) {
+    llvm::errs() << "Forest simplification failed.\n";
+  }
+}
+
+} // decisionforest
+} // mlir
@@ -8,6 +8,7 @@
 #include "mlir/Dialect/SCF/IR/SCF.h"
 #include "mlir/Dialect/Math/IR/Math.h"
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/TypeUtilities.h"
 #include "mlir/Transforms/DialectConversion.h"
 
 #include "OpLoweringUtils.h"
@@ -55,12 +56,81 @@ inline Value CreateZeroVectorFPConst(mlir::OpBuilder &rewriter, Location locatio
     zeroConst = rewriter.create<arith::ConstantFloatOp>(location, llvm::APFloat(0.0), fpType.cast<FloatType>());
   else if(fpType.isa<mlir::Float32Type>())
     zeroConst = rewriter.create<arith::ConstantFloatOp>(location, llvm::APFloat((float)0.0), fpType.cast<FloatType>());
+  else if(fpType.isF16() || fpType.isBF16())
+    zeroConst = rewriter.create<arith::ConstantFloatOp>(location, llvm::APFloat::getZero(fpType.cast<FloatType>().getFloatSemantics()), fpType.cast<FloatType>());
   else
     assert(false && "Unsupported floating point type");
   auto vectorValue = rewriter.create<vector::BroadcastOp>(location, vectorType, zeroConst);
   return vectorValue;
 }
 
+// Thresholds can be stored in a narrower floating point type than the input rows (16-bit 
+// thresholds with 32-bit inputs for example). Extend them before they are compared with features.
+// The thresholds of quantized models are unsigned bin indices and are converted to the feature type.
+inline Value ExtendToFloatType(mlir::OpBuilder &rewriter, Location location, Value value, Type targetType) {
+  if (value.getType() == targetType)
+    return value;
+  if (getElementTypeOrSelf(value.getType()).isa<IntegerType>())
+    return rewriter.create<arith::UIToFPOp>(location, targetType, value);
+  return rewriter.create<arith::ExtFOp>(location, targetType, value);
+}
+
+// Returns the index of the bin featureValue falls into (the number of bin boundaries of the feature
+// that are <= featureValue) as a value of binType. Every row of boundariesMemref is padded with +inf 
+// to 2^n - 1 entries so that the bin is found with a fixed length branchless binary search. NaNs 
+// compare false and therefore end up in bin 0 (they go left like with the ULT predicate).
+inline Value GenerateBinIndex(mlir::OpBuilder &builder, Location location, Value boundariesMemref, Value featureIndex,
+                              Value featureValue, Type binType) {
+  auto rowLength = boundariesMemref.getType().cast<MemRefType>().getShape()[1];
+  int32_t numSearchSteps = 0;
+  while ((int64_t(1) << numSearchSteps) - 1 < rowLength)
+    ++numSearchSteps;
+  assert ((int64_t(1) << numSearchSteps) - 1 == rowLength);
+
+  Value binIndex = builder.create<arith::ConstantIndexOp>(location, 0);
+  for (int32_t step=numSearchSteps-1 ; step>=0 ; --step) {
+    auto stepConst = builder.create<arith::ConstantIndexOp>(location, int64_t(1) << step);
+    auto stepMinusOneConst = builder.create<arith::ConstantIndexOp>(location, (int64_t(1) << step) - 1);
+    auto boundaryIndex = builder.create<arith::AddIOp>(location, binIndex, stepMinusOneConst);
+    auto boundary = builder.create<memref::LoadOp>(location, boundariesMemref, ValueRange{featureIndex, boundaryIndex});
+    auto boundaryLessEqual = builder.create<arith::CmpFOp>(location, arith::CmpFPredicate::OLE, boundary, featureValue);
+    auto nextBinIndex = builder.create<arith::AddIOp>(location, binIndex, stepConst);
+    binIndex = builder.create<arith::SelectOp>(location, boundaryLessEqual, nextBinIndex, binIndex);
+  }
+  auto binIndexInt = builder.create<arith::IndexCastOp>(location, builder.getI64Type(), binIndex);
+  return builder.create<arith::UIToFPOp>(location, binType, binIndexInt);
+}
+
+// Replaces the features binnedFeatures of row rowIndex of rows with their bin index. Row i of
+// boundariesMemref has the bin boundaries of binnedFeatures[i].
+inline void GenerateInPlaceBinning(mlir::OpBuilder &builder, Location location, Value boundariesMemref, Value rows,
+                                   Value rowIndex, ArrayRef<int32_t> binnedFeatures) {
+  auto elementType = rows.getType().cast<MemRefType>().getElementType();
+  for (size_t i=0 ; i<binnedFeatures.size() ; ++i) {
+    auto boundariesIndex = builder.create<arith::ConstantIndexOp>(location, static_cast<int64_t>(i));
+    auto featureIndex = builder.create<arith::ConstantIndexOp>(location, binnedFeatures[i]);
+    auto featureValue = builder.create<memref::LoadOp>(location, rows, ValueRange{rowIndex, featureIndex});
+    auto binIndex = GenerateBinIndex(builder, location, boundariesMemref, boundariesIndex, featureValue, elementType);
+    builder.create<memref::StoreOp>(location, binIndex, rows, ValueRange{rowIndex, featureIndex});
+  }
+}
+
+// Copies input column columns[i] of row srcRowIndex of data into feature i of row destRowIndex of dest. The 
+// columns are known when the model is compiled, so every feature is loaded with a constant column index. If 
+// boundariesMemref is set, every feature is replaced by its bin index (row i has the boundaries of feature i).
+inline void GenerateColumnGather(mlir::OpBuilder &builder, Location location, Value data, Value srcRowIndex, Value dest,
+                                 Value destRowIndex, ArrayRef<int32_t> columns, Value boundariesMemref=Value()) {
+  auto elementType = dest.getType().cast<MemRefType>().getElementType();
+  for (size_t i=0 ; i<columns.size() ; ++i) {
+    auto featureIndex = builder.create<arith::ConstantIndexOp>(location, static_cast<int64_t>(i));
+    auto columnIndex = builder.create<arith::ConstantIndexOp>(location, columns[i]);
+    Value featureValue = builder.create<memref::LoadOp>(location, data, ValueRange{srcRowIndex, columnIndex});
+    if (boundariesMemref)
+      featureValue = GenerateBinIndex(builder, location, boundariesMemref, featureIndex, featureValue, elementType);
+    builder.create<memref::StoreOp>(location, featureValue, dest, ValueRange{destRowIndex, featureIndex});
+  }
+}
+
 inline Value CreateZeroVectorIntConst(mlir::OpBuilder &rewriter, Location location, Type intType, int32_t tileSize) {
   Value zeroConst = rewriter.create<arith::ConstantIntOp>(location, 0, intType);
   auto vectorType = VectorType::get(tileSize, intType);
@@ -68,6 +138,13 @@ inline Value CreateZeroVectorIntConst(mlir::OpBuilder &rewriter, Location locati
   return vectorValue;
 }
 
+// The thresholds of quantized models are integers
+inline Value CreateZeroVectorConst(mlir::OpBuilder &rewriter, Location location, Type elementType, int32_t tileSize) {
+  if (elementType.isa<IntegerType>())
+    return CreateZeroVectorIntConst(rewriter, location, elementType, tileSize);
+  return CreateZeroVectorFPConst(rewriter, location, elementType, tileSize);
+}
+
 inline Value CreateZeroVectorIndexConst(ConversionPatternRewriter &rewriter, Location location, int32_t tileSize) {
   Value zeroConst = rewriter.create<arith::ConstantIndexOp>(location, 0);
   auto vectorType = VectorType::get(tileSize, rewriter.getIndexType());
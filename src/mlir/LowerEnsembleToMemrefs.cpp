@@ -156,6 +156,23 @@ struct EnsembleConstantOpLowering: public ConversionPattern {
     if (tileSize == 1)
       return Type(); // We don't need a lookup table if the tile size is 1
     
+    using TileShapeMap = mlir::decisionforest::TileShapeToTileIDMap;
+    if (TileShapeMap::UseTileChildTable(tileSize)) {
+      // For large tiles, the table only has rows for the tile shapes that are actually used by the model
+      auto& tileShapeToTileIDMap = ensembleConstOp.getForest().GetDecisionForest().GetTileShapeToTileIDMap(tileSize);
+      auto numberOfTileShapes = tileShapeToTileIDMap.NumberOfAssignedTileShapes();
+      auto entryBitWidth = TileShapeMap::TileChildTableEntryBitWidth(tileSize);
+      auto rowLength = 2 * TileShapeMap::TileChildTableWidth(tileSize);
+      auto childTableMemrefType = MemRefType::get({numberOfTileShapes, rowLength}, rewriter.getIntegerType(entryBitWidth));
+      // With the bitcast, the outcome of node i is bit i. Otherwise, node 0 is the most significant bit.
+      bool nodeZeroIsMostSignificantBit = !mlir::decisionforest::UseBitcastForComparisonOutcome;
+      std::vector<int64_t> childTableData;
+      for (auto& shapeEntries : tileShapeToTileIDMap.ComputeTileChildTable(nodeZeroIsMostSignificantBit))
+        childTableData.insert(childTableData.end(), shapeEntries.begin(), shapeEntries.end());
+      mlir::decisionforest::createConstantGlobalOp(rewriter, location, lookupTableMemrefName, childTableMemrefType, childTableData);
+      return childTableMemrefType;
+    }
+
     auto numberOfTileOutcomes = static_cast<int>(std::pow(2, tileSize));
     auto numberOfTileShapes = mlir::decisionforest::TileShapeToTileIDMap::NumberOfTileShapes(tileSize);
     // TODO We may need to implement something smarter here. We don't really need I8's for each outcome. We could store all outcomes
@@ -235,6 +252,7 @@ struct EnsembleConstantOpGPULowering: public ConversionPattern {
     auto tileSize = firstTreeTileSize;
     if (tileSize == 1)
       return Type(); // We don't need a lookup table if the tile size is 1
+    assert (!mlir::decisionforest::TileShapeToTileIDMap::UseTileChildTable(tileSize) && "Large tiles are not supported on the GPU");
     
     auto numberOfTileOutcomes = static_cast<int>(std::pow(2, tileSize));
     auto numberOfTileShapes = mlir::decisionforest::TileShapeToTileIDMap::NumberOfTileShapes(tileSize);
@@ -414,11 +432,247 @@ struct TraverseTreeTileOpLowering : public ConversionPattern {
   }
 };
 
+// Split of every level of every tree of an oblivious forest (see AddObliviousLevelSplitGlobals)
+const std::string kObliviousLevelThresholdsGlobalName = "obliviousLevelThresholds";
+const std::string kObliviousLevelFeatureIndicesGlobalName = "obliviousLevelFeatureIndices";
+
+// All nodes of a level of an oblivious tree have the same split. The split of level l of the tree at index t
+// of the model buffer is stored at [l][t] so that the splits of a level are contiguous across the trees and 
+// the walks of neighbouring trees load them from the same cache lines.
+void AddObliviousLevelSplitGlobals(ConversionPatternRewriter &rewriter, Location location, mlir::ModuleOp module,
+                                   DecisionForest& forest, int32_t depth, Type thresholdType, Type featureIndexType) {
+  auto numTrees = static_cast<int64_t>(forest.NumTrees());
+  std::vector<double> thresholds(depth*numTrees);
+  std::vector<int32_t> featureIndices(depth*numTrees);
+  for (int64_t i=0 ; i<numTrees ; ++i) {
+    auto& nodes = forest.GetTree(i).GetNodes();
+    int64_t nodeIndex = 0;
+    for (int32_t level=0 ; level<depth ; ++level) {
+      auto& node = nodes.at(nodeIndex);
+      assert (!node.IsLeaf() && "Every tree of an oblivious forest needs to have the depth of the forest");
+      thresholds.at(level*numTrees + i) = node.threshold;
+      featureIndices.at(level*numTrees + i) = node.featureIndex;
+      nodeIndex = node.leftChild;
+    }
+  }
+  SaveAndRestoreInsertionPoint saveAndRestoreInsertPoint(rewriter);
+  rewriter.setInsertionPoint(&module.front());
+  createConstantGlobalOp(rewriter, location, kObliviousLevelThresholdsGlobalName, MemRefType::get({depth, numTrees}, thresholdType), thresholds);
+  createConstantGlobalOp(rewriter, location, kObliviousLevelFeatureIndicesGlobalName, MemRefType::get({depth, numTrees}, featureIndexType), featureIndices);
+}
+
+// Nodes are at their positions in the complete tree in the array representation (with tile size 1) and so
+// the leaf at position p of the last level of a tree of depth d is node 2^d-1+p. The outcome of the comparison 
+// at level l is bit (depth-1-l) of p. None of the comparisons depend on each other, so the splits of all levels 
+// of all the traversed trees are loaded from the per level globals into one vector (ordered by level and then 
+// by tree), compared with the features of the rows at once and the outcomes are shifted into place and or'ed 
+// together level by level.
+struct TraverseObliviousTreesOpLowering : public ConversionPattern {
+  std::shared_ptr<mlir::decisionforest::IRepresentation> m_representation;
+  TraverseObliviousTreesOpLowering(MLIRContext *ctx, std::shared_ptr<mlir::decisionforest::IRepresentation> representation) 
+  : ConversionPattern(mlir::decisionforest::TraverseObliviousTreesOp::getOperationName(), 1 /*benefit*/, ctx), m_representation(representation) {}
+
+  LogicalResult
+  matchAndRewrite(Operation *op, ArrayRef<Value> operands, ConversionPatternRewriter &rewriter) const final {
+    auto traverseOp = AssertOpIsOfType<mlir::decisionforest::TraverseObliviousTreesOp>(op);
+    auto trees = traverseOp.getTrees();
+    auto dataRows = traverseOp.getData();
+    int32_t depth = traverseOp.getDepth();
+    assert (trees.size() == dataRows.size());
+    assert (m_representation->GetTileSize() == 1 && "Only trees that aren't tiled can be traversed as oblivious trees");
+
+    auto location = op->getLoc();
+    auto nodeType = mlir::decisionforest::NodeType::get(op->getContext());
+    std::vector<Type> nodeTypes(trees.size(), nodeType);
+
+    if (!dynamic_cast<decisionforest::ArrayBasedRepresentation*>(m_representation.get())) {
+      // Other representations don't place the leaves at known positions. Walk all levels
+      // one after the other (the walk still doesn't need to check for leaves).
+      std::vector<Value> nodes;
+      for (auto tree : trees)
+        nodes.push_back(rewriter.create<decisionforest::GetRootOp>(location, nodeType, tree));
+      for (int32_t level = 0; level < depth; ++level) {
+        auto traverseTile = rewriter.create<decisionforest::InterleavedTraverseTreeTileOp>(location, nodeTypes, traverseOp.getPredicateAttr(),
+                                                                                           rewriter.getBoolAttr(false), trees, nodes, dataRows);
+        nodes.assign(traverseTile.getResults().begin(), traverseTile.getResults().end());
+      }
+      rewriter.replaceOp(op, nodes);
+      return mlir::success();
+    }
+
+    std::vector<Value> leaves;
+    if (depth == 0) {
+      auto zeroIndex = rewriter.create<arith::ConstantIndexOp>(location, 0);
+      for (auto tree : trees)
+        leaves.push_back(rewriter.create<decisionforest::IndexToNodeOp>(location, nodeType, m_representation->GetThresholdsMemref(tree), zeroIndex));
+      rewriter.replaceOp(op, leaves);
+      return mlir::success();
+    }
+
+    auto module = op->getParentOfType<mlir::ModuleOp>();
+    auto treeType = trees[0].getType().cast<decisionforest::TreeType>();
+    if (!module.lookupSymbol<memref::GlobalOp>(kObliviousLevelThresholdsGlobalName)) {
+      auto getTreeOp = AssertOpIsOfType<decisionforest::GetTreeFromEnsembleOp>(trees[0].getDefiningOp());
+      auto ensembleConstOp = AssertOpIsOfType<decisionforest::EnsembleConstantOp>(getTreeOp.getForest().getDefiningOp());
+      AddObliviousLevelSplitGlobals(rewriter, location, module, ensembleConstOp.getForest().GetDecisionForest(), depth,
+                                    treeType.getThresholdType(), treeType.getFeatureIndexType());
+    }
+    auto thresholdsMemrefType = module.lookupSymbol<memref::GlobalOp>(kObliviousLevelThresholdsGlobalName).getType();
+    auto featureIndicesMemrefType = module.lookupSymbol<memref::GlobalOp>(kObliviousLevelFeatureIndicesGlobalName).getType();
+    assert (thresholdsMemrefType.getShape()[0] == depth && "All oblivious walks of a forest need to have the same depth");
+    auto levelThresholds = rewriter.create<memref::GetGlobalOp>(location, thresholdsMemrefType, kObliviousLevelThresholdsGlobalName);
+    auto levelFeatureIndices = rewriter.create<memref::GetGlobalOp>(location, featureIndicesMemrefType, kObliviousLevelFeatureIndicesGlobalName);
+
+    auto numTrees = static_cast<int64_t>(trees.size());
+    auto numLanes = depth * numTrees;
+    auto featureType = dataRows[0].getType().cast<MemRefType>().getElementType();
+    auto featureVectorType = VectorType::get(numLanes, featureType);
+    auto thresholdVectorType = VectorType::get(numLanes, treeType.getThresholdType());
+    std::vector<Value> treeIndices;
+    for (auto tree : trees)
+      treeIndices.push_back(m_representation->GetTreeIndex(tree));
+
+    auto zeroIndex = rewriter.create<arith::ConstantIndexOp>(location, 0);
+    Value thresholds = rewriter.create<arith::ConstantOp>(location, thresholdVectorType, rewriter.getZeroAttr(thresholdVectorType));
+    Value features = rewriter.create<arith::ConstantOp>(location, featureVectorType, rewriter.getZeroAttr(featureVectorType));
+    for (int32_t level = 0; level < depth; ++level) {
+      auto levelIndex = rewriter.create<arith::ConstantIndexOp>(location, level);
+      for (int64_t i = 0; i < numTrees; ++i) {
+        auto threshold = rewriter.create<memref::LoadOp>(location, levelThresholds, ValueRange{levelIndex, treeIndices[i]});
+        auto featureIndex = rewriter.create<memref::LoadOp>(location, levelFeatureIndices, ValueRange{levelIndex, treeIndices[i]});
+        auto featureIndexAsIndex = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), static_cast<Value>(featureIndex));
+        auto feature = rewriter.create<memref::LoadOp>(location, dataRows[i], ValueRange{zeroIndex, featureIndexAsIndex});
+        thresholds = rewriter.create<vector::InsertOp>(location, static_cast<Value>(threshold), thresholds, ArrayRef<int64_t>({ level*numTrees + i }));
+        features = rewriter.create<vector::InsertOp>(location, static_cast<Value>(feature), features, ArrayRef<int64_t>({ level*numTrees + i }));
+      }
+    }
+    thresholds = ExtendToFloatType(rewriter, location, thresholds, featureVectorType);
+    // True if the row goes right at the level
+    auto comparison = rewriter.create<arith::CmpFOp>(location, negateComparisonPredicate(traverseOp.getPredicateAttr()), features, thresholds);
+    auto i64VectorType = VectorType::get(numLanes, rewriter.getI64Type());
+    auto goRight = rewriter.create<arith::ExtUIOp>(location, i64VectorType, static_cast<Value>(comparison));
+    std::vector<int64_t> shiftAmounts;
+    for (int32_t level = 0; level < depth; ++level)
+      shiftAmounts.insert(shiftAmounts.end(), numTrees, depth - 1 - level);
+    auto shiftVector = rewriter.create<arith::ConstantOp>(location, i64VectorType, 
+                                                          DenseElementsAttr::get(i64VectorType, ArrayRef<int64_t>(shiftAmounts)));
+    auto leafIndexBits = rewriter.create<arith::ShLIOp>(location, static_cast<Value>(goRight), static_cast<Value>(shiftVector));
+    
+    Value leafPositions;
+    for (int32_t level = 0; level < depth; ++level) {
+      Value levelBits = rewriter.create<vector::ExtractStridedSliceOp>(location, static_cast<Value>(leafIndexBits), ArrayRef<int64_t>({ level*numTrees }),
+                                                                       ArrayRef<int64_t>({ numTrees }), ArrayRef<int64_t>({ 1 }));
+      if (level == 0)
+        leafPositions = levelBits;
+      else
+        leafPositions = rewriter.create<arith::OrIOp>(location, leafPositions, levelBits);
+    }
+    auto lastLevelStart = rewriter.create<arith::ConstantIntOp>(location, (int64_t(1) << depth) - 1, rewriter.getI64Type());
+    for (int64_t i = 0; i < numTrees; ++i) {
+      auto leafPosition = rewriter.create<vector::ExtractOp>(location, leafPositions, ArrayRef<int64_t>({ i }));
+      auto leafIndex = rewriter.create<arith::AddIOp>(location, static_cast<Value>(leafPosition), static_cast<Value>(lastLevelStart));
+      auto leafIndexAsIndex = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), static_cast<Value>(leafIndex));
+      leaves.push_back(rewriter.create<decisionforest::IndexToNodeOp>(location, nodeType, m_representation->GetThresholdsMemref(trees[i]), 
+                                                                      static_cast<Value>(leafIndexAsIndex)));
+    }
+    rewriter.replaceOp(op, leaves);
+    return mlir::success();
+  }
+};
+
+// Index of the first leaf hit counter of each tree of an instrumented module
+const std::string kLeafHitCountOffsetsGlobalName = "leafHitCountOffsets";
+
+// Position of each node of a tree in the complete tree the array representation stores it as and the depth of the node
+void ComputeArrayPositionsAndDepths(const std::vector<DecisionTree::Node>& nodes, int64_t nodeIndex, int64_t position, int64_t depth,
+                                    std::vector<int64_t>& positions, std::vector<int64_t>& depths) {
+  auto& node = nodes.at(nodeIndex);
+  positions.at(nodeIndex) = position;
+  depths.at(nodeIndex) = depth;
+  if (node.IsLeaf())
+    return;
+  ComputeArrayPositionsAndDepths(nodes, node.leftChild, 2*position + 1, depth + 1, positions, depths);
+  ComputeArrayPositionsAndDepths(nodes, node.rightChild, 2*position + 2, depth + 1, positions, depths);
+}
+
+// Adds the leaf hit counters of an instrumented module, the offset of the counters of each tree and the layout 
+// the inference runner uses to write the counts of the leaves as a probability profile. The counters are in the 
+// order of the trees in the model buffer, which may have been reordered (for example by class or across cores). 
+// The layout lists the trees in the order of the model as it was read.
+void AddLeafHitCountGlobals(ConversionPatternRewriter &rewriter, Location location, mlir::ModuleOp module,
+                            DecisionForest& forest) {
+  std::vector<int64_t> offsets;
+  std::vector<std::vector<int64_t>> treeLayouts(forest.NumTrees());
+  int64_t numCounters = 0;
+  for (size_t i=0 ; i<forest.NumTrees() ; ++i) {
+    auto& tree = forest.GetTree(i);
+    auto& nodes = tree.GetNodes();
+    auto indexInModel = tree.GetIndexInModel();
+    assert (indexInModel >= 0 && indexInModel < (int64_t)forest.NumTrees() && treeLayouts.at(indexInModel).empty() && 
+            "Every tree needs a distinct index in the model");
+    std::vector<int64_t> positions(nodes.size()), depths(nodes.size());
+    ComputeArrayPositionsAndDepths(nodes, 0, 0, 0, positions, depths);
+    auto& treeLayout = treeLayouts.at(indexInModel);
+    treeLayout.push_back(tree.NumLeaves());
+    for (size_t j=0 ; j<nodes.size() ; ++j) {
+      if (!nodes.at(j).IsLeaf())
+        continue;
+      treeLayout.push_back(numCounters + positions.at(j));
+      treeLayout.push_back(depths.at(j));
+    }
+    offsets.push_back(numCounters);
+    numCounters += tree.GetNumberOfTiles();
+  }
+  std::vector<int64_t> layout{ static_cast<int64_t>(forest.NumTrees()), numCounters };
+  for (auto& treeLayout : treeLayouts)
+    layout.insert(layout.end(), treeLayout.begin(), treeLayout.end());
+
+  SaveAndRestoreInsertionPoint saveAndRestoreInsertPoint(rewriter);
+  rewriter.setInsertionPoint(&module.front());
+  auto i64Type = rewriter.getI64Type();
+  // Public globals need an initial value to be defined (and exported) by the module
+  auto countsMemrefType = MemRefType::get({numCounters}, i64Type);
+  auto zerosAttr = DenseElementsAttr::get(RankedTensorType::get({numCounters}, i64Type), rewriter.getI64IntegerAttr(0));
+  rewriter.create<memref::GlobalOp>(location, kLeafHitCountsGlobalName, rewriter.getStringAttr("public"), countsMemrefType, zerosAttr, false, IntegerAttr());
+  
+  auto layoutSize = static_cast<int64_t>(layout.size());
+  auto layoutAttr = DenseElementsAttr::get(RankedTensorType::get({layoutSize}, i64Type), llvm::ArrayRef<int64_t>(layout));
+  rewriter.create<memref::GlobalOp>(location, kLeafHitCountLayoutGlobalName, rewriter.getStringAttr("public"), 
+                                    MemRefType::get({layoutSize}, i64Type), layoutAttr, true, IntegerAttr());
+
+  auto offsetsMemrefType = MemRefType::get({static_cast<int64_t>(forest.NumTrees())}, rewriter.getIndexType());
+  createConstantGlobalOp(rewriter, location, kLeafHitCountOffsetsGlobalName, offsetsMemrefType, offsets);
+}
+
 struct GetLeafValueOpLowering : public ConversionPattern {
   std::shared_ptr<decisionforest::IRepresentation> m_representation;
+  bool m_instrumentLeafHitCounts;
 
-  GetLeafValueOpLowering(MLIRContext *ctx, std::shared_ptr<decisionforest::IRepresentation> representation) 
-  : ConversionPattern(mlir::decisionforest::GetLeafValueOp::getOperationName(), 1 /*benefit*/, ctx), m_representation(representation) {}
+  GetLeafValueOpLowering(MLIRContext *ctx, std::shared_ptr<decisionforest::IRepresentation> representation, bool instrumentLeafHitCounts=false) 
+  : ConversionPattern(mlir::decisionforest::GetLeafValueOp::getOperationName(), 1 /*benefit*/, ctx), m_representation(representation),
+    m_instrumentLeafHitCounts(instrumentLeafHitCounts) {}
+
+  void IncrementLeafHitCount(ConversionPatternRewriter &rewriter, Operation *op, Value tree, Value nodeIndex) const {
+    assert (dynamic_cast<ArrayBasedRepresentation*>(m_representation.get()) && m_representation->GetTileSize() == 1 &&
+            "Leaf hit counts can only be collected for untiled trees in the array representation");
+    auto location = op->getLoc();
+    auto module = op->getParentOfType<mlir::ModuleOp>();
+    if (!module.lookupSymbol<memref::GlobalOp>(kLeafHitCountsGlobalName)) {
+      auto getTreeOp = AssertOpIsOfType<decisionforest::GetTreeFromEnsembleOp>(tree.getDefiningOp());
+      auto ensembleConstOp = AssertOpIsOfType<decisionforest::EnsembleConstantOp>(getTreeOp.getForest().getDefiningOp());
+      AddLeafHitCountGlobals(rewriter, location, module, ensembleConstOp.getForest().GetDecisionForest());
+    }
+    auto countsMemrefType = module.lookupSymbol<memref::GlobalOp>(kLeafHitCountsGlobalName).getType();
+    auto offsetsMemrefType = module.lookupSymbol<memref::GlobalOp>(kLeafHitCountOffsetsGlobalName).getType();
+    auto counts = rewriter.create<memref::GetGlobalOp>(location, countsMemrefType, kLeafHitCountsGlobalName);
+    auto offsets = rewriter.create<memref::GetGlobalOp>(location, offsetsMemrefType, kLeafHitCountOffsetsGlobalName);
+
+    auto treeOffset = rewriter.create<memref::LoadOp>(location, offsets, m_representation->GetTreeIndex(tree));
+    auto counterIndex = rewriter.create<arith::AddIOp>(location, static_cast<Value>(treeOffset), nodeIndex);
+    auto oneConst = rewriter.create<arith::ConstantIntOp>(location, int64_t(1), rewriter.getI64Type());
+    // The rows of a batch may be walked on several threads
+    rewriter.create<memref::AtomicRMWOp>(location, rewriter.getI64Type(), arith::AtomicRMWKind::addi, oneConst, counts, ValueRange{counterIndex});
+  }
 
   LogicalResult
   matchAndRewrite(Operation *op, ArrayRef<Value> operands, ConversionPatternRewriter &rewriter) const final {
@@ -434,6 +688,9 @@ struct GetLeafValueOpLowering : public ConversionPattern {
       rewriter.create<decisionforest::PrintTreeNodeOp>(location, nodeIndex);
     }
 
+    if (m_instrumentLeafHitCounts)
+      IncrementLeafHitCount(rewriter, op, operands[0], nodeIndex);
+
     auto leafValue = m_representation->GenerateGetLeafValueOp(rewriter, op, operands[0], nodeIndex);
     // TODO cast the loaded value to the correct result type of the tree. 
     rewriter.replaceOp(op, static_cast<Value>(leafValue));
@@ -457,6 +714,8 @@ struct GetLeafTileValueOpLowering : public ConversionPattern {
     auto location = op->getLoc();
 
     auto thresholdType = m_representation->GetThresholdFieldType();
+    // The thresholds of quantized models are bin indices and don't hold the leaf values
+    assert (m_representation->GetThresholdElementType().isa<FloatType>() && "Peeled walks are not supported for quantized models");
     auto node = getLeafValAdaptor.getNode();
     auto tree = getLeafValAdaptor.getTree();
     auto nodeIndex = rewriter.create<decisionforest::NodeToIndexOp>(location, 
@@ -566,8 +825,10 @@ struct CacheRowsOpLowering: public ConversionPattern {
 struct MidLevelIRToMemrefLoweringPass: public PassWrapper<MidLevelIRToMemrefLoweringPass, OperationPass<mlir::ModuleOp>> {
   std::shared_ptr<decisionforest::IModelSerializer> m_serializer;
   std::shared_ptr<decisionforest::IRepresentation> m_representation;
-  MidLevelIRToMemrefLoweringPass(std::shared_ptr<decisionforest::IModelSerializer> serializer, std::shared_ptr<decisionforest::IRepresentation> representation)
-    :m_serializer(serializer), m_representation(representation) { }
+  bool m_instrumentLeafHitCounts;
+  MidLevelIRToMemrefLoweringPass(std::shared_ptr<decisionforest::IModelSerializer> serializer, std::shared_ptr<decisionforest::IRepresentation> representation,
+                                 bool instrumentLeafHitCounts)
+    :m_serializer(serializer), m_representation(representation), m_instrumentLeafHitCounts(instrumentLeafHitCounts) { }
 
   void getDependentDialects(DialectRegistry &registry) const override {
     registry.insert<AffineDialect, memref::MemRefDialect, scf::SCFDialect>();
@@ -590,6 +851,7 @@ struct MidLevelIRToMemrefLoweringPass: public PassWrapper<MidLevelIRToMemrefLowe
                         decisionforest::IsLeafTileOp,
                         decisionforest::TraverseTreeTileOp,
                         decisionforest::InterleavedTraverseTreeTileOp,
+                        decisionforest::TraverseObliviousTreesOp,
                         decisionforest::GetLeafValueOp,
                         decisionforest::GetLeafTileValueOp,
                         decisionforest::GetTreeClassIdOp,
@@ -600,10 +862,11 @@ struct MidLevelIRToMemrefLoweringPass: public PassWrapper<MidLevelIRToMemrefLowe
     patterns.add<EnsembleConstantOpLowering>(patterns.getContext(), m_serializer, m_representation);
     patterns.add<TraverseTreeTileOpLowering>(patterns.getContext(), m_representation);
     patterns.add<InterleavedTraverseTreeTileOpLowering>(patterns.getContext(), m_representation);
+    patterns.add<TraverseObliviousTreesOpLowering>(patterns.getContext(), m_representation);
     patterns.add<GetRootOpLowering>(patterns.getContext(), m_representation);
     patterns.add<GetTreeOpLowering>(patterns.getContext(), m_representation);
     patterns.add<GetTreeClassIdOpLowering>(patterns.getContext(), m_representation);
-    patterns.add<GetLeafValueOpLowering>(patterns.getContext(), m_representation);
+    patterns.add<GetLeafValueOpLowering>(patterns.getContext(), m_representation, m_instrumentLeafHitCounts);
     patterns.add<GetLeafTileValueOpLowering>(patterns.getContext(), m_representation);
     patterns.add<IsLeafOpLowering>(patterns.getContext(), m_representation);
     patterns.add<IsLeafTileOpLowering>(patterns.getContext(), m_representation);
@@ -677,11 +940,12 @@ namespace decisionforest
 
 void LowerEnsembleToMemrefs(mlir::MLIRContext& context, mlir::ModuleOp module, 
                             std::shared_ptr<IModelSerializer> serializer,
-                            std::shared_ptr<IRepresentation> representation) {
+                            std::shared_ptr<IRepresentation> representation,
+                            bool instrumentLeafHitCounts) {
   // llvm::DebugFlag = true;
   // Lower from high-level IR to mid-level IR
   mlir::PassManager pm(&context);
-  pm.addPass(std::make_unique<MidLevelIRToMemrefLoweringPass>(serializer, representation));
+  pm.addPass(std::make_unique<MidLevelIRToMemrefLoweringPass>(serializer, representation, instrumentLeafHitCounts));
 
   if (mlir::failed(pm.run(module))) {
     llvm::errs() << "Lowering to memrefs failed.\n";
@@ -194,10 +194,10 @@ struct EnsembleConstantOpLowering: public ConversionPattern {
       return Type(); // We don't need a lookup table if the tile size is 1
     
     auto numberOfTileOutcomes = static_cast<int>(std::pow(2, tileSize));
-    auto numberOfTileShapes = mlir::decisionforest::TileShapeToTileIDMap::NumberOfTileShapes(tileSize);
     // TODO We may need to implement something smarter here. We don't really need I8's for each outcome. We could store all outcomes
     // in a single int64 for tile size 4 for example (each entry needs 3 bits and there are 16 entries -- one for each outcome). 
-    auto lutMemrefType = MemRefType::get({numberOfTileShapes, numberOfTileOutcomes}, rewriter.getI8Type());
+    auto lutMemrefType = MemRefType::get({mlir::decisionforest::TileShapeToTileIDMap::NumberOfTileShapes(tileSize), numberOfTileOutcomes}, 
+                                         rewriter.getI8Type());
 
     rewriter.create<memref::GlobalOp>(location, lookupTableMemrefName,
                                       /*sym_visibility=*/rewriter.getStringAttr("private"),
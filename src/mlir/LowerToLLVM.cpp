@@ -1,4 +1,6 @@
 // #include "Passes.h"
+#include <set>
+#include <functional>
 
 #include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
 #include "mlir/Conversion/LLVMCommon/ConversionTarget.h"
@@ -29,12 +31,16 @@
 
 #include "Dialect.h"
 #include "Representations.h"
+#include "TaskRuntime.h"
+#include "ModelReplicas.h"
 
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "mlir/Transforms/RegionUtils.h"
 #include "llvm/ADT/Sequence.h"
+#include "llvm/ADT/SetVector.h"
 
 #include "mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h"
 #include "mlir/Target/LLVMIR/Export.h"
@@ -155,6 +161,325 @@ struct LowerOMPToLLVMPass : public PassWrapper<LowerOMPToLLVMPass, OperationPass
   }
 };
 
+// Runs the parallel loops on the work stealing task runtime (runtime/TaskRuntime.cpp) instead of in OpenMP 
+// parallel regions. The body of every scf.parallel is outlined into a function that runs a range of the 
+// loop's iterations and the loop is replaced by a call to TreebeardParallelFor. The values the body uses 
+// from the enclosing function are passed to it through a struct on the stack. Outer loops are outlined 
+// first so that the struct of a nested loop is on the stack of the thread that runs it.
+struct ParallelLoopToTaskRuntimePass : public PassWrapper<ParallelLoopToTaskRuntimePass, OperationPass<ModuleOp>> {
+  std::shared_ptr<decisionforest::IRepresentation> m_representation;
+  int32_t m_numOutlinedLoops = 0;
+
+  ParallelLoopToTaskRuntimePass(std::shared_ptr<decisionforest::IRepresentation> representation)
+    :m_representation(representation)
+  { }
+
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<LLVM::LLVMDialect, scf::SCFDialect, arith::ArithDialect, func::FuncDialect>();
+  }
+
+  func::FuncOp GetOrInsertParallelForFunction(OpBuilder& builder, FunctionType bodyType) {
+    auto module = getOperation();
+    if (auto parallelFor = module.lookupSymbol<func::FuncOp>(TreeBeard::runtime::kParallelForFunctionName))
+      return parallelFor;
+    OpBuilder::InsertionGuard insertGuard(builder);
+    builder.setInsertionPointToStart(module.getBody());
+    auto voidPtrType = LLVM::LLVMPointerType::get(builder.getI8Type());
+    auto functionType = builder.getFunctionType({builder.getI64Type(), bodyType, voidPtrType}, {});
+    auto parallelFor = builder.create<func::FuncOp>(module.getLoc(), TreeBeard::runtime::kParallelForFunctionName, functionType);
+    parallelFor.setPrivate();
+    return parallelFor;
+  }
+
+  // Values computed only from constants and global addresses (like the memref descriptors of the model
+  // globals) are recomputed in the outlined body instead of being passed to it. Besides keeping the struct 
+  // small, this lets the body look up the model buffers on the thread that runs it (see ModelReplicaPass).
+  bool IsRematerializable(Value value) {
+    auto definingOp = value.getDefiningOp();
+    if (!definingOp || !llvm::isa<LLVM::AddressOfOp, LLVM::ConstantOp, LLVM::UndefOp, LLVM::InsertValueOp, LLVM::GEPOp,
+                                  LLVM::IntToPtrOp, LLVM::BitcastOp, UnrealizedConversionCastOp>(definingOp))
+      return false;
+    return llvm::all_of(definingOp->getOperands(), [&](Value operand) { return IsRematerializable(operand); });
+  }
+
+  Value Rematerialize(OpBuilder& builder, Value value, llvm::DenseMap<Value, Value>& rematerializedValues) {
+    auto rematerializedValue = rematerializedValues.find(value);
+    if (rematerializedValue != rematerializedValues.end())
+      return rematerializedValue->second;
+    auto definingOp = value.getDefiningOp();
+    SmallVector<Value> operands;
+    for (auto operand : definingOp->getOperands())
+      operands.push_back(Rematerialize(builder, operand, rematerializedValues));
+    auto clonedOp = builder.clone(*definingOp);
+    clonedOp->setOperands(operands);
+    for (unsigned i=0 ; i<definingOp->getNumResults() ; ++i)
+      rematerializedValues[definingOp->getResult(i)] = clonedOp->getResult(i);
+    return rematerializedValues[value];
+  }
+
+  void OutlineParallelLoop(scf::ParallelOp parallelOp, LLVMTypeConverter& typeConverter) {
+    assert (parallelOp.getNumLoops() == 1 && parallelOp.getNumReductions() == 0 && "Only one dimensional parallel loops without reductions are supported");
+    auto module = getOperation();
+    auto location = parallelOp.getLoc();
+    OpBuilder builder(&getContext());
+    auto indexType = builder.getIndexType();
+    auto i64Type = builder.getI64Type();
+    auto voidPtrType = LLVM::LLVMPointerType::get(builder.getI8Type());
+    // void body(int64_t begin, int64_t end, void *context)
+    auto bodyType = builder.getFunctionType({i64Type, i64Type, voidPtrType}, {});
+
+    Value lowerBound = parallelOp.getLowerBound()[0];
+    Value upperBound = parallelOp.getUpperBound()[0];
+    Value step = parallelOp.getStep()[0];
+    // The outlined body computes the induction variable from the iteration number, the lower bound and the step
+    llvm::SetVector<Value> usedValues;
+    usedValues.insert(lowerBound);
+    usedValues.insert(step);
+    getUsedValuesDefinedAbove(parallelOp.getRegion(), usedValues);
+    SmallVector<Value> capturedValues;
+    SmallVector<Type> fieldTypes;
+    for (auto value : usedValues) {
+      if (IsRematerializable(value))
+        continue;
+      capturedValues.push_back(value);
+      auto fieldType = typeConverter.convertType(value.getType());
+      assert (fieldType && "Values used in a parallel loop must have an LLVM type");
+      fieldTypes.push_back(fieldType);
+    }
+    auto contextType = LLVM::LLVMStructType::getLiteral(&getContext(), fieldTypes);
+    auto contextPtrType = LLVM::LLVMPointerType::get(contextType);
+    auto getFieldPtr = [&](Value ptr, size_t fieldIndex) -> Value {
+      auto fieldPtrType = LLVM::LLVMPointerType::get(fieldTypes[fieldIndex]);
+      return builder.create<LLVM::GEPOp>(location, fieldPtrType, ptr, ArrayRef<LLVM::GEPArg>{0, static_cast<int32_t>(fieldIndex)});
+    };
+
+    // The struct is allocated once in the entry block so that loops around the parallel loop don't grow the stack
+    auto parentFunction = parallelOp->getParentOfType<func::FuncOp>();
+    builder.setInsertionPointToStart(&parentFunction.getBody().front());
+    auto one = builder.create<LLVM::ConstantOp>(location, i64Type, builder.getI64IntegerAttr(1));
+    Value contextPtr = builder.create<LLVM::AllocaOp>(location, contextPtrType, one, 0);
+
+    builder.setInsertionPoint(parallelOp);
+    for (size_t i=0 ; i<capturedValues.size() ; ++i) {
+      Value value = capturedValues[i];
+      if (value.getType() != fieldTypes[i])
+        value = builder.create<UnrealizedConversionCastOp>(location, fieldTypes[i], value).getResult(0);
+      builder.create<LLVM::StoreOp>(location, value, getFieldPtr(contextPtr, i));
+    }
+    // numIterations = ceil((upperBound - lowerBound) / step)
+    auto stepMinusOne = builder.create<arith::SubIOp>(location, step, builder.create<arith::ConstantIndexOp>(location, 1));
+    auto range = builder.create<arith::SubIOp>(location, upperBound, lowerBound);
+    auto tripCount = builder.create<arith::DivUIOp>(location, builder.create<arith::AddIOp>(location, range, stepMinusOne), step);
+    auto numIterations = builder.create<arith::IndexCastOp>(location, i64Type, tripCount);
+    
+    auto parallelFor = GetOrInsertParallelForFunction(builder, bodyType);
+    auto functionName = parentFunction.getName().str() + "_ParallelLoop" + std::to_string(m_numOutlinedLoops++);
+    auto bodyFunctionPtr = builder.create<func::ConstantOp>(location, bodyType, FlatSymbolRefAttr::get(&getContext(), functionName));
+    auto voidContextPtr = builder.create<LLVM::BitcastOp>(location, voidPtrType, contextPtr);
+    builder.create<func::CallOp>(location, parallelFor, ValueRange{numIterations, bodyFunctionPtr, voidContextPtr});
+
+    // Unpack the captured values in the outlined function and run iterations [begin, end) of the loop
+    builder.setInsertionPointToEnd(module.getBody());
+    auto bodyFunction = builder.create<func::FuncOp>(location, functionName, bodyType);
+    auto& entryBlock = *bodyFunction.addEntryBlock();
+    builder.setInsertionPointToStart(&entryBlock);
+    Value typedContextPtr = builder.create<LLVM::BitcastOp>(location, contextPtrType, entryBlock.getArgument(2));
+    llvm::DenseMap<Value, Value> unpackedValues;
+    for (size_t i=0 ; i<capturedValues.size() ; ++i) {
+      Value value = builder.create<LLVM::LoadOp>(location, fieldTypes[i], getFieldPtr(typedContextPtr, i));
+      if (value.getType() != capturedValues[i].getType())
+        value = builder.create<UnrealizedConversionCastOp>(location, capturedValues[i].getType(), value).getResult(0);
+      unpackedValues[capturedValues[i]] = value;
+    }
+    for (auto value : usedValues)
+      Rematerialize(builder, value, unpackedValues);
+    auto begin = builder.create<arith::IndexCastOp>(location, indexType, entryBlock.getArgument(0));
+    auto end = builder.create<arith::IndexCastOp>(location, indexType, entryBlock.getArgument(1));
+    auto forOp = builder.create<scf::ForOp>(location, begin, end, builder.create<arith::ConstantIndexOp>(location, 1));
+    builder.create<func::ReturnOp>(location);
+
+    auto& forBody = *forOp.getBody();
+    builder.setInsertionPointToStart(&forBody);
+    auto scaledIteration = builder.create<arith::MulIOp>(location, forOp.getInductionVar(), unpackedValues[step]);
+    auto inductionVar = builder.create<arith::AddIOp>(location, unpackedValues[lowerBound], scaledIteration);
+    auto& parallelBody = *parallelOp.getBody();
+    parallelBody.getArgument(0).replaceAllUsesWith(inductionVar);
+    // Everything but the scf.yield terminator moves into the for loop
+    forBody.getOperations().splice(forBody.getTerminator()->getIterator(), parallelBody.getOperations(),
+                                   parallelBody.begin(), std::prev(parallelBody.end()));
+    for (auto value : usedValues)
+      replaceAllUsesInRegionWith(value, unpackedValues[value], forOp.getRegion());
+    parallelOp.erase();
+  }
+
+  void runOnOperation() final {
+    auto module = getOperation();
+    auto& context = getContext();
+    LowerToLLVMOptions options(&context);
+    LLVMTypeConverter typeConverter(&context, options);
+    m_representation->AddTypeConversions(context, typeConverter);
+
+    std::vector<scf::ParallelOp> parallelLoops;
+    module.walk<WalkOrder::PreOrder>([&](scf::ParallelOp parallelOp) { parallelLoops.push_back(parallelOp); });
+    for (auto parallelOp : parallelLoops)
+      OutlineParallelLoop(parallelOp, typeConverter);
+  }
+};
+
+// Adds kSingleRowPredictFunctionName to modules compiled for a batch size of 1. It is a copy of the lowered 
+// prediction function that takes a bare pointer to the row and returns the prediction by value. The memref 
+// descriptor fields of the input and the result are replaced by constants (the result is a stack slot) so 
+// that none of them are passed.
+struct SingleRowPredictFunctionPass : public PassWrapper<SingleRowPredictFunctionPass, OperationPass<ModuleOp>> {
+  int64_t m_rowSize;
+
+  SingleRowPredictFunctionPass(int64_t rowSize)
+    : m_rowSize(rowSize)
+  { }
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<LLVM::LLVMDialect>();
+  }
+  void runOnOperation() final {
+    auto module = getOperation();
+    auto predictionFunction = module.lookupSymbol<LLVM::LLVMFuncOp>("Prediction_Function");
+    // (allocated ptr, aligned ptr, offset, 2 sizes, 2 strides) of the input and (allocated ptr, aligned ptr, offset, size, stride) of the result
+    const unsigned kNumDescriptorFields = 12;
+    assert (predictionFunction && predictionFunction.getNumArguments() == kNumDescriptorFields);
+    auto location = predictionFunction.getLoc();
+    auto inputPtrType = predictionFunction.getArgument(0).getType();
+    auto resultPtrType = predictionFunction.getArgument(7).getType().cast<LLVM::LLVMPointerType>();
+    auto resultType = resultPtrType.getElementType();
+    auto indexType = predictionFunction.getArgument(2).getType();
+
+    auto predictFunction = llvm::cast<LLVM::LLVMFuncOp>(predictionFunction->clone());
+    predictFunction.setSymName(kSingleRowPredictFunctionName);
+    predictFunction.setFunctionTypeAttr(TypeAttr::get(LLVM::LLVMFunctionType::get(resultType, {inputPtrType})));
+    module.push_back(predictFunction);
+
+    auto& entryBlock = predictFunction.getBody().front();
+    auto row = entryBlock.insertArgument(0u, inputPtrType, location);
+    OpBuilder builder(&getContext());
+    builder.setInsertionPointToStart(&entryBlock);
+    auto constant = [&](int64_t value) -> Value {
+      return builder.create<LLVM::ConstantOp>(location, indexType, builder.getIntegerAttr(indexType, value));
+    };
+    auto zero = constant(0), one = constant(1), rowSize = constant(m_rowSize);
+    Value result = builder.create<LLVM::AllocaOp>(location, resultPtrType, one, 0);
+    Value descriptorFields[kNumDescriptorFields] = { row, row, zero, one, rowSize, rowSize, one, result, result, zero, one, one };
+    for (unsigned i=0 ; i<kNumDescriptorFields ; ++i)
+      entryBlock.getArgument(i+1).replaceAllUsesWith(descriptorFields[i]);
+    entryBlock.eraseArguments(1, kNumDescriptorFields);
+
+    std::vector<LLVM::ReturnOp> returnOps;
+    predictFunction.walk([&](LLVM::ReturnOp returnOp) { returnOps.push_back(returnOp); });
+    for (auto returnOp : returnOps) {
+      builder.setInsertionPoint(returnOp);
+      auto prediction = builder.create<LLVM::LoadOp>(location, resultType, result);
+      builder.create<LLVM::ReturnOp>(location, ValueRange{prediction});
+      returnOp.erase();
+    }
+  }
+};
+
+// Makes the functions that run inference read the model from its copy on the NUMA node of the thread that 
+// runs them (see runtime/ModelReplicas.h). The model is stored in the constant globals and the globals the 
+// Init_ functions fill. Every other function gets the address of these globals from TreebeardGetLocalReplica. 
+// kInitModelReplicasFunctionName and kReleaseModelReplicasFunctionName create and free the copies.
+struct ModelReplicaPass : public PassWrapper<ModelReplicaPass, OperationPass<ModuleOp>> {
+  int32_t m_hugePages;
+
+  ModelReplicaPass(int32_t hugePages)
+    : m_hugePages(hugePages)
+  { }
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<LLVM::LLVMDialect>();
+  }
+
+  static bool IsInitFunction(LLVM::LLVMFuncOp function) {
+    return function && function.getSymName().startswith("Init_");
+  }
+
+  LLVM::LLVMFuncOp GetOrInsertFunction(OpBuilder& builder, const std::string& functionName, LLVM::LLVMFunctionType functionType) {
+    auto module = getOperation();
+    if (auto function = module.lookupSymbol<LLVM::LLVMFuncOp>(functionName))
+      return function;
+    OpBuilder::InsertionGuard insertGuard(builder);
+    builder.setInsertionPointToStart(module.getBody());
+    return builder.create<LLVM::LLVMFuncOp>(module.getLoc(), functionName, functionType);
+  }
+
+  // Adds a function that calls the runtime function for the address of every model global 
+  void AddFunctionOverModelGlobals(OpBuilder& builder, const std::string& functionName, std::vector<LLVM::GlobalOp>& modelGlobals,
+                                   std::function<void(Value)> callRuntimeFunction) {
+    auto module = getOperation();
+    auto location = module.getLoc();
+    auto functionType = LLVM::LLVMFunctionType::get(LLVM::LLVMVoidType::get(&getContext()), {});
+    builder.setInsertionPointToEnd(module.getBody());
+    auto function = builder.create<LLVM::LLVMFuncOp>(location, functionName, functionType);
+    builder.setInsertionPointToStart(function.addEntryBlock());
+    for (auto global : modelGlobals)
+      callRuntimeFunction(builder.create<LLVM::AddressOfOp>(location, global));
+    builder.create<LLVM::ReturnOp>(location, ValueRange{});
+  }
+
+  void runOnOperation() final {
+    auto module = getOperation();
+    auto location = module.getLoc();
+    OpBuilder builder(&getContext());
+    auto voidType = LLVM::LLVMVoidType::get(&getContext());
+    auto i8PtrType = LLVM::LLVMPointerType::get(builder.getI8Type());
+    auto i64Type = builder.getI64Type();
+
+    std::set<std::string> initializedGlobals, modelGlobalNames;
+    module.walk([&](LLVM::AddressOfOp addressOf) {
+      if (IsInitFunction(addressOf->getParentOfType<LLVM::LLVMFuncOp>()))
+        initializedGlobals.insert(addressOf.getGlobalName().str());
+    });
+    std::vector<LLVM::GlobalOp> modelGlobals;
+    for (auto global : module.getOps<LLVM::GlobalOp>()) {
+      if (global.getConstant() || initializedGlobals.count(global.getSymName().str())) {
+        modelGlobals.push_back(global);
+        modelGlobalNames.insert(global.getSymName().str());
+      }
+    }
+    if (modelGlobals.empty())
+      return;
+
+    auto getLocalReplica = GetOrInsertFunction(builder, TreeBeard::runtime::kGetLocalReplicaFunctionName, 
+                                               LLVM::LLVMFunctionType::get(i8PtrType, {i8PtrType}));
+    std::vector<LLVM::AddressOfOp> modelGlobalAddresses;
+    module.walk([&](LLVM::AddressOfOp addressOf) {
+      if (!IsInitFunction(addressOf->getParentOfType<LLVM::LLVMFuncOp>()) && modelGlobalNames.count(addressOf.getGlobalName().str()))
+        modelGlobalAddresses.push_back(addressOf);
+    });
+    for (auto addressOf : modelGlobalAddresses) {
+      builder.setInsertionPointAfter(addressOf);
+      auto buffer = builder.create<LLVM::BitcastOp>(addressOf.getLoc(), i8PtrType, addressOf);
+      auto replica = builder.create<LLVM::CallOp>(addressOf.getLoc(), getLocalReplica, ValueRange{buffer});
+      auto typedReplica = builder.create<LLVM::BitcastOp>(addressOf.getLoc(), addressOf.getType(), replica->getResult(0));
+      addressOf.getResult().replaceAllUsesExcept(typedReplica, buffer);
+    }
+
+    auto replicateBuffer = GetOrInsertFunction(builder, TreeBeard::runtime::kReplicateBufferFunctionName, 
+                                               LLVM::LLVMFunctionType::get(voidType, {i8PtrType, i64Type, builder.getI32Type()}));
+    AddFunctionOverModelGlobals(builder, kInitModelReplicasFunctionName, modelGlobals, [&](Value address) {
+      // sizeof(global) is the address of the element after it in an array starting at null
+      auto nullPtr = builder.create<LLVM::NullOp>(location, address.getType());
+      auto end = builder.create<LLVM::GEPOp>(location, address.getType(), nullPtr, ArrayRef<LLVM::GEPArg>{1});
+      auto size = builder.create<LLVM::PtrToIntOp>(location, i64Type, end);
+      auto hugePages = builder.create<LLVM::ConstantOp>(location, builder.getI32Type(), builder.getI32IntegerAttr(m_hugePages));
+      auto buffer = builder.create<LLVM::BitcastOp>(location, i8PtrType, address);
+      builder.create<LLVM::CallOp>(location, replicateBuffer, ValueRange{buffer, size, hugePages});
+    });
+    auto releaseReplicas = GetOrInsertFunction(builder, TreeBeard::runtime::kReleaseReplicasFunctionName, 
+                                               LLVM::LLVMFunctionType::get(voidType, {i8PtrType}));
+    AddFunctionOverModelGlobals(builder, kReleaseModelReplicasFunctionName, modelGlobals, [&](Value address) {
+      auto buffer = builder.create<LLVM::BitcastOp>(location, i8PtrType, address);
+      builder.create<LLVM::CallOp>(location, releaseReplicas, ValueRange{buffer});
+    });
+  }
+};
+
 struct PrintModulePass : public PassWrapper<PrintModulePass, OperationPass<ModuleOp>> {
   void getDependentDialects(DialectRegistry &registry) const override {
     registry.insert<LLVM::LLVMDialect, scf::SCFDialect, AffineDialect, memref::MemRefDialect, 
@@ -176,18 +501,41 @@ namespace decisionforest
 
 void LowerToLLVM(mlir::MLIRContext& context, 
                  mlir::ModuleOp module,
-                 std::shared_ptr<IRepresentation> representation) {
+                 std::shared_ptr<IRepresentation> representation,
+                 bool useWorkStealingRuntime,
+                 bool replicateModelPerNUMANode,
+                 int32_t modelHugePages) {
   // llvm::DebugFlag = true;
+  // Only modules that predict one row at a time (with a float result and no arguments other than the input 
+  // and the result) get a single row entry point
+  auto predictionFunction = module.lookupSymbol<func::FuncOp>("Prediction_Function");
+  bool addSingleRowPredictFunction = false;
+  int64_t rowSize = 0;
+  if (predictionFunction) {
+    auto inputType = predictionFunction.getFunctionType().getInput(0).cast<MemRefType>();
+    auto resultType = predictionFunction.getFunctionType().getResult(0).cast<MemRefType>();
+    addSingleRowPredictFunction = inputType.getShape()[0] == 1 && resultType.getElementType().isa<FloatType>() &&
+                                  predictionFunction.getNumArguments() == 2;
+    rowSize = inputType.getShape()[1];
+  }
+
   // Lower from low-level IR to LLVM IR
   mlir::PassManager pm(&context);
   pm.addPass(memref::createExpandStridedMetadataPass());
   // pm.addPass(std::make_unique<PrintModulePass>());
   pm.addPass(std::make_unique<DecisionForestToLLVMLoweringPass>(representation));
-  pm.addPass(createConvertSCFToOpenMPPass());
+  if (useWorkStealingRuntime)
+    pm.addPass(std::make_unique<ParallelLoopToTaskRuntimePass>(representation));
+  else
+    pm.addPass(createConvertSCFToOpenMPPass());
   pm.addPass(createMemRefToLLVMConversionPass());
   pm.addPass(createConvertSCFToCFPass());
   pm.addPass(std::make_unique<LowerOMPToLLVMPass>(representation));
   pm.addPass(createReconcileUnrealizedCastsPass());
+  if (addSingleRowPredictFunction)
+    pm.addPass(std::make_unique<SingleRowPredictFunctionPass>(rowSize));
+  if (replicateModelPerNUMANode)
+    pm.addPass(std::make_unique<ModelReplicaPass>(modelHugePages));
   
   if (mlir::failed(pm.run(module))) {
     llvm::errs() << "Lowering to LLVM failed.\n";
@@ -1,6 +1,13 @@
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 #include "Dialect.h"
+#include "Logger.h"
 // #include "Passes.h"
 #include "OpLoweringUtils.h"
+#include "LIRLoweringHelpers.h"
+#include "TypeDefinitions.h"
 
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
@@ -8,12 +15,14 @@
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "mlir/Dialect/Math/IR/Math.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Dialect/GPU/Transforms/ParallelLoopMapper.h"
 
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/ADT/APFloat.h"
 
 
 using namespace mlir;
@@ -74,13 +83,50 @@ void InsertPrintElementOp(
     rewriter.create<decisionforest::PrintVectorOp>(location, kindConst, bitWidthConst, tileSizeConst, ValueRange{value});
   }
 
+// A group of trees [start, end) walked between two early exit checks. After the group, the class of a row
+// is still undecided if negativeCut < (sum of the predictions of the trees so far) <= positiveCut.
+struct EarlyExitTreeGroup {
+  int64_t start;
+  int64_t end;
+  double negativeCut;
+  double positiveCut;
+};
+
 typedef struct {
   bool isMultiClass;
+  bool hasGPUMapping;
+
+  // How the tree predictions are combined. The votes of a voting forest are counted in the class weights memref.
+  decisionforest::ReductionType reductionType;
+  // Whether the trees of a voting forest are walked for a vector of rows at a time and their votes for the rows are
+  // counted together (see GenerateVectorizedVotingBatchLoop). Only set for voting forests whose tree loop is a simple 
+  // innermost loop.
+  bool vectorizeVotes = false;
 
   // Memrefs and Types
   Value treeClassesMemref;
   MemRefType treeClassesMemrefType;
 
+  // The PredictionOutputMode argument of the prediction function of a multi-class model on the CPU. The class 
+  // weights are accumulated in the caller's scores memref unless the class is predicted. Not set on the GPU.
+  Value outputMode;
+
+  // [start, end) tree indices of each class. Only non-empty when the trees are grouped by class 
+  // and the tree loop can be split into one loop per class.
+  std::vector<std::pair<int64_t, int64_t>> classTreeRanges;
+
+  // Groups of trees with early exit checks between them. Only non-empty if early exit is enabled on the tree index.
+  std::vector<EarlyExitTreeGroup> earlyExitTreeGroups;
+
+  // [start, end) range of trees to walk, passed as arguments of the prediction function. 
+  // Only set if the tree index is marked for anytime prediction.
+  Value anytimeTreeStart;
+  Value anytimeTreeEnd;
+
+  // Whether the sigmoid is applied to the prediction of a row as it is stored into the result memref, 
+  // instead of in a separate pass over the results. Only set when one sequential loop walks all the trees of a row.
+  bool fuseSigmoidWithResultStore = false;
+
   Value resultMemref;
   MemRefType resultMemrefType;
 
@@ -88,6 +134,18 @@ typedef struct {
   MemRefType dataMemrefType;
   Value inputIndexOffset;
 
+  // Input column of each feature of a forest whose features have been compacted and whether state.data 
+  // holds compacted rows. Empty if the features of the forest aren't compacted.
+  std::vector<int32_t> compactFeatureColumns;
+  bool isDataCompacted = false;
+
+  // Global with the bin boundaries of every feature of a quantized forest and whether state.data holds
+  // binned rows. Only set if the thresholds of the forest are quantized. If only some features are binned
+  // (features with thresholds that aren't exact in 16 bits), binnedFeatures lists them.
+  FlatSymbolRefAttr binBoundaries;
+  std::vector<int32_t> binnedFeatures;
+  bool isDataBinned = false;
+
   // Indices
   arith::ConstantIndexOp numClassesConst;
   arith::ConstantIndexOp oneIndexConst;
@@ -119,6 +177,106 @@ Value SumOfValues(ConversionPatternRewriter &rewriter, Location location, std::l
   return accumulator;
 }
 
+// Whether the index is the inner index of a tile whose last tile is shorter than the others
+bool IsInnerIndexOfPartialTile(const decisionforest::IndexVariable& indexVar) {
+  auto tileModifier = dynamic_cast<decisionforest::TileIndexModifier*>(indexVar.GetParentModifier());
+  return tileModifier && tileModifier->PartialTiles() && &tileModifier->InnerIndex() == &indexVar;
+}
+
+// Whether the tree loop is a plain sequential loop over all the trees of the forest that is nested inside
+// the batch loop. The trees of each row can then be walked in any grouping, for example one loop per class 
+// (with the partial sum of the class carried in a register) or groups of trees with early exit checks in between.
+bool IsSimpleInnermostTreeLoop(decisionforest::Schedule& schedule) {
+  auto& treeIndex = schedule.GetTreeIndex();
+  if (treeIndex.GetIndexModifier() != nullptr || !treeIndex.GetContainedLoops().empty())
+    return false;
+  if (treeIndex.Unroll() || treeIndex.Pipelined() || treeIndex.Parallel() || treeIndex.Cache())
+    return false;
+  auto range = treeIndex.GetRange();
+  if (range.m_start != 0 || range.m_stop != schedule.GetForestSize() || range.m_step != 1)
+    return false;
+  for (const decisionforest::IndexVariable* loop = &treeIndex ; loop != nullptr ; loop = loop->GetContainingLoop()) {
+    if (loop->GetGPUDimension().construct != decisionforest::IndexVariable::GPUConstruct::None)
+      return false;
+  }
+  return true;
+}
+
+// Returns the [start, end) tree indices of each class, or an empty vector if the trees of some class
+// are not contiguous in the forest.
+std::vector<std::pair<int64_t, int64_t>> GetClassTreeRanges(decisionforest::DecisionForest& forest) {
+  int32_t numClasses = forest.GetNumClasses();
+  std::vector<std::pair<int64_t, int64_t>> classTreeRanges(numClasses, {0, 0});
+  std::vector<bool> classSeen(numClasses, false);
+  int32_t prevClassId = -1;
+  for (int64_t i=0 ; i<(int64_t)forest.NumTrees() ; ++i) {
+    auto classId = forest.GetTree(i).GetClassId();
+    assert (classId >= 0 && classId < numClasses);
+    if (classId != prevClassId) {
+      if (classSeen.at(classId))
+        return {};
+      classSeen.at(classId) = true;
+      classTreeRanges.at(classId).first = i;
+      prevClassId = classId;
+    }
+    classTreeRanges.at(classId).second = i + 1;
+  }
+  return classTreeRanges;
+}
+
+double RoundToFloatType(double value, FloatType type, bool roundUp) {
+  llvm::APFloat apValue(value);
+  bool losesInfo = false;
+  apValue.convert(type.getFloatSemantics(), roundUp ? llvm::APFloat::rmTowardPositive : llvm::APFloat::rmTowardNegative, &losesInfo);
+  apValue.convert(llvm::APFloat::IEEEdouble(), llvm::APFloat::rmNearestTiesToEven, &losesInfo);
+  return apValue.convertToDouble();
+}
+
+// The class of a row is decided once the sum of the predictions of the remaining trees can't move 
+// its margin across the decision threshold. For every group boundary, compute the smallest and largest 
+// sums of the leaves of the remaining trees (suffix bounds) and turn them into cuts on the partial sum.
+// The cuts are rounded outwards in the accumulator type so that rounding never decides a row early.
+std::vector<EarlyExitTreeGroup> GetEarlyExitTreeGroups(decisionforest::DecisionForest& forest, int32_t groupSize, double probabilityThreshold,
+                                                       FloatType leafType, FloatType accumulatorType) {
+  int64_t numTrees = forest.NumTrees();
+  std::vector<double> suffixMin(numTrees + 1, 0.0), suffixMax(numTrees + 1, 0.0);
+  for (int64_t i=numTrees-1 ; i>=0 ; --i) {
+    double minLeaf = std::numeric_limits<double>::infinity();
+    double maxLeaf = -std::numeric_limits<double>::infinity();
+    for (auto& node : forest.GetTree(i).GetNodes()) {
+      if (!node.IsLeaf())
+        continue;
+      // The leaves are stored in the threshold type
+      minLeaf = std::min(minLeaf, RoundToFloatType(node.threshold, leafType, false));
+      maxLeaf = std::max(maxLeaf, RoundToFloatType(node.threshold, leafType, true));
+    }
+    suffixMin[i] = suffixMin[i+1] + minLeaf;
+    suffixMax[i] = suffixMax[i+1] + maxLeaf;
+  }
+
+  // sigmoid(initialOffset + sum) > probabilityThreshold <=> sum > marginThreshold
+  double marginThreshold = std::log(probabilityThreshold / (1.0 - probabilityThreshold)) - forest.GetInitialOffset();
+  std::vector<EarlyExitTreeGroup> groups;
+  for (int64_t start=0 ; start<numTrees ; start += groupSize) {
+    int64_t end = std::min(start + groupSize, numTrees);
+    double negativeCut = RoundToFloatType(marginThreshold - suffixMax[end], accumulatorType, false);
+    double positiveCut = RoundToFloatType(marginThreshold - suffixMin[end], accumulatorType, true);
+    groups.push_back(EarlyExitTreeGroup{start, end, negativeCut, positiveCut});
+  }
+  if (TreeBeard::Logging::loggingOptions.logGenCodeStats)
+    TreeBeard::Logging::Log("Early exit checks : " + std::to_string(groups.size() - 1) + " (" + std::to_string(groupSize) + " trees per group)");
+  return groups;
+}
+
+bool LoopNestHasGPUMapping(const decisionforest::IndexVariable& index) {
+  if (index.GetGPUDimension().construct != decisionforest::IndexVariable::GPUConstruct::None)
+    return true;
+  for (auto containedLoop : index.GetContainedLoops())
+    if (LoopNestHasGPUMapping(*containedLoop))
+      return true;
+  return false;
+}
+
 template<typename LoopType>
 struct LoopConstructor {
   LoopType m_loop;
@@ -131,6 +289,8 @@ struct LoopConstructor {
   Value m_oldDataValue;
   MemRefType m_oldDataMemrefType;
   Value m_oldInputIndexOffset;
+  bool m_oldIsDataCompacted;
+  bool m_oldIsDataBinned;
 
   void InsertCacheRowsOpIfNeeded(const decisionforest::IndexVariable& indexVar,
                                  PredictOpLoweringState& loweringState, 
@@ -141,6 +301,8 @@ struct LoopConstructor {
                                  std::list<Value>& batchIndexVars) {
     m_oldDataValue = loweringState.data;
     m_oldDataMemrefType = loweringState.dataMemrefType;
+    m_oldIsDataCompacted = loweringState.isDataCompacted;
+    m_oldIsDataBinned = loweringState.isDataBinned;
     if (indexVar.GetType() != decisionforest::IndexVariable::IndexVariableType::kBatch)
       return;
     if (!indexVar.Cache())
@@ -155,7 +317,27 @@ struct LoopConstructor {
     auto endIndex = rewriter.create<arith::AddIOp>(location, startIndex, step);
     auto inputType = loweringState.dataMemrefType;
     auto numberOfRows = getConstantIntValue(step).value();
-    auto cachedType = MemRefType::get(llvm::ArrayRef<int64_t>{numberOfRows, inputType.getShape()[1]}, 
+    auto numberOfColumns = inputType.getShape()[1];
+    // If the features of the forest are compacted, only copy the used columns. Every cached row
+    // is padded to a whole number of cache lines.
+    DenseI32ArrayAttr featureColumns;
+    if (!loweringState.compactFeatureColumns.empty() && !loweringState.isDataCompacted) {
+      featureColumns = rewriter.getDenseI32ArrayAttr(loweringState.compactFeatureColumns);
+      auto numUsedFeatures = static_cast<int64_t>(loweringState.compactFeatureColumns.size());
+      int64_t elementsPerCacheLine = 64 / (inputType.getElementTypeBitWidth()/8);
+      numberOfColumns = ((numUsedFeatures + elementsPerCacheLine - 1) / elementsPerCacheLine) * elementsPerCacheLine;
+      loweringState.isDataCompacted = true;
+    }
+    // The cached rows of a quantized forest are binned
+    FlatSymbolRefAttr binBoundaries;
+    DenseI32ArrayAttr binnedFeatures;
+    if (loweringState.binBoundaries && !loweringState.isDataBinned) {
+      binBoundaries = loweringState.binBoundaries;
+      if (!loweringState.binnedFeatures.empty())
+        binnedFeatures = rewriter.getDenseI32ArrayAttr(loweringState.binnedFeatures);
+      loweringState.isDataBinned = true;
+    }
+    auto cachedType = MemRefType::get(llvm::ArrayRef<int64_t>{numberOfRows, numberOfColumns}, 
                                       inputType.getElementType(),
                                       {}, // Affine map
                                       3); // Memory space ID
@@ -164,7 +346,10 @@ struct LoopConstructor {
                                                                       cachedType,
                                                                       loweringState.data,
                                                                       startIndex,
-                                                                      static_cast<Value>(endIndex));
+                                                                      static_cast<Value>(endIndex),
+                                                                      featureColumns,
+                                                                      binBoundaries,
+                                                                      binnedFeatures);
     m_oldInputIndexOffset = loweringState.inputIndexOffset;
     
     loweringState.inputIndexOffset = startIndex;
@@ -256,6 +441,8 @@ struct LoopConstructor {
   {
     auto oldDataValue = loweringState.data;
     auto oldDataMemrefType = loweringState.dataMemrefType;
+    auto oldIsDataCompacted = loweringState.isDataCompacted;
+    auto oldIsDataBinned = loweringState.isDataBinned;
     auto oldForestValue = loweringState.forestConst;
 
     auto batchLoopIndices = batchIndexVars;
@@ -283,6 +470,8 @@ struct LoopConstructor {
 
     m_oldDataValue = oldDataValue;
     m_oldDataMemrefType = oldDataMemrefType;
+    m_oldIsDataCompacted = oldIsDataCompacted;
+    m_oldIsDataBinned = oldIsDataBinned;
     m_oldForestValue = oldForestValue;
   }
 
@@ -341,6 +530,8 @@ struct LoopConstructor {
     m_loweringState.forestConst = m_oldForestValue;
     m_loweringState.data = m_oldDataValue;
     m_loweringState.dataMemrefType = m_oldDataMemrefType;
+    m_loweringState.isDataCompacted = m_oldIsDataCompacted;
+    m_loweringState.isDataBinned = m_oldIsDataBinned;
     m_loweringState.inputIndexOffset = m_oldInputIndexOffset;
     m_rewriter.setInsertionPointAfter(m_loop);
   }
@@ -350,7 +541,10 @@ struct LoopConstructor {
 };
 
 struct PredictForestOpLowering: public ConversionPattern {
-  PredictForestOpLowering(MLIRContext *ctx) : ConversionPattern(mlir::decisionforest::PredictForestOp::getOperationName(), 1 /*benefit*/, ctx) {}
+  bool m_useFastApproximateTransforms;
+  PredictForestOpLowering(MLIRContext *ctx, bool useFastApproximateTransforms) 
+    : ConversionPattern(mlir::decisionforest::PredictForestOp::getOperationName(), 1 /*benefit*/, ctx), 
+      m_useFastApproximateTransforms(useFastApproximateTransforms) {}
 
   LogicalResult
   matchAndRewrite(Operation *op, ArrayRef<Value> operands, ConversionPatternRewriter &rewriter) const final {
@@ -399,6 +593,14 @@ struct PredictForestOpLowering: public ConversionPattern {
     return row;
   }
 
+  // The arguments AddPredictionFunctionArgumentsPass appended to the prediction function (the last two arguments)
+  std::pair<Value, Value> GetPredictionFunctionArguments(mlir::decisionforest::PredictForestOp forestOp) const {
+    auto function = forestOp->getParentOfType<func::FuncOp>();
+    auto numArguments = function.getNumArguments();
+    assert (numArguments == 4 && "Expected the input, the result and two arguments added by AddPredictionFunctionArgumentsPass");
+    return std::make_pair(static_cast<Value>(function.getArgument(numArguments - 2)), static_cast<Value>(function.getArgument(numArguments - 1)));
+  }
+
   void InitPredictOpLoweringState(
     ConversionPatternRewriter &rewriter,
     Location location,
@@ -419,14 +621,24 @@ struct PredictForestOpLowering: public ConversionPattern {
     state.forestConst = rewriter.create<mlir::decisionforest::EnsembleConstantOp>(location, forestType, forestAttribute);
 
     state.isMultiClass = forestAttribute.GetDecisionForest().IsMultiClassClassifier();
+    state.hasGPUMapping = LoopNestHasGPUMapping(*forestOp.getSchedule().GetSchedule()->GetRootIndex());
     state.treeType = forestType.getTreeType(0).cast<mlir::decisionforest::TreeType>();
+    state.reductionType = forestType.getReductionType();
+    assert ((state.reductionType == decisionforest::ReductionType::kAdd || !state.hasGPUMapping) && 
+            "Only additive forests are supported on the GPU");
+    assert ((state.reductionType != decisionforest::ReductionType::kVoting || state.isMultiClass) && 
+            "Voting is only supported for classifiers");
 
     // Initialize constants
     state.batchSizeConst = rewriter.create<arith::ConstantIndexOp>(location, batchSize); 
     state.zeroIndexConst = rewriter.create<arith::ConstantIndexOp>(location, 0);
     state.oneIndexConst = rewriter.create<arith::ConstantIndexOp>(location, 1); 
     state.numClassesConst = rewriter.create<arith::ConstantIndexOp>(location, forestAttribute.GetDecisionForest().GetNumClasses());
+    // Votes are counted from zero and the initial offset of an averaged forest is added once the sums 
+    // are averaged (see GenerateTreePredictionAverage)
     auto initialValue = forestAttribute.GetDecisionForest().GetInitialOffset();
+    if (state.reductionType != decisionforest::ReductionType::kAdd)
+      initialValue = 0.0;
     state.initialValueConst = CreateFPConstant(rewriter, location, dataMemrefType.getElementType(), initialValue);
 
     // Initialize members for multi-class classification
@@ -436,31 +648,187 @@ struct PredictForestOpLowering: public ConversionPattern {
           dataMemrefType.getElementType());
 
       state.treeClassesMemref = rewriter.create<memref::AllocaOp>(location, state.treeClassesMemrefType);
+      // On the CPU, the prediction function also takes the caller's scores memref and the output mode. When the 
+      // margins or the probabilities are requested, the class weights are accumulated directly in the scores memref.
+      if (!state.hasGPUMapping) {
+        auto scoresArguments = GetPredictionFunctionArguments(forestOp);
+        state.outputMode = scoresArguments.second;
+        auto predictionModeConst = rewriter.create<arith::ConstantIntOp>(location, static_cast<int64_t>(decisionforest::PredictionOutputMode::kPrediction), 
+                                                                         rewriter.getI32Type());
+        auto isPredictionMode = rewriter.create<arith::CmpIOp>(location, arith::CmpIPredicate::eq, state.outputMode, predictionModeConst);
+        state.treeClassesMemref = rewriter.create<arith::SelectOp>(location, isPredictionMode, state.treeClassesMemref, scoresArguments.first);
+      }
+
+      if (IsSimpleInnermostTreeLoop(*forestOp.getSchedule().GetSchedule())) {
+        if (state.reductionType == decisionforest::ReductionType::kVoting)
+          state.vectorizeVotes = true;
+        else
+          state.classTreeRanges = GetClassTreeRanges(forestAttribute.GetDecisionForest());
+      }
+    }
+
+    auto& schedule = *forestOp.getSchedule().GetSchedule();
+    auto& treeIndex = schedule.GetTreeIndex();
+    if (treeIndex.EarlyExit()) {
+      auto& forest = forestAttribute.GetDecisionForest();
+      assert (!state.isMultiClass && forest.GetPredictionTransformation() == decisionforest::PredictionTransformation::kSigmoid && 
+              state.reductionType == decisionforest::ReductionType::kAdd && "Early exit is only supported for binary classifiers");
+      assert (IsSimpleInnermostTreeLoop(schedule) && "Early exit needs a sequential loop over all trees inside the batch loop");
+      state.earlyExitTreeGroups = GetEarlyExitTreeGroups(forest, treeIndex.EarlyExitTreeGroupSize(), treeIndex.EarlyExitProbabilityThreshold(),
+                                                         state.treeType.getThresholdType().cast<FloatType>(),
+                                                         dataMemrefType.getElementType().cast<FloatType>());
+    }
+    if (treeIndex.AnytimePrediction()) {
+      assert (!state.isMultiClass && !state.hasGPUMapping && state.reductionType == decisionforest::ReductionType::kAdd && 
+              "Anytime prediction is only supported for additive single output models on the CPU");
+      auto treeRange = GetPredictionFunctionArguments(forestOp);
+      state.anytimeTreeStart = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), treeRange.first);
+      state.anytimeTreeEnd = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), treeRange.second);
+      // Only the call that walks the first trees adds the initial offset so that the margins of 
+      // consecutive tree ranges can be summed.
+      auto isFirstRange = rewriter.create<arith::CmpIOp>(location, arith::CmpIPredicate::eq, state.anytimeTreeStart, state.zeroIndexConst);
+      auto zeroConst = CreateFPConstant(rewriter, location, dataMemrefType.getElementType(), 0.0);
+      state.initialValueConst = rewriter.create<arith::SelectOp>(location, isFirstRange, state.initialValueConst, zeroConst);
     }
+    state.fuseSigmoidWithResultStore = forestAttribute.GetDecisionForest().GetPredictionTransformation() == decisionforest::PredictionTransformation::kSigmoid &&
+                                       !state.isMultiClass && state.reductionType == decisionforest::ReductionType::kAdd && 
+                                       IsSimpleInnermostTreeLoop(schedule) && !treeIndex.EarlyExit() && !treeIndex.AnytimePrediction();
 
     state.data = operands[0];
     state.dataMemrefType = dataMemrefType;
     state.cmpPredicate = forestOp.getPredicateAttr();
   }
 
-  Value GenSigmoid(ConversionPatternRewriter& rewriter, Value operand, Location location) const {
-    assert (operand.getType().isIntOrFloat());
-    auto negate = rewriter.create<mlir::arith::NegFOp>(location, operand.getType(), operand);
-    auto exponential = rewriter.create<mlir::math::ExpOp>(location, operand.getType(), static_cast<Value>(negate));
-    
-    Value oneConst;
-    if (operand.getType().isa<mlir::Float64Type>())
-      oneConst = rewriter.create<arith::ConstantFloatOp>(location, llvm::APFloat(1.0), operand.getType().cast<FloatType>());
-    else if(operand.getType().isa<mlir::Float32Type>())
-      oneConst = rewriter.create<arith::ConstantFloatOp>(location, llvm::APFloat((float)1.0), operand.getType().cast<FloatType>());
+  // Creates a constant of the given scalar or vector type. Vector constants are splats.
+  Value CreateSplatConstant(ConversionPatternRewriter &rewriter, Location location, Type type, double value) const {
+    auto elementType = getElementTypeOrSelf(type);
+    Value constValue;
+    if (elementType.isa<mlir::IntegerType>())
+      constValue = rewriter.create<arith::ConstantIntOp>(location, static_cast<int64_t>(value), elementType);
     else
-      assert(false && "Unsupported floating point type");
+      constValue = CreateFPConstant(rewriter, location, elementType, value);
+    if (auto vectorType = type.dyn_cast<VectorType>())
+      constValue = rewriter.create<vector::BroadcastOp>(location, vectorType, constValue);
+    return constValue;
+  }
+
+  // exp(x) = 2^n * exp(r) where n = round(x*log2(e)) and |r| <= ln(2)/2. exp(r) is evaluated with a polynomial 
+  // (the Cephes expf polynomial for f32 and the degree 13 Taylor polynomial for f64) and 2^n is built directly in
+  // the exponent bits, so no libm call is needed and the computation vectorizes. The result is within 2 ULP of
+  // exp(x) for x in [minArg, maxArg]. Arguments outside this range are clamped (exp saturates instead of 
+  // returning 0 or inf, which doesn't change the sigmoid).
+  Value GenFastExp(ConversionPatternRewriter &rewriter, Location location, Value x) const {
+    auto type = x.getType();
+    auto floatType = getElementTypeOrSelf(type).cast<FloatType>();
+    bool isF32 = floatType.isF32();
+    assert ((isF32 || floatType.isF64()) && "Unsupported floating point type");
+    auto constant = [&](double value) { return CreateSplatConstant(rewriter, location, type, value); };
+
+    const double maxArg = isF32 ? 88.0 : 709.0;
+    const double minArg = isF32 ? -87.0 : -708.0;
+    x = rewriter.create<arith::MinFOp>(location, x, constant(maxArg));
+    x = rewriter.create<arith::MaxFOp>(location, x, constant(minArg));
+
+    Value n = rewriter.create<arith::MulFOp>(location, x, constant(1.4426950408889634)); // log2(e)
+    n = rewriter.create<arith::AddFOp>(location, n, constant(0.5));
+    n = rewriter.create<math::FloorOp>(location, n);
+    // r = x - n*ln(2). ln(2) is split into a high part with few significant bits (so that n*ln2Hi is exact) and the rest.
+    const double ln2Hi = isF32 ? 0.693359375 : 6.93145751953125E-1;
+    const double ln2Lo = isF32 ? -2.12194440E-4 : 1.42860682030941723212E-6;
+    Value r = rewriter.create<arith::SubFOp>(location, x, rewriter.create<arith::MulFOp>(location, n, constant(ln2Hi)));
+    r = rewriter.create<arith::SubFOp>(location, r, rewriter.create<arith::MulFOp>(location, n, constant(ln2Lo)));
+
+    Value expR;
+    if (isF32) {
+      const double coefficients[] = { 1.9875691500E-4, 1.3981999507E-3, 8.3334519073E-3, 4.1665795894E-2, 1.6666665459E-1, 5.0000001201E-1 };
+      Value p = constant(coefficients[0]);
+      for (size_t i=1 ; i<sizeof(coefficients)/sizeof(double) ; ++i)
+        p = rewriter.create<arith::AddFOp>(location, rewriter.create<arith::MulFOp>(location, p, r), constant(coefficients[i]));
+      // exp(r) ~= 1 + r + r^2 * p(r)
+      Value rSquared = rewriter.create<arith::MulFOp>(location, r, r);
+      expR = rewriter.create<arith::MulFOp>(location, p, rSquared);
+      expR = rewriter.create<arith::AddFOp>(location, expR, r);
+      expR = rewriter.create<arith::AddFOp>(location, expR, constant(1.0));
+    }
+    else {
+      const int32_t degree = 13;
+      double inverseFactorial[degree + 1] = { 1.0 };
+      for (int32_t k=1 ; k<=degree ; ++k)
+        inverseFactorial[k] = inverseFactorial[k-1] / k;
+      expR = constant(inverseFactorial[degree]);
+      for (int32_t k=degree-1 ; k>=0 ; --k)
+        expR = rewriter.create<arith::AddFOp>(location, rewriter.create<arith::MulFOp>(location, expR, r), constant(inverseFactorial[k]));
+    }
 
-    auto onePlusExp = rewriter.create<arith::AddFOp>(location, operand.getType(), oneConst, exponential);
-    auto result = rewriter.create<arith::DivFOp>(location, operand.getType(), oneConst, onePlusExp);
+    // 2^n has exponent bits (n + bias) and a zero mantissa
+    auto bitWidth = floatType.getWidth();
+    auto mantissaBits = isF32 ? 23 : 52;
+    auto exponentBias = isF32 ? 127 : 1023;
+    Type intType = rewriter.getIntegerType(bitWidth);
+    if (auto vectorType = type.dyn_cast<VectorType>())
+      intType = VectorType::get(vectorType.getShape(), intType);
+    Value exponent = rewriter.create<arith::FPToSIOp>(location, intType, n);
+    exponent = rewriter.create<arith::AddIOp>(location, exponent, CreateSplatConstant(rewriter, location, intType, exponentBias));
+    exponent = rewriter.create<arith::ShLIOp>(location, exponent, CreateSplatConstant(rewriter, location, intType, mantissaBits));
+    auto twoToTheN = rewriter.create<arith::BitcastOp>(location, type, exponent);
+    return rewriter.create<arith::MulFOp>(location, expR, twoToTheN);
+  }
+
+  Value GenExp(ConversionPatternRewriter& rewriter, Location location, Value x) const {
+    if (m_useFastApproximateTransforms)
+      return GenFastExp(rewriter, location, x);
+    return rewriter.create<mlir::math::ExpOp>(location, x.getType(), x);
+  }
+
+  // operand can be a scalar or a vector of f32 or f64 values
+  Value GenSigmoid(ConversionPatternRewriter& rewriter, Value operand, Location location) const {
+    auto type = operand.getType();
+    auto elementType = getElementTypeOrSelf(type);
+    assert (elementType.isa<mlir::Float64Type>() || elementType.isa<mlir::Float32Type>());
+    auto negate = rewriter.create<mlir::arith::NegFOp>(location, type, operand);
+    auto exponential = GenExp(rewriter, location, negate);
+    
+    auto oneConst = CreateSplatConstant(rewriter, location, type, 1.0);
+    auto onePlusExp = rewriter.create<arith::AddFOp>(location, type, oneConst, exponential);
+    auto result = rewriter.create<arith::DivFOp>(location, type, oneConst, onePlusExp);
     return result;
   }
 
+  // Applies the sigmoid to the results with vector loads and stores so that the exp of several rows is 
+  // computed at once. Rows that don't fill a whole vector go through a scalar loop that computes the same function.
+  void GenVectorizedSigmoid(ConversionPatternRewriter &rewriter, Location location, PredictOpLoweringState& state) const {
+    const int64_t kVectorBits = 256;
+    auto elementType = state.resultMemrefType.getElementType();
+    int64_t batchSize = state.resultMemrefType.getShape()[0];
+    int64_t vectorWidth = kVectorBits / elementType.getIntOrFloatBitWidth();
+    while (vectorWidth > batchSize)
+      vectorWidth /= 2;
+    int64_t vectorEnd = vectorWidth > 1 ? batchSize - (batchSize % vectorWidth) : 0;
+
+    if (vectorEnd > 0) {
+      auto vectorType = VectorType::get({vectorWidth}, elementType);
+      auto vectorEndConst = rewriter.create<arith::ConstantIndexOp>(location, vectorEnd);
+      auto vectorWidthConst = rewriter.create<arith::ConstantIndexOp>(location, vectorWidth);
+      auto vectorLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, vectorEndConst, vectorWidthConst);
+      rewriter.setInsertionPointToStart(vectorLoop.getBody());
+      auto i = vectorLoop.getInductionVar();
+      auto predictions = rewriter.create<vector::LoadOp>(location, vectorType, state.resultMemref, ValueRange{i});
+      auto transformedValues = GenSigmoid(rewriter, predictions, location);
+      rewriter.create<vector::StoreOp>(location, transformedValues, state.resultMemref, ValueRange{i});
+      rewriter.setInsertionPointAfter(vectorLoop);
+    }
+    if (vectorEnd < batchSize) {
+      auto startConst = rewriter.create<arith::ConstantIndexOp>(location, vectorEnd);
+      auto remainderLoop = rewriter.create<scf::ForOp>(location, startConst, state.batchSizeConst, state.oneIndexConst);
+      rewriter.setInsertionPointToStart(remainderLoop.getBody());
+      auto i = remainderLoop.getInductionVar();
+      auto prediction = rewriter.create<memref::LoadOp>(location, state.resultMemref, i);
+      auto transformedValue = GenSigmoid(rewriter, prediction, location);
+      rewriter.create<memref::StoreOp>(location, transformedValue, state.resultMemref, i);
+      rewriter.setInsertionPointAfter(remainderLoop);
+    }
+  }
+
   Value GenArgMax(ConversionPatternRewriter& rewriter, Location location, PredictOpLoweringState& state, Value index) const {
       auto treeClassesMemref = GetRow(rewriter, location, state.treeClassesMemref, index, state.treeClassesMemrefType);
       auto treeClassElementType = treeClassesMemref.getType().cast<MemRefType>().getElementType();
@@ -552,6 +920,9 @@ struct PredictForestOpLowering: public ConversionPattern {
   }
 
   void InitializeTreeClassWeightsMemref(ConversionPatternRewriter &rewriter, Location location, PredictOpLoweringState& state) const {
+    // The per class loops write every element of the class weights memref exactly once
+    if (!state.classTreeRanges.empty())
+      return;
     if (state.isMultiClass) {
       auto outerLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, state.batchSizeConst, state.oneIndexConst);
       rewriter.setInsertionPointToStart(outerLoop.getBody());
@@ -580,6 +951,11 @@ struct PredictForestOpLowering: public ConversionPattern {
     // We don't accumulate into result memref in case of multi-class.
     if (state.isMultiClass) return;
 
+    if (state.resultMemrefType.getShape()[0] == 1) {
+      rewriter.create<memref::StoreOp>(location, state.initialValueConst, state.resultMemref, ValueRange{state.zeroIndexConst});
+      return;
+    }
+
     // Create a for loop over the outputs
     auto batchLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, state.batchSizeConst, state.oneIndexConst);
     
@@ -589,38 +965,314 @@ struct PredictForestOpLowering: public ConversionPattern {
     rewriter.setInsertionPointAfter(batchLoop);
   }
 
+  FlatSymbolRefAttr CreateFeatureBinBoundariesGlobal(ConversionPatternRewriter &rewriter, Location location, mlir::ModuleOp module,
+                                                     const std::vector<std::vector<double>>& binBoundaries, mlir::FloatType elementType) const {
+    // Every row of the table is padded with +inf to 2^numSearchSteps - 1 entries so that the
+    // search for every feature takes the same number of steps (see GenerateBinIndex).
+    size_t maxNumBoundaries = 0;
+    for (auto& featureBoundaries : binBoundaries)
+      maxNumBoundaries = std::max(maxNumBoundaries, featureBoundaries.size());
+    int32_t numSearchSteps = 1;
+    while (((size_t(1) << numSearchSteps) - 1) < maxNumBoundaries)
+      ++numSearchSteps;
+
+    int64_t numFeatures = static_cast<int64_t>(binBoundaries.size());
+    int64_t rowLength = (int64_t(1) << numSearchSteps) - 1;
+    auto boundariesMemrefType = MemRefType::get({numFeatures, rowLength}, elementType);
+    std::string boundariesMemrefName = "featureBinBoundaries";
+    {
+      PatternRewriter::InsertionGuard insertGuard(rewriter);
+      rewriter.setInsertionPointToStart(module.getBody());
+      auto tensorType = RankedTensorType::get({numFeatures, rowLength}, elementType);
+      DenseElementsAttr boundariesAttr;
+      if (elementType.isF64()) {
+        std::vector<double> boundaries(numFeatures * rowLength, std::numeric_limits<double>::infinity());
+        for (int64_t i=0 ; i<numFeatures ; ++i)
+          std::copy(binBoundaries.at(i).begin(), binBoundaries.at(i).end(), boundaries.begin() + i*rowLength);
+        boundariesAttr = DenseElementsAttr::get(tensorType, llvm::ArrayRef<double>(boundaries));
+      }
+      else if (elementType.isF32()) {
+        std::vector<float> boundaries(numFeatures * rowLength, std::numeric_limits<float>::infinity());
+        for (int64_t i=0 ; i<numFeatures ; ++i)
+          std::transform(binBoundaries.at(i).begin(), binBoundaries.at(i).end(), boundaries.begin() + i*rowLength,
+                         [](double d) { return static_cast<float>(d); });
+        boundariesAttr = DenseElementsAttr::get(tensorType, llvm::ArrayRef<float>(boundaries));
+      }
+      else {
+        assert (false && "Unsupported input element type for quantized models");
+      }
+      rewriter.create<memref::GlobalOp>(location, boundariesMemrefName, rewriter.getStringAttr("private"), boundariesMemrefType, boundariesAttr, true, IntegerAttr());
+    }
+    return SymbolRefAttr::get(rewriter.getContext(), boundariesMemrefName);
+  }
+
+  // Caches the batch loops that are directly nested in the root loop so that the rows of a quantized forest (or of
+  // a forest with compacted features) are binned (or gathered) a few at a time as they're cached. Returns false (and leaves the schedule unchanged) if some tree loop
+  // is not nested inside these batch loops.
+  bool CacheOutermostBatchLoops(decisionforest::Schedule& schedule) const {
+    auto& outermostLoops = schedule.GetRootIndex()->GetContainedLoops();
+    for (auto loop : outermostLoops) {
+      if (loop->GetType() != decisionforest::IndexVariable::IndexVariableType::kBatch || loop->Unroll() ||
+          loop->GetGPUDimension().construct != decisionforest::IndexVariable::GPUConstruct::None)
+        return false;
+    }
+    for (auto loop : outermostLoops)
+      schedule.Cache(*loop);
+    return true;
+  }
+
+  // Replaces every input feature (or every feature in state.binnedFeatures) with the index of the bin it falls 
+  // into. Only used when the rows can't be binned as they're cached (when a tree loop is outermost). The binned 
+  // rows are written into a stack buffer that replaces state.data for the rest of the lowering so that predicting
+  // a batch doesn't go through the allocator. The used columns of a forest with compacted features are gathered
+  // at the same time.
+  void GenerateInputBinning(ConversionPatternRewriter &rewriter, Location location, PredictOpLoweringState& state,
+                            mlir::ModuleOp module) const {
+    auto boundariesGlobal = module.lookupSymbol<memref::GlobalOp>(state.binBoundaries.getValue());
+    assert (boundariesGlobal);
+    auto boundariesMemref = rewriter.create<memref::GetGlobalOp>(location, boundariesGlobal.getType(), state.binBoundaries.getValue());
+    bool gatherColumns = !state.compactFeatureColumns.empty() && !state.isDataCompacted;
+    auto numFeatures = gatherColumns ? static_cast<int64_t>(state.compactFeatureColumns.size()) : state.dataMemrefType.getShape()[1];
+    bool binAllFeatures = state.binnedFeatures.empty();
+    assert (!binAllFeatures || numFeatures == boundariesGlobal.getType().getShape()[0]);
+
+    auto elementType = state.dataMemrefType.getElementType();
+    auto binnedDataType = MemRefType::get({state.dataMemrefType.getShape()[0], numFeatures}, elementType);
+    auto binnedData = rewriter.create<memref::AllocaOp>(location, binnedDataType, rewriter.getI64IntegerAttr(64));
+
+    auto batchLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, state.batchSizeConst, state.oneIndexConst);
+    rewriter.setInsertionPointToStart(batchLoop.getBody());
+    auto rowIndex = batchLoop.getInductionVar();
+    if (gatherColumns) {
+      decisionforest::helpers::GenerateColumnGather(rewriter, location, state.data, rowIndex, binnedData, rowIndex, state.compactFeatureColumns,
+                                                    binAllFeatures ? static_cast<Value>(boundariesMemref) : Value());
+    }
+    else {
+      auto numFeaturesConst = rewriter.create<arith::ConstantIndexOp>(location, numFeatures);
+      auto featureLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, numFeaturesConst, state.oneIndexConst);
+      PatternRewriter::InsertionGuard insertGuard(rewriter);
+      rewriter.setInsertionPointToStart(featureLoop.getBody());
+      auto featureIndex = featureLoop.getInductionVar();
+      Value featureValue = rewriter.create<memref::LoadOp>(location, state.data, ValueRange{rowIndex, featureIndex});
+      if (binAllFeatures)
+        featureValue = decisionforest::helpers::GenerateBinIndex(rewriter, location, boundariesMemref, featureIndex, featureValue, elementType);
+      rewriter.create<memref::StoreOp>(location, featureValue, binnedData, ValueRange{rowIndex, featureIndex});
+    }
+    if (!binAllFeatures) {
+      decisionforest::helpers::GenerateInPlaceBinning(rewriter, location, boundariesMemref, binnedData, batchLoop.getInductionVar(), 
+                                                      state.binnedFeatures);
+    }
+    rewriter.setInsertionPointAfter(batchLoop);
+
+    state.data = binnedData;
+    state.dataMemrefType = binnedDataType;
+    state.isDataCompacted = state.isDataCompacted || gatherColumns;
+    state.isDataBinned = true;
+  }
+
+  // Whether every tree walk is nested inside a batch loop whose rows are cached. The used columns 
+  // of a forest with compacted features can then be gathered when the rows are cached.
+  bool AreTreeWalksInCachedBatchLoops(const decisionforest::IndexVariable& indexVar, bool inCachedBatchLoop) const {
+    inCachedBatchLoop = inCachedBatchLoop || 
+                        (indexVar.GetType() == decisionforest::IndexVariable::IndexVariableType::kBatch && indexVar.Cache());
+    if (indexVar.GetContainedLoops().empty())
+      return inCachedBatchLoop;
+    for (auto nestedIndexVar : indexVar.GetContainedLoops())
+      if (!AreTreeWalksInCachedBatchLoops(*nestedIndexVar, inCachedBatchLoop))
+        return false;
+    return true;
+  }
+
+  // Copies the used columns of all the input rows (in the compacted order) into a stack buffer that replaces 
+  // state.data for the rest of the lowering. Only used when the rows can't be compacted as they're cached 
+  // (when a tree loop is outermost).
+  void GenerateInputCompaction(ConversionPatternRewriter &rewriter, Location location, PredictOpLoweringState& state) const {
+    auto numUsedFeatures = static_cast<int64_t>(state.compactFeatureColumns.size());
+    auto compactDataType = MemRefType::get({state.dataMemrefType.getShape()[0], numUsedFeatures}, state.dataMemrefType.getElementType());
+    auto compactData = rewriter.create<memref::AllocaOp>(location, compactDataType, rewriter.getI64IntegerAttr(64));
+
+    auto batchLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, state.batchSizeConst, state.oneIndexConst);
+    rewriter.setInsertionPointToStart(batchLoop.getBody());
+    auto rowIndex = batchLoop.getInductionVar();
+    decisionforest::helpers::GenerateColumnGather(rewriter, location, state.data, rowIndex, compactData, rowIndex, state.compactFeatureColumns);
+    rewriter.setInsertionPointAfter(batchLoop);
+
+    state.data = compactData;
+    state.dataMemrefType = compactDataType;
+    state.isDataCompacted = true;
+  }
+
+  // Generates an scf.if that is taken when the output mode argument of the prediction function is outputMode
+  // and sets the insertion point to its body
+  scf::IfOp GenerateIfOutputMode(ConversionPatternRewriter &rewriter, Location location, PredictOpLoweringState& state,
+                                 decisionforest::PredictionOutputMode outputMode) const {
+    auto outputModeConst = rewriter.create<arith::ConstantIntOp>(location, static_cast<int64_t>(outputMode), rewriter.getI32Type());
+    auto isOutputMode = rewriter.create<arith::CmpIOp>(location, arith::CmpIPredicate::eq, state.outputMode, outputModeConst);
+    auto ifOutputMode = rewriter.create<scf::IfOp>(location, TypeRange{}, isOutputMode, false);
+    rewriter.setInsertionPointToStart(ifOutputMode.thenBlock());
+    return ifOutputMode;
+  }
+
+  // Turns the class weights in the scores memref into probabilities. The scores are stored row major, so the scores 
+  // of one class for vectorWidth consecutive rows are gathered into a vector and every step of the softmax computes 
+  // vectorWidth rows at once. The maximum of each row is subtracted before exponentiating so that exp can't overflow. 
+  // The class weights of voting forests are vote counts and are only divided by their sum. Rows that don't fill a 
+  // whole vector are computed one at a time.
+  void GenVectorizedClassProbabilities(ConversionPatternRewriter &rewriter, Location location, PredictOpLoweringState& state) const {
+    // The class weights of an averaged forest are already averaged class probabilities
+    if (state.reductionType == decisionforest::ReductionType::kAverage)
+      return;
+    bool exponentiate = state.reductionType == decisionforest::ReductionType::kAdd;
+    const int64_t kVectorBits = 256;
+    auto elementType = state.treeClassesMemrefType.getElementType();
+    int64_t batchSize = state.treeClassesMemrefType.getShape()[0];
+    int64_t numClasses = state.treeClassesMemrefType.getShape()[1];
+    int64_t vectorWidth = kVectorBits / elementType.getIntOrFloatBitWidth();
+    while (vectorWidth > batchSize)
+      vectorWidth /= 2;
+    int64_t vectorEnd = vectorWidth > 1 ? batchSize - (batchSize % vectorWidth) : 0;
+
+    auto scores = rewriter.create<memref::CollapseShapeOp>(location, state.treeClassesMemref, ArrayRef<ReassociationIndices>{ {0, 1} });
+    auto generateRowLoop = [&](int64_t start, int64_t end, int64_t width) {
+      Type type = elementType;
+      Value classOffsets, mask, zeros;
+      if (width > 1) {
+        type = VectorType::get({width}, elementType);
+        // Offsets of the scores of a class of consecutive rows from the score of the first row
+        std::vector<int32_t> offsets;
+        for (int64_t i=0 ; i<width ; ++i)
+          offsets.push_back(static_cast<int32_t>(i * numClasses));
+        auto offsetsType = VectorType::get({width}, rewriter.getI32Type());
+        classOffsets = rewriter.create<arith::ConstantOp>(location, DenseElementsAttr::get(offsetsType, llvm::ArrayRef<int32_t>(offsets)));
+        mask = CreateSplatConstant(rewriter, location, VectorType::get({width}, rewriter.getI1Type()), 1.0);
+        zeros = CreateSplatConstant(rewriter, location, type, 0.0);
+      }
+      auto startConst = rewriter.create<arith::ConstantIndexOp>(location, start);
+      auto endConst = rewriter.create<arith::ConstantIndexOp>(location, end);
+      auto stepConst = rewriter.create<arith::ConstantIndexOp>(location, width);
+      auto rowLoop = rewriter.create<scf::ForOp>(location, startConst, endConst, stepConst);
+      rewriter.setInsertionPointToStart(rowLoop.getBody());
+      auto firstScoreIndex = rewriter.create<arith::MulIOp>(location, rowLoop.getInductionVar(), state.numClassesConst);
+
+      std::vector<Value> classScores, scoreIndices;
+      for (int64_t classId=0 ; classId<numClasses ; ++classId) {
+        auto classIdConst = rewriter.create<arith::ConstantIndexOp>(location, classId);
+        scoreIndices.push_back(rewriter.create<arith::AddIOp>(location, firstScoreIndex, classIdConst));
+        if (width > 1)
+          classScores.push_back(rewriter.create<vector::GatherOp>(location, type, scores, ValueRange{scoreIndices.back()}, classOffsets, mask, zeros));
+        else
+          classScores.push_back(rewriter.create<memref::LoadOp>(location, scores, ValueRange{scoreIndices.back()}));
+      }
+      if (exponentiate) {
+        Value maxScore = classScores.front();
+        for (int64_t classId=1 ; classId<numClasses ; ++classId)
+          maxScore = rewriter.create<arith::MaxFOp>(location, maxScore, classScores.at(classId));
+        for (auto& classScore : classScores)
+          classScore = GenExp(rewriter, location, rewriter.create<arith::SubFOp>(location, classScore, maxScore));
+      }
+      Value sum = classScores.front();
+      for (int64_t classId=1 ; classId<numClasses ; ++classId)
+        sum = rewriter.create<arith::AddFOp>(location, sum, classScores.at(classId));
+      auto inverseSum = rewriter.create<arith::DivFOp>(location, CreateSplatConstant(rewriter, location, type, 1.0), sum);
+      for (int64_t classId=0 ; classId<numClasses ; ++classId) {
+        auto probability = rewriter.create<arith::MulFOp>(location, classScores.at(classId), inverseSum);
+        if (width > 1)
+          rewriter.create<vector::ScatterOp>(location, scores, ValueRange{scoreIndices.at(classId)}, classOffsets, mask, probability);
+        else
+          rewriter.create<memref::StoreOp>(location, probability, scores, ValueRange{scoreIndices.at(classId)});
+      }
+      rewriter.setInsertionPointAfter(rowLoop);
+    };
+    if (vectorEnd > 0)
+      generateRowLoop(0, vectorEnd, vectorWidth);
+    if (vectorEnd < batchSize)
+      generateRowLoop(vectorEnd, batchSize, 1);
+  }
+
   void TransformResultMemref(
     ConversionPatternRewriter &rewriter, Location location, decisionforest::PredictionTransformation predTransform, PredictOpLoweringState& state) const {
     
-    if (predTransform == decisionforest::PredictionTransformation::kIdentity)
+    // The prediction function of a multi-class model on the CPU computes the class, the margins (which are already 
+    // in the scores memref) or the probabilities depending on its output mode argument.
+    if (state.outputMode) {
+      auto ifPrediction = GenerateIfOutputMode(rewriter, location, state, decisionforest::PredictionOutputMode::kPrediction);
+      TransformResultRows(rewriter, location, predTransform, state);
+      rewriter.setInsertionPointAfter(ifPrediction);
+      auto ifProbabilities = GenerateIfOutputMode(rewriter, location, state, decisionforest::PredictionOutputMode::kProbabilities);
+      GenVectorizedClassProbabilities(rewriter, location, state);
+      rewriter.setInsertionPointAfter(ifProbabilities);
+      return;
+    }
+    TransformResultRows(rewriter, location, predTransform, state);
+  }
+
+  void TransformResultRows(
+    ConversionPatternRewriter &rewriter, Location location, decisionforest::PredictionTransformation predTransform, PredictOpLoweringState& state) const {
+
+    // The result of a multi-class classifier is always the class with the highest weight (or the most votes)
+    if (predTransform == decisionforest::PredictionTransformation::kIdentity && !state.isMultiClass)
+      return;
+    // The sigmoid has already been applied when the predictions were stored
+    if (state.fuseSigmoidWithResultStore)
       return;
 
     // assert (resultMemrefType.getElementType().isa<mlir::FloatType>());
     // assert (predTransform == decisionforest::PredictionTransformation::kSigmoid);
 
+    // The prediction of a single row is transformed without a loop
+    if (state.resultMemrefType.getShape()[0] == 1) {
+      TransformResult(rewriter, location, predTransform, state, state.zeroIndexConst);
+      return;
+    }
+
+    if (predTransform == decisionforest::PredictionTransformation::kSigmoid && !state.isMultiClass && !state.hasGPUMapping) {
+      GenVectorizedSigmoid(rewriter, location, state);
+      return;
+    }
+
     auto batchLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, state.batchSizeConst, state.oneIndexConst);
-    
     rewriter.setInsertionPointToStart(batchLoop.getBody());
-    auto i = batchLoop.getInductionVar();
-    
+    TransformResult(rewriter, location, predTransform, state, batchLoop.getInductionVar());
+    rewriter.setInsertionPointAfter(batchLoop);
+  }
+
+  void TransformResult(ConversionPatternRewriter &rewriter, Location location, decisionforest::PredictionTransformation predTransform, 
+                       PredictOpLoweringState& state, Value i) const {
     auto memrefElem = rewriter.create<memref::LoadOp>(location, state.resultMemref, i);
     Value transformedValue;
-    if (predTransform == decisionforest::PredictionTransformation::kSigmoid)
-      transformedValue = GenSigmoid(rewriter, static_cast<Value>(memrefElem), location);
-    else if (predTransform == decisionforest::PredictionTransformation::kSoftMax)
+    if (state.isMultiClass)
       transformedValue = GenArgMax(rewriter, location, state, i);
+    else if (predTransform == decisionforest::PredictionTransformation::kSigmoid)
+      transformedValue = GenSigmoid(rewriter, static_cast<Value>(memrefElem), location);
     else
       assert(false && "Unsupported prediction transformation.");
 
     rewriter.create<memref::StoreOp>(location, transformedValue, state.resultMemref, i);
-    rewriter.setInsertionPointAfter(batchLoop);
+  }
+
+  // Tree walks return values of the threshold type. When the thresholds are stored in a narrower type 
+  // than the input (16-bit thresholds for example), extend the predictions before they are accumulated.
+  Value ExtendTreePrediction(ConversionPatternRewriter& rewriter, Location location, Value prediction, PredictOpLoweringState& state) const {
+    auto accumulatorType = state.dataMemrefType.getElementType();
+    if (prediction.getType() == accumulatorType)
+      return prediction;
+    return rewriter.create<arith::ExtFOp>(location, accumulatorType, prediction);
   }
 
   void GenerateMultiClassAccumulate(ConversionPatternRewriter& rewriter, Location location, Value result, Value rowIndex, Value index, PredictOpLoweringState& state) const {
     if (state.isMultiClass) {
       auto batchTreeClassMemref = GetRow(rewriter, location, state.treeClassesMemref, rowIndex, state.treeClassesMemrefType);
-      auto classId = rewriter.create<decisionforest::GetTreeClassIdOp>(location, state.treeType.getResultType(), state.forestConst, index);
-      auto classIdIndex = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), static_cast<Value>(classId));
+      // The prediction of a tree of a voting forest is the class it votes for
+      Value classIdIndex;
+      if (state.reductionType == decisionforest::ReductionType::kVoting) {
+        auto votedClass = rewriter.create<arith::FPToSIOp>(location, rewriter.getI32Type(), result);
+        classIdIndex = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), static_cast<Value>(votedClass));
+        result = CreateFPConstant(rewriter, location, state.dataMemrefType.getElementType(), 1.0);
+      }
+      else {
+        auto classId = rewriter.create<decisionforest::GetTreeClassIdOp>(location, state.treeType.getResultType(), state.forestConst, index);
+        classIdIndex = rewriter.create<arith::IndexCastOp>(location, rewriter.getIndexType(), static_cast<Value>(classId));
+      }
       auto currentValue = rewriter.create<memref::LoadOp>(
         location,
         state.treeClassesMemrefType.getElementType(),
@@ -632,6 +1284,261 @@ struct PredictForestOpLowering: public ConversionPattern {
     }
   }
 
+  // Walks the trees [start, end) on row in a loop that carries the partial sum in a register and returns 
+  // initialValue plus the sum of the predictions of the trees. Returns initialValue if the range is empty.
+  Value GenerateTreeRangeSum(ConversionPatternRewriter &rewriter,
+                             Location location,
+                             const decisionforest::IndexVariable& indexVar,
+                             PredictOpLoweringState& state,
+                             Value row,
+                             int64_t start,
+                             int64_t end,
+                             Value initialValue) const {
+    if (start >= end)
+      return initialValue;
+    auto forestType = state.forestConst.getType().cast<decisionforest::TreeEnsembleType>();
+    assert (forestType.doAllTreesHaveSameTileSize());
+    assert(forestType.getReductionType() != decisionforest::ReductionType::kVoting);
+    auto treeType = forestType.getTreeType(0).cast<mlir::decisionforest::TreeType>();
+
+    auto startConst = rewriter.create<arith::ConstantIndexOp>(location, start);
+    auto stopConst = rewriter.create<arith::ConstantIndexOp>(location, end);
+    auto treeLoop = rewriter.create<scf::ForOp>(location, startConst, stopConst, state.oneIndexConst, ValueRange{ initialValue });
+    rewriter.setInsertionPointToStart(treeLoop.getBody());
+    
+    Value treeIndex = treeLoop.getInductionVar();
+    auto tree = rewriter.create<decisionforest::GetTreeFromEnsembleOp>(location, treeType, state.forestConst, treeIndex);
+    Value walkOp;
+    if (indexVar.PeelWalk()) {
+      auto peelItersAttrib = rewriter.getI32IntegerAttr(indexVar.IterationsToPeel());
+      walkOp = rewriter.create<decisionforest::WalkDecisionTreePeeledOp>(location, treeType.getThresholdType(), state.cmpPredicate,
+                                                                         tree, row, peelItersAttrib);
+    }
+    else {
+      walkOp = rewriter.create<decisionforest::WalkDecisionTreeOp>(location, treeType.getThresholdType(), state.cmpPredicate, tree, row);
+    }
+    walkOp = ExtendTreePrediction(rewriter, location, walkOp, state);
+    auto accumulatedValue = rewriter.create<arith::AddFOp>(location, state.dataMemrefType.getElementType(), 
+                                                           treeLoop.getBody()->getArguments()[1], walkOp);
+    rewriter.create<scf::YieldOp>(location, static_cast<Value>(accumulatedValue));
+    rewriter.setInsertionPointAfter(treeLoop);
+    return treeLoop.getResult(0);
+  }
+
+  // Walk the trees of each class in a separate loop and accumulate the class's predictions in the
+  // loop carried value. The class weight is stored once per row and class. This avoids looking up the class 
+  // of every tree and the load/store of the class weight for every tree.
+  void GenerateClassGroupedTreeLoops(ConversionPatternRewriter &rewriter,
+                                     Location location,
+                                     const decisionforest::IndexVariable& indexVar,
+                                     PredictOpLoweringState& state,
+                                     Value row,
+                                     Value rowIndex) const {
+    auto batchTreeClassMemref = GetRow(rewriter, location, state.treeClassesMemref, rowIndex, state.treeClassesMemrefType);
+
+    for (size_t classId=0 ; classId<state.classTreeRanges.size() ; ++classId) {
+      auto& treeRange = state.classTreeRanges.at(classId);
+      auto classWeight = GenerateTreeRangeSum(rewriter, location, indexVar, state, row, treeRange.first, treeRange.second, state.initialValueConst);
+      auto classIdConst = rewriter.create<arith::ConstantIndexOp>(location, classId);
+      rewriter.create<memref::StoreOp>(location, classWeight, batchTreeClassMemref, ValueRange{state.zeroIndexConst, classIdConst});
+    }
+  }
+
+  // Adds the votes of a tree of a voting forest for consecutive rows starting at firstRowIndex (the prediction 
+  // of a tree of a voting forest is the class it votes for). The vote counts of the voted classes of the rows are 
+  // gathered, incremented and scattered back as one vector. Every row votes for a single class, so the rows 
+  // never update the same count.
+  void GenerateVectorizedVoteAccumulate(ConversionPatternRewriter& rewriter, Location location, const std::vector<Value>& treePredictions, 
+                                        Value firstRowIndex, PredictOpLoweringState& state) const {
+    assert (state.reductionType == decisionforest::ReductionType::kVoting);
+    auto numRows = static_cast<int64_t>(treePredictions.size());
+    int64_t numClasses = state.treeClassesMemrefType.getShape()[1];
+    auto offsetsType = VectorType::get({numRows}, rewriter.getI32Type());
+    auto votesType = VectorType::get({numRows}, state.treeClassesMemrefType.getElementType());
+    // Offsets of the vote counts of consecutive rows from the counts of the first row
+    std::vector<int32_t> rowOffsets;
+    for (int64_t i=0 ; i<numRows ; ++i)
+      rowOffsets.push_back(static_cast<int32_t>(i * numClasses));
+    auto rowOffsetsConst = rewriter.create<arith::ConstantOp>(location, DenseElementsAttr::get(offsetsType, llvm::ArrayRef<int32_t>(rowOffsets)));
+    Value votedClasses = CreateSplatConstant(rewriter, location, offsetsType, 0.0);
+    for (int64_t i=0 ; i<numRows ; ++i) {
+      auto votedClass = rewriter.create<arith::FPToSIOp>(location, rewriter.getI32Type(), treePredictions.at(i));
+      votedClasses = rewriter.create<vector::InsertOp>(location, static_cast<Value>(votedClass), votedClasses, ArrayRef<int64_t>({ i }));
+    }
+    auto countOffsets = rewriter.create<arith::AddIOp>(location, static_cast<Value>(rowOffsetsConst), votedClasses);
+
+    auto counts = rewriter.create<memref::CollapseShapeOp>(location, state.treeClassesMemref, ArrayRef<ReassociationIndices>{ {0, 1} });
+    auto firstCountIndex = rewriter.create<arith::MulIOp>(location, firstRowIndex, state.numClassesConst);
+    auto mask = CreateSplatConstant(rewriter, location, VectorType::get({numRows}, rewriter.getI1Type()), 1.0);
+    auto zeros = CreateSplatConstant(rewriter, location, votesType, 0.0);
+    auto currentCounts = rewriter.create<vector::GatherOp>(location, votesType, counts, ValueRange{firstCountIndex}, countOffsets, mask, zeros);
+    auto newCounts = rewriter.create<arith::AddFOp>(location, static_cast<Value>(currentCounts), CreateSplatConstant(rewriter, location, votesType, 1.0));
+    rewriter.create<vector::ScatterOp>(location, counts, ValueRange{firstCountIndex}, countOffsets, mask, newCounts);
+  }
+
+  // Number of rows of a batch loop of a voting forest whose votes are counted together (see GenerateVectorizedVotingBatchLoop). 
+  // Returns 1 if the rows of the loop are walked one at a time.
+  int64_t GetVotingVectorWidth(const decisionforest::IndexVariable& indexVar, PredictOpLoweringState& state) const {
+    if (!state.vectorizeVotes || indexVar.GetType() != decisionforest::IndexVariable::IndexVariableType::kBatch || 
+        indexVar.Cache() || indexVar.Parallel() || indexVar.GetRange().m_step != 1)
+      return 1;
+    auto& containedLoops = indexVar.GetContainedLoops();
+    if (containedLoops.size() != 1 || containedLoops.front()->GetType() != decisionforest::IndexVariable::IndexVariableType::kTree ||
+        containedLoops.front()->PeelWalk())
+      return 1;
+    auto range = indexVar.GetRange();
+    return GetVoteVectorWidth(range.m_stop - range.m_start, state);
+  }
+
+  // Number of consecutive rows (at most numRows) whose vote counts fit in a 256 bit vector
+  int64_t GetVoteVectorWidth(int64_t numRows, PredictOpLoweringState& state) const {
+    const int64_t kVectorBits = 256;
+    int64_t vectorWidth = kVectorBits / state.treeClassesMemrefType.getElementType().getIntOrFloatBitWidth();
+    while (vectorWidth > numRows)
+      vectorWidth /= 2;
+    return vectorWidth;
+  }
+
+  // Walks the trees of a voting forest for vectorWidth consecutive rows at a time. Every tree is walked for all the rows 
+  // of the vector at once and its votes for the rows are counted with one vector update of the vote counts. The rows
+  // that don't fill a whole vector are walked one at a time.
+  void GenerateVectorizedVotingBatchLoop(ConversionPatternRewriter &rewriter, Location location, const decisionforest::IndexVariable& indexVar, 
+                                         std::list<Value> batchIndices, std::list<Value> treeIndices, PredictOpLoweringState& state) const {
+    auto range = indexVar.GetRange();
+    auto vectorWidth = GetVotingVectorWidth(indexVar, state);
+    int64_t vectorEnd = range.m_stop - (range.m_stop - range.m_start) % vectorWidth;
+    auto& treeIndexVar = *indexVar.GetContainedLoops().front();
+    auto forestType = state.forestConst.getType().cast<decisionforest::TreeEnsembleType>();
+    assert (forestType.doAllTreesHaveSameTileSize());
+    auto treeType = forestType.getTreeType(0).cast<mlir::decisionforest::TreeType>();
+
+    auto startConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_start);
+    auto vectorEndConst = rewriter.create<arith::ConstantIndexOp>(location, vectorEnd);
+    auto vectorWidthConst = rewriter.create<arith::ConstantIndexOp>(location, vectorWidth);
+    {
+      auto vectorBatchIndices = batchIndices;
+      LoopConstructor<scf::ForOp> loopConstructor(indexVar, state, location, rewriter, startConst, vectorEndConst, vectorWidthConst, 
+                                                  vectorBatchIndices, treeIndices);
+      vectorBatchIndices.push_back(loopConstructor.GetLoop().getInductionVar());
+      auto firstRowIndex = SumOfValues(rewriter, location, vectorBatchIndices);
+      std::vector<Value> rows;
+      for (int64_t i=0 ; i<vectorWidth ; ++i) {
+        auto offsetConst = rewriter.create<arith::ConstantIndexOp>(location, i);
+        Value rowIndexForRowRead = rewriter.create<arith::AddIOp>(location, firstRowIndex, static_cast<Value>(offsetConst));
+        if (state.inputIndexOffset)
+          rowIndexForRowRead = rewriter.create<arith::SubIOp>(location, rowIndexForRowRead, state.inputIndexOffset);
+        rows.push_back(GetRow(rewriter, location, state.data, rowIndexForRowRead, state.dataMemrefType));
+      }
+
+      auto treeRange = treeIndexVar.GetRange();
+      auto treeStartConst = rewriter.create<arith::ConstantIndexOp>(location, treeRange.m_start);
+      auto treeStopConst = rewriter.create<arith::ConstantIndexOp>(location, treeRange.m_stop);
+      auto treeLoop = rewriter.create<scf::ForOp>(location, treeStartConst, treeStopConst, state.oneIndexConst);
+      rewriter.setInsertionPointToStart(treeLoop.getBody());
+      auto tree = rewriter.create<decisionforest::GetTreeFromEnsembleOp>(location, treeType, state.forestConst, treeLoop.getInductionVar());
+      std::vector<Value> trees(vectorWidth, tree);
+      std::vector<Type> treeResultTypes(vectorWidth, treeType.getThresholdType());
+      auto unrollLoopAttr = decisionforest::UnrollLoopAttribute::get(treeType, treeIndexVar.GetTreeWalkUnrollFactor());
+      auto prefetchDistanceAttr = rewriter.getI32IntegerAttr(-1);
+      auto walkOp = rewriter.create<decisionforest::PipelinedWalkDecisionTreeOp>(location, treeResultTypes, unrollLoopAttr, state.cmpPredicate, 
+                                                                                 prefetchDistanceAttr, trees, rows);
+      std::vector<Value> treePredictions;
+      for (int64_t i=0 ; i<vectorWidth ; ++i)
+        treePredictions.push_back(ExtendTreePrediction(rewriter, location, walkOp.getResult(i), state));
+      GenerateVectorizedVoteAccumulate(rewriter, location, treePredictions, firstRowIndex, state);
+    }
+
+    if (vectorEnd < range.m_stop) {
+      auto stopConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_stop);
+      LoopConstructor<scf::ForOp> loopConstructor(indexVar, state, location, rewriter, vectorEndConst, stopConst, state.oneIndexConst, 
+                                                  batchIndices, treeIndices);
+      batchIndices.push_back(loopConstructor.GetLoop().getInductionVar());
+      GenerateLoop(rewriter, location, treeIndexVar, batchIndices, treeIndices, state);
+    }
+  }
+
+  // Divides the sums of the tree predictions of an averaged forest (of each class) by the number of trees 
+  // summed and adds the initial offset of the forest.
+  void GenerateTreePredictionAverage(ConversionPatternRewriter &rewriter, Location location, decisionforest::DecisionForest& forest, 
+                                     PredictOpLoweringState& state) const {
+    if (state.reductionType != decisionforest::ReductionType::kAverage)
+      return;
+    auto elementType = state.dataMemrefType.getElementType();
+    auto initialValueConst = CreateFPConstant(rewriter, location, elementType, forest.GetInitialOffset());
+    auto averageSum = [&](Value sum, int64_t numTrees) -> Value {
+      if (numTrees == 0)
+        return initialValueConst;
+      auto scaleConst = CreateFPConstant(rewriter, location, elementType, 1.0 / numTrees);
+      auto average = rewriter.create<arith::MulFOp>(location, sum, scaleConst);
+      return rewriter.create<arith::AddFOp>(location, static_cast<Value>(average), initialValueConst);
+    };
+
+    auto batchLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, state.batchSizeConst, state.oneIndexConst);
+    rewriter.setInsertionPointToStart(batchLoop.getBody());
+    auto i = batchLoop.getInductionVar();
+    if (state.isMultiClass) {
+      std::vector<int64_t> numClassTrees(forest.GetNumClasses(), 0);
+      for (auto& tree : forest.GetTrees())
+        ++numClassTrees.at(tree->GetClassId());
+      for (int64_t classId=0 ; classId<(int64_t)numClassTrees.size() ; ++classId) {
+        auto classIdConst = rewriter.create<arith::ConstantIndexOp>(location, classId);
+        auto classWeight = rewriter.create<memref::LoadOp>(location, state.treeClassesMemref, ValueRange{i, classIdConst});
+        auto averageWeight = averageSum(classWeight, numClassTrees.at(classId));
+        rewriter.create<memref::StoreOp>(location, averageWeight, state.treeClassesMemref, ValueRange{i, classIdConst});
+      }
+    }
+    else {
+      auto sum = rewriter.create<memref::LoadOp>(location, state.resultMemref, ValueRange{i});
+      rewriter.create<memref::StoreOp>(location, averageSum(sum, forest.NumTrees()), state.resultMemref, ValueRange{i});
+    }
+    rewriter.setInsertionPointAfter(batchLoop);
+  }
+
+  // Walks the trees of a row one group at a time. After each group, the partial sum is compared against the
+  // cuts computed from the bounds of the remaining trees and the remaining groups are skipped once the 
+  // class of the row is decided. The flag that tracks whether the row is still undecided is carried 
+  // from one group to the next.
+  void GenerateEarlyExitTreeLoops(ConversionPatternRewriter &rewriter,
+                                  Location location,
+                                  const decisionforest::IndexVariable& indexVar,
+                                  PredictOpLoweringState& state,
+                                  Value row,
+                                  Value rowIndex) const {
+    auto accumulatorType = state.dataMemrefType.getElementType();
+    auto i1Type = rewriter.getI1Type();
+    auto falseConst = rewriter.create<arith::ConstantIntOp>(location, 0, i1Type);
+    Value partialSum = CreateFPConstant(rewriter, location, accumulatorType, 0.0);
+    Value undecided = rewriter.create<arith::ConstantIntOp>(location, 1, i1Type);
+
+    for (size_t i=0 ; i<state.earlyExitTreeGroups.size() ; ++i) {
+      auto& group = state.earlyExitTreeGroups.at(i);
+      auto ifUndecided = rewriter.create<scf::IfOp>(location, TypeRange({accumulatorType, i1Type}), undecided, true);
+      {
+        PatternRewriter::InsertionGuard insertGuard(rewriter);
+        rewriter.setInsertionPointToStart(ifUndecided.thenBlock());
+        auto groupSum = GenerateTreeRangeSum(rewriter, location, indexVar, state, row, group.start, group.end, partialSum);
+        Value stillUndecided = falseConst;
+        if (i != state.earlyExitTreeGroups.size() - 1) {
+          auto negativeCut = CreateFPConstant(rewriter, location, accumulatorType, group.negativeCut);
+          auto positiveCut = CreateFPConstant(rewriter, location, accumulatorType, group.positiveCut);
+          auto aboveNegativeCut = rewriter.create<arith::CmpFOp>(location, arith::CmpFPredicate::OGT, groupSum, negativeCut);
+          auto notAbovePositiveCut = rewriter.create<arith::CmpFOp>(location, arith::CmpFPredicate::OLE, groupSum, positiveCut);
+          stillUndecided = rewriter.create<arith::AndIOp>(location, aboveNegativeCut, notAbovePositiveCut);
+        }
+        rewriter.create<scf::YieldOp>(location, ValueRange{groupSum, stillUndecided});
+
+        rewriter.setInsertionPointToStart(ifUndecided.elseBlock());
+        rewriter.create<scf::YieldOp>(location, ValueRange{partialSum, falseConst});
+      }
+      partialSum = ifUndecided.getResult(0);
+      undecided = ifUndecided.getResult(1);
+    }
+
+    auto currentMemrefElem = rewriter.create<memref::LoadOp>(location, state.resultMemref, ValueRange{rowIndex});
+    auto newMemrefElem = rewriter.create<arith::AddFOp>(location, state.resultMemrefType.getElementType(), partialSum, currentMemrefElem);
+    rewriter.create<memref::StoreOp>(location, newMemrefElem, state.resultMemref, ValueRange{rowIndex});
+  }
+
   Value GenerateTreeIndexLeafLoopBody(ConversionPatternRewriter &rewriter,
                                       Location location,
                                       const decisionforest::IndexVariable& indexVar,
@@ -670,12 +1577,13 @@ struct PredictForestOpLowering: public ConversionPattern {
                                                                    row);
       // auto printResult = rewriter.create<gpu::PrintfOp>(location, "Result [%d]: %lf\t", ValueRange{rowIndex, static_cast<Value>(walkOp)});
     }
+    walkOp = ExtendTreePrediction(rewriter, location, walkOp, state);
     GenerateMultiClassAccumulate(rewriter, location, static_cast<Value>(walkOp), rowIndex, treeIndex, state);
 
     if (state.isMultiClass) return prevAccumulatorValue;
 
     // Accumulate the tree prediction
-    assert(forestType.getReductionType() == decisionforest::ReductionType::kAdd);
+    assert(forestType.getReductionType() != decisionforest::ReductionType::kVoting);
     auto accumulatedValue = rewriter.create<arith::AddFOp>(location, state.resultMemrefType.getElementType(), prevAccumulatorValue, walkOp);
 
     if (mlir::decisionforest::InsertDebugHelpers) {
@@ -722,22 +1630,25 @@ struct PredictForestOpLowering: public ConversionPattern {
 
     // Walk the tree.
     auto unrollLoopAttr = decisionforest::UnrollLoopAttribute::get(treeType, -1);
+    auto prefetchDistanceAttr = rewriter.getI32IntegerAttr(-1);
     auto walkOp = rewriter.create<
                         decisionforest::PipelinedWalkDecisionTreeOp>(location,
                                                                      treeResultTypes,
                                                                      unrollLoopAttr,
                                                                      state.cmpPredicate,
+                                                                     prefetchDistanceAttr,
                                                                      trees,
                                                                      rows);
     
     for (size_t i = 0; i < trees.size(); i++) {
+      auto treePrediction = ExtendTreePrediction(rewriter, location, walkOp.getResult(i), state);
       if (state.isMultiClass) {
-        GenerateMultiClassAccumulate(rewriter, location, walkOp.getResult(i), rowIndex, finalTreeIndices[i], state);
+        GenerateMultiClassAccumulate(rewriter, location, treePrediction, rowIndex, finalTreeIndices[i], state);
       }
       else {
           // Accumulate the tree prediction
-        assert(forestType.getReductionType() == decisionforest::ReductionType::kAdd);
-        prevAccumulatorValue = rewriter.create<arith::AddFOp>(location, state.resultMemrefType.getElementType(), prevAccumulatorValue, walkOp.getResult(i));
+        assert(forestType.getReductionType() != decisionforest::ReductionType::kVoting);
+        prevAccumulatorValue = rewriter.create<arith::AddFOp>(location, state.resultMemrefType.getElementType(), prevAccumulatorValue, treePrediction);
       }
 
       if (mlir::decisionforest::InsertDebugHelpers) {
@@ -749,10 +1660,38 @@ struct PredictForestOpLowering: public ConversionPattern {
     return prevAccumulatorValue;
   }
 
+  // Restricts a loop over trees to the tree range of an anytime prediction. The loop index needs to be the 
+  // tree index itself, so the tree loop can't be tiled. Loops that are split (for example by depth) are 
+  // each clamped to the part of the range they cover.
+  void ClampToAnytimeTreeRange(ConversionPatternRewriter &rewriter, Location location, const decisionforest::IndexVariable& indexVar,
+                               const std::list<Value>& treeIndices, PredictOpLoweringState& state, Value& start, Value& stop) const {
+    if (!state.anytimeTreeEnd)
+      return;
+    assert (treeIndices.empty() && indexVar.GetRange().m_step == 1 && !indexVar.Parallel() && 
+            "Anytime prediction needs sequential tree loops that aren't tiled");
+    start = rewriter.create<arith::MaxSIOp>(location, start, state.anytimeTreeStart);
+    stop = rewriter.create<arith::MinSIOp>(location, stop, state.anytimeTreeEnd);
+  }
+
+  // Stops the inner loop of the last tile of a tree index tiled with partial tiles at the end of the forest.
+  // The tree index is the sum of the outer tile index (the only enclosing tree loop) and the inner index.
+  void ClampToPartialTile(ConversionPatternRewriter &rewriter, Location location, const decisionforest::IndexVariable& indexVar,
+                          std::list<Value> treeIndices, PredictOpLoweringState& state, Value& stop) const {
+    if (!IsInnerIndexOfPartialTile(indexVar))
+      return;
+    auto tileModifier = static_cast<decisionforest::TileIndexModifier*>(indexVar.GetParentModifier());
+    assert (treeIndices.size() == 1 && indexVar.GetRange().m_step == 1 && "Partial tiles need the tree index to be tiled once");
+    auto sourceStop = rewriter.create<arith::ConstantIndexOp>(location, tileModifier->SourceIndex().GetRange().m_stop);
+    auto treesLeft = rewriter.create<arith::SubIOp>(location, static_cast<Value>(sourceStop), SumOfValues(rewriter, location, treeIndices));
+    stop = rewriter.create<arith::MinSIOp>(location, stop, static_cast<Value>(treesLeft));
+  }
+
   void GenerateLeafLoopForTreeIndex(ConversionPatternRewriter &rewriter, Location location, const decisionforest::IndexVariable& indexVar, 
                         std::list<Value> batchIndices, std::list<Value> treeIndices, PredictOpLoweringState& state) const {
     
     assert (indexVar.GetType() == decisionforest::IndexVariable::IndexVariableType::kTree);
+    assert (!(state.anytimeTreeEnd && (indexVar.Unroll() || indexVar.Pipelined())) && "Anytime prediction doesn't support unrolled or pipelined tree loops");
+    assert (!((indexVar.Unroll() || indexVar.Pipelined()) && IsInnerIndexOfPartialTile(indexVar)) && "Partial tiles can't be unrolled or pipelined");
     
     Value rowIndex = SumOfValues(rewriter, location, batchIndices);
     Value rowIndexForRowRead = rowIndex;
@@ -864,12 +1803,22 @@ struct PredictForestOpLowering: public ConversionPattern {
         }
       }
     }
+    else if (!state.classTreeRanges.empty()) {
+      assert (treeIndices.empty());
+      GenerateClassGroupedTreeLoops(rewriter, location, indexVar, state, row, rowIndex);
+    }
+    else if (!state.earlyExitTreeGroups.empty()) {
+      assert (treeIndices.empty());
+      GenerateEarlyExitTreeLoops(rewriter, location, indexVar, state, row, rowIndex);
+    }
     else {
       // Generate leaf loop for tree index var
       auto range = indexVar.GetRange();
-      auto stopConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_stop); 
-      auto startConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_start);
+      Value stopConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_stop); 
+      Value startConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_start);
       auto stepConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_step);
+      ClampToAnytimeTreeRange(rewriter, location, indexVar, treeIndices, state, startConst, stopConst);
+      ClampToPartialTile(rewriter, location, indexVar, treeIndices, state, stopConst);
 
       auto zeroConst = CreateFPConstant(rewriter, location, state.dataMemrefType.getElementType(), 0.0);      
 
@@ -890,13 +1839,31 @@ struct PredictForestOpLowering: public ConversionPattern {
       
       // Generate the store back in to the result memref
       auto currentMemrefElem = rewriter.create<memref::LoadOp>(location, state.resultMemref, ValueRange{rowIndex});
-      auto newMemrefElem = rewriter.create<arith::AddFOp>(location, state.resultMemrefType.getElementType(), loopResult, currentMemrefElem);
+      Value newMemrefElem = rewriter.create<arith::AddFOp>(location, state.resultMemrefType.getElementType(), loopResult, currentMemrefElem);
+      if (state.fuseSigmoidWithResultStore)
+        newMemrefElem = GenSigmoid(rewriter, newMemrefElem, location);
       rewriter.create<memref::StoreOp>(location, newMemrefElem, state.resultMemref, ValueRange{rowIndex});
 
       // rewriter.create<gpu::PrintfOp>(location, "Writing result[%d] = %lf + %lf: %lf\n", ValueRange{rowIndex, currentMemrefElem, loop.getResults()[0], newMemrefElem});
     }
   }
 
+  // Prefetch the row that is 'distance' rows ahead of rowIndex so that it is in cache 
+  // by the time the batch loop gets to it. The row index is clamped to the last row 
+  // of the batch so we never prefetch past the end of the input.
+  void GenerateInputRowPrefetch(ConversionPatternRewriter &rewriter, Location location, int32_t distance, 
+                                Value rowIndex, PredictOpLoweringState& state) const {
+    // Rows are read out of a cached buffer when there is an input offset. No point prefetching those.
+    if (state.inputIndexOffset)
+      return;
+    auto distanceConst = rewriter.create<arith::ConstantIndexOp>(location, distance);
+    auto lastRowIndex = rewriter.create<arith::SubIOp>(location, state.batchSizeConst, state.oneIndexConst);
+    auto prefetchRowIndex = rewriter.create<arith::AddIOp>(location, rowIndex, static_cast<Value>(distanceConst));
+    auto clampedRowIndex = rewriter.create<arith::MinUIOp>(location, static_cast<Value>(prefetchRowIndex), static_cast<Value>(lastRowIndex));
+    rewriter.create<memref::PrefetchOp>(location, state.data, ValueRange{clampedRowIndex, state.zeroIndexConst}, 
+                                        false /*isWrite*/, 3 /*localityHint*/, true /*isDataCache*/);
+  }
+
   void GeneratePipelinedBatchIndexLeafLoopBody(
     ConversionPatternRewriter &rewriter,
     Location location,
@@ -924,28 +1891,42 @@ struct PredictForestOpLowering: public ConversionPattern {
       trees.push_back(tree);
       treeResultTypes.push_back(treeType.getThresholdType());
       
+      if (indexVar.Prefetch())
+        GenerateInputRowPrefetch(rewriter, location, indexVar.PrefetchDistance(), rowIndex, state);
+
       batchIndices.pop_back();
     }
 
     // Walk the tree
     auto unrollLoopAttr = decisionforest::UnrollLoopAttribute::get(treeType, indexVar.GetContainingLoop()->GetTreeWalkUnrollFactor());
+    auto prefetchDistanceAttr = rewriter.getI32IntegerAttr(indexVar.Prefetch() ? indexVar.PrefetchDistance() : -1);
     auto walkOp = rewriter.create<
                             decisionforest::PipelinedWalkDecisionTreeOp>(location,
                                                                          treeResultTypes,
                                                                          unrollLoopAttr,
                                                                          state.cmpPredicate,
+                                                                         prefetchDistanceAttr,
                                                                          trees,
                                                                          rows);
+    // The rows are consecutive, so their votes are counted with one vector update
+    if (state.reductionType == decisionforest::ReductionType::kVoting) {
+      std::vector<Value> treePredictions;
+      for (size_t i = 0; i < rowIndices.size(); i++)
+        treePredictions.push_back(ExtendTreePrediction(rewriter, location, walkOp.getResult(i), state));
+      GenerateVectorizedVoteAccumulate(rewriter, location, treePredictions, rowIndices.front(), state);
+      return;
+    }
     for (size_t i = 0; i < rowIndices.size(); i++) {
+      auto treePrediction = ExtendTreePrediction(rewriter, location, walkOp.getResult(i), state);
       // Don't accumulate into memref in case of multiclass.
       if (state.isMultiClass) {
-        GenerateMultiClassAccumulate(rewriter, location, walkOp.getResult(i), rowIndices[i], treeIndex, state);
+        GenerateMultiClassAccumulate(rewriter, location, treePrediction, rowIndices[i], treeIndex, state);
       }
       else {
         // Accumulate the tree prediction and generate the store back in to the result memref
         // TODO - Check of load and store value range can just store all row indices at once
         auto currentMemrefElem = rewriter.create<memref::LoadOp>(location, state.resultMemref, ValueRange{rowIndices[i]});
-        auto accumulatedValue = rewriter.create<arith::AddFOp>(location, state.resultMemrefType.getElementType(), walkOp.getResult(i), currentMemrefElem);
+        auto accumulatedValue = rewriter.create<arith::AddFOp>(location, state.resultMemrefType.getElementType(), treePrediction, currentMemrefElem);
         rewriter.create<memref::StoreOp>(location, accumulatedValue, state.resultMemref, ValueRange{rowIndices[i]});
 
         if (mlir::decisionforest::InsertDebugHelpers) {
@@ -985,6 +1966,7 @@ struct PredictForestOpLowering: public ConversionPattern {
                                                                    row);
       // walkOp = rewriter.create<arith::ConstantFloatOp>(location, APFloat((double)0), treeType.getThresholdType().cast<FloatType>());
     }
+    walkOp = ExtendTreePrediction(rewriter, location, walkOp, state);
     
     GenerateMultiClassAccumulate(rewriter, location, static_cast<Value>(walkOp), rowIndex, treeIndex, state);
 
@@ -1004,6 +1986,43 @@ struct PredictForestOpLowering: public ConversionPattern {
     }
   }
 
+  // Walks the rows of the batch loop stepSize rows at a time with a pipelined walk. The rows that remain after the 
+  // last full step are walked together in a final iteration.
+  void GenerateBatchIndexLeafLoopInSteps(ConversionPatternRewriter &rewriter, Location location, const decisionforest::IndexVariable& indexVar, 
+                                         int32_t stepSize, std::list<Value> batchIndices, std::list<Value> treeIndices, 
+                                         decisionforest::TreeType treeType, Value tree, Value treeIndex, PredictOpLoweringState& state) const {
+    // Currently supports only single variable.
+    auto range = indexVar.GetRange();
+    
+    int32_t peeledLoopStart = range.m_stop - (range.m_stop - range.m_start) % stepSize;
+    int32_t peeledLoopStep = range.m_stop - peeledLoopStart;
+
+    auto stopConst = rewriter.create<arith::ConstantIndexOp>(location, peeledLoopStart); 
+    auto startConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_start);
+    auto stepConst = rewriter.create<arith::ConstantIndexOp>(location, stepSize);
+    
+    {
+      LoopConstructor<scf::ForOp> loopConstructor(indexVar, state, location, rewriter, startConst, stopConst, stepConst, batchIndices, treeIndices);
+      auto loop = loopConstructor.GetLoop();
+      batchIndices.push_back(loop.getInductionVar());
+      GeneratePipelinedBatchIndexLeafLoopBody(rewriter, location, indexVar, stepSize, batchIndices, treeType, tree, treeIndex, state);
+    }
+
+    if (peeledLoopStart < range.m_stop) {
+      stopConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_stop); 
+      startConst = rewriter.create<arith::ConstantIndexOp>(location, peeledLoopStart);
+      stepConst = rewriter.create<arith::ConstantIndexOp>(location, peeledLoopStep);
+
+      LoopConstructor<scf::ForOp> peeledLoopConstructor(indexVar, state, location, rewriter, startConst, stopConst, stepConst, batchIndices, treeIndices);
+      auto peeledLoop = peeledLoopConstructor.GetLoop();
+
+      batchIndices.pop_back();
+      batchIndices.push_back(peeledLoop.getInductionVar());
+
+      GeneratePipelinedBatchIndexLeafLoopBody(rewriter, location, indexVar, peeledLoopStep, batchIndices, treeType, tree, treeIndex, state);
+    }
+  }
+
   void GenerateLeafLoopForBatchIndex(ConversionPatternRewriter &rewriter, Location location, const decisionforest::IndexVariable& indexVar, 
                         std::list<Value> batchIndices, std::list<Value> treeIndices, PredictOpLoweringState& state) const {
 
@@ -1014,12 +2033,25 @@ struct PredictForestOpLowering: public ConversionPattern {
     // Get the current tree
     auto forestType = state.forestConst.getType().cast<decisionforest::TreeEnsembleType>();
     assert (forestType.doAllTreesHaveSameTileSize()); // TODO how do we check which type of tree we'll get here?
-    assert(forestType.getReductionType() == decisionforest::ReductionType::kAdd);
     auto treeType = forestType.getTreeType(0).cast<mlir::decisionforest::TreeType>();
     auto tree = rewriter.create<decisionforest::GetTreeFromEnsembleOp>(location, treeType, state.forestConst, treeIndex);
 
-    if (indexVar.Unroll()) {
-      auto range = indexVar.GetRange();
+    // The rows of a voting forest are walked a vector at a time so that the votes of a tree for the rows are counted together
+    int64_t voteVectorWidth = 1;
+    auto range = indexVar.GetRange();
+    if (state.reductionType == decisionforest::ReductionType::kVoting && range.m_step == 1 && !indexVar.Pipelined() &&
+        !indexVar.PeelWalk() && !indexVar.Parallel() && !indexVar.Cache())
+      voteVectorWidth = GetVoteVectorWidth(range.m_stop - range.m_start, state);
+
+    if (indexVar.Unroll() && voteVectorWidth > 1) {
+      for (int64_t i=range.m_start ; i<range.m_stop ; i+=voteVectorWidth) {
+        batchIndices.push_back(rewriter.create<arith::ConstantIndexOp>(location, i));
+        auto numRows = static_cast<int32_t>(std::min(voteVectorWidth, range.m_stop - i));
+        GeneratePipelinedBatchIndexLeafLoopBody(rewriter, location, indexVar, numRows, batchIndices, treeType, tree, treeIndex, state);
+        batchIndices.pop_back();
+      }
+    }
+    else if (indexVar.Unroll()) {
       for (int32_t i=range.m_start ; i<range.m_stop ; i+=range.m_step) {
         auto batchIndex = rewriter.create<arith::ConstantIndexOp>(location, i);
         batchIndices.push_back(batchIndex);
@@ -1027,40 +2059,13 @@ struct PredictForestOpLowering: public ConversionPattern {
       }
     }
     else if (indexVar.Pipelined()) {
-      // Currently supports only single variable.
-      auto range = indexVar.GetRange();
-      
-      int32_t peeledLoopStart = range.m_stop - (range.m_stop - range.m_start) % range.m_step;
-      int32_t peeledLoopStep = range.m_stop - peeledLoopStart;
-
-      auto stopConst = rewriter.create<arith::ConstantIndexOp>(location, peeledLoopStart); 
-      auto startConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_start);
-      auto stepConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_step);
-      
-      {
-        LoopConstructor<scf::ForOp> loopConstructor(indexVar, state, location, rewriter, startConst, stopConst, stepConst, batchIndices, treeIndices);
-        auto loop = loopConstructor.GetLoop();
-        batchIndices.push_back(loop.getInductionVar());
-        GeneratePipelinedBatchIndexLeafLoopBody(rewriter, location, indexVar, range.m_step, batchIndices, treeType, tree, treeIndex, state);
-      }
-
-      if (peeledLoopStart < range.m_stop) {
-        stopConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_stop); 
-        startConst = rewriter.create<arith::ConstantIndexOp>(location, peeledLoopStart);
-        stepConst = rewriter.create<arith::ConstantIndexOp>(location, peeledLoopStep);
-
-        LoopConstructor<scf::ForOp> peeledLoopConstructor(indexVar, state, location, rewriter, startConst, stopConst, stepConst, batchIndices, treeIndices);
-        auto peeledLoop = peeledLoopConstructor.GetLoop();
-
-        batchIndices.pop_back();
-        batchIndices.push_back(peeledLoop.getInductionVar());
-
-        GeneratePipelinedBatchIndexLeafLoopBody(rewriter, location, indexVar, peeledLoopStep, batchIndices, treeType, tree, treeIndex, state);
-      }
+      GenerateBatchIndexLeafLoopInSteps(rewriter, location, indexVar, range.m_step, batchIndices, treeIndices, treeType, tree, treeIndex, state);
+    }
+    else if (voteVectorWidth > 1) {
+      GenerateBatchIndexLeafLoopInSteps(rewriter, location, indexVar, voteVectorWidth, batchIndices, treeIndices, treeType, tree, treeIndex, state);
     }
     else {
       // Generate leaf loop for tree index var
-      auto range = indexVar.GetRange();
       auto stopConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_stop); 
       auto startConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_start);
       auto stepConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_step);
@@ -1084,9 +2089,19 @@ struct PredictForestOpLowering: public ConversionPattern {
     }
   }
 
+  // Batch loops with a single iteration (when the batch size is 1) are not generated. Their index is a constant. 
+  bool IsSingleIterationBatchLoop(const decisionforest::IndexVariable& indexVar) const {
+    if (indexVar.GetType() != decisionforest::IndexVariable::IndexVariableType::kBatch || indexVar.Cache() || indexVar.Parallel())
+      return false;
+    auto range = indexVar.GetRange();
+    return range.m_stop - range.m_start == 1;
+  }
+
   void GenerateUnrolledLoop(ConversionPatternRewriter &rewriter, Location location, const decisionforest::IndexVariable& indexVar, 
                         std::list<Value> batchIndices, std::list<Value> treeIndices, PredictOpLoweringState& state) const {
     auto range = indexVar.GetRange();
+    assert (!(state.anytimeTreeEnd && indexVar.GetType() == decisionforest::IndexVariable::IndexVariableType::kTree) && 
+            "Anytime prediction doesn't support unrolled tree loops");
 
     for (int32_t i=range.m_start ; i<range.m_stop ; ++i) {
       auto indexVal = rewriter.create<arith::ConstantIndexOp>(location, i);
@@ -1112,32 +2127,127 @@ struct PredictForestOpLowering: public ConversionPattern {
     }
   }
 
+  // Buffers of partial sums up to this size are allocated on the stack
+  static constexpr int64_t kMaxStackAllocatedPartialSumsBytes = 64 * 1024;
+
+  // Allocates one row of partial sums per iteration of a parallel tree loop. The rows are padded to a 
+  // whole number of cache lines so that threads accumulating the predictions of small batches don't 
+  // write to the same cache line. Small buffers are allocated on the stack at the start of the prediction 
+  // function rather than on the heap on every call. A tree loop that isn't tiled has an iteration per tree, 
+  // so larger buffers are allocated on the heap before the loop (and freed by ReduceTreeParallelPartialSums).
+  Value AllocateTreeParallelPartialSums(ConversionPatternRewriter &rewriter, Location location, const decisionforest::IndexVariable& indexVar, 
+                                        PredictOpLoweringState& state) const {
+    assert (!state.isMultiClass && "Parallel tree loops are only supported for single output models");
+    for (auto loop = indexVar.GetContainingLoop() ; loop != nullptr ; loop = loop->GetContainingLoop())
+      assert (!loop->Parallel() && "Parallel tree loops can't be nested inside other parallel loops");
+    auto range = indexVar.GetRange();
+    int64_t numIterations = (range.m_stop - range.m_start + range.m_step - 1) / range.m_step;
+    int64_t batchSize = state.resultMemrefType.getShape()[0];
+    auto elementType = state.resultMemrefType.getElementType();
+    int64_t elementsPerCacheLine = 64 / (elementType.getIntOrFloatBitWidth()/8);
+    int64_t rowLength = ((batchSize + elementsPerCacheLine - 1) / elementsPerCacheLine) * elementsPerCacheLine;
+    auto partialSumsType = MemRefType::get({numIterations, rowLength}, elementType);
+    int64_t partialSumsBytes = numIterations * rowLength * (elementType.getIntOrFloatBitWidth()/8);
+    if (partialSumsBytes > kMaxStackAllocatedPartialSumsBytes)
+      return rewriter.create<memref::AllocOp>(location, partialSumsType, rewriter.getI64IntegerAttr(64));
+    auto func = rewriter.getInsertionBlock()->getParent()->getParentOfType<func::FuncOp>();
+    PatternRewriter::InsertionGuard insertGuard(rewriter);
+    rewriter.setInsertionPointToStart(&func.getBody().front());
+    return rewriter.create<memref::AllocaOp>(location, partialSumsType, rewriter.getI64IntegerAttr(64));
+  }
+
+  // Returns the (zeroed) row of partial sums of the current iteration of a parallel tree loop. 
+  Value GetTreeParallelPartialSumsRow(ConversionPatternRewriter &rewriter, Location location, Value partialSums, Value loopIndex,
+                                      Value start, Value step, PredictOpLoweringState& state) const {
+    int64_t batchSize = state.resultMemrefType.getShape()[0];
+    auto iteration = rewriter.create<arith::SubIOp>(location, loopIndex, start);
+    auto rowIndex = rewriter.create<arith::DivUIOp>(location, static_cast<Value>(iteration), step);
+    auto zeroIndexAttr = rewriter.getIndexAttr(0);
+    auto oneIndexAttr = rewriter.getIndexAttr(1);
+    auto batchSizeAttr = rewriter.getIndexAttr(batchSize);
+    SmallVector<OpFoldResult> offsets{static_cast<Value>(rowIndex), zeroIndexAttr}, sizes{oneIndexAttr, batchSizeAttr}, strides{oneIndexAttr, oneIndexAttr};
+    auto rowType = memref::SubViewOp::inferRankReducedResultType({batchSize}, partialSums.getType().cast<MemRefType>(), 
+                                                                 offsets, sizes, strides).cast<MemRefType>();
+    auto row = rewriter.create<memref::SubViewOp>(location, rowType, partialSums, offsets, sizes, strides);
+
+    auto zeroConst = CreateFPConstant(rewriter, location, state.resultMemrefType.getElementType(), 0.0);
+    auto batchLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, state.batchSizeConst, state.oneIndexConst);
+    rewriter.setInsertionPointToStart(batchLoop.getBody());
+    rewriter.create<memref::StoreOp>(location, zeroConst, row, ValueRange{batchLoop.getInductionVar()});
+    rewriter.setInsertionPointAfter(batchLoop);
+    return row;
+  }
+
+  // Adds the partial sums of all the iterations of a parallel tree loop into the result and frees them if they're on the heap.
+  void ReduceTreeParallelPartialSums(ConversionPatternRewriter &rewriter, Location location, Value partialSums, PredictOpLoweringState& state) const {
+    auto numIterations = partialSums.getType().cast<MemRefType>().getShape()[0];
+    auto numIterationsConst = rewriter.create<arith::ConstantIndexOp>(location, numIterations);
+    auto batchLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, state.batchSizeConst, state.oneIndexConst);
+    rewriter.setInsertionPointToStart(batchLoop.getBody());
+    {
+      auto rowIndex = batchLoop.getInductionVar();
+      auto result = rewriter.create<memref::LoadOp>(location, state.resultMemref, ValueRange{rowIndex});
+      auto iterationLoop = rewriter.create<scf::ForOp>(location, state.zeroIndexConst, numIterationsConst, state.oneIndexConst, ValueRange{result});
+      rewriter.setInsertionPointToStart(iterationLoop.getBody());
+      auto partialSum = rewriter.create<memref::LoadOp>(location, partialSums, ValueRange{iterationLoop.getInductionVar(), rowIndex});
+      auto sum = rewriter.create<arith::AddFOp>(location, iterationLoop.getBody()->getArguments()[1], partialSum);
+      rewriter.create<scf::YieldOp>(location, static_cast<Value>(sum));
+      rewriter.setInsertionPointAfter(iterationLoop);
+      rewriter.create<memref::StoreOp>(location, iterationLoop.getResult(0), state.resultMemref, ValueRange{rowIndex});
+    }
+    rewriter.setInsertionPointAfter(batchLoop);
+    if (partialSums.getDefiningOp<memref::AllocOp>())
+      rewriter.create<memref::DeallocOp>(location, partialSums);
+  }
+
   void GenerateSingleLoop(ConversionPatternRewriter &rewriter, Location location, const decisionforest::IndexVariable& indexVar, 
                     std::list<Value> batchIndices, std::list<Value> treeIndices, PredictOpLoweringState& state) const {
     auto range = indexVar.GetRange();
-    auto stopConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_stop); 
-    auto startConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_start);
+    Value stopConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_stop); 
+    Value startConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_start);
     auto stepConst = rewriter.create<arith::ConstantIndexOp>(location, range.m_step);
+    if (indexVar.GetType() == decisionforest::IndexVariable::IndexVariableType::kTree) {
+      ClampToAnytimeTreeRange(rewriter, location, indexVar, treeIndices, state, startConst, stopConst);
+      ClampToPartialTile(rewriter, location, indexVar, treeIndices, state, stopConst);
+    }
 
     if (indexVar.Parallel()) {
-      LoopConstructor<scf::ParallelOp> loopConstructor(std::list<const decisionforest::IndexVariable*>{&indexVar}, state, location, rewriter, 
-                                                       ValueRange{startConst},
-                                                       ValueRange{stopConst},
-                                                       ValueRange{stepConst},
-                                                       batchIndices, treeIndices);
-      auto i = loopConstructor.GetLoop().getInductionVars()[0];
+      // Iterations of a parallel tree loop walk different trees for the same rows. Each of them 
+      // accumulates into its own partial sums, which are added into the result after the loop.
+      bool isTreeParallel = indexVar.GetType() == decisionforest::IndexVariable::IndexVariableType::kTree;
+      Value partialSums, resultMemref = state.resultMemref;
+      if (isTreeParallel)
+        partialSums = AllocateTreeParallelPartialSums(rewriter, location, indexVar, state);
+      {
+        LoopConstructor<scf::ParallelOp> loopConstructor(std::list<const decisionforest::IndexVariable*>{&indexVar}, state, location, rewriter, 
+                                                         ValueRange{startConst},
+                                                         ValueRange{stopConst},
+                                                         ValueRange{stepConst},
+                                                         batchIndices, treeIndices);
+        auto i = loopConstructor.GetLoop().getInductionVars()[0];
 
-      if (indexVar.GetType() == decisionforest::IndexVariable::IndexVariableType::kBatch)
-        batchIndices.push_back(i);
-      else if (indexVar.GetType() == decisionforest::IndexVariable::IndexVariableType::kTree)
-        treeIndices.push_back(i);
-      else
-        assert (false && "Unknown index variable type!");
+        if (indexVar.GetType() == decisionforest::IndexVariable::IndexVariableType::kBatch)
+          batchIndices.push_back(i);
+        else if (indexVar.GetType() == decisionforest::IndexVariable::IndexVariableType::kTree)
+          treeIndices.push_back(i);
+        else
+          assert (false && "Unknown index variable type!");
 
-      for (auto nestedIndexVar : indexVar.GetContainedLoops()) {
-        GenerateLoop(rewriter, location, *nestedIndexVar, batchIndices, treeIndices, state);
+        if (isTreeParallel)
+          state.resultMemref = GetTreeParallelPartialSumsRow(rewriter, location, partialSums, i, startConst, stepConst, state);
+
+        for (auto nestedIndexVar : indexVar.GetContainedLoops()) {
+          GenerateLoop(rewriter, location, *nestedIndexVar, batchIndices, treeIndices, state);
+        }
+      }
+      if (isTreeParallel) {
+        state.resultMemref = resultMemref;
+        ReduceTreeParallelPartialSums(rewriter, location, partialSums, state);
       }
     }
+    else if (GetVotingVectorWidth(indexVar, state) > 1) {
+      GenerateVectorizedVotingBatchLoop(rewriter, location, indexVar, batchIndices, treeIndices, state);
+    }
     else {
       LoopConstructor<scf::ForOp> loopConstructor(indexVar, state, location, rewriter, startConst, stopConst, stepConst, batchIndices, treeIndices);
       auto i = loopConstructor.GetLoop().getInductionVar();
@@ -1261,7 +2371,7 @@ struct PredictForestOpLowering: public ConversionPattern {
       if (indexVar.GetGPUDimension().construct != decisionforest::IndexVariable::GPUConstruct::None) {
         GenerateGPUParallelLoops(rewriter, location, indexVar, batchIndices, treeIndices, state);
       }
-      else if (indexVar.Unroll()) {
+      else if (indexVar.Unroll() || IsSingleIterationBatchLoop(indexVar)) {
         GenerateUnrolledLoop(rewriter, location, indexVar, batchIndices, treeIndices, state);
       }
       else {
@@ -1281,41 +2391,286 @@ struct PredictForestOpLowering: public ConversionPattern {
 
     // First initialize the result memref to zeros (This is not always needed, for example for the default schedule, but leaving that optimization out for now)
     InitPredictOpLoweringState(rewriter, location, state, forestOp, operands, dataMemrefType, batchSize);
-    InitializeResultMemref(rewriter, location, state);
-    InitializeTreeClassWeightsMemref(rewriter, location, state);
 
     auto scheduleAttribute = forestOp.getSchedule();
     auto& schedule = *scheduleAttribute.GetSchedule();
 
+    // The thresholds of a quantized forest (or of some of its features) are bin indices and the input rows are binned
+    // when they're cached. The used columns of the rows of a forest with compacted features are gathered when they're 
+    // cached. If the schedule doesn't cache the rows of every tree walk, the outermost batch loops are cached so that 
+    // only a few rows are binned or gathered into a small buffer at a time.
+    auto& forest = forestOp.getEnsemble().GetDecisionForest();
+    auto module = op->getParentOfType<mlir::ModuleOp>();
+    if (forest.HasBinnedFeatures()) {
+      assert (!state.hasGPUMapping && "Quantized models are not supported on GPUs");
+      state.binBoundaries = CreateFeatureBinBoundariesGlobal(rewriter, location, module, forest.GetFeatureBinBoundaries(), 
+                                                             state.dataMemrefType.getElementType().cast<mlir::FloatType>());
+      state.binnedFeatures = forest.GetBinnedFeatures();
+    }
+    if (forest.IsFeatureCompacted()) {
+      assert (!state.hasGPUMapping && "Feature compaction is not supported on GPUs");
+      state.compactFeatureColumns = forest.GetCompactFeatureColumns();
+    }
+    if ((forest.HasBinnedFeatures() || forest.IsFeatureCompacted()) && !AreTreeWalksInCachedBatchLoops(*schedule.GetRootIndex(), false))
+      CacheOutermostBatchLoops(schedule);
+    bool rowsAreCached = AreTreeWalksInCachedBatchLoops(*schedule.GetRootIndex(), false);
+
+    // Otherwise (when a tree loop is outermost), all the rows are gathered and binned up front
+    if (forest.IsFeatureCompacted() && !rowsAreCached && !forest.HasBinnedFeatures())
+      GenerateInputCompaction(rewriter, location, state);
+
+    if (forest.HasBinnedFeatures() && !rowsAreCached)
+      GenerateInputBinning(rewriter, location, state, module);
+
+    InitializeResultMemref(rewriter, location, state);
+    InitializeTreeClassWeightsMemref(rewriter, location, state);
+
     // Generate the loop nest
     auto rootIndex = schedule.GetRootIndex();
     assert (rootIndex);
     for (auto index : rootIndex->GetContainedLoops())
       GenerateLoop(rewriter, location, *index, std::list<Value>{}, std::list<Value>{}, state);
 
-    // Generate the transformations to compute final prediction (sigmoid etc)
-    TransformResultMemref(rewriter, location, forestOp.getEnsemble().GetDecisionForest().GetPredictionTransformation(), state);
+    GenerateTreePredictionAverage(rewriter, location, forest, state);
+
+    // Generate the transformations to compute final prediction (sigmoid etc). Anytime predictions return
+    // the margin of the walked trees so that the margins of several tree ranges can be summed.
+    if (!state.anytimeTreeEnd)
+      TransformResultMemref(rewriter, location, forest.GetPredictionTransformation(), state);
     rewriter.replaceOp(op, static_cast<Value>(state.resultMemref));
     return mlir::success();
   }
 
 };
 
+// Reorders the trees of a multi-class forest so that the trees of each class are contiguous. 
+// The prediction lowering can then split the tree loop by class (see GenerateClassGroupedTreeLoops).
+struct ReorderTreesByClassPattern : public RewritePattern {
+  ReorderTreesByClassPattern(MLIRContext *ctx) 
+    : RewritePattern(mlir::decisionforest::PredictForestOp::getOperationName(), 1 /*benefit*/, ctx)
+  {}
+
+  LogicalResult matchAndRewrite(Operation *op, PatternRewriter &rewriter) const final {
+    mlir::decisionforest::PredictForestOp predictOp = llvm::dyn_cast<mlir::decisionforest::PredictForestOp>(op);
+    assert(predictOp);
+    if (!predictOp)
+      return mlir::failure();
+
+    auto forestAttribute = predictOp.getEnsemble();
+    auto forest = forestAttribute.GetDecisionForest();
+    if (!forest.IsMultiClassClassifier() || !IsSimpleInnermostTreeLoop(*predictOp.getSchedule().GetSchedule()))
+      return mlir::failure();
+    // The trees of a voting forest aren't walked by class
+    if (forest.GetReductionType() == decisionforest::ReductionType::kVoting)
+      return mlir::failure();
+    if (!GetClassTreeRanges(forest).empty())
+      return mlir::failure();
+
+    auto& trees = forest.GetTrees();
+    std::vector<size_t> treeOrder(trees.size());
+    std::iota(treeOrder.begin(), treeOrder.end(), 0);
+    std::stable_sort(treeOrder.begin(), treeOrder.end(), 
+                     [&](size_t t1, size_t t2) { return trees.at(t1)->GetClassId() < trees.at(t2)->GetClassId(); });
+    std::vector<std::shared_ptr<DecisionTree>> reorderedTrees;
+    for (auto treeIndex : treeOrder)
+      reorderedTrees.push_back(trees.at(treeIndex));
+    trees = reorderedTrees;
+
+    // The types of the trees move with the trees
+    auto forestType = forestAttribute.getType().cast<decisionforest::TreeEnsembleType>().getReorderedType(treeOrder);
+    auto newForestAttribute = decisionforest::DecisionForestAttribute::get(forestType, forest);
+    auto reorderedPredictForestOp = rewriter.create<decisionforest::PredictForestOp>(op->getLoc(), 
+                                                                                     predictOp.getResult().getType(), 
+                                                                                     newForestAttribute,
+                                                                                     predictOp.getPredicateAttr(), 
+                                                                                     predictOp.getData(),
+                                                                                     predictOp.getResult(),
+                                                                                     predictOp.getSchedule());
+    rewriter.replaceOp(op, static_cast<Value>(reorderedPredictForestOp));
+    return mlir::success();
+  }
+};
+
+struct ReorderTreesByClassPass : public PassWrapper<ReorderTreesByClassPass, OperationPass<mlir::ModuleOp>> {
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<memref::MemRefDialect, scf::SCFDialect>();
+  }
+  void runOnOperation() final {
+    RewritePatternSet patterns(&getContext());
+    patterns.add<ReorderTreesByClassPattern>(&getContext());
+
+    if (failed(applyPatternsAndFoldGreedily(getOperation(), std::move(patterns))))
+        signalPassFailure();
+  }
+};
+
+// Variance of the prediction of a tree over the profiled inputs, with every leaf weighted by its hit count. 
+// Without a profile, a leaf at depth d is weighted by 2^-d (the fraction of the inputs that reach it if 
+// every split sends half of its inputs each way).
+double GetTreeContributionVariance(DecisionTree& tree) {
+  auto& nodes = tree.GetNodes();
+  bool hasProfile = std::any_of(nodes.begin(), nodes.end(), [](const DecisionTree::Node& n) { return n.IsLeaf() && n.hitCount > 0; });
+  double totalWeight = 0.0, weightedSum = 0.0, weightedSumOfSquares = 0.0;
+  for (auto& node : nodes) {
+    if (!node.IsLeaf())
+      continue;
+    double weight;
+    if (hasProfile) {
+      weight = node.hitCount;
+    }
+    else {
+      int32_t depth = 0;
+      for (auto parent = node.parent ; parent != DecisionTree::INVALID_NODE_INDEX ; parent = nodes.at(parent).parent)
+        ++depth;
+      weight = std::ldexp(1.0, -depth);
+    }
+    totalWeight += weight;
+    weightedSum += weight * node.threshold;
+    weightedSumOfSquares += weight * node.threshold * node.threshold;
+  }
+  if (totalWeight == 0.0)
+    return 0.0;
+  auto mean = weightedSum / totalWeight;
+  return std::max(0.0, weightedSumOfSquares / totalWeight - mean * mean);
+}
+
+// Reorders the trees of a forest compiled for anytime prediction so that the trees whose predictions vary 
+// the most come first. A prefix of the reordered forest then accounts for more of the variation of the 
+// full model's margin than a prefix of the trees in training order.
+struct ReorderTreesByContributionVariancePattern : public RewritePattern {
+  ReorderTreesByContributionVariancePattern(MLIRContext *ctx) 
+    : RewritePattern(mlir::decisionforest::PredictForestOp::getOperationName(), 1 /*benefit*/, ctx)
+  {}
+
+  LogicalResult matchAndRewrite(Operation *op, PatternRewriter &rewriter) const final {
+    mlir::decisionforest::PredictForestOp predictOp = llvm::dyn_cast<mlir::decisionforest::PredictForestOp>(op);
+    assert(predictOp);
+    if (!predictOp)
+      return mlir::failure();
+
+    auto& schedule = *predictOp.getSchedule().GetSchedule();
+    if (!schedule.GetTreeIndex().ReorderTreesByContributionVariance() || !IsSimpleInnermostTreeLoop(schedule))
+      return mlir::failure();
+    auto forestAttribute = predictOp.getEnsemble();
+    auto forest = forestAttribute.GetDecisionForest();
+    if (forest.IsMultiClassClassifier())
+      return mlir::failure();
+
+    auto& trees = forest.GetTrees();
+    std::vector<std::pair<double, std::shared_ptr<DecisionTree>>> treeVariances;
+    for (auto& tree : trees)
+      treeVariances.push_back(std::make_pair(GetTreeContributionVariance(*tree), tree));
+    auto compareVariances = [](const std::pair<double, std::shared_ptr<DecisionTree>>& t1, const std::pair<double, std::shared_ptr<DecisionTree>>& t2) {
+                              return t1.first > t2.first;
+                            };
+    if (std::is_sorted(treeVariances.begin(), treeVariances.end(), compareVariances))
+      return mlir::failure();
+    std::stable_sort(treeVariances.begin(), treeVariances.end(), compareVariances);
+    for (size_t i=0 ; i<trees.size() ; ++i)
+      trees.at(i) = treeVariances.at(i).second;
+
+    auto forestType = forestAttribute.getType().cast<decisionforest::TreeEnsembleType>();
+    auto newForestAttribute = decisionforest::DecisionForestAttribute::get(forestType, forest);
+    auto reorderedPredictForestOp = rewriter.create<decisionforest::PredictForestOp>(op->getLoc(), 
+                                                                                     predictOp.getResult().getType(), 
+                                                                                     newForestAttribute,
+                                                                                     predictOp.getPredicateAttr(), 
+                                                                                     predictOp.getData(),
+                                                                                     predictOp.getResult(),
+                                                                                     predictOp.getSchedule());
+    rewriter.replaceOp(op, static_cast<Value>(reorderedPredictForestOp));
+    return mlir::success();
+  }
+};
+
+struct ReorderTreesByContributionVariancePass : public PassWrapper<ReorderTreesByContributionVariancePass, OperationPass<mlir::ModuleOp>> {
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<memref::MemRefDialect, scf::SCFDialect>();
+  }
+  void runOnOperation() final {
+    RewritePatternSet patterns(&getContext());
+    patterns.add<ReorderTreesByContributionVariancePattern>(&getContext());
+
+    if (failed(applyPatternsAndFoldGreedily(getOperation(), std::move(patterns))))
+        signalPassFailure();
+  }
+};
+
+// Appends the arguments the lowered prediction function takes (see PredictionFunctionArguments) to the functions 
+// that predict a forest and adds the functions that describe the prediction function to the module (see 
+// kPredictionFunctionArgumentsFunctionName). The arguments are added before the predict op is lowered so that 
+// the lowering can use them.
+struct AddPredictionFunctionArgumentsPass : public PassWrapper<AddPredictionFunctionArgumentsPass, OperationPass<mlir::ModuleOp>> {
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<func::FuncDialect, arith::ArithDialect>();
+  }
+
+  static decisionforest::PredictionFunctionArguments GetPredictionFunctionArguments(decisionforest::PredictForestOp predictOp) {
+    auto& schedule = *predictOp.getSchedule().GetSchedule();
+    if (predictOp.getEnsemble().GetDecisionForest().IsMultiClassClassifier() && !LoopNestHasGPUMapping(*schedule.GetRootIndex()))
+      return decisionforest::PredictionFunctionArguments::kClassScores;
+    if (schedule.GetTreeIndex().AnytimePrediction())
+      return decisionforest::PredictionFunctionArguments::kTreeRange;
+    return decisionforest::PredictionFunctionArguments::kNone;
+  }
+
+  void AddConstIntegerGetFunction(mlir::ModuleOp module, const std::string& functionName, int32_t value) {
+    OpBuilder builder(&getContext());
+    auto location = module.getLoc();
+    auto int32Type = builder.getI32Type();
+    builder.setInsertionPointToEnd(module.getBody());
+    auto func = builder.create<func::FuncOp>(location, functionName, builder.getFunctionType({ }, int32Type));
+    func.setPublic();
+    builder.setInsertionPointToStart(func.addEntryBlock());
+    auto constVal = builder.create<arith::ConstantIntOp>(location, value, int32Type);
+    builder.create<func::ReturnOp>(location, static_cast<Value>(constVal));
+  }
+
+  void runOnOperation() final {
+    auto module = getOperation();
+    std::vector<decisionforest::PredictForestOp> predictOps;
+    module.walk([&](decisionforest::PredictForestOp predictOp) { predictOps.push_back(predictOp); });
+    if (predictOps.empty())
+      return;
+    assert (predictOps.size() == 1 && "Expected a single predict op in the module");
+    auto predictOp = predictOps.front();
+    auto function = predictOp->getParentOfType<func::FuncOp>();
+    auto location = function.getLoc();
+    auto arguments = GetPredictionFunctionArguments(predictOp);
+    auto& forest = predictOp.getEnsemble().GetDecisionForest();
+    OpBuilder builder(&getContext());
+    if (arguments == decisionforest::PredictionFunctionArguments::kClassScores) {
+      auto dataType = predictOp.getData().getType().cast<MemRefType>();
+      auto scoresType = MemRefType::get({dataType.getShape()[0], static_cast<int64_t>(forest.GetNumClasses())}, dataType.getElementType());
+      function.insertArgument(function.getNumArguments(), scoresType, DictionaryAttr(), location);
+      function.insertArgument(function.getNumArguments(), builder.getI32Type(), DictionaryAttr(), location);
+    }
+    else if (arguments == decisionforest::PredictionFunctionArguments::kTreeRange) {
+      function.insertArgument(function.getNumArguments(), builder.getI64Type(), DictionaryAttr(), location);
+      function.insertArgument(function.getNumArguments(), builder.getI64Type(), DictionaryAttr(), location);
+    }
+    AddConstIntegerGetFunction(module, kPredictionFunctionArgumentsFunctionName, static_cast<int32_t>(arguments));
+    AddConstIntegerGetFunction(module, kNumberOfTreesFunctionName, static_cast<int32_t>(forest.NumTrees()));
+  }
+};
+
 struct HighLevelIRToMidLevelIRLoweringPass: public PassWrapper<HighLevelIRToMidLevelIRLoweringPass, OperationPass<mlir::ModuleOp>> {
+  bool m_useFastApproximateTransforms;
+  HighLevelIRToMidLevelIRLoweringPass(bool useFastApproximateTransforms) : m_useFastApproximateTransforms(useFastApproximateTransforms) { }
   void getDependentDialects(DialectRegistry &registry) const override {
-    registry.insert<AffineDialect, memref::MemRefDialect, scf::SCFDialect>();
+    registry.insert<AffineDialect, memref::MemRefDialect, scf::SCFDialect, vector::VectorDialect>();
   }
   void runOnOperation() final {
     ConversionTarget target(getContext());
 
     target.addLegalDialect<memref::MemRefDialect, scf::SCFDialect, 
                            decisionforest::DecisionForestDialect, math::MathDialect,
-                           arith::ArithDialect, func::FuncDialect, gpu::GPUDialect>();
+                           arith::ArithDialect, func::FuncDialect, gpu::GPUDialect, vector::VectorDialect>();
 
     target.addIllegalOp<decisionforest::PredictForestOp>();
 
     RewritePatternSet patterns(&getContext());
-    patterns.add<PredictForestOpLowering>(&getContext());
+    patterns.add<PredictForestOpLowering>(&getContext(), m_useFastApproximateTransforms);
 
     if (failed(applyPartialConversion(getOperation(), target, std::move(patterns))))
         signalPassFailure();
@@ -1330,14 +2685,17 @@ namespace mlir
 namespace decisionforest
 {
 
-void AddWalkDecisionTreeOpLoweringPass(mlir::PassManager &optPM);
+void AddWalkDecisionTreeOpLoweringPass(mlir::PassManager &optPM, bool specializeObliviousTrees);
 
-void LowerFromHighLevelToMidLevelIR(mlir::MLIRContext& context, mlir::ModuleOp module) {
+void LowerFromHighLevelToMidLevelIR(mlir::MLIRContext& context, mlir::ModuleOp module, bool specializeObliviousTrees, bool useFastApproximateTransforms) {
   // llvm::DebugFlag = true;
   // Lower from high-level IR to mid-level IR
   mlir::PassManager pm(&context);
-  pm.addPass(std::make_unique<HighLevelIRToMidLevelIRLoweringPass>());
-  AddWalkDecisionTreeOpLoweringPass(pm);
+  pm.addPass(std::make_unique<ReorderTreesByClassPass>());
+  pm.addPass(std::make_unique<ReorderTreesByContributionVariancePass>());
+  pm.addPass(std::make_unique<AddPredictionFunctionArgumentsPass>());
+  pm.addPass(std::make_unique<HighLevelIRToMidLevelIRLoweringPass>(useFastApproximateTransforms));
+  AddWalkDecisionTreeOpLoweringPass(pm, specializeObliviousTrees);
 
   if (mlir::failed(pm.run(module))) {
     llvm::errs() << "Lowering to mid level IR failed.\n";
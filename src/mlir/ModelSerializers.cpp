@@ -248,7 +248,7 @@ void PersistDecisionForestSparse(mlir::decisionforest::DecisionForest& forest, m
                 std::vector<int32_t> tileShapeIDs, leafBitMasks;
                 std::vector<int32_t> childIndices, leafIndices;
                 std::vector<double> leaves;
-                tiledTree.GetSparseSerialization(thresholds, featureIndices, tileShapeIDs, childIndices, leaves);
+                tiledTree.GetSparseSerialization(thresholds, featureIndices, tileShapeIDs, childIndices, leaves, decisionforest::UseHotPathSparseLayout);
                 int32_t numTiles = tileShapeIDs.size();
                 int32_t tileSize = tiledTree.TileSize();
                 int32_t classId = tiledTree.GetClassId();
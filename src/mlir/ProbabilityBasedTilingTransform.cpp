@@ -29,15 +29,17 @@ struct TileEnsembleAttribute : public RewritePattern {
   Type m_tileShapeType;
   bool m_hybrid;
   double m_tilingThreshold;
+  // Peel the first levels of the walks of probabilistically tiled trees
+  bool m_peelWalks;
 
   TileEnsembleAttribute(MLIRContext *ctx, int32_t tileSize, Type tileShapeType) 
     : RewritePattern(mlir::decisionforest::PredictForestOp::getOperationName(), 1 /*benefit*/, ctx),
-      m_tileSize(tileSize), m_tileShapeType(tileShapeType), m_hybrid(false), m_tilingThreshold(0.0)
+      m_tileSize(tileSize), m_tileShapeType(tileShapeType), m_hybrid(false), m_tilingThreshold(0.0), m_peelWalks(false)
   {}
 
-  TileEnsembleAttribute(MLIRContext *ctx, int32_t tileSize, Type tileShapeType, bool hybrid, double tilingThreshold) 
+  TileEnsembleAttribute(MLIRContext *ctx, int32_t tileSize, Type tileShapeType, bool hybrid, double tilingThreshold, bool peelWalks) 
     : RewritePattern(mlir::decisionforest::PredictForestOp::getOperationName(), 1 /*benefit*/, ctx),
-      m_tileSize(tileSize), m_tileShapeType(tileShapeType), m_hybrid(hybrid), m_tilingThreshold(tilingThreshold)
+      m_tileSize(tileSize), m_tileShapeType(tileShapeType), m_hybrid(hybrid), m_tilingThreshold(tilingThreshold), m_peelWalks(peelWalks)
   {}
 
   LogicalResult matchAndRewrite(Operation *op, PatternRewriter &rewriter) const final {
@@ -62,7 +64,7 @@ struct TileEnsembleAttribute : public RewritePattern {
       
       auto tiledProbabilistically = TileSingleDecisionTree(forest.GetTree(i));
       numTreesTiledProbabilistically += tiledProbabilistically ? 1 : 0;
-      if (mlir::decisionforest::PeeledCodeGenForProbabiltyBasedTiling && tiledProbabilistically) {
+      if ((m_peelWalks || mlir::decisionforest::PeeledCodeGenForProbabiltyBasedTiling) && tiledProbabilistically) {
         auto tiledTree = forest.GetTree(i).GetTiledTree();
         tiledTree->SetProbabilisticallyTiled(tiledProbabilistically);
         // Set the number of levels that need to be peeled.
@@ -214,11 +216,12 @@ struct ProbabilityBasedTilingPass : public PassWrapper<ProbabilityBasedTilingPas
   int32_t m_tileShapeBitWidth;
   bool m_hybrid;
   double m_tilingThreshold;
-  ProbabilityBasedTilingPass(int32_t tileSize, int32_t tileShapeBitWidth) 
-    : m_tileSize(tileSize), m_tileShapeBitWidth(tileShapeBitWidth), m_hybrid(false), m_tilingThreshold(0.0)
+  bool m_peelWalks;
+  ProbabilityBasedTilingPass(int32_t tileSize, int32_t tileShapeBitWidth, bool peelWalks) 
+    : m_tileSize(tileSize), m_tileShapeBitWidth(tileShapeBitWidth), m_hybrid(false), m_tilingThreshold(0.0), m_peelWalks(peelWalks)
   { }
-  ProbabilityBasedTilingPass(int32_t tileSize, int32_t tileShapeBitWidth, bool hybrid, double tilingThreshold) 
-    : m_tileSize(tileSize), m_tileShapeBitWidth(tileShapeBitWidth), m_hybrid(hybrid), m_tilingThreshold(tilingThreshold)
+  ProbabilityBasedTilingPass(int32_t tileSize, int32_t tileShapeBitWidth, bool hybrid, double tilingThreshold, bool peelWalks) 
+    : m_tileSize(tileSize), m_tileShapeBitWidth(tileShapeBitWidth), m_hybrid(hybrid), m_tilingThreshold(tilingThreshold), m_peelWalks(peelWalks)
   { }
   void getDependentDialects(DialectRegistry &registry) const override {
     registry.insert<AffineDialect, memref::MemRefDialect, scf::SCFDialect, math::MathDialect>();
@@ -226,7 +229,7 @@ struct ProbabilityBasedTilingPass : public PassWrapper<ProbabilityBasedTilingPas
   void runOnOperation() final {
     RewritePatternSet patterns(&getContext());
     auto tileShapeType = IntegerType::get(&getContext(), m_tileShapeBitWidth);
-    patterns.add<TileEnsembleAttribute>(&getContext(), m_tileSize, tileShapeType, m_hybrid, m_tilingThreshold);
+    patterns.add<TileEnsembleAttribute>(&getContext(), m_tileSize, tileShapeType, m_hybrid, m_tilingThreshold, m_peelWalks);
 
     if (failed(applyPatternsAndFoldGreedily(getOperation(), std::move(patterns))))
         signalPassFailure();
@@ -239,18 +242,18 @@ namespace mlir
 {
 namespace decisionforest
 {
-void DoProbabilityBasedTiling(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t tileSize, int32_t tileShapeBitWidth) {
+void DoProbabilityBasedTiling(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t tileSize, int32_t tileShapeBitWidth, bool peelWalks) {
   mlir::PassManager pm(&context);
-  pm.addPass(std::make_unique<ProbabilityBasedTilingPass>(tileSize, tileShapeBitWidth));
+  pm.addPass(std::make_unique<ProbabilityBasedTilingPass>(tileSize, tileShapeBitWidth, peelWalks));
 
   if (mlir::failed(pm.run(module))) {
     llvm::errs() << "Lowering to mid level IR failed.\n";
   }
 }
 
-void DoHybridTiling(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t tileSize, int32_t tileShapeBitWidth) {
+void DoHybridTiling(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t tileSize, int32_t tileShapeBitWidth, bool peelWalks) {
   mlir::PassManager pm(&context);
-  pm.addPass(std::make_unique<ProbabilityBasedTilingPass>(tileSize, tileShapeBitWidth, true, 0.20));
+  pm.addPass(std::make_unique<ProbabilityBasedTilingPass>(tileSize, tileShapeBitWidth, true, 0.20, peelWalks));
 
   if (mlir::failed(pm.run(module))) {
     llvm::errs() << "Lowering to mid level IR failed.\n";
@@ -153,9 +153,10 @@ struct SplitTreeLoopsByTreeDepthPattern : public RewritePattern {
 
   int32_t m_pipelineSize;
   int32_t m_numberOfCores;
-  SplitTreeLoopsByTreeDepthPattern(MLIRContext *ctx, int32_t pipelineSize, int32_t numCores) 
+  int32_t m_prefetchDistance;
+  SplitTreeLoopsByTreeDepthPattern(MLIRContext *ctx, int32_t pipelineSize, int32_t numCores, int32_t prefetchDistance) 
     : RewritePattern(mlir::decisionforest::PredictForestOp::getOperationName(), 1 /*benefit*/, ctx), 
-      m_pipelineSize(pipelineSize), m_numberOfCores(numCores)
+      m_pipelineSize(pipelineSize), m_numberOfCores(numCores), m_prefetchDistance(prefetchDistance)
   {}
 
   void SplitTreeLoopForProbAndUniformTiling(decisionforest::Schedule* schedule, decisionforest::DecisionForest& forest,
@@ -208,6 +209,8 @@ struct SplitTreeLoopsByTreeDepthPattern : public RewritePattern {
     auto& treeIndex = *treeIndexPtr;
     // TODO check this API. Why do we need the second parameter?
     schedule->Pipeline(batchIndex, m_pipelineSize);
+    if (m_prefetchDistance > 0)
+      schedule->Prefetch(batchIndex, m_prefetchDistance);
     
     // This index may already have been split. So we need to start at the right place
     int32_t currTreeIndex = treeIndex.GetRange().m_start; 
@@ -339,15 +342,16 @@ struct SplitTreeLoopsByTreeDepthPattern : public RewritePattern {
 struct SplitTreeLoopByDepth : public PassWrapper<SplitTreeLoopByDepth, OperationPass<mlir::ModuleOp>> {
   int32_t m_pipelineSize;
   int32_t m_numCores;
-  SplitTreeLoopByDepth(int32_t pipelineSize, int32_t numCores) 
-  :m_pipelineSize(pipelineSize), m_numCores(numCores)
+  int32_t m_prefetchDistance;
+  SplitTreeLoopByDepth(int32_t pipelineSize, int32_t numCores, int32_t prefetchDistance) 
+  :m_pipelineSize(pipelineSize), m_numCores(numCores), m_prefetchDistance(prefetchDistance)
   { }
   void getDependentDialects(DialectRegistry &registry) const override {
     registry.insert<AffineDialect, memref::MemRefDialect, scf::SCFDialect, math::MathDialect>();
   }
   void runOnOperation() final {
     RewritePatternSet patterns(&getContext());
-    patterns.add<SplitTreeLoopsByTreeDepthPattern>(&getContext(), m_pipelineSize, m_numCores);
+    patterns.add<SplitTreeLoopsByTreeDepthPattern>(&getContext(), m_pipelineSize, m_numCores, m_prefetchDistance);
 
     if (failed(applyPatternsAndFoldGreedily(getOperation(), std::move(patterns))))
         signalPassFailure();
@@ -361,11 +365,11 @@ namespace mlir
 {
 namespace decisionforest
 {
-void DoReorderTreesByDepth(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t pipelineSize, int32_t numCores) {
+void DoReorderTreesByDepth(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t pipelineSize, int32_t numCores, int32_t prefetchDistance) {
   mlir::PassManager pm(&context);
   pm.addPass(std::make_unique<ReorderTreesByDepthPass>());
   // TODO pipelineSize needs to be added to CompilerOptions
-  pm.addPass(std::make_unique<SplitTreeLoopByDepth>(pipelineSize, numCores));
+  pm.addPass(std::make_unique<SplitTreeLoopByDepth>(pipelineSize, numCores, prefetchDistance));
 
   if (mlir::failed(pm.run(module))) {
     llvm::errs() << "Lowering to mid level IR failed.\n";
@@ -22,6 +22,9 @@
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Types.h"
 #include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <map>
 
 using namespace mlir;
 using namespace mlir::decisionforest::helpers;
@@ -242,6 +245,16 @@ struct GetModelMemrefSizeOpLowering : public ConversionPattern {
   }
 };
 
+// Cache buffers are allocated at the start of the closest enclosing allocation scope (the function or the 
+// body of a parallel loop) so that the stack doesn't grow with every iteration of the loops they're used in.
+Value AllocateCacheBuffer(ConversionPatternRewriter &rewriter, mlir::Operation *op, MemRefType memrefType) {
+  PatternRewriter::InsertionGuard insertGuard(rewriter);
+  auto allocationScope = op->getParentWithTrait<OpTrait::AutomaticAllocationScope>();
+  assert (allocationScope);
+  rewriter.setInsertionPointToStart(&allocationScope->getRegion(0).front());
+  return rewriter.create<memref::AllocaOp>(op->getLoc(), memrefType, rewriter.getI64IntegerAttr(64));
+}
+
 // TODO_Ashwin This is just a hacky caching implementation. 
 // We can't just use a memref.subview since that would lead 
 // to the types of the cacheInputRowsOp and the replacement 
@@ -257,27 +270,179 @@ void LowerCacheRowsOpToCPU(ConversionPatternRewriter &rewriter,
   auto resultType = cacheInputOp.getResult().getType();
   auto resultMemrefType = resultType.cast<MemRefType>();
 
-  auto zeroConst = rewriter.getIndexAttr(0);
-  auto oneConst = rewriter.getIndexAttr(1);
-  auto numRows = rewriter.getIndexAttr(resultMemrefType.getShape()[0]);
-  auto numCols = rewriter.getIndexAttr(resultMemrefType.getShape()[1]);
-  auto cacheSubview = rewriter.create<memref::SubViewOp>(location, 
-          cacheInputOpAdaptor.getData(),
-          ArrayRef<OpFoldResult>({cacheInputOpAdaptor.getStartIndex(), zeroConst}), // offsets
-          ArrayRef<OpFoldResult>({numRows, numCols}), // sizes
-          ArrayRef<OpFoldResult>({oneConst, oneConst}) // strides
-          );
-  // auto prefetchOp = rewriter.create<memref::PrefetchOp>(location, 
-  //         cacheSubview.getResult(),
-  //         ValueRange{zeroConst.getResult(), zeroConst.getResult()},
-  //         false, //isWrite
-  //         (uint32_t)3, // locality hint
-  //         true); // data cache
-  auto allocCache = rewriter.create<memref::AllocaOp>(location, resultMemrefType);
-  rewriter.create<memref::CopyOp>(location, cacheSubview.getResult(), allocCache.getResult());
-  rewriter.replaceOp(op, allocCache.getResult());
+  // Gather the used columns of the rows of a forest with compacted features into a cache line aligned
+  // buffer (the rows of the result type are padded to a whole number of cache lines) and replace the 
+  // features of a quantized forest with their bin index. 
+  auto featureColumns = cacheInputOp.getFeatureColumns();
+  auto binBoundaries = cacheInputOp.getBinBoundaries();
+  auto binnedFeatures = cacheInputOp.getBinnedFeatures();
+  auto numFeatures = featureColumns ? static_cast<int64_t>(featureColumns->size()) : resultMemrefType.getShape()[1];
+  Value boundariesMemref;
+  if (binBoundaries) {
+    auto boundariesGlobal = op->getParentOfType<mlir::ModuleOp>().lookupSymbol<memref::GlobalOp>(*binBoundaries);
+    assert (boundariesGlobal);
+    assert (boundariesGlobal.getType().getShape()[0] == (binnedFeatures ? static_cast<int64_t>(binnedFeatures->size()) : numFeatures));
+    boundariesMemref = rewriter.create<memref::GetGlobalOp>(location, boundariesGlobal.getType(), *binBoundaries);
+  }
+  bool binAllFeatures = binBoundaries && !binnedFeatures;
+
+  auto cache = AllocateCacheBuffer(rewriter, op, resultMemrefType);
+  auto zeroIndexConst = rewriter.create<arith::ConstantIndexOp>(location, 0);
+  auto oneIndexConst = rewriter.create<arith::ConstantIndexOp>(location, 1);
+  auto numRowsConst = rewriter.create<arith::ConstantIndexOp>(location, resultMemrefType.getShape()[0]);
+  if (featureColumns) {
+    auto rowLoop = rewriter.create<scf::ForOp>(location, zeroIndexConst, numRowsConst, oneIndexConst);
+    PatternRewriter::InsertionGuard insertGuard(rewriter);
+    rewriter.setInsertionPointToStart(rowLoop.getBody());
+    auto rowIndex = rowLoop.getInductionVar();
+    auto inputRowIndex = rewriter.create<arith::AddIOp>(location, cacheInputOpAdaptor.getStartIndex(), rowIndex);
+    GenerateColumnGather(rewriter, location, cacheInputOpAdaptor.getData(), inputRowIndex, cache, rowIndex, *featureColumns,
+                         binAllFeatures ? boundariesMemref : Value());
+  }
+  else if (binAllFeatures) {
+    auto numFeaturesConst = rewriter.create<arith::ConstantIndexOp>(location, numFeatures);
+    auto rowLoop = rewriter.create<scf::ForOp>(location, zeroIndexConst, numRowsConst, oneIndexConst);
+    PatternRewriter::InsertionGuard insertGuard(rewriter);
+    rewriter.setInsertionPointToStart(rowLoop.getBody());
+    auto featureLoop = rewriter.create<scf::ForOp>(location, zeroIndexConst, numFeaturesConst, oneIndexConst);
+    rewriter.setInsertionPointToStart(featureLoop.getBody());
+    auto rowIndex = rowLoop.getInductionVar();
+    auto featureIndex = featureLoop.getInductionVar();
+    auto inputRowIndex = rewriter.create<arith::AddIOp>(location, cacheInputOpAdaptor.getStartIndex(), rowIndex);
+    Value featureValue = rewriter.create<memref::LoadOp>(location, cacheInputOpAdaptor.getData(), ValueRange{inputRowIndex, featureIndex});
+    featureValue = GenerateBinIndex(rewriter, location, boundariesMemref, featureIndex, featureValue, resultMemrefType.getElementType());
+    rewriter.create<memref::StoreOp>(location, featureValue, cache, ValueRange{rowIndex, featureIndex});
+  }
+  else {
+    auto zeroConst = rewriter.getIndexAttr(0);
+    auto oneConst = rewriter.getIndexAttr(1);
+    auto numRows = rewriter.getIndexAttr(resultMemrefType.getShape()[0]);
+    auto numCols = rewriter.getIndexAttr(resultMemrefType.getShape()[1]);
+    auto cacheSubview = rewriter.create<memref::SubViewOp>(location, 
+            cacheInputOpAdaptor.getData(),
+            ArrayRef<OpFoldResult>({cacheInputOpAdaptor.getStartIndex(), zeroConst}), // offsets
+            ArrayRef<OpFoldResult>({numRows, numCols}), // sizes
+            ArrayRef<OpFoldResult>({oneConst, oneConst}) // strides
+            );
+    // auto prefetchOp = rewriter.create<memref::PrefetchOp>(location, 
+    //         cacheSubview.getResult(),
+    //         ValueRange{zeroConst.getResult(), zeroConst.getResult()},
+    //         false, //isWrite
+    //         (uint32_t)3, // locality hint
+    //         true); // data cache
+    rewriter.create<memref::CopyOp>(location, cacheSubview.getResult(), cache);
+  }
+
+  // Only the features that have thresholds that aren't exact in the threshold type are binned
+  if (binnedFeatures) {
+    auto rowLoop = rewriter.create<scf::ForOp>(location, zeroIndexConst, numRowsConst, oneIndexConst);
+    PatternRewriter::InsertionGuard insertGuard(rewriter);
+    rewriter.setInsertionPointToStart(rowLoop.getBody());
+    GenerateInPlaceBinning(rewriter, location, boundariesMemref, cache, rowLoop.getInductionVar(), *binnedFeatures);
+  }
+  rewriter.replaceOp(op, cache);
 }
 
+// The thresholds of a quantized forest are bin indices. They're stored in the narrowest integer type that holds 
+// all of them so that the tiles of the model are smaller. If leafValuesInThresholds is set, tiles whose first 
+// feature index is -1 hold a leaf value in their threshold fields. These are replaced by the index of the value
+// in the unique leaf values of the tree, which are appended to leaves. Returns the integer type.
+Type StoreThresholdsAsBinIndices(ConversionPatternRewriter &rewriter, std::vector<double>& thresholds, const std::vector<int32_t>& featureIndices,
+                                 int32_t tileSize, const std::vector<int64_t>& offsets, const std::vector<int64_t>& lengths,
+                                 bool leafValuesInThresholds, std::vector<double>& leaves, std::vector<int64_t>& leafOffsets,
+                                 std::vector<int64_t>& leafLengths) {
+  assert (offsets.size() == lengths.size());
+  for (size_t i=0 ; i<offsets.size() ; ++i) {
+    std::map<double, int64_t> treeLeafIndices;
+    std::vector<double> treeLeaves;
+    for (int64_t tile=offsets.at(i) ; tile<offsets.at(i)+lengths.at(i) ; ++tile) {
+      auto tileThresholds = thresholds.begin() + tile*tileSize;
+      if (leafValuesInThresholds && featureIndices.at(tile*tileSize) == -1) {
+        auto insertResult = treeLeafIndices.insert(std::make_pair(*tileThresholds, static_cast<int64_t>(treeLeaves.size())));
+        if (insertResult.second)
+          treeLeaves.push_back(*tileThresholds);
+        std::fill(tileThresholds, tileThresholds + tileSize, static_cast<double>(insertResult.first->second));
+        continue;
+      }
+      // Lanes that aren't used are -1
+      std::replace_if(tileThresholds, tileThresholds + tileSize, [](double threshold) { return !(threshold >= 0.0); }, 0.0);
+    }
+    leafOffsets.push_back(static_cast<int64_t>(leaves.size()));
+    leafLengths.push_back(static_cast<int64_t>(treeLeaves.size()));
+    leaves.insert(leaves.end(), treeLeaves.begin(), treeLeaves.end());
+  }
+
+  // The bin indices are read as unsigned values (see ExtendToFloatType), but are converted to the signed
+  // integer type of the same width when the global is created.
+  double maxThreshold = thresholds.empty() ? 0.0 : *std::max_element(thresholds.begin(), thresholds.end());
+  int32_t bitWidth = 32;
+  if (maxThreshold <= std::numeric_limits<int8_t>::max())
+    bitWidth = 8;
+  else if (maxThreshold <= std::numeric_limits<int16_t>::max())
+    bitWidth = 16;
+  assert (maxThreshold <= std::numeric_limits<int32_t>::max());
+  if (TreeBeard::Logging::loggingOptions.logGenCodeStats)
+    TreeBeard::Logging::Log("Bin index bit width : " + std::to_string(bitWidth));
+  return rewriter.getIntegerType(bitWidth);
+}
+
+// A leaf of a sparse tiled tree that has non-leaf siblings is moved into a dummy tile whose children are all copies
+// of the leaf. The thresholds of such tiles hold the leaf value and are never used. Zero them so that they aren't 
+// stored as bin indices when the forest is quantized. Tiles whose children are all the same leaf value can have
+// any thresholds, so it doesn't matter whether they're dummy tiles.
+void ClearThresholdsOfSingleValueTiles(std::vector<double>& thresholds, const std::vector<int32_t>& childIndices,
+                                       const std::vector<double>& leaves, int32_t tileSize) {
+  auto numTiles = static_cast<int64_t>(childIndices.size());
+  for (int64_t i=0 ; i<numTiles ; ++i) {
+    int64_t firstLeaf = childIndices.at(i) - numTiles;
+    if (firstLeaf < 0 || firstLeaf + tileSize >= static_cast<int64_t>(leaves.size()))
+      continue;
+    auto leavesBegin = leaves.begin() + firstLeaf;
+    if (std::all_of(leavesBegin, leavesBegin + tileSize + 1, [&](double leaf) { return leaf == *leavesBegin; }))
+      std::fill(thresholds.begin() + i*tileSize, thresholds.begin() + (i+1)*tileSize, 0.0);
+  }
+}
+
+// The children of a sparse tile are contiguous, so the leaves of a tree are made up of groups of siblings that 
+// start at the leaf child indices of the tiles. Append the groups of the tree that aren't already in the forest's 
+// leaf dictionary to it and point the child indices directly at the groups in the dictionary, so that a leaf is 
+// still read with a single load. Every tree indexes the dictionary from its start except trees with a single leaf 
+// (and no tiles), whose leaves start at their group.
+void AddTreeLeavesToDictionary(std::vector<int32_t>& childIndices, const std::vector<double>& treeLeaves,
+                               std::vector<double>& dictionary, std::map<std::vector<double>, int64_t>& leafGroupOffsets,
+                               int64_t& treeLeavesOffset) {
+  auto numTiles = static_cast<int64_t>(childIndices.size());
+  std::vector<int64_t> groupStarts;
+  for (auto childIndex : childIndices)
+    if (childIndex >= numTiles)
+      groupStarts.push_back(childIndex - numTiles);
+  if (numTiles == 0)
+    groupStarts.push_back(0);
+  std::sort(groupStarts.begin(), groupStarts.end());
+  groupStarts.erase(std::unique(groupStarts.begin(), groupStarts.end()), groupStarts.end());
+  assert (groupStarts.empty() || groupStarts.front() == 0);
+
+  std::map<int64_t, int64_t> groupDictionaryOffsets;
+  for (size_t i=0 ; i<groupStarts.size() ; ++i) {
+    auto groupEnd = i+1 < groupStarts.size() ? groupStarts.at(i+1) : static_cast<int64_t>(treeLeaves.size());
+    std::vector<double> group(treeLeaves.begin() + groupStarts.at(i), treeLeaves.begin() + groupEnd);
+    auto groupIter = leafGroupOffsets.find(group);
+    if (groupIter == leafGroupOffsets.end()) {
+      groupIter = leafGroupOffsets.insert(std::make_pair(group, static_cast<int64_t>(dictionary.size()))).first;
+      dictionary.insert(dictionary.end(), group.begin(), group.end());
+    }
+    groupDictionaryOffsets[groupStarts.at(i)] = groupIter->second;
+  }
+
+  for (auto& childIndex : childIndices) {
+    if (childIndex < numTiles)
+      continue;
+    auto newChildIndex = numTiles + groupDictionaryOffsets.at(childIndex - numTiles);
+    assert (newChildIndex <= std::numeric_limits<int32_t>::max() && "Leaf dictionary is too large for 32 bit child indices");
+    childIndex = static_cast<int32_t>(newChildIndex);
+  }
+  treeLeavesOffset = numTiles == 0 ? groupDictionaryOffsets.at(0) : 0;
+}
 
 } // anonymous namespace
 
@@ -292,6 +457,7 @@ namespace decisionforest
 void ArrayBasedRepresentation::InitRepresentation() {
   ensembleConstantToMemrefsMap.clear();
   getTreeOperationMap.clear();
+  getTreeLeavesMap.clear();
 }
 
 mlir::LogicalResult ArrayBasedRepresentation::GenerateModelGlobals(Operation *op, ArrayRef<Value> operands, ConversionPatternRewriter &rewriter,
@@ -321,6 +487,12 @@ mlir::LogicalResult ArrayBasedRepresentation::GenerateModelGlobals(Operation *op
     auto classInfoGlobal = ensembleConstOp.getForest().GetDecisionForest().IsMultiClassClassifier()
                           ? rewriter.create<memref::GetGlobalOp>(location, memrefTypes.classInfo, kClassInfoMemrefName)
                           : Value();
+    Value getLeavesGlobal, getLeavesOffsetGlobal, getLeavesLengthGlobal;
+    if (memrefTypes.leaves) {
+      getLeavesGlobal = rewriter.create<memref::GetGlobalOp>(location, memrefTypes.leaves, kLeavesMemrefName);
+      getLeavesOffsetGlobal = rewriter.create<memref::GetGlobalOp>(location, memrefTypes.offset, kLeavesOffsetMemrefName);
+      getLeavesLengthGlobal = rewriter.create<memref::GetGlobalOp>(location, memrefTypes.offset, kLeavesLengthMemrefName);
+    }
 
     EnsembleConstantLoweringInfo info 
     {
@@ -332,6 +504,9 @@ mlir::LogicalResult ArrayBasedRepresentation::GenerateModelGlobals(Operation *op
       memrefTypes.offset,
       memrefTypes.offset,
       memrefTypes.classInfo,
+      getLeavesGlobal,
+      getLeavesOffsetGlobal,
+      getLeavesLengthGlobal
     };
     ensembleConstantToMemrefsMap[op] = info;
     return mlir::success();
@@ -356,7 +531,6 @@ ArrayBasedRepresentation::GlobalMemrefTypes ArrayBasedRepresentation::AddGlobalM
   m_featureIndexType = treeType.getFeatureIndexType(); 
   auto tileSize = treeType.getTileSize();
   m_tileShapeType = treeType.getTileShapeType();
-  Type memrefElementType = decisionforest::TiledNumericalNodeType::get(m_thresholdType, m_featureIndexType, m_tileShapeType, tileSize);
   
   m_tileSize = tileSize;
   
@@ -404,6 +578,14 @@ ArrayBasedRepresentation::GlobalMemrefTypes ArrayBasedRepresentation::AddGlobalM
     }
   }
 
+  // The leaves of a quantized model are stored separately (with one integer type for bin and leaf indices)
+  std::vector<double> leaves;
+  std::vector<int64_t> leafOffsets, leafLengths;
+  if (forest.IsQuantized())
+    m_thresholdType = StoreThresholdsAsBinIndices(rewriter, thresholds, indices, tileSize, offsets, lengths, true /*leafValuesInThresholds*/,
+                                                  leaves, leafOffsets, leafLengths);
+  Type memrefElementType = decisionforest::TiledNumericalNodeType::get(m_thresholdType, m_featureIndexType, m_tileShapeType, tileSize);
+
   int64_t modelMemrefSize = currentOffset;
   auto modelMemrefType = MemRefType::get({modelMemrefSize}, memrefElementType);
   rewriter.create<memref::GlobalOp>(location, kModelMemrefName,
@@ -428,12 +610,20 @@ ArrayBasedRepresentation::GlobalMemrefTypes ArrayBasedRepresentation::AddGlobalM
   createConstantGlobalOp(rewriter, location, kLengthMemrefName, offsetMemrefType, lengths);
 
 
+  MemRefType leavesMemrefType;
+  if (forest.IsQuantized()) {
+    leavesMemrefType = MemRefType::get({(int64_t)leaves.size()}, treeType.getThresholdType());
+    createConstantGlobalOp(rewriter, location, kLeavesMemrefName, leavesMemrefType, leaves);
+    createConstantGlobalOp(rewriter, location, kLeavesOffsetMemrefName, offsetMemrefType, leafOffsets);
+    createConstantGlobalOp(rewriter, location, kLeavesLengthMemrefName, offsetMemrefType, leafLengths);
+  }
+
   auto classInfoMemrefType = MemRefType::get({offsetSize}, treeType.getResultType());
   if (forest.IsMultiClassClassifier()) {
     createConstantGlobalOp(rewriter, location, kClassInfoMemrefName, classInfoMemrefType, classIDs);
   }
   
-  return GlobalMemrefTypes { modelMemrefType, offsetMemrefType, classInfoMemrefType };
+  return GlobalMemrefTypes { modelMemrefType, offsetMemrefType, classInfoMemrefType, leavesMemrefType };
 }
 
 void ArrayBasedRepresentation::GenModelMemrefInitFunctionBody(MemRefType memrefType, Value getGlobalMemref,
@@ -447,7 +637,7 @@ void ArrayBasedRepresentation::GenModelMemrefInitFunctionBody(MemRefType memrefT
   auto tileSizeTimesi = builder.create<arith::MulIOp>(location, tileIndex, tileSizeConst);
 
     if (tileSize > 1) {
-      auto thresholdVec = CreateZeroVectorFPConst(builder, location, modelMemrefElementType.getThresholdElementType(), tileSize);
+      auto thresholdVec = CreateZeroVectorConst(builder, location, modelMemrefElementType.getThresholdElementType(), tileSize);
       auto indexVec = CreateZeroVectorIntConst(builder, location, modelMemrefElementType.getIndexElementType(), tileSize);
 
     // Load from index to index + (tileSize - 1) into a vector
@@ -554,6 +744,14 @@ void ArrayBasedRepresentation::GenerateTreeMemref(mlir::ConversionPatternRewrite
     //   rewriter.create<decisionforest::PrintTreeToDOTFileOp>(location, treeMemref, treeIndex);
     // }
     getTreeOperationMap[op] = static_cast<Value>(treeMemref);
+
+    if (ensembleInfo.leavesGlobal) {
+      auto leavesMemrefIndex = rewriter.create<memref::LoadOp>(location, ensembleInfo.leavesOffsetGlobal, treeIndex);
+      auto leavesLength = rewriter.create<memref::LoadOp>(location, ensembleInfo.leavesLengthGlobal, treeIndex);
+      auto leavesMemref = rewriter.create<memref::SubViewOp>(location, ensembleInfo.leavesGlobal, ArrayRef<OpFoldResult>({static_cast<Value>(leavesMemrefIndex)}),
+                                                             ArrayRef<OpFoldResult>({static_cast<Value>(leavesLength)}), ArrayRef<OpFoldResult>({rewriter.getIndexAttr(1)}));
+      getTreeLeavesMap[op] = static_cast<Value>(leavesMemref);
+    }
 }
 
 mlir::Value ArrayBasedRepresentation::GenerateGetTreeClassId(mlir::ConversionPatternRewriter &rewriter, mlir::Operation *op, Value ensemble, Value treeIndex) {
@@ -601,6 +799,13 @@ mlir::Value ArrayBasedRepresentation::GenerateGetLeafValueOp(ConversionPatternRe
     auto extractElement = rewriter.create<vector::ExtractElementOp>(location, static_cast<Value>(loadThresholdOp), zeroConst);
     leafValue = extractElement;
   }
+
+  // The threshold field of a leaf of a quantized model holds the index of the leaf value in the leaves of the tree
+  auto leavesMapIter = getTreeLeavesMap.find(treeValue.getDefiningOp());
+  if (leavesMapIter != getTreeLeavesMap.end()) {
+    auto leafIndex = rewriter.create<arith::IndexCastUIOp>(location, rewriter.getIndexType(), leafValue);
+    leafValue = rewriter.create<memref::LoadOp>(location, leavesMapIter->second, static_cast<Value>(leafIndex));
+  }
   return leafValue;
 }
 
@@ -711,8 +916,10 @@ mlir::LogicalResult SparseRepresentation::GenerateModelGlobals(Operation *op, Ar
     auto getOffsetGlobal = rewriter.create<memref::GetGlobalOp>(location, std::get<1>(memrefTypes), kOffsetMemrefName);
     auto getLengthGlobal = rewriter.create<memref::GetGlobalOp>(location, std::get<1>(memrefTypes), kLengthMemrefName);
     auto getLeavesGlobal = rewriter.create<memref::GetGlobalOp>(location, std::get<2>(memrefTypes), kLeavesMemrefName);
-    auto getLeavesOffsetGlobal = m_tileSize > 1 ? rewriter.create<memref::GetGlobalOp>(location, std::get<1>(memrefTypes), kLeavesOffsetMemrefName) : Value();
-    auto getLeavesLengthGlobal = m_tileSize > 1 ? rewriter.create<memref::GetGlobalOp>(location, std::get<1>(memrefTypes), kLeavesLengthMemrefName) : Value();
+    // Leaves are only stored per tree if the trees are tiled or the model is quantized
+    bool hasLeavesPerTree = owningModule.lookupSymbol(kLeavesOffsetMemrefName) != nullptr;
+    auto getLeavesOffsetGlobal = hasLeavesPerTree ? rewriter.create<memref::GetGlobalOp>(location, std::get<1>(memrefTypes), kLeavesOffsetMemrefName) : Value();
+    auto getLeavesLengthGlobal = hasLeavesPerTree ? rewriter.create<memref::GetGlobalOp>(location, std::get<1>(memrefTypes), kLeavesLengthMemrefName) : Value();
     auto classInfoGlobal = ensembleConstOp.getForest().GetDecisionForest().IsMultiClassClassifier() 
                           ? rewriter.create<memref::GetGlobalOp>(location, std::get<3>(memrefTypes), kClassInfoMemrefName)
                           : Value();
@@ -742,18 +949,20 @@ std::tuple<Type, Type, Type, Type> SparseRepresentation::AddGlobalMemrefs(mlir::
   auto treeType = forestType.getTreeType(0).cast<decisionforest::TreeType>();
 
   m_thresholdType = treeType.getThresholdType();
+  m_leafType = treeType.getThresholdType();
   m_featureIndexType = treeType.getFeatureIndexType(); 
   m_tileSize = treeType.getTileSize();
   m_tileShapeType = treeType.getTileShapeType();
   auto childIndexType = treeType.getChildIndexType();
-  Type memrefElementType = decisionforest::TiledNumericalNodeType::get(m_thresholdType, m_featureIndexType, m_tileShapeType, 
-                                                                       m_tileSize, childIndexType);
 
   std::vector<double> thresholds, leaves;
   std::vector<int32_t> indices, tileShapeIDs, childIndices;
-  std::vector<int64_t> offsets, lengths, leafOffsets, leafLengths;
+  std::vector<int64_t> offsets, lengths, leafOffsets, leafLengths, unusedLeafOffsets, unusedLeafLengths;
   int64_t currentOffset = 0, currentLeafOffset = 0;
   std::vector<int32_t> classIds;
+  // Sibling groups of leaves in the leaf dictionary (leaves) and their offsets in it
+  std::map<std::vector<double>, int64_t> leafGroupOffsets;
+  size_t numUncompressedLeaves = 0;
 
   if (m_tileSize > 1) {
     for (size_t i = 0; i < forest.NumTrees(); i++) {
@@ -761,26 +970,43 @@ std::tuple<Type, Type, Type, Type> SparseRepresentation::AddGlobalMemrefs(mlir::
       std::vector<int32_t> tiledFeatureIndices, tiledTreeShapeIDs, tiledTreechildIndices;
       
       auto* tiledTree = forest.GetTree(i).GetTiledTree();
-      tiledTree->GetSparseSerialization(tiledThresholds, tiledFeatureIndices, tiledTreeShapeIDs, tiledTreechildIndices, tiledLeaves);
+      tiledTree->GetSparseSerialization(tiledThresholds, tiledFeatureIndices, tiledTreeShapeIDs, tiledTreechildIndices, tiledLeaves,
+                                        decisionforest::UseHotPathSparseLayout);
+      if (forest.IsQuantized())
+        ClearThresholdsOfSingleValueTiles(tiledThresholds, tiledTreechildIndices, tiledLeaves, m_tileSize);
       
       thresholds.insert(thresholds.end(), tiledThresholds.begin(), tiledThresholds.end());
       indices.insert(indices.end(), tiledFeatureIndices.begin(), tiledFeatureIndices.end());
       tileShapeIDs.insert(tileShapeIDs.end(), tiledTreeShapeIDs.begin(), tiledTreeShapeIDs.end());
+      if (decisionforest::UseLeafDictionaryCompression) {
+        int64_t treeLeavesOffset;
+        numUncompressedLeaves += tiledLeaves.size();
+        AddTreeLeavesToDictionary(tiledTreechildIndices, tiledLeaves, leaves, leafGroupOffsets, treeLeavesOffset);
+        leafOffsets.push_back(treeLeavesOffset);
+      }
+      else {
+        leaves.insert(leaves.end(), tiledLeaves.begin(), tiledLeaves.end());
+        leafOffsets.push_back(currentLeafOffset);
+        leafLengths.push_back(tiledLeaves.size());
+        currentLeafOffset += tiledLeaves.size();
+      }
       childIndices.insert(childIndices.end(), tiledTreechildIndices.begin(), tiledTreechildIndices.end());
-      leaves.insert(leaves.end(), tiledLeaves.begin(), tiledLeaves.end());
 
       offsets.push_back(currentOffset);
       lengths.push_back(tiledTreeShapeIDs.size());
       currentOffset += tiledTreeShapeIDs.size();
 
-      leafOffsets.push_back(currentLeafOffset);
-      leafLengths.push_back(tiledLeaves.size());
-      currentLeafOffset += tiledLeaves.size();
-
       if (forest.IsMultiClassClassifier()) {
         classIds.push_back(tiledTree->GetClassId());
       }
     }
+    if (decisionforest::UseLeafDictionaryCompression) {
+      // A tree's leaves extend to the end of the dictionary
+      for (auto leafOffset : leafOffsets)
+        leafLengths.push_back(static_cast<int64_t>(leaves.size()) - leafOffset);
+      auto maxChildIndex = childIndices.empty() ? 0 : *std::max_element(childIndices.begin(), childIndices.end());
+      assert (childIndexType.getIntOrFloatBitWidth() >= 32 || maxChildIndex < (1 << (childIndexType.getIntOrFloatBitWidth()-1)));
+    }
   }
   else {
     for (size_t i = 0; i < forest.NumTrees(); i++) {
@@ -803,6 +1029,15 @@ std::tuple<Type, Type, Type, Type> SparseRepresentation::AddGlobalMemrefs(mlir::
     }
   }
 
+  // The leaves of tiled trees are always stored separately. Those of untiled trees are only stored separately
+  // if the model is quantized (with one integer type for bin and leaf indices).
+  if (forest.IsQuantized())
+    m_thresholdType = StoreThresholdsAsBinIndices(rewriter, thresholds, indices, m_tileSize, offsets, lengths, m_tileSize == 1 /*leafValuesInThresholds*/,
+                                                  leaves, m_tileSize == 1 ? leafOffsets : unusedLeafOffsets,
+                                                  m_tileSize == 1 ? leafLengths : unusedLeafLengths);
+  Type memrefElementType = decisionforest::TiledNumericalNodeType::get(m_thresholdType, m_featureIndexType, m_tileShapeType, 
+                                                                       m_tileSize, childIndexType);
+
   int64_t modelMemrefSize = currentOffset;
   auto modelMemrefType = MemRefType::get({modelMemrefSize}, memrefElementType);
   rewriter.create<memref::GlobalOp>(location, kModelMemrefName,
@@ -824,7 +1059,7 @@ std::tuple<Type, Type, Type, Type> SparseRepresentation::AddGlobalMemrefs(mlir::
   }
 
   auto leavesMemrefSize = leaves.size();
-  auto leavesMemrefType = MemRefType::get({(int64_t)leavesMemrefSize}, m_thresholdType);
+  auto leavesMemrefType = MemRefType::get({(int64_t)leavesMemrefSize}, m_leafType);
   createConstantGlobalOp(rewriter, location, kLeavesMemrefName, leavesMemrefType, leaves);
 
   auto offsetSize = (int32_t)forest.NumTrees();
@@ -832,10 +1067,14 @@ std::tuple<Type, Type, Type, Type> SparseRepresentation::AddGlobalMemrefs(mlir::
   createConstantGlobalOp(rewriter, location, kOffsetMemrefName, offsetMemrefType, offsets);
   createConstantGlobalOp(rewriter, location, kLengthMemrefName, offsetMemrefType, lengths);
 
-  if (TreeBeard::Logging::loggingOptions.logGenCodeStats)
-      TreeBeard::Logging::Log("Leaves memref size : " + std::to_string(leavesMemrefSize * (m_thresholdType.getIntOrFloatBitWidth()/8)));
+  if (TreeBeard::Logging::loggingOptions.logGenCodeStats) {
+      TreeBeard::Logging::Log("Leaves memref size : " + std::to_string(leavesMemrefSize * (m_leafType.getIntOrFloatBitWidth()/8)));
+      if (m_tileSize > 1 && decisionforest::UseLeafDictionaryCompression)
+        TreeBeard::Logging::Log("Leaf dictionary : " + std::to_string(leavesMemrefSize) + " values for " + std::to_string(numUncompressedLeaves) + 
+                                " leaves (compression ratio " + std::to_string((double)numUncompressedLeaves/std::max(leavesMemrefSize, (size_t)1)) + ")");
+  }
 
-  if (m_tileSize > 1)
+  if (m_tileSize > 1 || forest.IsQuantized())
   {
     createConstantGlobalOp(rewriter, location, kLeavesOffsetMemrefName, offsetMemrefType, leafOffsets);
     createConstantGlobalOp(rewriter, location, kLeavesLengthMemrefName, offsetMemrefType, leafLengths);
@@ -862,7 +1101,7 @@ void SparseRepresentation::GenModelMemrefInitFunctionBody(MemRefType memrefType,
   auto tileSizeTimesi = builder.create<arith::MulIOp>(location, tileIndex, tileSizeConst);
   
   if (tileSize > 1) {
-    auto thresholdVec = CreateZeroVectorFPConst(builder, location, modelMemrefElementType.getThresholdElementType(), tileSize);
+    auto thresholdVec = CreateZeroVectorConst(builder, location, modelMemrefElementType.getThresholdElementType(), tileSize);
     auto indexVec = CreateZeroVectorIntConst(builder, location, modelMemrefElementType.getIndexElementType(), tileSize);
 
     // Load from index to index + (tileSize - 1) into a vector
@@ -1007,9 +1246,8 @@ void SparseRepresentation::GenerateTreeMemref(mlir::ConversionPatternRewriter &r
   // rewriter.create<gpu::PrintfOp>(location, "ThreadID: (%ld, %ld, %ld), Got Tree: %ld, Offset: %ld, Len: %ld\n", 
   //                       ValueRange{threadId.x, threadId.y, threadId.z, treeIndex, modelMemrefIndex.getResult(), treeLength.getResult()});
 
-  int32_t tileSize = ensembleInfo.modelGlobal.getType().cast<MemRefType>().getElementType().cast<decisionforest::TiledNumericalNodeType>().getTileSize();
   Value leavesMemref;
-  if (tileSize > 1) {
+  if (ensembleInfo.leavesOffsetGlobal) {
     auto leavesMemrefIndex = rewriter.create<memref::LoadOp>(location, ensembleInfo.leavesOffsetGlobal, treeIndex);
     // ensembleInfo.leavesOffsetGlobal.getType().dump();
     // rewriter.create<gpu::PrintfOp>(location, "ThreadID: (%ld, %ld, %ld), Getting Leaves: %ld, Offset: %ld\n", 
@@ -1063,6 +1301,12 @@ mlir::Value SparseRepresentation::GenerateGetLeafValueOp(ConversionPatternRewrit
                                                                                  static_cast<Value>(nodeIndex),
                                                                                  treeIndex);
     Value leafValue = loadThresholdOp;
+    // The threshold field of a leaf of a quantized model holds the index of the leaf value in the leaves of the tree
+    auto leavesMemref = this->GetLeafMemref(treeValue);
+    if (leavesMemref) {
+      auto leafIndex = rewriter.create<arith::IndexCastUIOp>(location, rewriter.getIndexType(), leafValue);
+      leafValue = rewriter.create<memref::LoadOp>(location, leavesMemref, static_cast<Value>(leafIndex));
+    }
     return static_cast<Value>(leafValue);
   }
   else {
@@ -1070,7 +1314,6 @@ mlir::Value SparseRepresentation::GenerateGetLeafValueOp(ConversionPatternRewrit
     auto leafIndex = rewriter.create<arith::SubIOp>(location, nodeIndex, treeMemrefLen);
     auto leavesMemref = this->GetLeafMemref(treeValue);
     auto leafValue = rewriter.create<memref::LoadOp>(location, leavesMemref, static_cast<Value>(leafIndex));
-    
     // auto resultConst = rewriter.create<arith::ConstantFloatOp>(location, APFloat(double(0.5)), rewriter.getF64Type());
     // TODO cast the loaded value to the correct result type of the tree. 
     return static_cast<Value>(leafValue);
@@ -1,6 +1,7 @@
 #ifndef _REPRESENTATIONS_H_
 #define _REPRESENTATIONS_H_
 
+#include <map>
 #include <vector>
 #include <type_traits>
 #include <cstddef>
@@ -81,11 +82,16 @@ protected:
   const std::string kThresholdsMemrefName = "thresholdValues";
   const std::string kFeatureIndexMemrefName = "featureIndexValues";
   const std::string kTileShapeMemrefName = "tileShapeValues";
+  // The leaves of quantized models are stored separately from the bin indices
+  const std::string kLeavesMemrefName = "leaves";
+  const std::string kLeavesOffsetMemrefName = "leavesOffsets";
+  const std::string kLeavesLengthMemrefName = "leavesLengths";
 
   typedef struct Memrefs {
     mlir::Type model;
     mlir::Type offset;
     mlir::Type classInfo;
+    mlir::Type leaves;
   } GlobalMemrefTypes;
 
   struct EnsembleConstantLoweringInfo {
@@ -98,12 +104,19 @@ protected:
     mlir::Type offsetGlobaltype;
     mlir::Type lengthGlobalType;
     mlir::Type classInfoType;
+
+    // Only set for quantized models
+    mlir::Value leavesGlobal;
+    mlir::Value leavesOffsetGlobal;
+    mlir::Value leavesLengthGlobal;
   };
 
   // Maps an ensemble constant operation to a model memref and an offsets memref
   std::map<mlir::Operation*, EnsembleConstantLoweringInfo> ensembleConstantToMemrefsMap;
   // Maps a GetTree operation to a memref that represents the tree once the ensemble constant has been replaced
   std::map<mlir::Operation*, mlir::Value> getTreeOperationMap;
+  // Maps a GetTree operation to a memref with the leaves of the tree (only for quantized models)
+  std::map<mlir::Operation*, mlir::Value> getTreeLeavesMap;
 
   int32_t m_tileSize=-1;
   mlir::Type m_thresholdType;
@@ -224,6 +237,8 @@ protected:
 
   int32_t m_tileSize=-1;
   mlir::Type m_thresholdType;
+  // Same as the threshold type unless the thresholds are quantized into bin indices
+  mlir::Type m_leafType;
   mlir::Type m_featureIndexType;
   mlir::Type m_tileShapeType;
 
@@ -371,6 +386,19 @@ void createGlobalWithCorrectType(ConversionPatternRewriter &rewriter, Location l
     std::vector<float> floatData(data.begin(), data.end());
     createConstantGlobalOp<float>(rewriter, location, memrefName, type, floatData);
   }
+  else if(type.getElementType().isF16() || type.getElementType().isBF16()) {
+    // There is no host type for the 16-bit float types. Round the values to the element type here.
+    auto& semantics = type.getElementType().cast<FloatType>().getFloatSemantics();
+    std::vector<llvm::APFloat> floatData;
+    for (auto value : data) {
+      llvm::APFloat apValue(static_cast<double>(value));
+      bool losesInfo = false;
+      apValue.convert(semantics, llvm::APFloat::rmNearestTiesToEven, &losesInfo);
+      floatData.push_back(apValue);
+    }
+    auto dataElementsAttribute = DenseElementsAttr::get(memref::getTensorTypeFromMemRefType(type).cast<ShapedType>(), floatData);
+    rewriter.create<memref::GlobalOp>(location, memrefName, rewriter.getStringAttr("private"), type, dataElementsAttribute, true, IntegerAttr());
+  }
   else {
     assert(false && "Unsupported type");
   }
@@ -0,0 +1,143 @@
+// Implementation of a transformation that quantizes the thresholds of a forest.
+// The distinct thresholds of each feature are sorted and every threshold is replaced
+// by its bin index. The input rows are binned the same way before the trees are
+// walked (see GenerateInputBinning in LowerToMidLevelIR.cpp) so that the tree walks
+// only compare small integers.
+
+#include <set>
+#include <map>
+#include <numeric>
+#include <algorithm>
+#include <cassert>
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Math/IR/Math.h"
+
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassManager.h"
+#include "Dialect.h"
+#include "Logger.h"
+
+namespace mlir {
+namespace decisionforest {
+
+namespace
+{
+
+// Replaces the thresholds of binnedFeatures with their bin indices and returns the bin boundaries
+// (the sorted distinct thresholds) of each of these features.
+std::vector<std::vector<double>> ReplaceThresholdsWithBinIndices(DecisionForest& forest, const std::vector<int32_t>& binnedFeatures) {
+  std::map<int32_t, size_t> boundariesIndices;
+  for (size_t i=0 ; i<binnedFeatures.size() ; ++i)
+    boundariesIndices[binnedFeatures.at(i)] = i;
+
+  std::vector<std::set<double>> featureThresholds(binnedFeatures.size());
+  for (auto& tree : forest.GetTrees()) {
+    for (auto& node : tree->GetNodes()) {
+      if (node.IsLeaf())
+        continue;
+      auto boundariesIndexIter = boundariesIndices.find(node.featureIndex);
+      if (boundariesIndexIter != boundariesIndices.end())
+        featureThresholds.at(boundariesIndexIter->second).insert(node.threshold);
+    }
+  }
+  std::vector<std::vector<double>> binBoundaries;
+  for (auto& thresholds : featureThresholds)
+    binBoundaries.push_back(std::vector<double>(thresholds.begin(), thresholds.end()));
+
+  // If the bin index of x is the number of thresholds of the feature that are <= x, then
+  // x < t_k <=> binIndex(x) < k+1. Replace t_k with k+1 so that the predicate is unchanged.
+  // The trees may be shared with other copies of the forest. Don't modify them in place.
+  for (auto& tree : forest.GetTrees()) {
+    tree = std::make_shared<DecisionTree>(*tree);
+    auto& nodes = tree->GetNodes();
+    for (size_t i=0 ; i<nodes.size() ; ++i) {
+      if (nodes.at(i).IsLeaf())
+        continue;
+      auto boundariesIndexIter = boundariesIndices.find(nodes.at(i).featureIndex);
+      if (boundariesIndexIter == boundariesIndices.end())
+        continue;
+      auto& boundaries = binBoundaries.at(boundariesIndexIter->second);
+      auto boundaryIter = std::lower_bound(boundaries.begin(), boundaries.end(), nodes.at(i).threshold);
+      assert (boundaryIter != boundaries.end() && *boundaryIter == nodes.at(i).threshold);
+      tree->SetNodeThreshold(i, static_cast<double>(boundaryIter - boundaries.begin() + 1));
+    }
+  }
+  return binBoundaries;
+}
+
+} // anonymous namespace
+
+struct ThresholdQuantizationPass : public PassWrapper<ThresholdQuantizationPass, OperationPass<mlir::ModuleOp>> {
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<AffineDialect, memref::MemRefDialect, scf::SCFDialect, math::MathDialect>();
+  }
+
+  void QuantizeForest(DecisionForest& forest, int64_t numFeatures) {
+    for (auto& tree : forest.GetTrees()) {
+      for (auto& node : tree->GetNodes())
+        assert (node.IsLeaf() || (node.featureIndex >= 0 && node.featureIndex < numFeatures));
+    }
+    std::vector<int32_t> features(numFeatures);
+    std::iota(features.begin(), features.end(), 0);
+    auto binBoundaries = ReplaceThresholdsWithBinIndices(forest, features);
+    forest.SetFeatureBinBoundaries(binBoundaries);
+
+    if (TreeBeard::Logging::loggingOptions.logGenCodeStats) {
+      size_t maxNumberOfBins = 0;
+      for (auto& boundaries : binBoundaries)
+        maxNumberOfBins = std::max(maxNumberOfBins, boundaries.size() + 1);
+      auto binIndexBitWidth = maxNumberOfBins <= 256 ? 8 : 16;
+      TreeBeard::Logging::Log("Maximum number of bins per feature : " + std::to_string(maxNumberOfBins) +
+                              " (bin indices fit in " + std::to_string(binIndexBitWidth) + " bits)");
+    }
+  }
+
+  void runOnOperation() final {
+    auto module = getOperation();
+    module.walk([&](mlir::decisionforest::PredictForestOp predictForestOp) {
+      // The binning only preserves the semantics of "feature < threshold" (including NaNs
+      // going left since they are put in the first bin).
+      assert (predictForestOp.getPredicate() == arith::CmpFPredicate::ULT && "Quantization is only supported for the ULT predicate");
+      auto& forest = predictForestOp.getEnsemble().GetDecisionForest();
+      if (forest.IsQuantized())
+        return;
+      assert (!forest.HasBinnedFeatures() && "Forest with some binned features can't be quantized");
+      assert (forest.NumTrees() > 0 && forest.GetTree(0).TilingDescriptor().MaxTileSize() == 1 && "Forest must be quantized before it is tiled");
+
+      // The inputs of a forest with compacted features are compacted before they are binned
+      auto dataType = predictForestOp.getData().getType().cast<MemRefType>();
+      auto numFeatures = forest.IsFeatureCompacted() ? static_cast<int64_t>(forest.GetCompactFeatureColumns().size()) : dataType.getShape()[1];
+      QuantizeForest(forest, numFeatures);
+    });
+  }
+};
+
+} // namespace decisionforest
+} // namespace mlir
+
+namespace mlir
+{
+namespace decisionforest
+{
+void QuantizeFeatureThresholds(DecisionForest& forest, const std::vector<int32_t>& features) {
+  assert (!forest.HasBinnedFeatures() && !features.empty());
+  auto binBoundaries = ReplaceThresholdsWithBinIndices(forest, features);
+  forest.SetFeatureBinBoundaries(binBoundaries, features);
+}
+
+void DoThresholdQuantization(mlir::MLIRContext& context, mlir::ModuleOp module) {
+  mlir::PassManager pm(&context);
+  pm.addPass(std::make_unique<ThresholdQuantizationPass>());
+
+  if (mlir::failed(pm.run(module))) {
+    llvm::errs() << "Threshold quantization failed.\n";
+  }
+}
+
+} // decisionforest
+} // mlir
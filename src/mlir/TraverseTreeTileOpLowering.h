@@ -29,6 +29,7 @@ namespace decisionforest
             auto trees = traverseTileOp.getTrees();
             auto nodes = traverseTileOp.getNodes();
             auto dataRows = traverseTileOp.getData();
+            bool prefetchNextTile = traverseTileOp.getPrefetchNextTile();
 
             assert(nodes.size() == trees.size());
             assert(trees.size() == dataRows.size());
@@ -48,7 +49,8 @@ namespace decisionforest
                         traverseTileOp.getResult(i).getType(),
                         m_representation,
                         tree,
-                        traverseTileOp.getPredicateAttr()));
+                        traverseTileOp.getPredicateAttr(),
+                        prefetchNextTile));
                 }
                 else {
                     codeGenStateMachine.AddStateMachine(
@@ -59,7 +61,8 @@ namespace decisionforest
                         traverseTileOp.getResult(i).getType(),
                         m_representation,
                         m_getLutFromTree,
-                        traverseTileOp.getPredicateAttr()));
+                        traverseTileOp.getPredicateAttr(),
+                        prefetchNextTile));
                 }
             }
 
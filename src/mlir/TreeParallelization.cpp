@@ -0,0 +1,159 @@
+// Implementation of a transformation that walks the trees of a forest on several cores. Small batches
+// don't have enough rows to keep several cores busy, so the trees are split into one chunk per core and
+// the chunks are walked in parallel (each into its own partial sums, see GenerateSingleLoop in
+// LowerToMidLevelIR.cpp). All chunks but the last one have the same number of trees (the last one has
+// the remaining trees), but the trees are assigned to chunks by their estimated cost (the expected number
+// of tile evaluations when the model is profiled and the tiled depth otherwise) so that all cores finish
+// at about the same time.
+
+#include <numeric>
+#include <algorithm>
+#include <cassert>
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Math/IR/Math.h"
+
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassManager.h"
+#include "Dialect.h"
+#include "Logger.h"
+#include "TiledTree.h"
+
+namespace mlir {
+namespace decisionforest {
+
+struct TreeParallelizationPass : public PassWrapper<TreeParallelizationPass, OperationPass<mlir::ModuleOp>> {
+  int32_t m_numberOfCores;
+
+  TreeParallelizationPass(int32_t numberOfCores)
+    : m_numberOfCores(numberOfCores)
+  { }
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<AffineDialect, memref::MemRefDialect, scf::SCFDialect, math::MathDialect>();
+  }
+
+  double EstimateTreeCost(DecisionTree& tree) {
+    auto tiledTree = tree.GetTiledTree();
+    if (tree.GetNodes().at(0).hitCount > 0)
+      return std::get<0>(tiledTree->ComputeExpectedNumberOfTileEvaluations());
+    return tiledTree->GetTreeDepth();
+  }
+
+  // The tree loop is tiled into chunks of ceil(numTrees/numberOfCores) trees. The last chunk is clamped to
+  // the end of the forest (see ClampToPartialTile in LowerToMidLevelIR.cpp).
+  int32_t GetChunkSize(int32_t numTrees) {
+    int32_t numChunks = std::min(m_numberOfCores, numTrees);
+    return (numTrees + numChunks - 1) / numChunks;
+  }
+
+  // Assigns the trees, most expensive first, to the chunk with the lowest total cost that isn't full
+  // and returns the indices of the trees chunk by chunk. Trees keep their relative order within a chunk.
+  std::vector<size_t> BalanceTreesAcrossChunks(DecisionForest& forest, int32_t chunkSize) {
+    auto& trees = forest.GetTrees();
+    int32_t numChunks = (static_cast<int32_t>(trees.size()) + chunkSize - 1) / chunkSize;
+    std::vector<size_t> chunkCapacities(numChunks, chunkSize);
+    chunkCapacities.back() = trees.size() - (numChunks - 1) * chunkSize;
+    std::vector<double> costs;
+    for (auto& tree : trees)
+      costs.push_back(EstimateTreeCost(*tree));
+    std::vector<size_t> treeOrder(trees.size());
+    std::iota(treeOrder.begin(), treeOrder.end(), 0);
+    std::stable_sort(treeOrder.begin(), treeOrder.end(), [&](size_t t1, size_t t2) { return costs.at(t1) > costs.at(t2); });
+
+    std::vector<std::vector<size_t>> chunks(numChunks);
+    std::vector<double> chunkCosts(numChunks, 0.0);
+    for (auto treeIndex : treeOrder) {
+      int32_t cheapestChunk = -1;
+      for (int32_t i=0 ; i<numChunks ; ++i) {
+        if (chunks.at(i).size() == chunkCapacities.at(i))
+          continue;
+        if (cheapestChunk == -1 || chunkCosts.at(i) < chunkCosts.at(cheapestChunk))
+          cheapestChunk = i;
+      }
+      assert (cheapestChunk != -1);
+      chunks.at(cheapestChunk).push_back(treeIndex);
+      chunkCosts.at(cheapestChunk) += costs.at(treeIndex);
+    }
+
+    std::vector<size_t> chunkedTreeOrder;
+    for (auto& chunk : chunks) {
+      std::sort(chunk.begin(), chunk.end());
+      chunkedTreeOrder.insert(chunkedTreeOrder.end(), chunk.begin(), chunk.end());
+    }
+    if (TreeBeard::Logging::loggingOptions.logGenCodeStats) {
+      auto minMax = std::minmax_element(chunkCosts.begin(), chunkCosts.end());
+      TreeBeard::Logging::Log("Tree chunks : " + std::to_string(numChunks) + " (estimated cost " + std::to_string(*minMax.first) +
+                              " to " + std::to_string(*minMax.second) + ")");
+    }
+    return chunkedTreeOrder;
+  }
+
+  void runOnOperation() final {
+    auto module = getOperation();
+    std::vector<mlir::decisionforest::PredictForestOp> predictForestOps;
+    module.walk([&](mlir::decisionforest::PredictForestOp predictForestOp) { predictForestOps.push_back(predictForestOp); });
+    for (auto predictForestOp : predictForestOps) {
+      auto forestAttribute = predictForestOp.getEnsemble();
+      auto forest = forestAttribute.GetDecisionForest();
+      auto& schedule = *predictForestOp.getSchedule().GetSchedule();
+      assert (!forest.IsMultiClassClassifier() && "Tree parallelization is only supported for single output models");
+      assert (schedule.IsDefaultSchedule() && "Trees must be parallelized on the default schedule");
+
+      int32_t numTrees = static_cast<int32_t>(forest.NumTrees());
+      int32_t chunkSize = GetChunkSize(numTrees);
+      if (chunkSize == numTrees)
+        continue;
+      auto treeOrder = BalanceTreesAcrossChunks(forest, chunkSize);
+      auto& trees = forest.GetTrees();
+      std::vector<std::shared_ptr<DecisionTree>> reorderedTrees;
+      for (auto treeIndex : treeOrder)
+        reorderedTrees.push_back(trees.at(treeIndex));
+      trees = reorderedTrees;
+
+      // The types of the trees move with the trees
+      auto forestType = forestAttribute.getType().cast<decisionforest::TreeEnsembleType>().getReorderedType(treeOrder);
+      auto newForestAttribute = decisionforest::DecisionForestAttribute::get(forestType, forest);
+      mlir::OpBuilder builder(predictForestOp);
+      auto reorderedPredictForestOp = builder.create<decisionforest::PredictForestOp>(predictForestOp.getLoc(), 
+                                                                                      predictForestOp.getResult().getType(), 
+                                                                                      newForestAttribute,
+                                                                                      predictForestOp.getPredicateAttr(), 
+                                                                                      predictForestOp.getData(),
+                                                                                      predictForestOp.getResult(),
+                                                                                      predictForestOp.getSchedule());
+      predictForestOp->getResult(0).replaceAllUsesWith(reorderedPredictForestOp->getResult(0));
+      predictForestOp.erase();
+
+      auto& treeIndex = schedule.GetTreeIndex();
+      auto& batchIndex = schedule.GetBatchIndex();
+      auto& t0_parallel = schedule.NewIndexVariable("t0_parallel");
+      auto& t1 = schedule.NewIndexVariable("t1");
+      schedule.Tile(treeIndex, t0_parallel, t1, chunkSize, true);
+      schedule.Reorder({&t0_parallel, &batchIndex, &t1});
+      schedule.Parallel(t0_parallel);
+    }
+  }
+};
+
+} // namespace decisionforest
+} // namespace mlir
+
+namespace mlir
+{
+namespace decisionforest
+{
+void DoTreeParallelization(mlir::MLIRContext& context, mlir::ModuleOp module, int32_t numberOfCores) {
+  mlir::PassManager pm(&context);
+  pm.addPass(std::make_unique<TreeParallelizationPass>(numberOfCores));
+
+  if (mlir::failed(pm.run(module))) {
+    llvm::errs() << "Tree parallelization failed.\n";
+  }
+}
+
+} // decisionforest
+} // mlir
@@ -16,6 +16,18 @@ struct Memref {
   int64_t strides[Rank];
 };
 
+// What the inference runner writes into the output buffer. kPrediction is the output of the
+// prediction function (the class for multi-class models). kMargins and kProbabilities write
+// batchSize x numClasses values of the input element type. The generated code of multi-class 
+// models takes the mode as an argument, so the values are part of the ABI of the prediction function.
+enum class PredictionOutputMode : int32_t { kPrediction=0, kMargins=1, kProbabilities=2 };
+
+// The arguments the prediction function takes after the input and result memrefs.
+//  kClassScores : a batchSize x numClasses memref the class margins (or probabilities) are written to and
+//                 an i32 PredictionOutputMode. Taken by multi-class models compiled for the CPU.
+//  kTreeRange   : the [start, end) range of trees to walk as two i64s. Taken by models compiled for anytime prediction.
+enum class PredictionFunctionArguments : int32_t { kNone=0, kClassScores=1, kTreeRange=2 };
+
 }
 }
 #endif // _TYPEDEFINITIONS_H_
\ No newline at end of file
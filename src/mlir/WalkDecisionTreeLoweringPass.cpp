@@ -17,8 +17,42 @@ using namespace mlir;
 namespace mlir {
 namespace decisionforest {
 
+// Depth of the trees of the ensemble that a tree value is read from if all trees of the ensemble are
+// oblivious and equally deep. Returns -1 if the tree is tiled or isn't read from a constant ensemble.
+int32_t GetObliviousTreeDepth(Value tree) {
+  auto treeType = tree.getType().cast<mlir::decisionforest::TreeType>();
+  if (treeType.getTileSize() != 1)
+    return -1;
+  auto getTreeOp = llvm::dyn_cast_or_null<decisionforest::GetTreeFromEnsembleOp>(tree.getDefiningOp());
+  if (!getTreeOp)
+    return -1;
+  auto ensembleConstOp = llvm::dyn_cast_or_null<decisionforest::EnsembleConstantOp>(getTreeOp.getForest().getDefiningOp());
+  if (!ensembleConstOp)
+    return -1;
+  return ensembleConstOp.getForest().GetDecisionForest().GetObliviousTreeDepth();
+}
+
+// Compute the predictions of the <tree, row> pairs with a single traversal of their oblivious trees.
+std::vector<Value> GenerateObliviousTreeWalk(ConversionPatternRewriter &rewriter, Location location, 
+                                             arith::CmpFPredicateAttr cmpPredicate, int32_t depth,
+                                             ValueRange trees, ValueRange dataRows) {
+  auto nodeType = mlir::decisionforest::NodeType::get(rewriter.getContext());
+  std::vector<Type> nodeTypes(trees.size(), nodeType);
+  auto leaves = rewriter.create<decisionforest::TraverseObliviousTreesOp>(location, nodeTypes, cmpPredicate, 
+                                                                            rewriter.getI32IntegerAttr(depth), trees, dataRows);
+  std::vector<Value> predictions;
+  for (size_t i = 0; i < trees.size(); i++) {
+    auto treeType = trees[i].getType().cast<mlir::decisionforest::TreeType>();
+    auto treePrediction = rewriter.create<decisionforest::GetLeafValueOp>(location, treeType.getThresholdType(), trees[i], leaves.getResult(i));
+    predictions.push_back(treePrediction);
+  }
+  return predictions;
+}
+
 struct WalkDecisionTreeOpLowering: public ConversionPattern {
-  WalkDecisionTreeOpLowering(MLIRContext *ctx) : ConversionPattern(mlir::decisionforest::WalkDecisionTreeOp::getOperationName(), 1 /*benefit*/, ctx) {}
+  bool m_specializeObliviousTrees;
+  WalkDecisionTreeOpLowering(MLIRContext *ctx, bool specializeObliviousTrees) 
+  : ConversionPattern(mlir::decisionforest::WalkDecisionTreeOp::getOperationName(), 1 /*benefit*/, ctx), m_specializeObliviousTrees(specializeObliviousTrees) {}
 
   LogicalResult
   matchAndRewrite(Operation *op, ArrayRef<Value> operands, ConversionPatternRewriter &rewriter) const final {
@@ -35,6 +69,14 @@ struct WalkDecisionTreeOpLowering: public ConversionPattern {
     auto context = inputRow.getContext();
     auto treeType = tree.getType().cast<mlir::decisionforest::TreeType>();
 
+    auto obliviousTreeDepth = m_specializeObliviousTrees ? GetObliviousTreeDepth(tree) : -1;
+    if (obliviousTreeDepth > 0) {
+      auto predictions = GenerateObliviousTreeWalk(rewriter, location, walkTreeOp.getPredicateAttr(), obliviousTreeDepth,
+                                                   ValueRange{tree}, ValueRange{inputRow});
+      rewriter.replaceOp(op, predictions);
+      return mlir::success();
+    }
+
     auto nodeType = mlir::decisionforest::NodeType::get(context);
     auto node = rewriter.create<decisionforest::GetRootOp>(location, nodeType, tree);
 
@@ -75,7 +117,9 @@ struct WalkDecisionTreeOpLowering: public ConversionPattern {
 };
 
 struct PipelinedWalkDecisionTreeOpLowering: public ConversionPattern {
-  PipelinedWalkDecisionTreeOpLowering(MLIRContext *ctx) : ConversionPattern(mlir::decisionforest::PipelinedWalkDecisionTreeOp::getOperationName(), 1 /*benefit*/, ctx) {}
+  bool m_specializeObliviousTrees;
+  PipelinedWalkDecisionTreeOpLowering(MLIRContext *ctx, bool specializeObliviousTrees) 
+  : ConversionPattern(mlir::decisionforest::PipelinedWalkDecisionTreeOp::getOperationName(), 1 /*benefit*/, ctx), m_specializeObliviousTrees(specializeObliviousTrees) {}
 
   LogicalResult
   matchAndRewrite(Operation *op, ArrayRef<Value> operands, ConversionPatternRewriter &rewriter) const final {
@@ -88,11 +132,21 @@ struct PipelinedWalkDecisionTreeOpLowering: public ConversionPattern {
     auto trees = walkTreeOp.getTrees();
     auto dataRows = walkTreeOp.getDataRows();
     auto unrollLoopAttr = walkTreeOp.getUnrollLoopAttr();
+    auto prefetchNextTileAttr = rewriter.getBoolAttr(walkTreeOp.getPrefetchDistance() > 0);
     assert(trees.size() == dataRows.size());
 
     auto location = op->getLoc();
     auto context = op->getContext();
 
+    // All trees of the ensemble are equally deep and so the walks of all trees end together
+    auto obliviousTreeDepth = m_specializeObliviousTrees ? GetObliviousTreeDepth(trees[0]) : -1;
+    if (obliviousTreeDepth > 0) {
+      auto predictions = GenerateObliviousTreeWalk(rewriter, location, walkTreeOp.getPredicateAttr(), obliviousTreeDepth,
+                                                   trees, dataRows);
+      rewriter.replaceOp(op, predictions);
+      return mlir::success();
+    }
+
     std::vector<Value> nodes;
     std::vector<Type> nodeTypes;
     std::unordered_map<void*, decisionforest::GetRootOp> treeRootMap;
@@ -118,6 +172,7 @@ struct PipelinedWalkDecisionTreeOpLowering: public ConversionPattern {
           location,
           nodeTypes,
           cmpPredicate,
+          prefetchNextTileAttr,
           trees,
           nodeArgs,
           dataRows);
@@ -172,6 +227,7 @@ struct PipelinedWalkDecisionTreeOpLowering: public ConversionPattern {
             location,
             nodeTypes,
             cmpPredicate,
+            prefetchNextTileAttr,
             trees,
             nodeArgs,
             dataRows);
@@ -193,7 +249,9 @@ struct PipelinedWalkDecisionTreeOpLowering: public ConversionPattern {
 };
 
 struct WalkDecisionTreePeeledOpLowering: public ConversionPattern {
-  WalkDecisionTreePeeledOpLowering(MLIRContext *ctx) : ConversionPattern(mlir::decisionforest::WalkDecisionTreePeeledOp::getOperationName(), 1 /*benefit*/, ctx) {}
+  bool m_specializeObliviousTrees;
+  WalkDecisionTreePeeledOpLowering(MLIRContext *ctx, bool specializeObliviousTrees) 
+  : ConversionPattern(mlir::decisionforest::WalkDecisionTreePeeledOp::getOperationName(), 1 /*benefit*/, ctx), m_specializeObliviousTrees(specializeObliviousTrees) {}
 
   LogicalResult
   matchAndRewrite(Operation *op, ArrayRef<Value> operands, ConversionPatternRewriter &rewriter) const final {
@@ -212,6 +270,15 @@ struct WalkDecisionTreePeeledOpLowering: public ConversionPattern {
     auto context = inputRow.getContext();
     auto treeType = tree.getType().cast<mlir::decisionforest::TreeType>();
 
+    // There are no leaves to peel the walk at before the last level of an oblivious tree
+    auto obliviousTreeDepth = m_specializeObliviousTrees ? GetObliviousTreeDepth(tree) : -1;
+    if (obliviousTreeDepth > 0) {
+      auto predictions = GenerateObliviousTreeWalk(rewriter, location, walkTreeOp.getPredicateAttr(), obliviousTreeDepth,
+                                                   ValueRange{tree}, ValueRange{inputRow});
+      rewriter.replaceOp(op, predictions);
+      return mlir::success();
+    }
+
     auto nodeType = mlir::decisionforest::NodeType::get(context);
     Value node = rewriter.create<decisionforest::GetRootOp>(location, nodeType, tree);
     assert (iterationsToPeel > 1);
@@ -279,6 +346,8 @@ struct WalkDecisionTreePeeledOpLowering: public ConversionPattern {
 };
 
 struct WalkDecisionTreeOpLoweringPass: public PassWrapper<WalkDecisionTreeOpLoweringPass, OperationPass<mlir::ModuleOp>> {
+  bool m_specializeObliviousTrees;
+  WalkDecisionTreeOpLoweringPass(bool specializeObliviousTrees) : m_specializeObliviousTrees(specializeObliviousTrees) { }
   
   void getDependentDialects(DialectRegistry &registry) const override {
     registry.insert<scf::SCFDialect>();
@@ -292,8 +361,8 @@ struct WalkDecisionTreeOpLoweringPass: public PassWrapper<WalkDecisionTreeOpLowe
     target.addIllegalOp<decisionforest::WalkDecisionTreeOp, decisionforest::WalkDecisionTreePeeledOp>();
 
     RewritePatternSet patterns(&getContext());
-    patterns.add<WalkDecisionTreeOpLowering>(&getContext());
-    patterns.add<WalkDecisionTreePeeledOpLowering>(&getContext());
+    patterns.add<WalkDecisionTreeOpLowering>(&getContext(), m_specializeObliviousTrees);
+    patterns.add<WalkDecisionTreePeeledOpLowering>(&getContext(), m_specializeObliviousTrees);
 
     if (failed(applyPartialConversion(getOperation(), target, std::move(patterns))))
         signalPassFailure();
@@ -301,6 +370,8 @@ struct WalkDecisionTreeOpLoweringPass: public PassWrapper<WalkDecisionTreeOpLowe
 };
 
 struct PipelinedWalkDecisionTreeOpLoweringPass: public PassWrapper<PipelinedWalkDecisionTreeOpLoweringPass, OperationPass<mlir::ModuleOp>> {
+  bool m_specializeObliviousTrees;
+  PipelinedWalkDecisionTreeOpLoweringPass(bool specializeObliviousTrees) : m_specializeObliviousTrees(specializeObliviousTrees) { }
   
   void getDependentDialects(DialectRegistry &registry) const override {
     registry.insert<scf::SCFDialect>();
@@ -314,16 +385,16 @@ struct PipelinedWalkDecisionTreeOpLoweringPass: public PassWrapper<PipelinedWalk
     target.addIllegalOp<decisionforest::PipelinedWalkDecisionTreeOp>();
 
     RewritePatternSet patterns(&getContext());
-    patterns.add<PipelinedWalkDecisionTreeOpLowering>(&getContext());
+    patterns.add<PipelinedWalkDecisionTreeOpLowering>(&getContext(), m_specializeObliviousTrees);
 
     if (failed(applyPartialConversion(getOperation(), target, std::move(patterns))))
         signalPassFailure();
   }
 };
 
-void AddWalkDecisionTreeOpLoweringPass(mlir::PassManager &pm) {
-  pm.addPass(std::make_unique<WalkDecisionTreeOpLoweringPass>());
-  pm.addPass(std::make_unique<PipelinedWalkDecisionTreeOpLoweringPass>());
+void AddWalkDecisionTreeOpLoweringPass(mlir::PassManager &pm, bool specializeObliviousTrees) {
+  pm.addPass(std::make_unique<WalkDecisionTreeOpLoweringPass>(specializeObliviousTrees));
+  pm.addPass(std::make_unique<PipelinedWalkDecisionTreeOpLoweringPass>(specializeObliviousTrees));
 }
 
 } // namespace decisionforest
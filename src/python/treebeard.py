@@ -8,6 +8,10 @@ treebeardAPI = TreebeardAPI()
 #### ---------------------------------------------------------------- ####
 #### Compiler options
 #### ---------------------------------------------------------------- ####
+
+# Pass as a type width to let the compiler pick the narrowest width that is safe for the model
+AUTO_TYPE_WIDTH = -1
+
 class CompilerOptions:
   def __init__(self, batchSize, tileSize) -> None:
     self.optionsPtr = treebeardAPI.runtime_lib.CreateCompilerOptions()
@@ -40,6 +44,13 @@ class CompilerOptions:
 
   def SetChildIndexBitWidth(self, val : int) :  
     treebeardAPI.runtime_lib.Set_childIndexBitWidth(self.optionsPtr, val)
+
+  def SetAutoTypeWidths(self) :
+    self.SetThresholdTypeWidth(AUTO_TYPE_WIDTH)
+    self.SetFeatureIndexTypeWidth(AUTO_TYPE_WIDTH)
+    self.SetNodeIndexTypeWidth(AUTO_TYPE_WIDTH)
+    self.SetTileShapeBitWidth(AUTO_TYPE_WIDTH)
+    self.SetChildIndexBitWidth(AUTO_TYPE_WIDTH)
     
   def SetMakeAllLeavesSameDepth(self, val : int) :
     treebeardAPI.runtime_lib.Set_makeAllLeavesSameDepth(self.optionsPtr, val)
@@ -58,6 +69,47 @@ class CompilerOptions:
 
   def SetNumberOfCores(self, val : int) :
     treebeardAPI.runtime_lib.Set_numberOfCores(self.optionsPtr, val)
+
+  def SetPrefetchDistance(self, val : int) :
+    treebeardAPI.runtime_lib.Set_prefetchDistance(self.optionsPtr, val)
+
+  def SetQuantizeModel(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_quantizeModel(self.optionsPtr, 1 if val else 0)
+
+  def SetSimplifyForest(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_simplifyForest(self.optionsPtr, 1 if val else 0)
+
+  def SetCompactFeatures(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_compactFeatures(self.optionsPtr, 1 if val else 0)
+
+  def SetParallelizeTrees(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_parallelizeTrees(self.optionsPtr, 1 if val else 0)
+
+  def SetUseWorkStealingRuntime(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_useWorkStealingRuntime(self.optionsPtr, 1 if val else 0)
+
+  # hugePages : 0 for regular pages, 1 for transparent huge pages and 2 for explicit huge pages
+  def SetReplicateModelPerNUMANode(self, val : bool, hugePages : int = 0) :
+    treebeardAPI.runtime_lib.Set_replicateModelPerNUMANode(self.optionsPtr, 1 if val else 0)
+    treebeardAPI.runtime_lib.Set_modelHugePages(self.optionsPtr, hugePages)
+
+  def SetSpecializeObliviousTrees(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_specializeObliviousTrees(self.optionsPtr, 1 if val else 0)
+
+  def SetInstrumentLeafHitCounts(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_instrumentLeafHitCounts(self.optionsPtr, 1 if val else 0)
+
+  def SetThresholdTypeIsBFloat16(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_thresholdTypeIsBFloat16(self.optionsPtr, 1 if val else 0)
+
+  def SetFallbackTo32BitThresholds(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_fallbackTo32BitThresholds(self.optionsPtr, 1 if val else 0)
+
+  def SetUseFastApproximateTransforms(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_useFastApproximateTransforms(self.optionsPtr, 1 if val else 0)
+
+  def SetPeelProbabilisticallyTiledWalks(self, val : bool) :
+    treebeardAPI.runtime_lib.Set_peelProbabilisticallyTiledWalks(self.optionsPtr, 1 if val else 0)
   
   def SetStatsProfileCSVPath(self, val : str) :
     valStr = val.encode('ascii')
@@ -116,6 +168,15 @@ class Schedule:
   def Cache(self, index):
       treebeardAPI.Schedule_Cache(self.schedulePtr, index.indexVarPtr)
 
+  def Prefetch(self, index, distance):
+      treebeardAPI.Schedule_Prefetch(self.schedulePtr, index.indexVarPtr, distance)
+
+  def EarlyExit(self, index, treeGroupSize, probabilityThreshold=0.5):
+      treebeardAPI.Schedule_EarlyExit(self.schedulePtr, index.indexVarPtr, treeGroupSize, probabilityThreshold)
+
+  def AnytimePrediction(self, index, reorderTreesByContributionVariance=False):
+      treebeardAPI.Schedule_AnytimePrediction(self.schedulePtr, index.indexVarPtr, reorderTreesByContributionVariance)
+
   def GetRootIndex(self):
       return IndexVariable("root", treebeardAPI.Schedule_GetRootIndex(self.schedulePtr))
 
@@ -177,6 +238,11 @@ class TreebeardContext:
 #### ---------------------------------------------------------------- ####
 #### Inference Runner
 #### ---------------------------------------------------------------- ####
+# Values of the outputMode argument of the RunInference* methods (see PredictionOutputMode in TypeDefinitions.h)
+OUTPUT_MODE_PREDICTION = 0
+OUTPUT_MODE_MARGINS = 1
+OUTPUT_MODE_PROBABILITIES = 2
+
 class TreebeardInferenceRunner:
   def __init__(self) -> None:
     self.treebeardAPI = treebeardAPI
@@ -239,6 +305,81 @@ class TreebeardInferenceRunner:
     self.treebeardAPI.RunInferenceOnMultipleBatches(self.inferenceRunner, inputs.ctypes.data_as(ctypes.c_void_p), results.ctypes.data_as(ctypes.c_void_p), numRows)
     return results
 
+  def GetNumberOfClasses(self):
+    return self.treebeardAPI.GetNumberOfClasses(self.inferenceRunner)
+
+  # Predicts a single row (a 1-D array of the input type) with the single row entry point of a model 
+  # compiled for a batch size of 1.
+  def Predict(self, row, resultType=numpy.float32):
+    assert type(row) is numpy.ndarray and self.batchSize == 1
+    result = numpy.zeros((1), resultType)
+    self.treebeardAPI.RunSingleRowInference(self.inferenceRunner, row.ctypes.data_as(ctypes.c_void_p), result.ctypes.data_as(ctypes.c_void_p))
+    return result[0]
+
+  # Margins and probabilities of multi-class models are returned as a (numRows x numClasses) array
+  # with the same element type as the inputs.
+  def RunInferenceWithOutputMode(self, inputs, outputMode, resultType=numpy.float32):
+    assert type(inputs) is numpy.ndarray
+    if outputMode == OUTPUT_MODE_PREDICTION:
+      return self.RunInference(inputs, resultType)
+    results = numpy.zeros((self.batchSize, self.GetNumberOfClasses()), inputs.dtype)
+    self.treebeardAPI.RunInferenceWithOutputMode(self.inferenceRunner, inputs.ctypes.data_as(ctypes.c_void_p), results.ctypes.data_as(ctypes.c_void_p), outputMode)
+    return results
+
+  def RunInferenceOnMultipleBatchesWithOutputMode(self, inputs, outputMode, resultType=numpy.float32):
+    assert type(inputs) is numpy.ndarray
+    if outputMode == OUTPUT_MODE_PREDICTION:
+      return self.RunInferenceOnMultipleBatches(inputs, resultType)
+    numRows = inputs.shape[0]
+    results = numpy.zeros((numRows, self.GetNumberOfClasses()), inputs.dtype)
+    self.treebeardAPI.RunInferenceOnMultipleBatchesWithOutputMode(self.inferenceRunner, inputs.ctypes.data_as(ctypes.c_void_p), results.ctypes.data_as(ctypes.c_void_p), numRows, outputMode)
+    return results
+
+  # Anytime prediction (the model must be compiled with Schedule.AnytimePrediction). Returns the margins of 
+  # the batch over the first maxTrees trees (all trees if negative) and the number of trees walked. Trees are 
+  # walked treeGroupSize at a time and no new group is started once timeBudgetNanoseconds (if not negative) is used up.
+  def RunAnytimeInference(self, inputs, maxTrees=-1, timeBudgetNanoseconds=-1, treeGroupSize=16):
+    assert type(inputs) is numpy.ndarray
+    margins = numpy.zeros((self.batchSize), inputs.dtype)
+    treesWalked = self.treebeardAPI.RunAnytimeInference(self.inferenceRunner, inputs.ctypes.data_as(ctypes.c_void_p), margins.ctypes.data_as(ctypes.c_void_p), 
+                                                        maxTrees, timeBudgetNanoseconds, treeGroupSize)
+    return margins, treesWalked
+
+  # Leaf hit counts of a model compiled with CompilerOptions.SetInstrumentLeafHitCounts. The profile can be 
+  # passed to FromModelFile (profileCSVPathStr) to compile the model with probability based tiling.
+  def WriteLeafHitCountProfile(self, statsCSVPath : str):
+    self.treebeardAPI.WriteLeafHitCountProfile(self.inferenceRunner, statsCSVPath.encode('ascii'))
+
+  def ResetLeafHitCounts(self):
+    self.treebeardAPI.ResetLeafHitCounts(self.inferenceRunner)
+
+# Serves predictions with a model that is recompiled with probability based (tilingType 1) or hybrid (2) tiling 
+# in the background whenever the leaf distribution of the sampled batches shifts by more than shiftThreshold.
+# One in every samplingInterval batches is profiled and the distribution is compared every windowRows sampled rows.
+class AdaptiveInferenceRunner:
+  def __init__(self, modelPath : str, options : CompilerOptions, forestCreatorType : str = "xgboost_json", samplingInterval : int = 64, 
+               windowRows : int = 100000, shiftThreshold : float = 0.1, tilingType : int = 1, peelTreeWalks : bool = False) -> None:
+    self.treebeardAPI = treebeardAPI
+    self.adaptiveRunner = treebeardAPI.runtime_lib.CreateAdaptiveInferenceRunner(modelPath.encode('ascii'), forestCreatorType.encode('ascii'), 
+                                                                                options.optionsPtr, samplingInterval, windowRows, 
+                                                                                shiftThreshold, tilingType, 1 if peelTreeWalks else 0)
+    self.batchSize = treebeardAPI.runtime_lib.GetAdaptiveInferenceRunnerBatchSize(self.adaptiveRunner)
+
+  def __del__(self):
+    self.treebeardAPI.runtime_lib.DeleteAdaptiveInferenceRunner(self.adaptiveRunner)
+
+  def RunInference(self, inputs, resultType=numpy.float32):
+    assert type(inputs) is numpy.ndarray
+    results = numpy.zeros((self.batchSize), resultType)
+    self.treebeardAPI.runtime_lib.RunAdaptiveInference(self.adaptiveRunner, inputs.ctypes.data_as(ctypes.c_void_p), results.ctypes.data_as(ctypes.c_void_p))
+    return results
+
+  def GetNumberOfRecompilations(self):
+    return self.treebeardAPI.runtime_lib.GetNumberOfAdaptiveRecompilations(self.adaptiveRunner)
+
+  def WaitForRecompilation(self):
+    self.treebeardAPI.runtime_lib.WaitForAdaptiveRecompilation(self.adaptiveRunner)
+
 #### ---------------------------------------------------------------- ####
 #### Treebeard API -- Do not use these!
 #### ---------------------------------------------------------------- ####
@@ -259,3 +400,22 @@ def SetPeeledCodeGenForProbabilityBasedTiling(val):
 
 def IsPeeledCodeGenForProbabilityBasedTilingEnabled():
   return treebeardAPI.runtime_lib.IsPeeledCodeGenForProbabilityBasedTilingEnabled()
+
+def SetEnableLeafDictionaryCompression(val):
+  treebeardAPI.runtime_lib.SetEnableLeafDictionaryCompression(1 if val else 0)
+
+def IsLeafDictionaryCompressionEnabled():
+  return treebeardAPI.runtime_lib.IsLeafDictionaryCompressionEnabled()
+
+def SetEnableHotPathSparseLayout(val):
+  treebeardAPI.runtime_lib.SetEnableHotPathSparseLayout(1 if val else 0)
+
+def IsHotPathSparseLayoutEnabled():
+  return treebeardAPI.runtime_lib.IsHotPathSparseLayoutEnabled()
+
+# Returns the number of bytes allocated for model replicas on each NUMA node
+def GetModelReplicaMemoryUsage() -> List[int]:
+  maxNodes = 64
+  bytesPerNode = numpy.zeros(maxNodes, dtype=numpy.int64)
+  numNodes = treebeardAPI.GetModelReplicaMemoryUsage(bytesPerNode.ctypes.data_as(ctypes.c_void_p), maxNodes)
+  return [int(x) for x in bytesPerNode[:min(numNodes, maxNodes)]]
@@ -29,6 +29,49 @@ class TreebeardAPI:
       self.runtime_lib.RunInferenceOnMultipleBatches.argtypes = (ctypes.c_int64, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int32)
       self.runtime_lib.RunInferenceOnMultipleBatches.restype = None
       
+      self.runtime_lib.RunInferenceWithOutputMode.argtypes = (ctypes.c_int64, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int32)
+      self.runtime_lib.RunInferenceWithOutputMode.restype = None
+
+      self.runtime_lib.RunInferenceOnMultipleBatchesWithOutputMode.argtypes = (ctypes.c_int64, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int32, ctypes.c_int32)
+      self.runtime_lib.RunInferenceOnMultipleBatchesWithOutputMode.restype = None
+
+      self.runtime_lib.GetNumberOfClasses.argtypes = [ctypes.c_int64]
+      self.runtime_lib.GetNumberOfClasses.restype = ctypes.c_int32
+
+      self.runtime_lib.RunSingleRowInference.argtypes = (ctypes.c_int64, ctypes.c_void_p, ctypes.c_void_p)
+      self.runtime_lib.RunSingleRowInference.restype = None
+
+      self.runtime_lib.RunAnytimeInference.argtypes = (ctypes.c_int64, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int64, ctypes.c_int64, ctypes.c_int64)
+      self.runtime_lib.RunAnytimeInference.restype = ctypes.c_int64
+
+      self.runtime_lib.GetModelReplicaMemoryUsage.argtypes = (ctypes.c_void_p, ctypes.c_int32)
+      self.runtime_lib.GetModelReplicaMemoryUsage.restype = ctypes.c_int32
+
+      self.runtime_lib.WriteLeafHitCountProfile.argtypes = (ctypes.c_int64, ctypes.c_char_p)
+      self.runtime_lib.WriteLeafHitCountProfile.restype = None
+
+      self.runtime_lib.ResetLeafHitCounts.argtypes = [ctypes.c_int64]
+      self.runtime_lib.ResetLeafHitCounts.restype = None
+
+      self.runtime_lib.CreateAdaptiveInferenceRunner.argtypes = (ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int64, ctypes.c_int64, ctypes.c_int64, 
+                                                                 ctypes.c_double, ctypes.c_int32, ctypes.c_int32)
+      self.runtime_lib.CreateAdaptiveInferenceRunner.restype = ctypes.c_int64
+
+      self.runtime_lib.RunAdaptiveInference.argtypes = (ctypes.c_int64, ctypes.c_void_p, ctypes.c_void_p)
+      self.runtime_lib.RunAdaptiveInference.restype = None
+
+      self.runtime_lib.GetAdaptiveInferenceRunnerBatchSize.argtypes = [ctypes.c_int64]
+      self.runtime_lib.GetAdaptiveInferenceRunnerBatchSize.restype = ctypes.c_int32
+
+      self.runtime_lib.GetNumberOfAdaptiveRecompilations.argtypes = [ctypes.c_int64]
+      self.runtime_lib.GetNumberOfAdaptiveRecompilations.restype = ctypes.c_int64
+
+      self.runtime_lib.WaitForAdaptiveRecompilation.argtypes = [ctypes.c_int64]
+      self.runtime_lib.WaitForAdaptiveRecompilation.restype = None
+
+      self.runtime_lib.DeleteAdaptiveInferenceRunner.argtypes = [ctypes.c_int64]
+      self.runtime_lib.DeleteAdaptiveInferenceRunner.restype = None
+
       self.runtime_lib.GetBatchSize.argtypes = [ctypes.c_int64]
       self.runtime_lib.GetBatchSize.restype = ctypes.c_int32
 
@@ -92,6 +135,40 @@ class TreebeardAPI:
       self.runtime_lib.Set_numberOfCores.argtypes = [ctypes.c_int64, ctypes.c_int32]
       self.runtime_lib.Set_numberOfCores.restype = None
 
+      self.runtime_lib.Set_prefetchDistance.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_prefetchDistance.restype = None
+
+      self.runtime_lib.Set_quantizeModel.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_quantizeModel.restype = None
+      self.runtime_lib.Set_simplifyForest.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_simplifyForest.restype = None
+      self.runtime_lib.Set_compactFeatures.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_compactFeatures.restype = None
+      self.runtime_lib.Set_parallelizeTrees.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_parallelizeTrees.restype = None
+      self.runtime_lib.Set_useWorkStealingRuntime.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_useWorkStealingRuntime.restype = None
+      self.runtime_lib.Set_replicateModelPerNUMANode.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_replicateModelPerNUMANode.restype = None
+      self.runtime_lib.Set_modelHugePages.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_modelHugePages.restype = None
+      self.runtime_lib.Set_specializeObliviousTrees.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_specializeObliviousTrees.restype = None
+      self.runtime_lib.Set_instrumentLeafHitCounts.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_instrumentLeafHitCounts.restype = None
+
+      self.runtime_lib.Set_thresholdTypeIsBFloat16.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_thresholdTypeIsBFloat16.restype = None
+
+      self.runtime_lib.Set_fallbackTo32BitThresholds.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_fallbackTo32BitThresholds.restype = None
+
+      self.runtime_lib.Set_useFastApproximateTransforms.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_useFastApproximateTransforms.restype = None
+
+      self.runtime_lib.Set_peelProbabilisticallyTiledWalks.argtypes = [ctypes.c_int64, ctypes.c_int32]
+      self.runtime_lib.Set_peelProbabilisticallyTiledWalks.restype = None
+
       self.runtime_lib.Set_statsProfileCSVPath.argtypes = [ctypes.c_int64, ctypes.c_char_p]
       self.runtime_lib.Set_statsProfileCSVPath.restype = None
 
@@ -113,6 +190,18 @@ class TreebeardAPI:
       self.runtime_lib.IsPeeledCodeGenForProbabilityBasedTilingEnabled.argtypes = None
       self.runtime_lib.IsPeeledCodeGenForProbabilityBasedTilingEnabled.restype = ctypes.c_int32
 
+      self.runtime_lib.SetEnableLeafDictionaryCompression.argtypes = [ctypes.c_int32]
+      self.runtime_lib.SetEnableLeafDictionaryCompression.restype = None
+
+      self.runtime_lib.IsLeafDictionaryCompressionEnabled.argtypes = None
+      self.runtime_lib.IsLeafDictionaryCompressionEnabled.restype = ctypes.c_int32
+
+      self.runtime_lib.SetEnableHotPathSparseLayout.argtypes = [ctypes.c_int32]
+      self.runtime_lib.SetEnableHotPathSparseLayout.restype = None
+
+      self.runtime_lib.IsHotPathSparseLayoutEnabled.argtypes = None
+      self.runtime_lib.IsHotPathSparseLayoutEnabled.restype = ctypes.c_int32
+
       self.runtime_lib.Schedule_NewIndexVariable.argtypes = [ctypes.c_int64, ctypes.c_char_p]
       self.runtime_lib.Schedule_NewIndexVariable.restype = ctypes.c_int64
 
@@ -141,6 +230,12 @@ class TreebeardAPI:
 
       self.runtime_lib.Schedule_Cache.argtypes = [ctypes.c_int64, ctypes.c_int64]
 
+      self.runtime_lib.Schedule_Prefetch.argtypes = [ctypes.c_int64, ctypes.c_int64, ctypes.c_int32]
+
+      self.runtime_lib.Schedule_EarlyExit.argtypes = [ctypes.c_int64, ctypes.c_int64, ctypes.c_int32, ctypes.c_double]
+
+      self.runtime_lib.Schedule_AnytimePrediction.argtypes = [ctypes.c_int64, ctypes.c_int64, ctypes.c_bool]
+
       self.runtime_lib.Schedule_GetRootIndex.restype = ctypes.c_int64
       self.runtime_lib.Schedule_GetRootIndex.argtypes = [ctypes.c_int64]
 
@@ -210,6 +305,30 @@ class TreebeardAPI:
   def RunInferenceOnMultipleBatches(self, inferenceRunner : int, inputs : ctypes.c_void_p, results : ctypes.c_void_p, numRows : int) -> None:
     self.runtime_lib.RunInferenceOnMultipleBatches(inferenceRunner, inputs, results, numRows)
 
+  def RunInferenceWithOutputMode(self, inferenceRunner : int, inputs : ctypes.c_void_p, results : ctypes.c_void_p, outputMode : int) -> None:
+    self.runtime_lib.RunInferenceWithOutputMode(inferenceRunner, inputs, results, outputMode)
+
+  def RunInferenceOnMultipleBatchesWithOutputMode(self, inferenceRunner : int, inputs : ctypes.c_void_p, results : ctypes.c_void_p, numRows : int, outputMode : int) -> None:
+    self.runtime_lib.RunInferenceOnMultipleBatchesWithOutputMode(inferenceRunner, inputs, results, numRows, outputMode)
+
+  def GetNumberOfClasses(self, inferenceRunner : int) -> int:
+    return int(self.runtime_lib.GetNumberOfClasses(inferenceRunner))
+
+  def RunSingleRowInference(self, inferenceRunner : int, row : ctypes.c_void_p, result : ctypes.c_void_p) -> None:
+    self.runtime_lib.RunSingleRowInference(inferenceRunner, row, result)
+
+  def RunAnytimeInference(self, inferenceRunner : int, inputs : ctypes.c_void_p, margins : ctypes.c_void_p, maxTrees : int, timeBudgetNanoseconds : int, treeGroupSize : int) -> int:
+    return int(self.runtime_lib.RunAnytimeInference(inferenceRunner, inputs, margins, maxTrees, timeBudgetNanoseconds, treeGroupSize))
+
+  def GetModelReplicaMemoryUsage(self, bytesPerNode : ctypes.c_void_p, maxNodes : int) -> int:
+    return int(self.runtime_lib.GetModelReplicaMemoryUsage(bytesPerNode, maxNodes))
+
+  def WriteLeafHitCountProfile(self, inferenceRunner : int, statsCSVPath : bytes) -> None:
+    self.runtime_lib.WriteLeafHitCountProfile(inferenceRunner, statsCSVPath)
+
+  def ResetLeafHitCounts(self, inferenceRunner : int) -> None:
+    self.runtime_lib.ResetLeafHitCounts(inferenceRunner)
+
   def DeleteInferenceRunner(self, inferenceRunner : int) -> None:
     self.runtime_lib.DeleteInferenceRunner(inferenceRunner)
 
@@ -246,6 +365,15 @@ class TreebeardAPI:
   def Schedule_Cache(self, schedPtr, indexVarPtr):
       self.runtime_lib.Schedule_Cache(ctypes.c_int64(schedPtr), ctypes.c_int64(indexVarPtr))
 
+  def Schedule_Prefetch(self, schedPtr, indexVarPtr, distance):
+      self.runtime_lib.Schedule_Prefetch(ctypes.c_int64(schedPtr), ctypes.c_int64(indexVarPtr), ctypes.c_int32(distance))
+
+  def Schedule_EarlyExit(self, schedPtr, indexVarPtr, treeGroupSize, probabilityThreshold):
+      self.runtime_lib.Schedule_EarlyExit(ctypes.c_int64(schedPtr), ctypes.c_int64(indexVarPtr), ctypes.c_int32(treeGroupSize), ctypes.c_double(probabilityThreshold))
+
+  def Schedule_AnytimePrediction(self, schedPtr, indexVarPtr, reorderTreesByContributionVariance):
+      self.runtime_lib.Schedule_AnytimePrediction(ctypes.c_int64(schedPtr), ctypes.c_int64(indexVarPtr), ctypes.c_bool(reorderTreesByContributionVariance))
+
   def Schedule_GetRootIndex(self, schedPtr):
       return self.runtime_lib.Schedule_GetRootIndex(schedPtr)
 
@@ -0,0 +1,182 @@
+#include <cmath>
+#include <cassert>
+#include <filesystem>
+#include "AdaptiveInferenceRunner.h"
+#include "CompileUtils.h"
+#include "Dialect.h"
+#include "Logger.h"
+#include "ModelSerializers.h"
+#include "Representations.h"
+
+namespace
+{
+
+void RemoveFiles(const std::vector<std::string>& filePaths) {
+  for (auto& filePath : filePaths) {
+    std::error_code errorCode;
+    std::filesystem::remove(filePath, errorCode);
+  }
+}
+
+std::vector<std::vector<double>> ComputeLeafProbabilities(const std::vector<std::vector<int64_t>>& leafHitCounts) {
+  std::vector<std::vector<double>> leafProbabilities;
+  for (auto& treeHitCounts : leafHitCounts) {
+    int64_t numRows = 0;
+    for (auto hitCount : treeHitCounts)
+      numRows += hitCount;
+    std::vector<double> treeProbabilities(treeHitCounts.size(), 0.0);
+    for (size_t i=0 ; i<treeHitCounts.size() && numRows>0 ; ++i)
+      treeProbabilities[i] = static_cast<double>(treeHitCounts[i]) / numRows;
+    leafProbabilities.push_back(treeProbabilities);
+  }
+  return leafProbabilities;
+}
+
+} // anonymous namespace
+
+namespace TreeBeard
+{
+namespace runtime
+{
+
+double ComputeLeafDistributionShift(const std::vector<std::vector<double>>& leafProbabilities1,
+                                    const std::vector<std::vector<double>>& leafProbabilities2) {
+  assert (leafProbabilities1.size() == leafProbabilities2.size() && !leafProbabilities1.empty());
+  double totalDistance = 0.0;
+  for (size_t i=0 ; i<leafProbabilities1.size() ; ++i) {
+    auto& treeProbabilities1 = leafProbabilities1[i];
+    auto& treeProbabilities2 = leafProbabilities2[i];
+    assert (treeProbabilities1.size() == treeProbabilities2.size());
+    double treeDistance = 0.0;
+    for (size_t j=0 ; j<treeProbabilities1.size() ; ++j)
+      treeDistance += std::abs(treeProbabilities1[j] - treeProbabilities2[j]);
+    totalDistance += 0.5 * treeDistance;
+  }
+  return totalDistance / leafProbabilities1.size();
+}
+
+AdaptiveInferenceRunner::AdaptiveInferenceRunner(const std::string& modelPath, const std::string& forestCreatorType,
+                                                 const CompilerOptions& options, const AdaptiveTilingOptions& adaptiveOptions)
+  : m_modelPath(modelPath), m_forestCreatorType(forestCreatorType), m_options(options), m_adaptiveOptions(adaptiveOptions),
+    m_servingRepresentation(mlir::decisionforest::UseSparseTreeRepresentation ? "sparse" : "array"),
+    m_numBatches(0), m_recompiling(false), m_numRecompilations(0)
+{
+  assert ((adaptiveOptions.tilingType == TilingType::kProbabilistic || adaptiveOptions.tilingType == TilingType::kHybrid) &&
+          "Models can only be re-tiled with probability based or hybrid tiling");
+  assert (options.tileSize > 1 && "Probability based tiling needs a tile size larger than 1");
+  assert (adaptiveOptions.samplingInterval > 0 && adaptiveOptions.windowRows > 0);
+
+  auto workingDirectory = adaptiveOptions.workingDirectory.empty() ? std::filesystem::temp_directory_path()
+                                                                   : std::filesystem::path(adaptiveOptions.workingDirectory);
+  auto fileName = std::filesystem::path(modelPath).filename().string() + ".adaptive." + std::to_string(reinterpret_cast<intptr_t>(this));
+  m_filePathPrefix = (workingDirectory / fileName).string();
+
+  auto servingModelGlobalsJSONPath = ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(m_filePathPrefix + ".0");
+  std::atomic_store(&m_servingRunner, CompileModel(m_options, m_servingRepresentation, servingModelGlobalsJSONPath));
+  m_servingRunnerFiles = { servingModelGlobalsJSONPath };
+
+  // The leaf hit counters are only generated for untiled trees in the array representation. The thresholds
+  // aren't quantized so that the profile has the leaves the rows would reach in the original model.
+  CompilerOptions profilingOptions(m_options);
+  profilingOptions.tileSize = 1;
+  profilingOptions.tilingType = TilingType::kUniform;
+  profilingOptions.makeAllLeavesSameDepth = false;
+  profilingOptions.reorderTreesByDepth = false;
+  profilingOptions.simplifyForest = false;
+  profilingOptions.quantizeModel = false;
+  profilingOptions.replicateModelPerNUMANode = false;
+  profilingOptions.scheduleManipulator = nullptr;
+  profilingOptions.statsProfileCSVPath = "";
+  profilingOptions.instrumentLeafHitCounts = true;
+  profilingOptions.peelProbabilisticallyTiledWalks = false;
+  m_profilingModelGlobalsJSONPath = ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(m_filePathPrefix + ".profiling");
+  m_profilingRunner = CompileModel(profilingOptions, "array", m_profilingModelGlobalsJSONPath);
+  assert (m_profilingRunner->GetBatchSize() == m_servingRunner->GetBatchSize() &&
+          m_profilingRunner->GetRowSize() == m_servingRunner->GetRowSize());
+  // The results of the profiling runner are not used. Doubles are large enough for any return type.
+  m_profilingResults.resize(m_profilingRunner->GetBatchSize());
+}
+
+AdaptiveInferenceRunner::~AdaptiveInferenceRunner() {
+  WaitForRecompilation();
+  RemoveFiles(m_servingRunnerFiles);
+  RemoveFiles({ m_profilingModelGlobalsJSONPath });
+}
+
+std::shared_ptr<mlir::decisionforest::InferenceRunnerBase> AdaptiveInferenceRunner::CompileModel(const CompilerOptions& options,
+                                                                                                const std::string& representation,
+                                                                                                const std::string& modelGlobalsJSONPath) {
+  CompilerOptions compileOptions(options);
+  TreeBeard::TreebeardContext tbContext(m_modelPath, modelGlobalsJSONPath, compileOptions);
+  tbContext.SetRepresentationAndSerializer(representation);
+  tbContext.SetForestCreatorType(m_forestCreatorType);
+  auto module = TreeBeard::ConstructLLVMDialectModuleFromForestCreator(tbContext, *tbContext.forestConstructor);
+  // Use the widths from the context since automatically selected widths are only known after compilation
+  return std::make_shared<mlir::decisionforest::InferenceRunner>(tbContext.serializer, module, tbContext.options.tileSize,
+                                                                 tbContext.options.thresholdTypeWidth, tbContext.options.featureIndexTypeWidth);
+}
+
+void AdaptiveInferenceRunner::RunInference(void *inputs, void *results) {
+  auto servingRunner = std::atomic_load(&m_servingRunner);
+  // TODO The types in this template don't really matter. Maybe we should get rid of them?
+  servingRunner->RunInference<double, double>(reinterpret_cast<double*>(inputs), reinterpret_cast<double*>(results));
+  if (m_numBatches++ % m_adaptiveOptions.samplingInterval == 0)
+    ProfileBatch(inputs);
+}
+
+void AdaptiveInferenceRunner::ProfileBatch(void *inputs) {
+  // Skip the batch rather than wait for another thread that is profiling
+  std::unique_lock<std::mutex> lock(m_profilingMutex, std::try_to_lock);
+  if (!lock.owns_lock())
+    return;
+  m_profilingRunner->RunInference<double, double>(reinterpret_cast<double*>(inputs), m_profilingResults.data());
+  m_numSampledRows += m_profilingRunner->GetBatchSize();
+  // Keep counting while a recompilation is in progress. The window is compared with its profile once it's swapped in.
+  if (m_numSampledRows < m_adaptiveOptions.windowRows || m_recompiling)
+    return;
+
+  auto leafProbabilities = ComputeLeafProbabilities(m_profilingRunner->GetLeafHitCounts());
+  if (m_servingLeafProbabilities.empty() ||
+      ComputeLeafDistributionShift(m_servingLeafProbabilities, leafProbabilities) > m_adaptiveOptions.shiftThreshold) {
+    auto statsCSVPath = m_filePathPrefix + "." + std::to_string(m_numRecompilations + 1) + ".stats.csv";
+    m_profilingRunner->WriteLeafHitCountProfile(statsCSVPath);
+    m_servingLeafProbabilities = leafProbabilities;
+    StartRecompilation(statsCSVPath);
+  }
+  m_profilingRunner->ResetLeafHitCounts();
+  m_numSampledRows = 0;
+}
+
+void AdaptiveInferenceRunner::StartRecompilation(const std::string& statsCSVPath) {
+  // The previous recompilation has finished, but its thread may not have been joined yet
+  if (m_recompilationThread.joinable())
+    m_recompilationThread.join();
+  m_recompiling = true;
+  m_recompilationThread = std::thread([this, statsCSVPath]() {
+    CompilerOptions options(m_options);
+    options.tilingType = m_adaptiveOptions.tilingType;
+    options.statsProfileCSVPath = statsCSVPath;
+    options.peelProbabilisticallyTiledWalks = m_adaptiveOptions.peelTreeWalks;
+    // Peeled walks need the sparse representation
+    auto representation = m_adaptiveOptions.peelTreeWalks ? std::string("sparse") : m_servingRepresentation;
+    auto generation = std::to_string(m_numRecompilations + 1);
+    auto modelGlobalsJSONPath = ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(m_filePathPrefix + "." + generation);
+    auto runner = CompileModel(options, representation, modelGlobalsJSONPath);
+    std::atomic_store(&m_servingRunner, runner);
+    TreeBeard::Logging::Log("Swapped in the model re-tiled with profile " + statsCSVPath);
+    // Batches still running on the swapped out runner don't read its files (it was initialized when it was compiled)
+    RemoveFiles(m_servingRunnerFiles);
+    m_servingRunnerFiles = { statsCSVPath, modelGlobalsJSONPath };
+    ++m_numRecompilations;
+    m_recompiling = false;
+  });
+}
+
+void AdaptiveInferenceRunner::WaitForRecompilation() {
+  std::lock_guard<std::mutex> lock(m_profilingMutex);
+  if (m_recompilationThread.joinable())
+    m_recompilationThread.join();
+}
+
+} // runtime
+} // TreeBeard
@@ -0,0 +1,99 @@
+#ifndef _ADAPTIVEINFERENCERUNNER_H_
+#define _ADAPTIVEINFERENCERUNNER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TreebeardContext.h"
+#include "ExecutionHelpers.h"
+
+// Re-tiles a model while it is serving predictions. One in every samplingInterval batches is also
+// predicted by a profiling runner, a copy of the model compiled with instrumentLeafHitCounts. Every time
+// windowRows rows have been sampled, the leaf distribution of the window is compared with the one the
+// serving runner was tiled for. If it has shifted by more than shiftThreshold, the window is written out
+// as a probability profile and the model is recompiled with it on a background thread. The new runner
+// replaces the serving runner once it is ready. Batches that are being predicted when the runners are
+// swapped finish on the runner they started on.
+
+namespace TreeBeard
+{
+namespace runtime
+{
+
+struct AdaptiveTilingOptions {
+  // Profile one in every samplingInterval batches
+  int64_t samplingInterval = 64;
+  // Number of sampled rows the leaf distribution of a window is computed over
+  int64_t windowRows = 100000;
+  // The model is recompiled when the total variation distance between the leaf distributions of the
+  // window and of the serving profile, averaged over the trees, is larger than this
+  double shiftThreshold = 0.1;
+  // kProbabilistic or kHybrid
+  TilingType tilingType = TilingType::kProbabilistic;
+  // Peel the first levels of the walks of probabilistically tiled trees (see CompilerOptions::peelProbabilisticallyTiledWalks).
+  // Peeled walks need the sparse representation, so recompiled models are stored sparsely when this is set.
+  bool peelTreeWalks = false;
+  // Where the profiles and model globals of the recompiled models are written (the temporary directory if empty)
+  std::string workingDirectory = "";
+};
+
+class AdaptiveInferenceRunner {
+  std::string m_modelPath;
+  std::string m_forestCreatorType;
+  CompilerOptions m_options;
+  AdaptiveTilingOptions m_adaptiveOptions;
+  std::string m_filePathPrefix;
+  // Representation of the first serving model. Recompiled models use it too unless their walks are peeled.
+  std::string m_servingRepresentation;
+  // The profile and model globals of the serving runner. They are deleted when the runner is swapped out.
+  std::vector<std::string> m_servingRunnerFiles;
+  std::string m_profilingModelGlobalsJSONPath;
+
+  // Only accessed through std::atomic_load and std::atomic_store
+  std::shared_ptr<mlir::decisionforest::InferenceRunnerBase> m_servingRunner;
+  std::shared_ptr<mlir::decisionforest::InferenceRunnerBase> m_profilingRunner;
+  std::atomic<int64_t> m_numBatches;
+
+  // Held while a batch is profiled. Sampled batches are not profiled if another thread holds it.
+  std::mutex m_profilingMutex;
+  std::vector<double> m_profilingResults;
+  int64_t m_numSampledRows = 0;
+  // Leaf probabilities of every tree in the profile the serving runner was compiled with (empty until the first recompilation)
+  std::vector<std::vector<double>> m_servingLeafProbabilities;
+
+  std::thread m_recompilationThread;
+  std::atomic<bool> m_recompiling;
+  std::atomic<int64_t> m_numRecompilations;
+
+  std::shared_ptr<mlir::decisionforest::InferenceRunnerBase> CompileModel(const CompilerOptions& options, const std::string& representation,
+                                                                         const std::string& modelGlobalsJSONPath);
+  void ProfileBatch(void *inputs);
+  void StartRecompilation(const std::string& statsCSVPath);
+public:
+  AdaptiveInferenceRunner(const std::string& modelPath, const std::string& forestCreatorType,
+                          const CompilerOptions& options, const AdaptiveTilingOptions& adaptiveOptions);
+  ~AdaptiveInferenceRunner();
+
+  // Predicts a batch on the serving runner. Can be called from several threads at once.
+  void RunInference(void *inputs, void *results);
+
+  int32_t GetBatchSize() { return m_profilingRunner->GetBatchSize(); }
+  int32_t GetRowSize() { return m_profilingRunner->GetRowSize(); }
+  std::shared_ptr<mlir::decisionforest::InferenceRunnerBase> GetServingRunner() { return std::atomic_load(&m_servingRunner); }
+  int64_t GetNumberOfRecompilations() { return m_numRecompilations; }
+  // Returns once the recompilation in progress (if there is one) has swapped its runner in
+  void WaitForRecompilation();
+};
+
+// Mean over the trees of the total variation distance between the leaf distributions of the trees
+double ComputeLeafDistributionShift(const std::vector<std::vector<double>>& leafProbabilities1,
+                                    const std::vector<std::vector<double>>& leafProbabilities2);
+
+} // runtime
+} // TreeBeard
+
+#endif // _ADAPTIVEINFERENCERUNNER_H_
@@ -0,0 +1,190 @@
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "ModelReplicas.h"
+
+namespace
+{
+using namespace TreeBeard::runtime;
+
+const int64_t kHugePageSize = 2 << 20;
+// The node masks passed to mbind are a single word
+const int32_t kMaxNUMANodes = 64;
+// MPOL_BIND from numaif.h (which would need libnuma's headers)
+const int kMemoryPolicyBind = 2;
+// Threads can be moved to another node by the scheduler. getcpu is a system call, so the node of a 
+// thread is only looked up again every kNodeRefreshInterval replica lookups.
+const int32_t kNodeRefreshInterval = 256;
+
+struct ReplicatedBuffer {
+  void *buffer;
+  int64_t size;
+  std::vector<void*> replicas;
+  std::vector<int64_t> allocatedSizes;
+  // Number of times the buffer was registered and not yet released. Runners that share a model (the
+  // same shared object loaded twice for example) register its buffers once each. The replicas are
+  // only freed when the last of them releases the buffer, so they are never freed under another runner.
+  int64_t refCount;
+};
+
+std::mutex g_replicasMutex;
+std::vector<ReplicatedBuffer> g_replicatedBuffers;
+// Incremented every time g_replicatedBuffers changes so that threads know to refresh their cached lookups
+std::atomic<uint64_t> g_replicasVersion{0};
+
+// /sys/devices/system/node/online is a list of node ranges like "0-1" or "0,2-3"
+int32_t ReadNumberOfNUMANodes() {
+  std::ifstream fin("/sys/devices/system/node/online");
+  std::string onlineNodes;
+  if (!(fin >> onlineNodes))
+    return 1;
+  int32_t maxNode = 0;
+  std::stringstream rangeStream(onlineNodes);
+  std::string range;
+  while (std::getline(rangeStream, range, ',')) {
+    auto lastNode = range.substr(range.find('-') == std::string::npos ? 0 : range.find('-') + 1);
+    maxNode = std::max(maxNode, std::atoi(lastNode.c_str()));
+  }
+  return std::min(maxNode + 1, kMaxNUMANodes);
+}
+
+int32_t GetCurrentNUMANode() {
+  thread_local int32_t node = -1;
+  thread_local int32_t lookupsSinceRefresh = 0;
+  if (node == -1 || ++lookupsSinceRefresh >= kNodeRefreshInterval) {
+    unsigned cpu = 0, currentNode = 0;
+    if (syscall(SYS_getcpu, &cpu, &currentNode, nullptr) != 0)
+      currentNode = 0;
+    node = std::min(static_cast<int32_t>(currentNode), GetNumberOfNUMANodes() - 1);
+    lookupsSinceRefresh = 0;
+  }
+  return node;
+}
+
+void* AllocateOnNode(int64_t size, int32_t node, int32_t hugePages, int64_t& allocatedSize) {
+  int64_t pageSize = hugePages == kRegularPages ? sysconf(_SC_PAGESIZE) : kHugePageSize;
+  allocatedSize = (size + pageSize - 1) / pageSize * pageSize;
+  void *ptr = MAP_FAILED;
+  if (hugePages == kExplicitHugePages)
+    ptr = mmap(nullptr, allocatedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (ptr == MAP_FAILED) {
+    ptr = mmap(nullptr, allocatedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+      return nullptr;
+    if (hugePages != kRegularPages)
+      madvise(ptr, allocatedSize, MADV_HUGEPAGE);
+  }
+  // Bind the pages to the node before they are first touched. This fails (harmlessly) on kernels without NUMA support.
+  unsigned long nodeMask[2] = { 1UL << node, 0 };
+  syscall(SYS_mbind, ptr, allocatedSize, kMemoryPolicyBind, nodeMask, kMaxNUMANodes + 1, 0);
+  return ptr;
+}
+
+void FreeReplicas(ReplicatedBuffer& replicatedBuffer) {
+  for (size_t i=0 ; i<replicatedBuffer.replicas.size() ; ++i)
+    munmap(replicatedBuffer.replicas[i], replicatedBuffer.allocatedSizes[i]);
+}
+
+} // anonymous namespace
+
+namespace TreeBeard
+{
+namespace runtime
+{
+
+int32_t GetNumberOfNUMANodes() {
+  static int32_t numNodes = ReadNumberOfNUMANodes();
+  return numNodes;
+}
+
+} // runtime
+} // TreeBeard
+
+extern "C" void TreebeardReplicateBuffer(void *buffer, int64_t size, int32_t hugePages) {
+  {
+    // The buffer is already replicated. Its contents are the same, so the existing replicas are shared.
+    std::lock_guard<std::mutex> lock(g_replicasMutex);
+    auto existing = std::find_if(g_replicatedBuffers.begin(), g_replicatedBuffers.end(), [&](ReplicatedBuffer& b) { return b.buffer == buffer; });
+    if (existing != g_replicatedBuffers.end()) {
+      assert (existing->size == size && "A replicated buffer can only be registered again with the same size");
+      ++existing->refCount;
+      return;
+    }
+  }
+  ReplicatedBuffer replicatedBuffer{ buffer, size, {}, {}, 1 };
+  for (int32_t node=0 ; node<GetNumberOfNUMANodes() ; ++node) {
+    int64_t allocatedSize = 0;
+    auto replica = AllocateOnNode(size, node, hugePages, allocatedSize);
+    if (!replica) {
+      // Out of memory. Keep using the original buffer on all nodes.
+      FreeReplicas(replicatedBuffer);
+      return;
+    }
+    std::memcpy(replica, buffer, size);
+    replicatedBuffer.replicas.push_back(replica);
+    replicatedBuffer.allocatedSizes.push_back(allocatedSize);
+  }
+  std::lock_guard<std::mutex> lock(g_replicasMutex);
+  // Another thread registered the same buffer while this one was copying it
+  auto existing = std::find_if(g_replicatedBuffers.begin(), g_replicatedBuffers.end(), [&](ReplicatedBuffer& b) { return b.buffer == buffer; });
+  if (existing != g_replicatedBuffers.end()) {
+    FreeReplicas(replicatedBuffer);
+    ++existing->refCount;
+    return;
+  }
+  g_replicatedBuffers.push_back(replicatedBuffer);
+  g_replicasVersion.fetch_add(1, std::memory_order_release);
+}
+
+extern "C" void TreebeardReleaseReplicas(void *buffer) {
+  std::lock_guard<std::mutex> lock(g_replicasMutex);
+  auto existing = std::find_if(g_replicatedBuffers.begin(), g_replicatedBuffers.end(), [&](ReplicatedBuffer& b) { return b.buffer == buffer; });
+  if (existing == g_replicatedBuffers.end())
+    return;
+  if (--existing->refCount > 0)
+    return;
+  FreeReplicas(*existing);
+  g_replicatedBuffers.erase(existing);
+  g_replicasVersion.fetch_add(1, std::memory_order_release);
+}
+
+extern "C" void* TreebeardGetLocalReplica(void *buffer) {
+  // Each thread keeps the (buffer, replica) pairs of its node so that lookups don't take the lock
+  struct LocalReplicas {
+    uint64_t version = UINT64_MAX;
+    int32_t node = -1;
+    std::vector<std::pair<void*, void*>> replicas;
+  };
+  thread_local LocalReplicas localReplicas;
+  auto node = GetCurrentNUMANode();
+  if (localReplicas.version != g_replicasVersion.load(std::memory_order_acquire) || localReplicas.node != node) {
+    std::lock_guard<std::mutex> lock(g_replicasMutex);
+    localReplicas.replicas.clear();
+    for (auto& replicatedBuffer : g_replicatedBuffers)
+      localReplicas.replicas.push_back({replicatedBuffer.buffer, replicatedBuffer.replicas.at(node)});
+    localReplicas.version = g_replicasVersion.load(std::memory_order_relaxed);
+    localReplicas.node = node;
+  }
+  for (auto& replica : localReplicas.replicas)
+    if (replica.first == buffer)
+      return replica.second;
+  return buffer;
+}
+
+extern "C" int32_t TreebeardGetReplicaMemoryUsage(int64_t *bytesPerNode, int32_t maxNodes) {
+  auto numNodes = GetNumberOfNUMANodes();
+  std::fill(bytesPerNode, bytesPerNode + std::min(numNodes, maxNodes), 0);
+  std::lock_guard<std::mutex> lock(g_replicasMutex);
+  for (auto& replicatedBuffer : g_replicatedBuffers)
+    for (int32_t node=0 ; node<std::min(numNodes, maxNodes) ; ++node)
+      bytesPerNode[node] += replicatedBuffer.allocatedSizes.at(node);
+  return numNodes;
+}
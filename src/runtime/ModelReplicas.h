@@ -0,0 +1,44 @@
+#ifndef _MODELREPLICAS_H_
+#define _MODELREPLICAS_H_
+
+#include <cstdint>
+#include <string>
+
+// Per NUMA node copies of the buffers a model is stored in. Generated code compiled with
+// replicateModelPerNUMANode registers the model buffers once they are initialized (see
+// ModelReplicaPass in LowerToLLVM.cpp) and looks up the copy on the node of the calling thread
+// every time the prediction function (or an outlined parallel loop body) runs, so that the threads
+// on each socket only read memory local to that socket.
+
+namespace TreeBeard
+{
+namespace runtime
+{
+
+// How the pages of a replica are allocated. Explicit huge pages fall back to transparent huge
+// pages when there aren't enough huge pages reserved.
+enum ModelHugePages : int32_t { kRegularPages=0, kTransparentHugePages=1, kExplicitHugePages=2 };
+
+const std::string kGetLocalReplicaFunctionName = "TreebeardGetLocalReplica";
+const std::string kReplicateBufferFunctionName = "TreebeardReplicateBuffer";
+const std::string kReleaseReplicasFunctionName = "TreebeardReleaseReplicas";
+
+int32_t GetNumberOfNUMANodes();
+
+} // runtime
+} // TreeBeard
+
+extern "C"
+{
+// Copies the size bytes at buffer onto every NUMA node. A buffer that is already replicated keeps
+// its replicas. They are freed when every registration of the buffer has been released.
+void TreebeardReplicateBuffer(void *buffer, int64_t size, int32_t hugePages);
+void TreebeardReleaseReplicas(void *buffer);
+// Returns the copy of buffer on the node of the calling thread (buffer itself if it isn't replicated)
+void* TreebeardGetLocalReplica(void *buffer);
+// Writes the number of bytes allocated for replicas on each node into bytesPerNode (at most
+// maxNodes entries) and returns the number of nodes
+int32_t TreebeardGetReplicaMemoryUsage(int64_t *bytesPerNode, int32_t maxNodes);
+}
+
+#endif // _MODELREPLICAS_H_
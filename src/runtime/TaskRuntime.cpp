@@ -0,0 +1,228 @@
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <cassert>
+#include <algorithm>
+#include "TaskRuntime.h"
+
+namespace
+{
+using TreeBeard::runtime::ParallelLoopBody_t;
+
+// Number of times an idle worker checks for a new loop before it goes to sleep
+const int32_t kIdleSpinCount = 1 << 14;
+// The range of each thread is run in about this many pieces so that there is something left to steal
+const int64_t kGrainsPerThread = 8;
+
+inline void CPURelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+// The iterations [begin, end) of the current loop that a thread still has to run. The owning thread
+// takes iterations from the front and other threads steal from the back.
+struct alignas(64) IterationRange {
+  std::atomic_flag lock = ATOMIC_FLAG_INIT;
+  int64_t begin = 0;
+  int64_t end = 0;
+
+  void Lock() {
+    while (lock.test_and_set(std::memory_order_acquire))
+      CPURelax();
+  }
+  void Unlock() { lock.clear(std::memory_order_release); }
+
+  void Set(int64_t newBegin, int64_t newEnd) {
+    Lock();
+    begin = newBegin;
+    end = newEnd;
+    Unlock();
+  }
+
+  bool TakeFront(int64_t grainSize, int64_t& chunkBegin, int64_t& chunkEnd) {
+    Lock();
+    chunkBegin = begin;
+    chunkEnd = std::min(begin + grainSize, end);
+    begin = chunkEnd;
+    Unlock();
+    return chunkBegin < chunkEnd;
+  }
+
+  bool StealBack(int64_t& stolenBegin, int64_t& stolenEnd) {
+    Lock();
+    int64_t remaining = end - begin;
+    bool stole = remaining > 0;
+    if (stole) {
+      stolenBegin = begin + remaining/2;
+      stolenEnd = end;
+      end = stolenBegin;
+    }
+    Unlock();
+    return stole;
+  }
+};
+
+class WorkStealingPool {
+  int32_t m_numThreads;
+  std::vector<std::thread> m_workers;
+  std::unique_ptr<IterationRange[]> m_ranges;
+
+  // The loop that is currently running. These are written before m_loopGeneration is incremented.
+  ParallelLoopBody_t m_body = nullptr;
+  void *m_context = nullptr;
+  int64_t m_grainSize = 1;
+
+  std::atomic<uint64_t> m_loopGeneration{0};
+  std::atomic<int32_t> m_finishedWorkers{0};
+  std::atomic<bool> m_shutdown{false};
+
+  // Loops started by different application threads run one after the other
+  std::mutex m_loopMutex;
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wakeUp;
+  int32_t m_sleepingWorkers = 0;
+
+  bool StealWork(int32_t threadIndex) {
+    int64_t stolenBegin, stolenEnd;
+    for (int32_t i=1 ; i<m_numThreads ; ++i) {
+      auto victim = (threadIndex + i) % m_numThreads;
+      if (m_ranges[victim].StealBack(stolenBegin, stolenEnd)) {
+        m_ranges[threadIndex].Set(stolenBegin, stolenEnd);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns once this thread couldn't find any iterations of the current loop left to run
+  void RunLoop(int32_t threadIndex) {
+    auto& range = m_ranges[threadIndex];
+    int64_t begin, end;
+    do {
+      while (range.TakeFront(m_grainSize, begin, end))
+        m_body(begin, end, m_context);
+    } while (StealWork(threadIndex));
+  }
+
+  void WaitForNextLoop(uint64_t seenGeneration) {
+    auto loopStarted = [&]() {
+      return m_loopGeneration.load(std::memory_order_acquire) != seenGeneration || m_shutdown.load(std::memory_order_acquire);
+    };
+    for (int32_t i=0 ; i<kIdleSpinCount ; ++i) {
+      if (loopStarted())
+        return;
+      CPURelax();
+    }
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    ++m_sleepingWorkers;
+    m_wakeUp.wait(lock, loopStarted);
+    --m_sleepingWorkers;
+  }
+
+  void WorkerLoop(int32_t threadIndex);
+public:
+  WorkStealingPool(int32_t numThreads);
+  ~WorkStealingPool();
+  int32_t NumThreads() { return m_numThreads; }
+  void ParallelFor(int64_t numIterations, ParallelLoopBody_t body, void *context);
+};
+
+thread_local bool t_insideParallelLoop = false;
+
+WorkStealingPool::WorkStealingPool(int32_t numThreads)
+  : m_numThreads(numThreads), m_ranges(new IterationRange[numThreads])
+{
+  assert (numThreads > 0);
+  // The thread that starts a loop runs it as thread 0
+  for (int32_t i=1 ; i<numThreads ; ++i)
+    m_workers.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_shutdown.store(true, std::memory_order_release);
+  }
+  m_wakeUp.notify_all();
+  for (auto& worker : m_workers)
+    worker.join();
+}
+
+void WorkStealingPool::WorkerLoop(int32_t threadIndex) {
+  t_insideParallelLoop = true;
+  uint64_t seenGeneration = 0;
+  while (true) {
+    WaitForNextLoop(seenGeneration);
+    if (m_shutdown.load(std::memory_order_acquire))
+      return;
+    // The next loop can only start once this thread has finished this one
+    seenGeneration = m_loopGeneration.load(std::memory_order_acquire);
+    RunLoop(threadIndex);
+    m_finishedWorkers.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void WorkStealingPool::ParallelFor(int64_t numIterations, ParallelLoopBody_t body, void *context) {
+  std::lock_guard<std::mutex> loopLock(m_loopMutex);
+  m_body = body;
+  m_context = context;
+  m_grainSize = std::max(numIterations / (m_numThreads * kGrainsPerThread), int64_t(1));
+  for (int32_t i=0 ; i<m_numThreads ; ++i)
+    m_ranges[i].Set(numIterations*i/m_numThreads, numIterations*(i+1)/m_numThreads);
+  m_finishedWorkers.store(0, std::memory_order_relaxed);
+  m_loopGeneration.fetch_add(1, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    if (m_sleepingWorkers > 0)
+      m_wakeUp.notify_all();
+  }
+
+  t_insideParallelLoop = true;
+  RunLoop(0);
+  t_insideParallelLoop = false;
+
+  // Every worker takes part in every loop, so the loop is done once all workers have run out of iterations
+  auto numWorkers = static_cast<int32_t>(m_workers.size());
+  while (m_finishedWorkers.load(std::memory_order_acquire) != numWorkers)
+    CPURelax();
+}
+
+WorkStealingPool& GetWorkStealingPool() {
+  static WorkStealingPool pool(TreeBeard::runtime::GetNumberOfTaskRuntimeThreads());
+  return pool;
+}
+
+} // anonymous namespace
+
+namespace TreeBeard
+{
+namespace runtime
+{
+
+int32_t GetNumberOfTaskRuntimeThreads() {
+  const char* numThreadsString = std::getenv("TREEBEARD_NUM_THREADS");
+  if (numThreadsString && std::atoi(numThreadsString) > 0)
+    return std::atoi(numThreadsString);
+  return std::max(static_cast<int32_t>(std::thread::hardware_concurrency()), 1);
+}
+
+} // runtime
+} // TreeBeard
+
+extern "C" void TreebeardParallelFor(int64_t numIterations, TreeBeard::runtime::ParallelLoopBody_t body, void *context) {
+  if (numIterations <= 0)
+    return;
+  auto& pool = GetWorkStealingPool();
+  if (numIterations == 1 || t_insideParallelLoop || pool.NumThreads() == 1) {
+    body(0, numIterations, context);
+    return;
+  }
+  pool.ParallelFor(numIterations, body, context);
+}
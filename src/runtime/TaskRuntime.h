@@ -0,0 +1,36 @@
+#ifndef _TASKRUNTIME_H_
+#define _TASKRUNTIME_H_
+
+#include <cstdint>
+#include <string>
+
+// A small task runtime that generated code calls to run its parallel loops (see
+// ParallelLoopToTaskRuntimePass in LowerToLLVM.cpp). It keeps a persistent pool of worker threads, so
+// a parallel loop doesn't have to fork and join threads like an OpenMP parallel region. The iterations
+// of a loop are split into one contiguous range per thread and threads that run out of work steal
+// half of the remaining iterations of another thread.
+
+namespace TreeBeard
+{
+namespace runtime
+{
+// Runs iterations [begin, end) of an outlined parallel loop body. context points to the values
+// the body uses from the function the loop was outlined from.
+typedef void(*ParallelLoopBody_t)(int64_t begin, int64_t end, void *context);
+
+// Name of the runtime function generated code calls to run a parallel loop
+const std::string kParallelForFunctionName = "TreebeardParallelFor";
+
+// Number of threads (including the calling thread) parallel loops are run on. This is the value
+// of the TREEBEARD_NUM_THREADS environment variable if it is set and the number of hardware
+// threads otherwise.
+int32_t GetNumberOfTaskRuntimeThreads();
+
+} // runtime
+} // TreeBeard
+
+// Runs iterations [0, numIterations) of body on the threads of the pool and returns once all of
+// them have completed. Parallel loops started from inside a parallel loop run on the calling thread.
+extern "C" void TreebeardParallelFor(int64_t numIterations, TreeBeard::runtime::ParallelLoopBody_t body, void *context);
+
+#endif // _TASKRUNTIME_H_
@@ -16,6 +16,8 @@
 #include "ModelSerializers.h"
 #include "Representations.h"
 #include "onnxmodelparser.h"
+#include "ModelReplicas.h"
+#include "AdaptiveInferenceRunner.h"
 
 // ===-------------------------------------------------------------=== //
 // Execution API
@@ -64,6 +66,104 @@ extern "C" void RunInferenceOnMultipleBatches(intptr_t inferenceRunnerInt, void
   }
 }
 
+// Run inference and write the prediction (outputMode 0), the class margins (1) or the class probabilities (2)
+// of a batch. Margins and probabilities are batchSize x numClasses values of the input element type.
+extern "C" void RunInferenceWithOutputMode(intptr_t inferenceRunnerInt, void *inputs, void *results, int32_t outputMode) {
+  auto inferenceRunner = reinterpret_cast<mlir::decisionforest::InferenceRunnerBase*>(inferenceRunnerInt);
+  auto mode = static_cast<mlir::decisionforest::PredictionOutputMode>(outputMode);
+  if (mode == mlir::decisionforest::PredictionOutputMode::kPrediction) {
+    inferenceRunner->RunInference<double, double>(reinterpret_cast<double*>(inputs), reinterpret_cast<double*>(results));
+    return;
+  }
+  // The scores are computed in the input element type, so the types do matter here
+  bool computeProbabilities = mode == mlir::decisionforest::PredictionOutputMode::kProbabilities;
+  if (inferenceRunner->GetInputElementBitWidth() == 32)
+    inferenceRunner->RunInferenceForClassScores<float>(reinterpret_cast<float*>(inputs), reinterpret_cast<float*>(results), computeProbabilities);
+  else if (inferenceRunner->GetInputElementBitWidth() == 64)
+    inferenceRunner->RunInferenceForClassScores<double>(reinterpret_cast<double*>(inputs), reinterpret_cast<double*>(results), computeProbabilities);
+  else
+    assert (false && "Unsupported input element type");
+}
+
+extern "C" void RunInferenceOnMultipleBatchesWithOutputMode(intptr_t inferenceRunnerInt, void *inputs, void *results, int32_t numRows, int32_t outputMode) {
+  auto inferenceRunner = reinterpret_cast<mlir::decisionforest::InferenceRunnerBase*>(inferenceRunnerInt);
+  auto batchSize = inferenceRunner->GetBatchSize();
+  auto rowSize = inferenceRunner->GetRowSize();
+
+  assert (numRows % batchSize == 0);
+  int32_t inputElementSize = inferenceRunner->GetInputElementBitWidth()/8;
+  int32_t resultsPerRowSize = inferenceRunner->GetReturnTypeBitWidth()/8;
+  if (static_cast<mlir::decisionforest::PredictionOutputMode>(outputMode) != mlir::decisionforest::PredictionOutputMode::kPrediction)
+    resultsPerRowSize = inferenceRunner->GetNumberOfClasses() * inputElementSize;
+  for (int32_t batch=0 ; batch<numRows/batchSize ; ++batch) {
+    auto batchPtr = reinterpret_cast<char*>(inputs) + (batch * (rowSize*batchSize) * inputElementSize);
+    auto resultsPtr = reinterpret_cast<char*>(results) + (batch * batchSize * resultsPerRowSize);
+    RunInferenceWithOutputMode(inferenceRunnerInt, batchPtr, resultsPtr, outputMode);
+  }
+}
+
+// Anytime prediction on a batch of a model compiled for anytime prediction. Writes the margins of the first maxTrees 
+// trees (all trees if negative) into margins, stopping early at a tree group boundary once timeBudgetNanoseconds 
+// (if not negative) is used up. Returns the number of trees walked.
+extern "C" int64_t RunAnytimeInference(intptr_t inferenceRunnerInt, void *inputs, void *margins, int64_t maxTrees, 
+                                       int64_t timeBudgetNanoseconds, int64_t treeGroupSize) {
+  auto inferenceRunner = reinterpret_cast<mlir::decisionforest::InferenceRunnerBase*>(inferenceRunnerInt);
+  if (inferenceRunner->GetInputElementBitWidth() == 32)
+    return inferenceRunner->RunAnytimeInference<float>(reinterpret_cast<float*>(inputs), reinterpret_cast<float*>(margins), 
+                                                       maxTrees, timeBudgetNanoseconds, treeGroupSize);
+  else if (inferenceRunner->GetInputElementBitWidth() == 64)
+    return inferenceRunner->RunAnytimeInference<double>(reinterpret_cast<double*>(inputs), reinterpret_cast<double*>(margins), 
+                                                        maxTrees, timeBudgetNanoseconds, treeGroupSize);
+  assert (false && "Unsupported input element type");
+  return 0;
+}
+
+template<typename InputElementType>
+void RunSingleRowInferenceImpl(mlir::decisionforest::InferenceRunnerBase* inferenceRunner, void *row, void *result) {
+  auto typedRow = reinterpret_cast<InputElementType*>(row);
+  if (inferenceRunner->GetReturnTypeBitWidth() == 32)
+    inferenceRunner->RunSingleRowInference<InputElementType, float>(typedRow, reinterpret_cast<float*>(result));
+  else if (inferenceRunner->GetReturnTypeBitWidth() == 64)
+    inferenceRunner->RunSingleRowInference<InputElementType, double>(typedRow, reinterpret_cast<double*>(result));
+  else
+    assert (false && "Unsupported return type");
+}
+
+// Predict a single row with the single row entry point of a model compiled for a batch size of 1. The 
+// prediction is written to result in the return type of the model.
+extern "C" void RunSingleRowInference(intptr_t inferenceRunnerInt, void *row, void *result) {
+  auto inferenceRunner = reinterpret_cast<mlir::decisionforest::InferenceRunnerBase*>(inferenceRunnerInt);
+  if (inferenceRunner->GetInputElementBitWidth() == 32)
+    RunSingleRowInferenceImpl<float>(inferenceRunner, row, result);
+  else if (inferenceRunner->GetInputElementBitWidth() == 64)
+    RunSingleRowInferenceImpl<double>(inferenceRunner, row, result);
+  else
+    assert (false && "Unsupported input element type");
+}
+
+extern "C" int32_t GetNumberOfClasses(intptr_t inferenceRunnerInt) {
+  auto inferenceRunner = reinterpret_cast<mlir::decisionforest::InferenceRunnerBase*>(inferenceRunnerInt);
+  return inferenceRunner->GetNumberOfClasses();
+}
+
+// Bytes allocated for model replicas (see replicateModelPerNUMANode) on each NUMA node. At most
+// maxNodes entries of bytesPerNode are written. Returns the number of NUMA nodes.
+extern "C" int32_t GetModelReplicaMemoryUsage(int64_t *bytesPerNode, int32_t maxNodes) {
+  return TreebeardGetReplicaMemoryUsage(bytesPerNode, maxNodes);
+}
+
+// Writes the leaf hit counts of a model compiled with instrumentLeafHitCounts as a probability profile
+// that can be passed to the compiler as statsProfileCSVPath.
+extern "C" void WriteLeafHitCountProfile(intptr_t inferenceRunnerInt, const char *statsCSVPath) {
+  auto inferenceRunner = reinterpret_cast<mlir::decisionforest::InferenceRunnerBase*>(inferenceRunnerInt);
+  inferenceRunner->WriteLeafHitCountProfile(std::string(statsCSVPath));
+}
+
+extern "C" void ResetLeafHitCounts(intptr_t inferenceRunnerInt) {
+  auto inferenceRunner = reinterpret_cast<mlir::decisionforest::InferenceRunnerBase*>(inferenceRunnerInt);
+  inferenceRunner->ResetLeafHitCounts();
+}
+
 extern "C" int32_t GetBatchSize(intptr_t inferenceRunnerInt) {
   auto inferenceRunner = reinterpret_cast<mlir::decisionforest::InferenceRunnerBase*>(inferenceRunnerInt);
   // TODO The types in this template don't really matter. Maybe we should get rid of them? 
@@ -119,6 +219,20 @@ COMPILER_OPTION_SETTER(reorderTreesByDepth, int32_t)
 COMPILER_OPTION_SETTER(statsProfileCSVPath,  const char*)
 COMPILER_OPTION_SETTER(pipelineSize, int32_t)
 COMPILER_OPTION_SETTER(numberOfCores, int32_t)
+COMPILER_OPTION_SETTER(prefetchDistance, int32_t)
+COMPILER_OPTION_SETTER(quantizeModel, int32_t)
+COMPILER_OPTION_SETTER(simplifyForest, int32_t)
+COMPILER_OPTION_SETTER(compactFeatures, int32_t)
+COMPILER_OPTION_SETTER(parallelizeTrees, int32_t)
+COMPILER_OPTION_SETTER(useWorkStealingRuntime, int32_t)
+COMPILER_OPTION_SETTER(replicateModelPerNUMANode, int32_t)
+COMPILER_OPTION_SETTER(modelHugePages, int32_t)
+COMPILER_OPTION_SETTER(specializeObliviousTrees, int32_t)
+COMPILER_OPTION_SETTER(instrumentLeafHitCounts, int32_t)
+COMPILER_OPTION_SETTER(thresholdTypeIsBFloat16, int32_t)
+COMPILER_OPTION_SETTER(fallbackTo32BitThresholds, int32_t)
+COMPILER_OPTION_SETTER(useFastApproximateTransforms, int32_t)
+COMPILER_OPTION_SETTER(peelProbabilisticallyTiledWalks, int32_t)
 
 extern "C" void Set_tilingType(intptr_t options, int32_t val) {
   TreeBeard::CompilerOptions *optionsPtr = reinterpret_cast<TreeBeard::CompilerOptions*>(options);
@@ -161,12 +275,59 @@ extern "C" intptr_t CreateInferenceRunner(const char* modelJSONPath, const char*
                                         mlir::decisionforest::ConstructModelSerializer(modelGlobalsJSONPath),
                                         nullptr  /*TODO_ForestCreator*/);
   auto module = TreeBeard::ConstructLLVMDialectModuleFromXGBoostJSON(tbContext);
+  // Use the widths from the context since automatically selected widths are only known after compilation
   auto inferenceRunner = new mlir::decisionforest::InferenceRunner(tbContext.serializer, module, 
-                                                                   optionsPtr->tileSize, optionsPtr->thresholdTypeWidth,
-                                                                   optionsPtr->featureIndexTypeWidth);
+                                                                   tbContext.options.tileSize, tbContext.options.thresholdTypeWidth,
+                                                                   tbContext.options.featureIndexTypeWidth);
   return reinterpret_cast<intptr_t>(inferenceRunner);
 }
 
+// ===-------------------------------------------------------------=== //
+// Adaptive Inference API
+// ===-------------------------------------------------------------=== //
+
+// Serve predictions with a model that is re-tiled in the background whenever the leaf distribution of 
+// the sampled batches shifts (see runtime/AdaptiveInferenceRunner.h). tilingType is 1 (probabilistic) or 2 (hybrid).
+extern "C" intptr_t CreateAdaptiveInferenceRunner(const char* modelPath, const char* forestCreatorType, intptr_t options,
+                                                  int64_t samplingInterval, int64_t windowRows, double shiftThreshold, 
+                                                  int32_t tilingType, int32_t peelTreeWalks) {
+  TreeBeard::CompilerOptions *optionsPtr = reinterpret_cast<TreeBeard::CompilerOptions*>(options);
+  TreeBeard::runtime::AdaptiveTilingOptions adaptiveOptions;
+  adaptiveOptions.samplingInterval = samplingInterval;
+  adaptiveOptions.windowRows = windowRows;
+  adaptiveOptions.shiftThreshold = shiftThreshold;
+  assert ((tilingType == 1 || tilingType == 2) && "Invalid tiling type value");
+  adaptiveOptions.tilingType = tilingType == 1 ? TreeBeard::TilingType::kProbabilistic : TreeBeard::TilingType::kHybrid;
+  adaptiveOptions.peelTreeWalks = peelTreeWalks;
+  auto adaptiveRunner = new TreeBeard::runtime::AdaptiveInferenceRunner(modelPath, forestCreatorType, *optionsPtr, adaptiveOptions);
+  return reinterpret_cast<intptr_t>(adaptiveRunner);
+}
+
+extern "C" void RunAdaptiveInference(intptr_t adaptiveRunnerInt, void *inputs, void *results) {
+  auto adaptiveRunner = reinterpret_cast<TreeBeard::runtime::AdaptiveInferenceRunner*>(adaptiveRunnerInt);
+  adaptiveRunner->RunInference(inputs, results);
+}
+
+extern "C" int32_t GetAdaptiveInferenceRunnerBatchSize(intptr_t adaptiveRunnerInt) {
+  auto adaptiveRunner = reinterpret_cast<TreeBeard::runtime::AdaptiveInferenceRunner*>(adaptiveRunnerInt);
+  return adaptiveRunner->GetBatchSize();
+}
+
+extern "C" int64_t GetNumberOfAdaptiveRecompilations(intptr_t adaptiveRunnerInt) {
+  auto adaptiveRunner = reinterpret_cast<TreeBeard::runtime::AdaptiveInferenceRunner*>(adaptiveRunnerInt);
+  return adaptiveRunner->GetNumberOfRecompilations();
+}
+
+extern "C" void WaitForAdaptiveRecompilation(intptr_t adaptiveRunnerInt) {
+  auto adaptiveRunner = reinterpret_cast<TreeBeard::runtime::AdaptiveInferenceRunner*>(adaptiveRunnerInt);
+  adaptiveRunner->WaitForRecompilation();
+}
+
+extern "C" void DeleteAdaptiveInferenceRunner(intptr_t adaptiveRunnerInt) {
+  auto adaptiveRunner = reinterpret_cast<TreeBeard::runtime::AdaptiveInferenceRunner*>(adaptiveRunnerInt);
+  delete adaptiveRunner;
+}
+
 mlir::decisionforest::PredictionTransformation GetPredictionTransformation(const std::string& s)
 {
   if (s == "softmax") return mlir::decisionforest::PredictionTransformation::kSoftMax;
@@ -217,6 +378,22 @@ extern "C" int32_t IsPeeledCodeGenForProbabilityBasedTilingEnabled() {
   return mlir::decisionforest::PeeledCodeGenForProbabiltyBasedTiling;
 }
 
+extern "C" void SetEnableLeafDictionaryCompression(int32_t val) {
+  mlir::decisionforest::UseLeafDictionaryCompression = val;
+}
+
+extern "C" int32_t IsLeafDictionaryCompressionEnabled() {
+  return mlir::decisionforest::UseLeafDictionaryCompression;
+}
+
+extern "C" void SetEnableHotPathSparseLayout(int32_t val) {
+  mlir::decisionforest::UseHotPathSparseLayout = val;
+}
+
+extern "C" int32_t IsHotPathSparseLayoutEnabled() {
+  return mlir::decisionforest::UseHotPathSparseLayout;
+}
+
 // ===-------------------------------------------------------------=== //
 // Representation API
 // ===-------------------------------------------------------------=== //
@@ -342,6 +519,9 @@ void Schedule_Parallel(intptr_t schedPtr, intptr_t indexPtr);
 void Schedule_Unroll(intptr_t schedPtr, intptr_t indexVarPtr);
 void Schedule_PeelWalk(intptr_t schedPtr, intptr_t indexVarPtr, int32_t numberOfIterations);
 void Schedule_Cache(intptr_t schedPtr, intptr_t indexVarPtr);
+void Schedule_Prefetch(intptr_t schedPtr, intptr_t indexVarPtr, int32_t distance);
+void Schedule_EarlyExit(intptr_t schedPtr, intptr_t indexVarPtr, int32_t treeGroupSize, double probabilityThreshold);
+void Schedule_AnytimePrediction(intptr_t schedPtr, intptr_t indexVarPtr, bool reorderTreesByContributionVariance);
 intptr_t Schedule_GetRootIndex(intptr_t schedPtr);
 intptr_t Schedule_GetBatchIndex(intptr_t schedPtr);
 intptr_t Schedule_GetTreeIndex(intptr_t schedPtr);
@@ -437,6 +617,27 @@ void Schedule_Cache(intptr_t schedPtr, intptr_t indexVarPtr) {
   sched->Cache(*indexVar);
 }
 
+// Wrapper function for Schedule::Prefetch
+void Schedule_Prefetch(intptr_t schedPtr, intptr_t indexVarPtr, int32_t distance) {
+  Schedule* sched = reinterpret_cast<Schedule*>(schedPtr);
+  IndexVariable* indexVar = reinterpret_cast<IndexVariable*>(indexVarPtr);
+  sched->Prefetch(*indexVar, distance);
+}
+
+// Wrapper function for Schedule::EarlyExit
+void Schedule_EarlyExit(intptr_t schedPtr, intptr_t indexVarPtr, int32_t treeGroupSize, double probabilityThreshold) {
+  Schedule* sched = reinterpret_cast<Schedule*>(schedPtr);
+  IndexVariable* indexVar = reinterpret_cast<IndexVariable*>(indexVarPtr);
+  sched->EarlyExit(*indexVar, treeGroupSize, probabilityThreshold);
+}
+
+// Wrapper function for Schedule::AnytimePrediction
+void Schedule_AnytimePrediction(intptr_t schedPtr, intptr_t indexVarPtr, bool reorderTreesByContributionVariance) {
+  Schedule* sched = reinterpret_cast<Schedule*>(schedPtr);
+  IndexVariable* indexVar = reinterpret_cast<IndexVariable*>(indexVarPtr);
+  sched->AnytimePrediction(*indexVar, reorderTreesByContributionVariance);
+}
+
 // Wrapper function for Schedule::GetRootIndex
 intptr_t Schedule_GetRootIndex(intptr_t schedPtr) {
   Schedule* sched = reinterpret_cast<Schedule*>(schedPtr);
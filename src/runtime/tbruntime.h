@@ -9,6 +9,15 @@
 extern "C"
 {
     TREEBEARD_RUNTIME_EXPORT void RunInference(intptr_t inferenceRunnerInt, void *inputs, void *results);
+    TREEBEARD_RUNTIME_EXPORT void RunInferenceWithOutputMode(intptr_t inferenceRunnerInt, void *inputs, void *results, int32_t outputMode);
+    TREEBEARD_RUNTIME_EXPORT void RunInferenceOnMultipleBatchesWithOutputMode(intptr_t inferenceRunnerInt, void *inputs, void *results, int32_t numRows, int32_t outputMode);
+    TREEBEARD_RUNTIME_EXPORT int32_t GetNumberOfClasses(intptr_t inferenceRunnerInt);
+    TREEBEARD_RUNTIME_EXPORT void RunSingleRowInference(intptr_t inferenceRunnerInt, void *row, void *result);
+    TREEBEARD_RUNTIME_EXPORT int32_t GetModelReplicaMemoryUsage(int64_t *bytesPerNode, int32_t maxNodes);
+    TREEBEARD_RUNTIME_EXPORT int64_t RunAnytimeInference(intptr_t inferenceRunnerInt, void *inputs, void *margins, int64_t maxTrees, 
+                                                         int64_t timeBudgetNanoseconds, int64_t treeGroupSize);
+    TREEBEARD_RUNTIME_EXPORT void WriteLeafHitCountProfile(intptr_t inferenceRunnerInt, const char *statsCSVPath);
+    TREEBEARD_RUNTIME_EXPORT void ResetLeafHitCounts(intptr_t inferenceRunnerInt);
 
     TREEBEARD_RUNTIME_EXPORT void DeleteInferenceRunner(intptr_t inferenceRunnerInt);
     TREEBEARD_RUNTIME_EXPORT intptr_t CreateCompilerOptions();
@@ -30,6 +39,20 @@ extern "C"
     COMPILER_OPTION_SETTER_DECLARATION(statsProfileCSVPath,  const char*)
     COMPILER_OPTION_SETTER_DECLARATION(pipelineSize, int32_t)
     COMPILER_OPTION_SETTER_DECLARATION(numberOfCores, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(prefetchDistance, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(quantizeModel, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(simplifyForest, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(compactFeatures, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(parallelizeTrees, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(useWorkStealingRuntime, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(replicateModelPerNUMANode, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(modelHugePages, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(specializeObliviousTrees, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(instrumentLeafHitCounts, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(thresholdTypeIsBFloat16, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(fallbackTo32BitThresholds, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(useFastApproximateTransforms, int32_t)
+    COMPILER_OPTION_SETTER_DECLARATION(peelProbabilisticallyTiledWalks, int32_t)
 
 
     TREEBEARD_RUNTIME_EXPORT void Set_tilingType(intptr_t options, int32_t val);
@@ -37,9 +60,22 @@ extern "C"
     TREEBEARD_RUNTIME_EXPORT int32_t IsSparseRepresentationEnabled();
     TREEBEARD_RUNTIME_EXPORT void SetPeeledCodeGenForProbabilityBasedTiling(int32_t val);
     TREEBEARD_RUNTIME_EXPORT int32_t IsPeeledCodeGenForProbabilityBasedTilingEnabled();
+    TREEBEARD_RUNTIME_EXPORT void SetEnableLeafDictionaryCompression(int32_t val);
+    TREEBEARD_RUNTIME_EXPORT int32_t IsLeafDictionaryCompressionEnabled();
+    TREEBEARD_RUNTIME_EXPORT void SetEnableHotPathSparseLayout(int32_t val);
+    TREEBEARD_RUNTIME_EXPORT int32_t IsHotPathSparseLayoutEnabled();
 
     TREEBEARD_RUNTIME_EXPORT intptr_t CreateInferenceRunnerForONNXModel(const char*modelPath, intptr_t options);    
 
+    TREEBEARD_RUNTIME_EXPORT intptr_t CreateAdaptiveInferenceRunner(const char* modelPath, const char* forestCreatorType, intptr_t options,
+                                                                    int64_t samplingInterval, int64_t windowRows, double shiftThreshold, 
+                                                                    int32_t tilingType, int32_t peelTreeWalks);
+    TREEBEARD_RUNTIME_EXPORT void RunAdaptiveInference(intptr_t adaptiveRunnerInt, void *inputs, void *results);
+    TREEBEARD_RUNTIME_EXPORT int32_t GetAdaptiveInferenceRunnerBatchSize(intptr_t adaptiveRunnerInt);
+    TREEBEARD_RUNTIME_EXPORT int64_t GetNumberOfAdaptiveRecompilations(intptr_t adaptiveRunnerInt);
+    TREEBEARD_RUNTIME_EXPORT void WaitForAdaptiveRecompilation(intptr_t adaptiveRunnerInt);
+    TREEBEARD_RUNTIME_EXPORT void DeleteAdaptiveInferenceRunner(intptr_t adaptiveRunnerInt);
+
 }
 
 #endif // RUNTIME_H
\ No newline at end of file
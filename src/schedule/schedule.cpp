@@ -56,14 +56,16 @@ IndexVariable& Schedule::NewIndexVariable(const IndexVariable& indexVar) {
   return *indexVarPtr;
 }
 
-Schedule& Schedule::Tile(IndexVariable& index, IndexVariable& outer, IndexVariable& inner, int32_t tileSize) {
+Schedule& Schedule::Tile(IndexVariable& index, IndexVariable& outer, IndexVariable& inner, int32_t tileSize, bool allowPartialTiles) {
   auto sourceIndexRange = index.GetRange();
-  // Since we don't handle generation of code for partial tiles yet, asserting that there should be no partial tiles
-  assert (((sourceIndexRange.m_stop - sourceIndexRange.m_start) % tileSize) == 0);
+  // Code for partial tiles is only generated for tiles of the tree index
+  assert ((allowPartialTiles || ((sourceIndexRange.m_stop - sourceIndexRange.m_start) % tileSize) == 0) && "Partial tiles must be explicitly allowed");
+  assert ((!allowPartialTiles || &index == &m_treeIndex) && "Partial tiles are only supported on the tree index");
+  bool partialTiles = ((sourceIndexRange.m_stop - sourceIndexRange.m_start) % tileSize) != 0;
   // Don't allow tiling of strided index variables (But shouldn't be a big problem to support)
   assert (sourceIndexRange.m_step == 1);
   
-  auto tileModifierPtr = new TileIndexModifier(index, outer, inner, tileSize);
+  auto tileModifierPtr = new TileIndexModifier(index, outer, inner, tileSize, partialTiles);
   m_indexModifiers.push_back(tileModifierPtr);
 
   // There should be no derived indices of the current index
@@ -158,6 +160,11 @@ Schedule& Schedule::Split(IndexVariable& index, IndexVariable& first, IndexVaria
   first.m_peelWalk = second.m_peelWalk = index.m_peelWalk;
   first.m_iterationsToPeel = second.m_iterationsToPeel = index.m_iterationsToPeel;
   first.m_treeWalkUnrollFactor = second.m_treeWalkUnrollFactor = index.m_treeWalkUnrollFactor;
+  first.m_prefetchDistance = second.m_prefetchDistance = index.m_prefetchDistance;
+  first.m_earlyExitTreeGroupSize = second.m_earlyExitTreeGroupSize = index.m_earlyExitTreeGroupSize;
+  first.m_earlyExitProbabilityThreshold = second.m_earlyExitProbabilityThreshold = index.m_earlyExitProbabilityThreshold;
+  first.m_anytimePrediction = second.m_anytimePrediction = index.m_anytimePrediction;
+  first.m_reorderTreesByContributionVariance = second.m_reorderTreesByContributionVariance = index.m_reorderTreesByContributionVariance;
 
   // indexMap[&index] = std::make_pair(&first, &second);
 
@@ -242,6 +249,47 @@ Schedule& Schedule::Cache(IndexVariable& index) {
   return *this;
 }
 
+Schedule& Schedule::Prefetch(IndexVariable& index, int32_t distance) {
+  assert (index.m_containedLoops.size() == 0 && "Prefetch must be called on an innermost loop");
+  assert (distance > 0 && "Prefetch distance must be positive");
+  index.m_prefetchDistance = distance;
+  return *this;
+}
+
+// Stop walking the trees of a row once the trees evaluated so far decide its class (whether 
+// the probability is above probabilityThreshold) whatever the remaining trees return.
+Schedule& Schedule::EarlyExit(IndexVariable& index, int32_t treeGroupSize, double probabilityThreshold) {
+  assert (&index == &m_treeIndex && "Early exit must be called on the tree index");
+  assert (index.m_containedLoops.size() == 0 && "Early exit must be called on an innermost loop");
+  assert (!index.AnytimePrediction() && "Early exit can't be combined with anytime prediction");
+  assert (treeGroupSize > 0 && "Tree group size must be positive");
+  assert (probabilityThreshold > 0.0 && probabilityThreshold < 1.0);
+  index.m_earlyExitTreeGroupSize = treeGroupSize;
+  index.m_earlyExitProbabilityThreshold = probabilityThreshold;
+  return *this;
+}
+
+// Walk only the trees in the range set by the caller at runtime and return the margin of those trees
+// (no prediction transformation). If reorderTreesByContributionVariance is set, the trees are sorted 
+// so that the trees whose predictions vary the most on the profiled inputs come first.
+Schedule& Schedule::AnytimePrediction(IndexVariable& index, bool reorderTreesByContributionVariance) {
+  assert (&index == &m_treeIndex && "Anytime prediction must be called on the tree index");
+  assert (!index.EarlyExit() && "Anytime prediction can't be combined with early exit");
+  index.m_anytimePrediction = true;
+  index.m_reorderTreesByContributionVariance = reorderTreesByContributionVariance;
+  return *this;
+}
+
+// Called by transformations that change the number of trees in the forest. This needs to happen
+// before the tree index is transformed.
+void Schedule::SetForestSize(int32_t forestSize) {
+  assert (forestSize > 0);
+  assert (IsDefaultSchedule() && "The number of trees can only be changed before the schedule is modified");
+  assert (m_treeIndex.m_range.m_start == 0 && m_treeIndex.m_range.m_stop == m_forestSize && m_treeIndex.m_range.m_step == 1);
+  m_forestSize = forestSize;
+  m_treeIndex.m_range.m_stop = forestSize;
+}
+
 Schedule& Schedule::Pipeline(IndexVariable& index, int32_t stepSize) {
   assert (index.m_containedLoops.size() == 0 && "Pipeline must be called on an innermost loop");
   assert ((index.m_range.m_stop - index.m_range.m_start) >= stepSize && "Step size must be smaller than the range");
@@ -36,12 +36,16 @@ class TileIndexModifier : public IndexModifier {
   IndexVariable* m_outerIndex;
   IndexVariable* m_innerIndex;
   int32_t m_tileSize;
+  // The last tile is shorter when the tile size doesn't divide the range of the source index. The 
+  // inner loop of the last tile is then clamped to the end of the source range.
+  bool m_partialTiles;
 public:
-  TileIndexModifier(IndexVariable& source, IndexVariable& outer, IndexVariable& inner, int32_t tileSize)
-    : m_sourceIndex(&source), m_outerIndex(&outer), m_innerIndex(&inner), m_tileSize(tileSize) { }
+  TileIndexModifier(IndexVariable& source, IndexVariable& outer, IndexVariable& inner, int32_t tileSize, bool partialTiles)
+    : m_sourceIndex(&source), m_outerIndex(&outer), m_innerIndex(&inner), m_tileSize(tileSize), m_partialTiles(partialTiles) { }
   IndexVariable& OuterIndex() { return *m_outerIndex; }
   IndexVariable& InnerIndex() { return *m_innerIndex; }
   int32_t TileSize() { return m_tileSize; }
+  bool PartialTiles() { return m_partialTiles; }
   IndexVariable& SourceIndex() { return *m_sourceIndex; }
   void Validate() override;
   void Visit(IndexDerivationTreeVisitor& visitor) override;
@@ -118,6 +122,20 @@ protected:
   
   bool m_cache = false;
 
+  // Number of rows ahead of the current row to prefetch. Also enables 
+  // prefetching of the next tile in the tree walk. 
+  int32_t m_prefetchDistance = -1;
+
+  // Number of trees evaluated between checks of whether a row's class is already decided
+  // by the trees evaluated so far (early exit). Only valid on the tree index. 
+  int32_t m_earlyExitTreeGroupSize = -1;
+  double m_earlyExitProbabilityThreshold = 0.5;
+
+  // The range of trees walked is read from the module at the start of every call so that callers can
+  // evaluate a prefix of the forest (anytime prediction). Only valid on the tree index.
+  bool m_anytimePrediction = false;
+  bool m_reorderTreesByContributionVariance = false;
+
   // Index variables can only be constructed through the Schedule object
   IndexVariable(const std::string& name)
     :m_name(name), m_containingLoop(nullptr), m_parentModifier(nullptr), m_modifier(nullptr), m_treeWalkUnrollFactor(-1)
@@ -143,6 +161,16 @@ public:
   int32_t IterationsToPeel() const { return m_iterationsToPeel; }
 
   bool Cache() const { return m_cache; }
+
+  bool Prefetch() const { return m_prefetchDistance > 0; }
+  int32_t PrefetchDistance() const { return m_prefetchDistance; }
+
+  bool EarlyExit() const { return m_earlyExitTreeGroupSize > 0; }
+  int32_t EarlyExitTreeGroupSize() const { return m_earlyExitTreeGroupSize; }
+  double EarlyExitProbabilityThreshold() const { return m_earlyExitProbabilityThreshold; }
+
+  bool AnytimePrediction() const { return m_anytimePrediction; }
+  bool ReorderTreesByContributionVariance() const { return m_reorderTreesByContributionVariance; }
   
   void Visit(IndexDerivationTreeVisitor& visitor) override;
   void Validate() override;
@@ -184,7 +212,8 @@ public:
   IndexVariable& NewIndexVariable(const IndexVariable& indexVar);
 
   // Loop Modifiers
-  Schedule& Tile(IndexVariable& index, IndexVariable& outer, IndexVariable& inner, int32_t tileSize);
+  // Partial tiles are only supported on the tree index and if the inner loop isn't unrolled or pipelined
+  Schedule& Tile(IndexVariable& index, IndexVariable& outer, IndexVariable& inner, int32_t tileSize, bool allowPartialTiles=false);
   Schedule& Reorder(const std::vector<IndexVariable*>& indices);
   Schedule& Split(IndexVariable& index, IndexVariable& first, IndexVariable& second, 
                   int32_t splitIteration, std::map<IndexVariable*, std::pair<IndexVariable*, IndexVariable*>>& indexMap);
@@ -196,6 +225,9 @@ public:
   Schedule& Unroll(IndexVariable& index);
   Schedule& PeelWalk(IndexVariable& index, int32_t numberOfIterations);
   Schedule& Cache(IndexVariable& index);
+  Schedule& Prefetch(IndexVariable& index, int32_t distance);
+  Schedule& EarlyExit(IndexVariable& index, int32_t treeGroupSize, double probabilityThreshold=0.5);
+  Schedule& AnytimePrediction(IndexVariable& index, bool reorderTreesByContributionVariance=false);
 
   const IndexVariable* GetRootIndex() const { return &m_rootIndex; }
   IndexVariable& GetBatchIndex() { return m_batchIndex; }
@@ -204,6 +236,7 @@ public:
   
   int32_t GetBatchSize() const { return m_batchSize; }
   int32_t GetForestSize() const { return m_forestSize; }
+  void SetForestSize(int32_t forestSize);
 
   void WriteToDOTFile(const std::string& dotFile);
   bool IsDefaultSchedule();
@@ -240,6 +273,16 @@ void OneTreeAtATimePipelinedSchedule(mlir::decisionforest::Schedule* schedule);
 void OneTreeAtATimeUnrolledSchedule(mlir::decisionforest::Schedule* schedule);
 void UnrollTreeLoop(decisionforest::Schedule* schedule);
 
+template<int32_t PipelineSize, int32_t PrefetchDistance>
+void OneTreeAtATimePipelinedPrefetchSchedule(mlir::decisionforest::Schedule* schedule) {
+  auto& batchIndexVar = schedule->GetBatchIndex();
+  auto& treeIndexVar = schedule->GetTreeIndex();
+
+  schedule->Reorder(std::vector<mlir::decisionforest::IndexVariable*>{ &treeIndexVar, &batchIndexVar });
+  schedule->Pipeline(batchIndexVar, PipelineSize);
+  schedule->Prefetch(batchIndexVar, PrefetchDistance);
+}
+
 template<int32_t BatchTileSize, int32_t TreeTileSize>
 void TiledSchedule(mlir::decisionforest::Schedule* schedule) {
   auto& batchIndexVar = schedule->GetBatchIndex();
@@ -0,0 +1,58 @@
+#include <vector>
+#include <string>
+#include "TestUtilsCommon.h"
+#include "ForestTestUtils.h"
+#include "catboostparser.h"
+
+using namespace mlir;
+using namespace mlir::decisionforest;
+
+namespace TreeBeard
+{
+namespace test
+{
+
+// The expected outputs in the CSVs next to the models were computed with CatBoost's evaluation of 
+// oblivious trees (bit i of the leaf index is set if the feature of split i is greater than its border).
+// The rows include NaNs and values equal to the borders.
+static std::string GetCatBoostModelPath(const std::string& modelFileName) {
+  return GetTreeBeardRepoPath() + "/catboost_models/" + modelFileName;
+}
+
+static void WalkObliviousTreesLikeOtherTrees(TreeBeard::CompilerOptions& options) {
+  options.SetSpecializeObliviousTrees(false);
+}
+
+// Trees of different depths (including a tree without splits) where NaNs go left. 
+bool Test_CatBoost_Binary_ObliviousWalk(TestArgs_t& args) {
+  auto modelPath = GetCatBoostModelPath("binary_logloss.json");
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, float>(modelPath, 1, 1)));
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, float>(modelPath, 4, 1)));
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, float>(modelPath, 4, 1, WalkObliviousTreesLikeOtherTrees)));
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, float>(modelPath, 4, 4)));
+  return true;
+}
+
+// A multiclass model with a bias for each class where NaNs go right.
+bool Test_CatBoost_Multiclass_ObliviousWalk(TestArgs_t& args) {
+  auto modelPath = GetCatBoostModelPath("multiclass.json");
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, int8_t>(modelPath, 1, 1)));
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, int8_t>(modelPath, 4, 1)));
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, int8_t>(modelPath, 4, 1, WalkObliviousTreesLikeOtherTrees)));
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, int8_t>(modelPath, 4, 4)));
+  return true;
+}
+
+// The sparse representation doesn't store the leaves at known positions, so the levels of the oblivious
+// trees are walked one after the other instead of being compared all at once.
+bool Test_CatBoost_Multiclass_SparseObliviousWalk(TestArgs_t& args) {
+  decisionforest::UseSparseTreeRepresentation = true;
+  auto modelPath = GetCatBoostModelPath("multiclass.json");
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, int8_t>(modelPath, 1, 1)));
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, int8_t>(modelPath, 4, 1)));
+  Test_ASSERT((Test_ImportedModel<CatBoostJSONParser, int8_t>(modelPath, 4, 4)));
+  return true;
+}
+
+} // test
+} // TreeBeard
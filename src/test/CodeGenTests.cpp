@@ -1,3 +1,4 @@
+#include <cmath>
 #include <vector>
 #include <sstream>
 #include "Dialect.h"
@@ -1293,6 +1294,411 @@ bool Test_UniformTiling_BatchSize1_AllTypes(TestArgs_t& args, ForestConstructor_
   return true;
 }
 
+// Thresholds and leaves are stored in a 16-bit float type (HalfType is Float16 or BFloat16)
+// while the inputs and the result are floats. Rounding the thresholds of the test trees to 16 bits
+// does not change any decision for the test inputs, but the leaf values are rounded.
+template<typename HalfType>
+bool Test_HalfPrecisionThresholds_BatchSize1(TestArgs_t& args, ForestConstructor_t forestConstructor, int32_t tileSize) {
+  auto modelGlobalsJSONPath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(TreeBeard::test::GetGlobalJSONNameForTests());
+  auto serializer = decisionforest::ConstructModelSerializer(modelGlobalsJSONPath);
+
+  MLIRContext context;
+  TreeBeard::InitializeMLIRContext(context);
+
+  FixedTreeIRConstructor<HalfType, float, int32_t, int32_t, float> irGenerator(context, serializer, 1, forestConstructor);
+  irGenerator.ConstructForest();
+  auto module = irGenerator.GetEvaluationFunction();
+  decisionforest::DoUniformTiling(context, module, tileSize, 32, false);
+  decisionforest::LowerFromHighLevelToMidLevelIR(context, module);
+  auto representation = decisionforest::ConstructRepresentation();
+  decisionforest::LowerEnsembleToMemrefs(context,
+                                         module,
+                                         serializer,
+                                         representation);
+  decisionforest::ConvertNodeTypeToIndexType(context, module);
+  decisionforest::LowerToLLVM(context, module, representation);
+  decisionforest::InferenceRunner inferenceRunner(serializer, module, tileSize, 16, sizeof(int32_t)*8);
+  
+  // Half an ulp of the 16-bit type (10 mantissa bits for fp16, 7 for bf16)
+  const float leafTolerance = std::is_same<HalfType, TreeBeard::BFloat16>::value ? 1.0f/256 : 1.0f/2048;
+  auto inputData = GetBatchSize1Data();
+  for(auto& row : inputData) {
+    float result = -1;
+    std::vector<float> inputRow(row.begin(), row.end());
+    inferenceRunner.RunInference<float, float>(inputRow.data(), &result);
+    float expectedResult = irGenerator.GetForest().Predict(row);
+    Test_ASSERT(std::fabs(result - expectedResult) <= std::fabs(expectedResult) * leafTolerance);
+  }
+  return true;
+}
+
+bool Test_HalfPrecisionThresholds_Balanced_BatchSize1(TestArgs_t &args) {
+  Test_ASSERT(Test_HalfPrecisionThresholds_BatchSize1<TreeBeard::Float16>(args, AddBalancedTree<DoubleInt32Tile>, 1));
+  Test_ASSERT(Test_HalfPrecisionThresholds_BatchSize1<TreeBeard::Float16>(args, AddBalancedTree<DoubleInt32Tile>, 2));
+  Test_ASSERT(Test_HalfPrecisionThresholds_BatchSize1<TreeBeard::Float16>(args, AddBalancedTree<DoubleInt32Tile>, 4));
+  return true;
+}
+
+bool Test_BFloat16Thresholds_LeftHeavy_BatchSize1(TestArgs_t &args) {
+  Test_ASSERT(Test_HalfPrecisionThresholds_BatchSize1<TreeBeard::BFloat16>(args, AddLeftHeavyTree<DoubleInt32Tile>, 1));
+  Test_ASSERT(Test_HalfPrecisionThresholds_BatchSize1<TreeBeard::BFloat16>(args, AddLeftHeavyTree<DoubleInt32Tile>, 2));
+  Test_ASSERT(Test_HalfPrecisionThresholds_BatchSize1<TreeBeard::BFloat16>(args, AddLeftHeavyTree<DoubleInt32Tile>, 4));
+  return true;
+}
+
+// The thresholds 0.1 and 0.3 of features 1 and 4 of the balanced tree are rounded in 16 bits. Only these
+// features are binned and the inputs between the thresholds and their rounded values must go left.
+bool Test_HalfPrecisionThresholds_BinnedFeatures(TestArgs_t& args, int32_t tileSize) {
+  auto modelGlobalsJSONPath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(TreeBeard::test::GetGlobalJSONNameForTests());
+  auto serializer = decisionforest::ConstructModelSerializer(modelGlobalsJSONPath);
+
+  MLIRContext context;
+  TreeBeard::InitializeMLIRContext(context);
+
+  FixedTreeIRConstructor<TreeBeard::Float16, float, int32_t, int32_t, float> irGenerator(context, serializer, 1, AddBalancedTree<DoubleInt32Tile>);
+  irGenerator.ConstructForest();
+  decisionforest::DecisionForest originalForest = irGenerator.GetForest();
+  Test_ASSERT(irGenerator.CheckHalfPrecisionThresholds(false, true) == 2);
+  Test_ASSERT(irGenerator.GetForest().GetBinnedFeatures() == std::vector<int32_t>({1, 4}));
+  Test_ASSERT(!irGenerator.GetForest().IsQuantized());
+
+  auto module = irGenerator.GetEvaluationFunction();
+  decisionforest::DoUniformTiling(context, module, tileSize, 32, false);
+  decisionforest::LowerFromHighLevelToMidLevelIR(context, module);
+  auto representation = decisionforest::ConstructRepresentation();
+  decisionforest::LowerEnsembleToMemrefs(context, module, serializer, representation);
+  decisionforest::ConvertNodeTypeToIndexType(context, module);
+  decisionforest::LowerToLLVM(context, module, representation);
+  decisionforest::InferenceRunner inferenceRunner(serializer, module, tileSize, 16, sizeof(int32_t)*8);
+
+  const float leafTolerance = 1.0f/2048;
+  std::vector<std::vector<double>> inputData = {
+    { 0.0, 0.0999f, 0.4, 0.0, 0.0 },
+    { 0.0, 0.1f, 0.4, 0.0, 0.0 },
+    { 0.0, 0.0, 0.6, 0.0, 0.2999f },
+    { 0.0, 0.0, 0.6, 0.0, 0.3f },
+  };
+  for(auto& row : inputData) {
+    float result = -1;
+    std::vector<float> inputRow(row.begin(), row.end());
+    std::vector<double> roundedRow(inputRow.begin(), inputRow.end());
+    inferenceRunner.RunInference<float, float>(inputRow.data(), &result);
+    float expectedResult = originalForest.Predict(roundedRow);
+    Test_ASSERT(std::fabs(result - expectedResult) <= std::fabs(expectedResult) * leafTolerance);
+  }
+  return true;
+}
+
+bool Test_HalfPrecisionThresholds_BinnedFeatures_BatchSize1(TestArgs_t &args) {
+  Test_ASSERT(Test_HalfPrecisionThresholds_BinnedFeatures(args, 1));
+  Test_ASSERT(Test_HalfPrecisionThresholds_BinnedFeatures(args, 2));
+  Test_ASSERT(Test_HalfPrecisionThresholds_BinnedFeatures(args, 4));
+  return true;
+}
+
+// --------------------------------------------------------------------------
+// Forest Simplification Tests
+// --------------------------------------------------------------------------
+// Two copies of the balanced tree (merged into one tree), a single leaf tree (folded into the initial offset)
+// and a tree whose right subtree tests x2 < 0.3 although x2 >= 0.5 there (the left branch of that split is
+// unreachable) and then splits on x4 into two leaves with the same value.
+std::vector<DoubleInt32Tile> AddSimplifiableTrees(decisionforest::DecisionForest& forest) {
+  auto expectedArray = AddBalancedTree<DoubleInt32Tile>(forest);
+  AddBalancedTree<DoubleInt32Tile>(forest);
+  {
+    auto& constantTree = forest.NewTree();
+    constantTree.NewNode(0.4, -1);
+  }
+  {
+    auto& tree = forest.NewTree();
+    auto addChild = [&](int64_t parent, int64_t child, bool isLeft) {
+      tree.SetNodeParent(child, parent);
+      if (isLeft)
+        tree.SetNodeLeftChild(parent, child);
+      else
+        tree.SetNodeRightChild(parent, child);
+    };
+    auto rootNode = tree.NewNode(0.5, 2);
+    addChild(rootNode, tree.NewNode(0.6, -1), true);
+    auto rightNode = tree.NewNode(0.3, 2);
+    addChild(rootNode, rightNode, false);
+    addChild(rightNode, tree.NewNode(0.9, -1), true);
+    auto splitNode = tree.NewNode(0.2, 4);
+    addChild(rightNode, splitNode, false);
+    addChild(splitNode, tree.NewNode(0.35, -1), true);
+    addChild(splitNode, tree.NewNode(0.35, -1), false);
+  }
+  return expectedArray;
+}
+
+bool Test_ForestSimplification_HandcraftedForest(TestArgs_t &args) {
+  auto modelGlobalsJSONPath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(TreeBeard::test::GetGlobalJSONNameForTests());
+  auto serializer = decisionforest::ConstructModelSerializer(modelGlobalsJSONPath);
+
+  MLIRContext context;
+  TreeBeard::InitializeMLIRContext(context);
+
+  FixedTreeIRConstructor<double, double, int32_t, int32_t, double> irGenerator(context, serializer, 1, AddSimplifiableTrees);
+  irGenerator.ConstructForest();
+  auto module = irGenerator.GetEvaluationFunction();
+  decisionforest::DoForestSimplification(context, module);
+
+  int64_t numTrees = -1, numNodes = 0;
+  double initialOffset = -1.0;
+  module.walk([&](decisionforest::PredictForestOp predictForestOp) {
+    auto forest = predictForestOp.getEnsemble().GetDecisionForest();
+    numTrees = forest.NumTrees();
+    initialOffset = forest.GetInitialOffset();
+    for (auto& tree : forest.GetTrees())
+      numNodes += tree->GetNodes().size();
+  });
+  // The merged balanced tree (7 nodes) and the last tree reduced to a split with two leaves
+  Test_ASSERT(numTrees == 2);
+  Test_ASSERT(numNodes == 10);
+  Test_ASSERT(FPEqual(initialOffset, 0.4));
+  Test_ASSERT(irGenerator.GetSchedule()->GetForestSize() == 2);
+  // The forest of the IR constructor must not be modified
+  Test_ASSERT(irGenerator.GetForest().NumTrees() == 4);
+
+  int32_t tileSize = 2;
+  decisionforest::DoUniformTiling(context, module, tileSize, 32, false);
+  decisionforest::LowerFromHighLevelToMidLevelIR(context, module);
+  auto representation = decisionforest::ConstructRepresentation();
+  decisionforest::LowerEnsembleToMemrefs(context,
+                                         module,
+                                         serializer,
+                                         representation);
+  decisionforest::ConvertNodeTypeToIndexType(context, module);
+  decisionforest::LowerToLLVM(context, module, representation);
+  decisionforest::InferenceRunner inferenceRunner(serializer, module, tileSize, sizeof(double)*8, sizeof(int32_t)*8);
+
+  auto inputData = GetBatchSize1Data();
+  inputData.push_back({0.05, 0.2, 0.7, 0.3, 0.1});
+  inputData.push_back({0.1, 0.05, 0.2, 0.3, 0.3});
+  for(auto& row : inputData) {
+    double result = -1;
+    inferenceRunner.RunInference<double, double>(row.data(), &result);
+    double expectedResult = irGenerator.GetForest().Predict(row);
+    Test_ASSERT(FPEqual(result, expectedResult));
+  }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+// Random Forest Reduction Tests
+// --------------------------------------------------------------------------
+// Adds a tree with a single split on featureIndex to the forest
+std::vector<DoubleInt32Tile> AddStump(decisionforest::DecisionForest& forest, double threshold, int32_t featureIndex, 
+                                      double leftValue, double rightValue, int32_t classId=0) {
+  auto& tree = forest.NewTree();
+  tree.SetClassId(classId);
+  auto rootNode = tree.NewNode(threshold, featureIndex);
+  auto leftChild = tree.NewNode(leftValue, -1);
+  tree.SetNodeParent(leftChild, rootNode);
+  tree.SetNodeLeftChild(rootNode, leftChild);
+  auto rightChild = tree.NewNode(rightValue, -1);
+  tree.SetNodeParent(rightChild, rootNode);
+  tree.SetNodeRightChild(rootNode, rightChild);
+  return std::vector<DoubleInt32Tile>{ {threshold, featureIndex}, {leftValue, -1}, {rightValue, -1} };
+}
+
+// A random forest regressor. The prediction is the initial offset plus the average of the trees.
+std::vector<DoubleInt32Tile> AddAveragedRegressorTrees(decisionforest::DecisionForest& forest) {
+  forest.SetReductionType(decisionforest::ReductionType::kAverage);
+  forest.SetInitialOffset(0.5);
+  auto expectedArray = AddRightAndLeftHeavyTrees<DoubleInt32Tile>(forest);
+  auto balancedTree = AddBalancedTree<DoubleInt32Tile>(forest);
+  expectedArray.insert(expectedArray.end(), balancedTree.begin(), balancedTree.end());
+  auto stump = AddStump(forest, 0.15, 0, 1.0, -1.0);
+  expectedArray.insert(expectedArray.end(), stump.begin(), stump.end());
+  return expectedArray;
+}
+
+// A random forest classifier that averages class probabilities. Classes have different numbers of trees.
+std::vector<DoubleInt32Tile> AddAveragedClassifierTrees(decisionforest::DecisionForest& forest) {
+  forest.SetNumClasses(3);
+  forest.SetReductionType(decisionforest::ReductionType::kAverage);
+  std::vector<DoubleInt32Tile> expectedArray;
+  for (auto& stump : { AddStump(forest, 0.5, 2, 0.9, 0.1, 0), AddStump(forest, 0.1, 0, 0.2, 0.6, 1), 
+                       AddStump(forest, 0.28, 4, 0.7, 0.2, 1), AddStump(forest, 0.45, 2, 0.1, 0.5, 2), 
+                       AddStump(forest, 0.15, 1, 0.3, 0.4, 0) })
+    expectedArray.insert(expectedArray.end(), stump.begin(), stump.end());
+  return expectedArray;
+}
+
+// A random forest classifier with fully grown trees. Every tree predicts the class it votes for.
+std::vector<DoubleInt32Tile> AddVotingClassifierTrees(decisionforest::DecisionForest& forest) {
+  forest.SetNumClasses(3);
+  forest.SetReductionType(decisionforest::ReductionType::kVoting);
+  std::vector<DoubleInt32Tile> expectedArray;
+  for (auto& stump : { AddStump(forest, 0.5, 2, 0, 1), AddStump(forest, 0.1, 0, 2, 1), AddStump(forest, 0.28, 4, 1, 2),
+                       AddStump(forest, 0.45, 2, 2, 0), AddStump(forest, 0.15, 1, 2, 0) })
+    expectedArray.insert(expectedArray.end(), stump.begin(), stump.end());
+  return expectedArray;
+}
+
+// A boosted classifier whose trees aren't grouped by class. The prediction lowering reorders the trees by class.
+std::vector<DoubleInt32Tile> AddInterleavedBoostedClassifierTrees(decisionforest::DecisionForest& forest) {
+  forest.SetNumClasses(3);
+  forest.SetReductionType(decisionforest::ReductionType::kAdd);
+  std::vector<DoubleInt32Tile> expectedArray;
+  for (auto& stump : { AddStump(forest, 0.5, 2, 0.4, -0.2, 2), AddStump(forest, 0.1, 0, -0.3, 0.6, 0), 
+                       AddStump(forest, 0.28, 4, 0.7, 0.2, 1), AddStump(forest, 0.45, 2, -0.1, 0.5, 0), 
+                       AddStump(forest, 0.15, 1, 0.3, -0.4, 2), AddStump(forest, 0.35, 3, 0.2, 0.1, 1),
+                       AddStump(forest, 0.2, 0, -0.5, 0.3, 2) })
+    expectedArray.insert(expectedArray.end(), stump.begin(), stump.end());
+  return expectedArray;
+}
+
+template<typename ReturnType>
+bool Test_RandomForest_HandcraftedForest(TestArgs_t &args, ForestConstructor_t forestConstructor, int32_t batchSize, 
+                                         int32_t tileSize, ScheduleManipulator_t scheduleManipulator=nullptr) {
+  auto modelGlobalsJSONPath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(TreeBeard::test::GetGlobalJSONNameForTests());
+  auto serializer = decisionforest::ConstructModelSerializer(modelGlobalsJSONPath);
+
+  MLIRContext context;
+  TreeBeard::InitializeMLIRContext(context);
+
+  FixedTreeIRConstructor<double, ReturnType, int32_t, int32_t, double> irGenerator(context, serializer, batchSize, forestConstructor);
+  irGenerator.ConstructForest();
+  auto module = irGenerator.GetEvaluationFunction();
+  if (scheduleManipulator)
+    scheduleManipulator(irGenerator.GetSchedule());
+  decisionforest::DoUniformTiling(context, module, tileSize, 32, false);
+  decisionforest::LowerFromHighLevelToMidLevelIR(context, module);
+  auto representation = decisionforest::ConstructRepresentation();
+  decisionforest::LowerEnsembleToMemrefs(context,
+                                         module,
+                                         serializer,
+                                         representation);
+  decisionforest::ConvertNodeTypeToIndexType(context, module);
+  decisionforest::LowerToLLVM(context, module, representation);
+  decisionforest::InferenceRunner inferenceRunner(serializer, module, tileSize, sizeof(double)*8, sizeof(int32_t)*8);
+
+  std::vector<std::vector<double>> rows = GetBatchSize1Data();
+  rows.push_back({0.05, 0.2, 0.7, 0.3, 0.1});
+  rows.push_back({0.1, 0.05, 0.2, 0.3, 0.3});
+  rows.push_back({0.2, 0.3, 0.45, 0.1, 0.27});
+  for (size_t i=0 ; i+batchSize<=rows.size() ; i+=batchSize) {
+    std::vector<double> batch;
+    for (int32_t j=0 ; j<batchSize ; ++j)
+      batch.insert(batch.end(), rows[i+j].begin(), rows[i+j].end());
+    std::vector<ReturnType> result(batchSize, -1);
+    inferenceRunner.RunInference<double, ReturnType>(batch.data(), result.data());
+    for (int32_t j=0 ; j<batchSize ; ++j) {
+      ReturnType expectedResult = static_cast<ReturnType>(irGenerator.GetForest().Predict(rows[i+j]));
+      Test_ASSERT(FPEqual(result[j], expectedResult));
+    }
+  }
+  return true;
+}
+
+bool Test_RandomForest_Averaging_HandcraftedForest(TestArgs_t &args) {
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<double>(args, AddAveragedRegressorTrees, 1, 1));
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<double>(args, AddAveragedRegressorTrees, 2, 2));
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<double>(args, AddAveragedRegressorTrees, 2, 2, OneTreeAtATimeSchedule));
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<int8_t>(args, AddAveragedClassifierTrees, 1, 1));
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<int8_t>(args, AddAveragedClassifierTrees, 3, 2));
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<int8_t>(args, AddAveragedClassifierTrees, 3, 2, OneTreeAtATimeSchedule));
+  return true;
+}
+
+bool Test_RandomForest_Voting_HandcraftedForest(TestArgs_t &args) {
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<int8_t>(args, AddVotingClassifierTrees, 1, 1));
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<int8_t>(args, AddVotingClassifierTrees, 2, 2));
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<int8_t>(args, AddVotingClassifierTrees, 3, 2, OneTreeAtATimeSchedule));
+  return true;
+}
+
+bool Test_MultiClass_InterleavedClasses_HandcraftedForest(TestArgs_t &args) {
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<int8_t>(args, AddInterleavedBoostedClassifierTrees, 1, 1));
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<int8_t>(args, AddInterleavedBoostedClassifierTrees, 3, 2));
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<int8_t>(args, AddInterleavedBoostedClassifierTrees, 2, 4));
+  Test_ASSERT(Test_RandomForest_HandcraftedForest<int8_t>(args, AddInterleavedBoostedClassifierTrees, 3, 2, OneTreeAtATimeSchedule));
+  return true;
+}
+
+// --------------------------------------------------------------------------
+// Fast Approximate Transform Tests
+// --------------------------------------------------------------------------
+// A chain of splits on x0 whose k-th left leaf is reached by x0 = k. The leaf values cover the range of
+// margins the approximate sigmoid has to be accurate over, including the saturated ends.
+std::vector<DoubleInt32Tile> AddSigmoidMarginChainTree(decisionforest::DecisionForest& forest) {
+  const int32_t numLeaves = 33;
+  auto leafValue = [](int32_t k) { return -20.0 + 1.25 * k; };
+  std::vector<DoubleInt32Tile> expectedArray;
+  auto& tree = forest.NewTree();
+  auto parentNode = tree.NewNode(0.5, 0);
+  expectedArray.push_back({0.5, 0});
+  for (int32_t k=0 ; k<numLeaves-1 ; ++k) {
+    auto leftChild = tree.NewNode(leafValue(k), -1);
+    tree.SetNodeParent(leftChild, parentNode);
+    tree.SetNodeLeftChild(parentNode, leftChild);
+    auto rightChild = k==numLeaves-2 ? tree.NewNode(leafValue(k+1), -1) : tree.NewNode(k + 1.5, 0);
+    tree.SetNodeParent(rightChild, parentNode);
+    tree.SetNodeRightChild(parentNode, rightChild);
+    parentNode = rightChild;
+    expectedArray.push_back({k + 1.5, 0});
+  }
+  return expectedArray;
+}
+
+// Compares the sigmoid computed with the polynomial exp with std::exp. The default schedule applies it as the
+// predictions are stored, one tree at a time applies it to vectors of predictions (and a batch size of 5 also
+// runs the scalar remainder loop).
+template<typename FPType>
+bool Test_FastApproximateSigmoid_Accuracy(TestArgs_t &args, int32_t batchSize, ScheduleManipulator_t scheduleManipulator, double relativeTolerance) {
+  auto modelGlobalsJSONPath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(TreeBeard::test::GetGlobalJSONNameForTests());
+  auto serializer = decisionforest::ConstructModelSerializer(modelGlobalsJSONPath);
+
+  MLIRContext context;
+  TreeBeard::InitializeMLIRContext(context);
+
+  FixedTreeIRConstructor<FPType, FPType, int32_t, int32_t, FPType> irGenerator(context, serializer, batchSize, AddSigmoidMarginChainTree);
+  irGenerator.ConstructForest();
+  irGenerator.GetForest().SetPredictionTransformation(decisionforest::PredictionTransformation::kSigmoid);
+  auto module = irGenerator.GetEvaluationFunction();
+  if (scheduleManipulator)
+    scheduleManipulator(irGenerator.GetSchedule());
+  decisionforest::DoUniformTiling(context, module, 1, 32, false);
+  decisionforest::LowerFromHighLevelToMidLevelIR(context, module, false, true);
+  auto representation = decisionforest::ConstructRepresentation();
+  decisionforest::LowerEnsembleToMemrefs(context,
+                                         module,
+                                         serializer,
+                                         representation);
+  decisionforest::ConvertNodeTypeToIndexType(context, module);
+  decisionforest::LowerToLLVM(context, module, representation);
+  decisionforest::InferenceRunner inferenceRunner(serializer, module, 1, sizeof(FPType)*8, sizeof(int32_t)*8);
+
+  const int32_t numRows = 40;
+  for (int32_t i=0 ; i+batchSize<=numRows ; i+=batchSize) {
+    std::vector<FPType> batch;
+    for (int32_t j=0 ; j<batchSize ; ++j)
+      batch.push_back(static_cast<FPType>(i + j));
+    std::vector<FPType> result(batchSize, -1);
+    inferenceRunner.RunInference<FPType, FPType>(batch.data(), result.data());
+    for (int32_t j=0 ; j<batchSize ; ++j) {
+      std::vector<double> row = { static_cast<double>(i + j) };
+      double expectedResult = irGenerator.GetForest().Predict(row);
+      Test_ASSERT(std::abs(result[j] - expectedResult) <= relativeTolerance * expectedResult);
+    }
+  }
+  return true;
+}
+
+bool Test_FastApproximateSigmoid_Accuracy(TestArgs_t &args) {
+  for (auto batchSize : {1, 8}) {
+    Test_ASSERT(Test_FastApproximateSigmoid_Accuracy<double>(args, batchSize, nullptr, 1e-13));
+    Test_ASSERT(Test_FastApproximateSigmoid_Accuracy<float>(args, batchSize, nullptr, 1e-6));
+  }
+  for (auto batchSize : {8, 5}) {
+    Test_ASSERT(Test_FastApproximateSigmoid_Accuracy<double>(args, batchSize, OneTreeAtATimeSchedule, 1e-13));
+    Test_ASSERT(Test_FastApproximateSigmoid_Accuracy<float>(args, batchSize, OneTreeAtATimeSchedule, 1e-6));
+  }
+  return true;
+}
+
 bool Test_UniformTiling_LeftHeavy_BatchSize1(TestArgs_t &args) {
   return Test_UniformTiling_BatchSize1_AllTypes(args, AddLeftHeavyTree<DoubleInt32Tile>, 32);
 }
@@ -2,6 +2,11 @@
 #define _FORESTTESTUTILS_H_
 
 #include "forestcreator.h"
+#include "TreebeardContext.h"
+#include "CompileUtils.h"
+#include "ModelSerializers.h"
+#include "Representations.h"
+#include "TestUtilsCommon.h"
 using namespace mlir;
 
 // Some utlities that are used by the tests
@@ -259,6 +264,32 @@ namespace test
 std::vector<std::vector<double>> GetBatchSize1Data();
 std::vector<std::vector<double>> GetBatchSize2Data();
 
+// Compiles a model with the forest creator for its format and checks the predictions against the CSV next to it.
+// The thresholds and inputs are floats and the trees are tiled uniformly unless the options modifier says otherwise.
+template<typename ForestCreatorType, typename ResultType>
+bool Test_ImportedModel(const std::string& modelPath, int32_t batchSize, int32_t tileSize, 
+                        CompilerOptionsModifier_t optionsModifier=nullptr) {
+  using FloatType = float;
+  using FeatureIndexType = int32_t;
+  using NodeIndexType = int32_t;
+  auto csvPath = modelPath + ".csv";
+  auto modelGlobalsJSONPath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(modelPath);
+
+  TreeBeard::CompilerOptions options(sizeof(FloatType)*8, sizeof(ResultType)*8, IsFloatType(ResultType()), sizeof(FeatureIndexType)*8,
+                                     sizeof(NodeIndexType)*8, sizeof(FloatType)*8, batchSize, tileSize, 32, 32,
+                                     TreeBeard::TilingType::kUniform, false, false, nullptr);
+  if (optionsModifier)
+    optionsModifier(options);
+  TreeBeard::TreebeardContext tbContext(modelPath, modelGlobalsJSONPath, options,
+                                        mlir::decisionforest::ConstructRepresentation(),
+                                        mlir::decisionforest::ConstructModelSerializer(modelGlobalsJSONPath));
+  ForestCreatorType forestCreator(tbContext);
+  auto module = TreeBeard::ConstructLLVMDialectModuleFromForestCreator(tbContext, forestCreator);
+
+  mlir::decisionforest::InferenceRunner inferenceRunner(tbContext.serializer, module, tileSize, sizeof(FloatType)*8, sizeof(FeatureIndexType)*8);
+  return ValidateModuleOutputAgainstCSVdata<FloatType, ResultType>(inferenceRunner, csvPath, batchSize);
+}
+
 } // namespace test
 } // namespace Treebeard
 
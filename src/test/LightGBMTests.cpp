@@ -0,0 +1,40 @@
+#include <vector>
+#include <string>
+#include "TestUtilsCommon.h"
+#include "ForestTestUtils.h"
+#include "lightgbmparser.h"
+
+using namespace mlir;
+using namespace mlir::decisionforest;
+
+namespace TreeBeard
+{
+namespace test
+{
+
+// The expected outputs in the CSVs next to the models were computed with LightGBM's Booster.predict. 
+// The rows include NaNs, zeros and values outside the categories.
+static std::string GetLightGBMModelPath(const std::string& modelFileName) {
+  return GetTreeBeardRepoPath() + "/lightgbm_models/" + modelFileName;
+}
+
+// Splits with default-left NaNs, zeros as missing values and no missing values.
+bool Test_LightGBM_MissingValues_Binary(TestArgs_t& args) {
+  auto modelPath = GetLightGBMModelPath("missing_values_binary.txt");
+  Test_ASSERT((Test_ImportedModel<LightGBMTextParser, float>(modelPath, 1, 1)));
+  Test_ASSERT((Test_ImportedModel<LightGBMTextParser, float>(modelPath, 4, 1)));
+  Test_ASSERT((Test_ImportedModel<LightGBMTextParser, float>(modelPath, 4, 4)));
+  return true;
+}
+
+// Categorical splits in a multiclass model where NaNs go left at most splits.
+bool Test_LightGBM_Categorical_Multiclass(TestArgs_t& args) {
+  auto modelPath = GetLightGBMModelPath("categorical_multiclass.txt");
+  Test_ASSERT((Test_ImportedModel<LightGBMTextParser, int8_t>(modelPath, 1, 1)));
+  Test_ASSERT((Test_ImportedModel<LightGBMTextParser, int8_t>(modelPath, 4, 1)));
+  Test_ASSERT((Test_ImportedModel<LightGBMTextParser, int8_t>(modelPath, 4, 4)));
+  return true;
+}
+
+} // test
+} // TreeBeard
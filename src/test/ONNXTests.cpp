@@ -61,5 +61,63 @@ namespace test
             &options);
         return ValidateModuleOutputAgainstCSVdata<float, float>(*inferenceRunner, csvPath, 1024);
     }
+
+    // Random forest classifiers exported by skl2onnx store the class probabilities of every leaf
+    // (class_ids, class_nodeids, class_treeids and class_weights). Forests whose leaves each predict 
+    // one class are compiled as voting forests, others are split into a tree per class.
+    bool Test_ONNX_RandomForestClassifier(TestArgs_t &args, const std::string& modelName, int32_t batchSize,
+                                          ScheduleManipulator_t scheduleManipulatorFunc, bool expectVoting)
+    {
+        auto repoPath = GetTreeBeardRepoPath();
+        auto modelPath = repoPath + "/onnx_models/" + modelName;
+        auto csvPath = modelPath + ".csv";
+        const int32_t numTrees = 15, numClasses = 3;
+
+        ScheduleManipulationFunctionWrapper scheduleManipulator(scheduleManipulatorFunc);
+        TreeBeard::CompilerOptions options;
+        options.tileSize = 1;
+        options.thresholdTypeWidth = 32;
+        options.featureIndexTypeWidth = 32;
+        options.inputElementTypeWidth = 32;
+        options.batchSize = batchSize;
+        options.returnTypeWidth = 32;
+        options.numberOfFeatures = 5;
+        options.scheduleManipulator = scheduleManipulatorFunc ? &scheduleManipulator : nullptr;
+
+        auto modelGlobalsJSONPath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(modelPath);
+        TreeBeard::TreebeardContext tbContext(modelPath, modelGlobalsJSONPath, options,
+                                              mlir::decisionforest::ConstructRepresentation(),
+                                              mlir::decisionforest::ConstructModelSerializer(modelGlobalsJSONPath),
+                                              nullptr);
+        ONNXFileParser<float> onnxModelParser(tbContext);
+        auto module = TreeBeard::ConstructLLVMDialectModuleFromForestCreator(tbContext, onnxModelParser);
+
+        auto* forest = onnxModelParser.GetForest();
+        Test_ASSERT(forest->GetReductionType() == (expectVoting ? ReductionType::kVoting : ReductionType::kAdd));
+        Test_ASSERT(forest->NumTrees() == static_cast<size_t>(expectVoting ? numTrees : numTrees * numClasses));
+
+        decisionforest::InferenceRunner inferenceRunner(tbContext.serializer, module, options.tileSize,
+                                                        options.thresholdTypeWidth, options.featureIndexTypeWidth);
+        return ValidateModuleOutputAgainstCSVdata<float, float>(inferenceRunner, csvPath, batchSize);
+    }
+
+    bool Test_ONNX_RandomForest_Voting(TestArgs_t &args)
+    {
+        // Batches of 12 rows count the votes of 8 rows at a time and of the last 4 rows one at a time
+        Test_ASSERT(Test_ONNX_RandomForestClassifier(args, "rf_voting_classifier.onnx", 1, nullptr, true));
+        Test_ASSERT(Test_ONNX_RandomForestClassifier(args, "rf_voting_classifier.onnx", 8, nullptr, true));
+        Test_ASSERT(Test_ONNX_RandomForestClassifier(args, "rf_voting_classifier.onnx", 12, nullptr, true));
+        Test_ASSERT(Test_ONNX_RandomForestClassifier(args, "rf_voting_classifier.onnx", 8, OneTreeAtATimeSchedule, true));
+        Test_ASSERT(Test_ONNX_RandomForestClassifier(args, "rf_voting_classifier.onnx", 8, OneTreeAtATimePipelinedSchedule, true));
+        return true;
+    }
+
+    bool Test_ONNX_RandomForest_ClassProbabilities(TestArgs_t &args)
+    {
+        Test_ASSERT(Test_ONNX_RandomForestClassifier(args, "rf_classifier.onnx", 1, nullptr, false));
+        Test_ASSERT(Test_ONNX_RandomForestClassifier(args, "rf_classifier.onnx", 8, nullptr, false));
+        Test_ASSERT(Test_ONNX_RandomForestClassifier(args, "rf_classifier.onnx", 8, OneTreeAtATimeSchedule, false));
+        return true;
+    }
 }
 }
@@ -1,5 +1,7 @@
 #include <vector>
 #include <sstream>
+#include <memory>
+#include <filesystem>
 #include "Dialect.h"
 #include "TestUtilsCommon.h"
 
@@ -22,6 +24,7 @@
 #include "CompileUtils.h"
 #include "StatsUtils.h"
 #include "ModelSerializers.h"
+#include "AdaptiveInferenceRunner.h"
 
 using namespace mlir;
 
@@ -138,5 +141,183 @@ bool Test_YearStatGenerationAndReading(TestArgs_t &args) {
 }
 
 
+// Compiles the model with leaf hit counters, predicts the input and checks that the profile written by the inference 
+// runner matches the counts of the interpreter. The profile is then used to compile the model with probability based tiling.
+// The trees of multi-class models are reordered by class, and split across cores if treeParallelCores is set, when the 
+// instrumented model is compiled. The profile must still list the trees in the order of the model.
+template<typename InstrumentedResultType=double, typename ResultType=float>
+bool Test_XGBoostModel_InstrumentedProfile(const std::string& modelJSON, const std::string& inputCSV, const std::string& statsCSV,
+                                           int32_t treeParallelCores=-1) {
+  using FeatureIndexType = int32_t;
+  using NodeIndexType = int32_t;
+  const int32_t batchSize = 4;
+  auto modelGlobalsJSONPath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(modelJSON);
+  TestCSVReader csvReader(inputCSV);
+  // Only complete batches are predicted by the compiled model
+  size_t numRows = (csvReader.NumberOfRows()/batchSize) * batchSize;
+  {
+    // Double precision thresholds and inputs so that the compiled model takes the same paths as the interpreter
+    TreeBeard::CompilerOptions options(sizeof(double)*8, sizeof(double)*8, true, sizeof(FeatureIndexType)*8, sizeof(NodeIndexType)*8,
+                                       sizeof(double)*8, batchSize, 1, 16, 16, TreeBeard::TilingType::kUniform, false, false, nullptr);
+    options.SetInstrumentLeafHitCounts(true);
+    if (treeParallelCores != -1) {
+      options.numberOfCores = treeParallelCores;
+      options.SetParallelizeTrees(true);
+    }
+    TreeBeard::TreebeardContext tbContext(modelJSON, modelGlobalsJSONPath, options, 
+                                          mlir::decisionforest::ConstructRepresentation(),
+                                          mlir::decisionforest::ConstructModelSerializer(modelGlobalsJSONPath),
+                                          nullptr);
+    auto module = TreeBeard::ConstructLLVMDialectModuleFromXGBoostJSON<double, InstrumentedResultType, FeatureIndexType, NodeIndexType>(tbContext);
+    decisionforest::InferenceRunner inferenceRunner(tbContext.serializer, module, 1, sizeof(double)*8, sizeof(FeatureIndexType)*8);
+    for (size_t i=0 ; i<numRows ; i += batchSize) {
+      std::vector<double> batch;
+      std::vector<InstrumentedResultType> result(batchSize);
+      for (int32_t j=0 ; j<batchSize ; ++j) {
+        auto row = csvReader.GetRowOfType<double>(i + j);
+        row.pop_back();
+        batch.insert(batch.end(), row.begin(), row.end());
+      }
+      inferenceRunner.RunInference<double, InstrumentedResultType>(batch.data(), result.data());
+    }
+    inferenceRunner.WriteLeafHitCountProfile(statsCSV);
+  }
+
+  mlir::MLIRContext context;
+  TreeBeard::XGBoostJSONParser<> xgBoostParser(context, modelJSON, decisionforest::ConstructModelSerializer(""), 1);
+  xgBoostParser.ConstructForest();
+  auto decisionForest = xgBoostParser.GetForest();
+  TreeBeard::Profile::ReadProbabilityProfile(*decisionForest, statsCSV);
+
+  TreeBeard::XGBoostJSONParser<> interpreterParser(context, modelJSON, decisionforest::ConstructModelSerializer(""), 1);
+  interpreterParser.ConstructForest();
+  auto computedForest = interpreterParser.GetForest();
+  for (size_t i=0 ; i<numRows ; ++i) {
+    auto row = csvReader.GetRowOfType<double>(i);
+    row.pop_back();
+    computedForest->Predict(row);
+  }
+  for (size_t i=0 ; i<decisionForest->NumTrees() ; ++i) {
+    auto& nodes1 = decisionForest->GetTree(i).GetNodes();
+    auto& nodes2 = computedForest->GetTree(i).GetNodes();
+    Test_ASSERT(nodes1.size() == nodes2.size());
+    for (size_t j=0 ; j<nodes1.size() ; ++j) {
+      Test_ASSERT(nodes1.at(j).hitCount == nodes2.at(j).hitCount);
+      Test_ASSERT(nodes1.at(j).depth == nodes2.at(j).depth);
+    }
+  }
+
+  using FloatType = float;
+  const int32_t tileSize = 4;
+  TreeBeard::CompilerOptions options(sizeof(FloatType)*8, sizeof(FloatType)*8, true, sizeof(FeatureIndexType)*8, sizeof(NodeIndexType)*8,
+                                     sizeof(FloatType)*8, batchSize, tileSize, 16, 16, TreeBeard::TilingType::kProbabilistic, false, false, nullptr);
+  options.statsProfileCSVPath = statsCSV;
+  TreeBeard::TreebeardContext tbContext(modelJSON, modelGlobalsJSONPath, options, 
+                                        mlir::decisionforest::ConstructRepresentation(),
+                                        mlir::decisionforest::ConstructModelSerializer(modelGlobalsJSONPath),
+                                        nullptr);
+  auto module = TreeBeard::ConstructLLVMDialectModuleFromXGBoostJSON<FloatType, ResultType, FeatureIndexType, NodeIndexType>(tbContext);
+  decisionforest::InferenceRunner inferenceRunner(tbContext.serializer, module, tileSize, sizeof(FloatType)*8, sizeof(FeatureIndexType)*8);
+  return ValidateModuleOutputAgainstCSVdata<FloatType, ResultType>(inferenceRunner, inputCSV, batchSize);
+}
+
+bool Test_AirlineInstrumentedProfile(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto testModelsDir = repoPath + "/xgb_models";
+  auto modelJSONPath = testModelsDir + "/airline_xgb_model_save.json";
+  auto csvPath = modelJSONPath  + ".test.sampled.csv";
+  auto statsCSVPath = modelJSONPath  + ".test.sampled.instrumented.stats.csv";
+  Test_ASSERT(Test_XGBoostModel_InstrumentedProfile(modelJSONPath, csvPath, statsCSVPath));
+  // The trees are split into 3 cost balanced chunks
+  Test_ASSERT(Test_XGBoostModel_InstrumentedProfile(modelJSONPath, csvPath, statsCSVPath, 3));
+  return true;
+}
+
+bool Test_CovtypeInstrumentedProfile(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto testModelsDir = repoPath + "/xgb_models";
+  auto modelJSONPath = testModelsDir + "/covtype_xgb_model_save.json";
+  auto csvPath = modelJSONPath  + ".test.sampled.csv";
+  auto statsCSVPath = modelJSONPath  + ".test.sampled.instrumented.stats.csv";
+  return Test_XGBoostModel_InstrumentedProfile<int8_t, int8_t>(modelJSONPath, csvPath, statsCSVPath);
+}
+
+bool Test_HiggsInstrumentedProfile(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto testModelsDir = repoPath + "/xgb_models";
+  auto modelJSONPath = testModelsDir + "/higgs_xgb_model_save.json";
+  auto csvPath = modelJSONPath  + ".test.sampled.csv";
+  auto statsCSVPath = modelJSONPath  + ".test.sampled.instrumented.stats.csv";
+  return Test_XGBoostModel_InstrumentedProfile(modelJSONPath, csvPath, statsCSVPath);
+}
+
+int32_t CountFilesWithSuffix(const std::filesystem::path& directory, const std::string& suffix) {
+  int32_t numFiles = 0;
+  for (auto& entry : std::filesystem::directory_iterator(directory)) {
+    auto fileName = entry.path().filename().string();
+    if (fileName.size() >= suffix.size() && fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix) == 0)
+      ++numFiles;
+  }
+  return numFiles;
+}
+
+// Streams the input through an adaptive runner that profiles every batch. The first window always triggers a 
+// recompilation, so the predictions are checked before and after the re-tiled model is swapped in. The profiles
+// of swapped out runners are deleted and so are all the files of the runner once it is destroyed.
+bool Test_XGBoostModel_AdaptiveRetiling(const std::string& modelJSON, const std::string& inputCSV, TreeBeard::TilingType tilingType, bool peelTreeWalks) {
+  using FloatType = float;
+  const int32_t batchSize = 4;
+  auto workingDirectory = std::filesystem::temp_directory_path() / "treebeard_adaptive_retiling_test";
+  std::filesystem::remove_all(workingDirectory);
+  std::filesystem::create_directories(workingDirectory);
+  TreeBeard::CompilerOptions options(sizeof(FloatType)*8, sizeof(FloatType)*8, true, sizeof(int32_t)*8, sizeof(int32_t)*8,
+                                     sizeof(FloatType)*8, batchSize, 4, 16, 16, TreeBeard::TilingType::kUniform, false, false, nullptr);
+  TreeBeard::runtime::AdaptiveTilingOptions adaptiveOptions;
+  adaptiveOptions.samplingInterval = 1;
+  adaptiveOptions.windowRows = 64;
+  adaptiveOptions.tilingType = tilingType;
+  adaptiveOptions.peelTreeWalks = peelTreeWalks;
+  adaptiveOptions.workingDirectory = workingDirectory.string();
+  auto adaptiveRunnerPtr = std::make_unique<TreeBeard::runtime::AdaptiveInferenceRunner>(modelJSON, "xgboost_json", options, adaptiveOptions);
+  auto& adaptiveRunner = *adaptiveRunnerPtr;
+
+  TestCSVReader csvReader(inputCSV);
+  size_t numRows = (csvReader.NumberOfRows()/batchSize) * batchSize;
+  for (size_t i=0 ; i<numRows ; i += batchSize) {
+    std::vector<FloatType> batch, expectedResults, results(batchSize);
+    for (int32_t j=0 ; j<batchSize ; ++j) {
+      auto row = csvReader.GetRowOfType<FloatType>(i + j);
+      expectedResults.push_back(row.back());
+      row.pop_back();
+      batch.insert(batch.end(), row.begin(), row.end());
+    }
+    adaptiveRunner.RunInference(batch.data(), results.data());
+    for (int32_t j=0 ; j<batchSize ; ++j)
+      Test_ASSERT(FPEqual<FloatType>(results[j], expectedResults[j]));
+  }
+  adaptiveRunner.WaitForRecompilation();
+  Test_ASSERT(adaptiveRunner.GetNumberOfRecompilations() >= 1);
+  // Compiling the adaptive runner's models doesn't change the process wide code generation flags
+  Test_ASSERT(!mlir::decisionforest::UseSparseTreeRepresentation && !mlir::decisionforest::PeeledCodeGenForProbabiltyBasedTiling);
+  Test_ASSERT(CountFilesWithSuffix(workingDirectory, ".stats.csv") == 1);
+  Test_ASSERT(ValidateModuleOutputAgainstCSVdata<FloatType, FloatType>(*adaptiveRunner.GetServingRunner(), inputCSV, batchSize));
+  adaptiveRunnerPtr.reset();
+  Test_ASSERT(std::filesystem::is_empty(workingDirectory));
+  std::filesystem::remove_all(workingDirectory);
+  return true;
+}
+
+bool Test_AirlineAdaptiveRetiling(TestArgs_t &args) {
+  auto modelJSONPath = GetTreeBeardRepoPath() + "/xgb_models/airline_xgb_model_save.json";
+  auto csvPath = modelJSONPath  + ".test.sampled.csv";
+  return Test_XGBoostModel_AdaptiveRetiling(modelJSONPath, csvPath, TreeBeard::TilingType::kProbabilistic, false);
+}
+
+bool Test_AirlineAdaptiveRetiling_HybridPeeled(TestArgs_t &args) {
+  auto modelJSONPath = GetTreeBeardRepoPath() + "/xgb_models/airline_xgb_model_save.json";
+  auto csvPath = modelJSONPath  + ".test.sampled.csv";
+  return Test_XGBoostModel_AdaptiveRetiling(modelJSONPath, csvPath, TreeBeard::TilingType::kHybrid, true);
+}
+
 }
 }
\ No newline at end of file
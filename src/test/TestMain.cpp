@@ -35,6 +35,8 @@ bool Test_RandomXGBoostJSONs_1Tree_BatchSize1(TestArgs_t& args);
 bool Test_RandomXGBoostJSONs_1Tree_BatchSize8_TileSize2_4Pipelined(TestArgs_t& args);
 bool Test_RandomXGBoostJSONs_1Tree_BatchSize8_TlieSize4_4Pipelined(TestArgs_t& args);
 bool Test_RandomXGBoostJSONs_4Trees_BatchSize4_4Pipelined(TestArgs_t &args);
+bool Test_RandomXGBoostJSONs_1Tree_BatchSize8_TileSize2_4Pipelined_Prefetch(TestArgs_t& args);
+bool Test_RandomXGBoostJSONs_4Trees_BatchSize8_TileSize4_4Pipelined_Prefetch(TestArgs_t& args);
 bool Test_RandomXGBoostJSONs_1Tree_BatchSize2(TestArgs_t& args);
 bool Test_RandomXGBoostJSONs_1Tree_BatchSize4(TestArgs_t& args);
 bool Test_RandomXGBoostJSONs_2Trees_BatchSize1(TestArgs_t& args);
@@ -115,6 +117,59 @@ bool Test_TileSize2_Abalone(TestArgs_t &args);
 bool Test_TileSize3_Abalone(TestArgs_t &args);
 bool Test_TileSize4_Abalone(TestArgs_t &args);
 bool Test_TileSize8_Abalone(TestArgs_t &args);
+bool Test_TileSize16_Abalone(TestArgs_t &args);
+bool Test_Quantized_Scalar_Abalone(TestArgs_t &args);
+bool Test_Quantized_TileSize4_Abalone(TestArgs_t &args);
+bool Test_Quantized_TileSize8_Airline(TestArgs_t &args);
+bool Test_FastApproximateTransforms_TileSize4_Airline(TestArgs_t &args);
+bool Test_FastApproximateTransforms_TileSize8_Higgs(TestArgs_t &args);
+bool Test_EarlyExit_TileSize4_Airline(TestArgs_t &args);
+bool Test_EarlyExit_TileSize8_Higgs(TestArgs_t &args);
+bool Test_AnytimePrediction_TileSize4_Airline(TestArgs_t &args);
+bool Test_AnytimePrediction_TileSize8_Higgs_ReorderByVariance(TestArgs_t &args);
+bool Test_ForestSimplification_HandcraftedForest(TestArgs_t &args);
+bool Test_SimplifiedForest_Scalar_Abalone(TestArgs_t &args);
+bool Test_SimplifiedForest_TileSize4_Airline(TestArgs_t &args);
+bool Test_CompactFeatures_TileSize4_Airline(TestArgs_t &args);
+bool Test_CompactFeatures_CachedRows_TileSize8_Higgs(TestArgs_t &args);
+bool Test_SparseHotPathLayout_TileSize4_Abalone(TestArgs_t &args);
+bool Test_SparseHotPathLayout_TileSize8_Airline(TestArgs_t &args);
+bool Test_SparseHotPathLayout_ProbabilisticTiling_TileSize8_AirlineOHE(TestArgs_t &args);
+bool Test_AutoTypeWidths_Scalar_Abalone(TestArgs_t &args);
+bool Test_AutoTypeWidths_TileSize8_Airline(TestArgs_t &args);
+bool Test_SparseAutoTypeWidths_TileSize4_Year(TestArgs_t &args);
+bool Test_SparseAutoTypeWidths_TileSize8_Higgs(TestArgs_t &args);
+bool Test_TreeParallelSchedule_TileSize4_Airline(TestArgs_t &args);
+bool Test_UntiledTreeParallelSchedule_Airline(TestArgs_t &args);
+bool Test_ParallelizeTrees_TileSize8_Higgs(TestArgs_t &args);
+bool Test_SingleRowPredict_TileSize4_Airline(TestArgs_t &args);
+bool Test_SingleRowPredict_ReorderTrees_TileSize8_Higgs(TestArgs_t &args);
+bool Test_WorkStealingRuntime_ParallelFor(TestArgs_t &args);
+bool Test_WorkStealingRuntime_ParallelBatch_TileSize8_Airline(TestArgs_t &args);
+bool Test_WorkStealingRuntime_ParallelizeTrees_TileSize8_Higgs(TestArgs_t &args);
+bool Test_ModelReplicas_Runtime(TestArgs_t &args);
+bool Test_ModelReplicas_ParallelBatch_TileSize8_Airline(TestArgs_t &args);
+bool Test_ModelReplicas_TileSize4_Higgs(TestArgs_t &args);
+bool Test_RandomForest_Averaging_HandcraftedForest(TestArgs_t &args);
+bool Test_RandomForest_Voting_HandcraftedForest(TestArgs_t &args);
+bool Test_MultiClass_InterleavedClasses_HandcraftedForest(TestArgs_t &args);
+bool Test_FastApproximateSigmoid_Accuracy(TestArgs_t &args);
+bool Test_LightGBM_MissingValues_Binary(TestArgs_t &args);
+bool Test_LightGBM_Categorical_Multiclass(TestArgs_t &args);
+bool Test_CatBoost_Binary_ObliviousWalk(TestArgs_t &args);
+bool Test_CatBoost_Multiclass_ObliviousWalk(TestArgs_t &args);
+bool Test_CatBoost_Multiclass_SparseObliviousWalk(TestArgs_t &args);
+bool Test_UBJSONModel_RandomForests(TestArgs_t &args);
+bool Test_AirlineInstrumentedProfile(TestArgs_t &args);
+bool Test_CovtypeInstrumentedProfile(TestArgs_t &args);
+bool Test_HiggsInstrumentedProfile(TestArgs_t &args);
+bool Test_AirlineAdaptiveRetiling(TestArgs_t &args);
+bool Test_AirlineAdaptiveRetiling_HybridPeeled(TestArgs_t &args);
+bool Test_StreamingInference_Airline_CSV(TestArgs_t &args);
+bool Test_StreamingInference_Higgs_Binary(TestArgs_t &args);
+bool Test_HalfPrecisionThresholds_Balanced_BatchSize1(TestArgs_t &args);
+bool Test_HalfPrecisionThresholds_BinnedFeatures_BatchSize1(TestArgs_t &args);
+bool Test_BFloat16Thresholds_LeftHeavy_BatchSize1(TestArgs_t &args);
 
 bool Test_Scalar_Airline(TestArgs_t &args);
 bool Test_TileSize2_Airline(TestArgs_t &args);
@@ -163,6 +218,8 @@ bool Test_TileSize2_Letters_Int8Type(TestArgs_t &args);
 bool Test_TileSize3_Letters_Int8Type(TestArgs_t &args);
 bool Test_TileSize4_Letters_Int8Type(TestArgs_t &args);
 bool Test_TileSize8_Letters_Int8Type(TestArgs_t &args);
+bool Test_TileSize4_Letters_ClassScores(TestArgs_t &args);
+bool Test_TileSize8_CovType_OneTreeAtATime_ClassScores(TestArgs_t &args);
 bool Test_TileSize3_Letters_2Pipelined_Int8Type(TestArgs_t &args);
 bool Test_TileSize4_Letters_3Pipelined_Int8Type(TestArgs_t &args);
 bool Test_TileSize8_Letters_5Pipelined_Int8Type(TestArgs_t &args);
@@ -246,6 +303,7 @@ bool Test_SparseTileSize2_Abalone(TestArgs_t &args);
 bool Test_SparseTileSize3_Abalone(TestArgs_t &args);
 bool Test_SparseTileSize4_Abalone(TestArgs_t &args);
 bool Test_SparseTileSize8_Abalone(TestArgs_t &args);
+bool Test_SparseTileSize16_Abalone(TestArgs_t &args);
 bool Test_SparseScalar_Airline(TestArgs_t &args);
 bool Test_SparseTileSize2_Airline(TestArgs_t &args);
 bool Test_SparseTileSize3_Airline(TestArgs_t &args);
@@ -257,6 +315,8 @@ bool Test_SparseTileSize2_AirlineOHE(TestArgs_t &args);
 bool Test_SparseTileSize3_AirlineOHE(TestArgs_t &args);
 bool Test_SparseTileSize4_AirlineOHE(TestArgs_t &args);
 bool Test_SparseTileSize8_AirlineOHE(TestArgs_t &args);
+bool Test_SparseTileSize8_LeafDictionary_Abalone(TestArgs_t &args);
+bool Test_SparseTileSize4_LeafDictionary_AirlineOHE(TestArgs_t &args);
 bool Test_SparseTileSize8_Pipelined4_AirlineOHE(TestArgs_t &args);
 bool Test_SparseScalar_Bosch(TestArgs_t &args);
 bool Test_SparseTileSize2_Bosch(TestArgs_t &args);
@@ -425,6 +485,8 @@ bool Test_PeeledHybridProbabilisticTiling_TileSize8_Year(TestArgs_t &args);
 
 // ONNXTests
 bool Test_ONNX_TileSize8_Abalone(TestArgs_t &args);
+bool Test_ONNX_RandomForest_Voting(TestArgs_t &args);
+bool Test_ONNX_RandomForest_ClassProbabilities(TestArgs_t &args);
 
 // GPU model initialization tests
 bool Test_GPUModelInit_LeftHeavy_Scalar_DoubleInt(TestArgs_t& args);
@@ -1117,6 +1179,8 @@ bool Test_SplitSchedule(TestArgs_t& args) {
 #ifdef RUN_ALL_TESTS
 TestDescriptor testList[] = {
   TEST_LIST_ENTRY(Test_ONNX_TileSize8_Abalone),
+  TEST_LIST_ENTRY(Test_ONNX_RandomForest_Voting),
+  TEST_LIST_ENTRY(Test_ONNX_RandomForest_ClassProbabilities),
   
   // [Ashwin] These tests are exercising a part of the code that 
   // we intend to remove. Commenting them out to allow assertions 
@@ -1227,6 +1291,59 @@ TestDescriptor testList[] = {
   TEST_LIST_ENTRY(Test_TileSize3_Abalone),
   TEST_LIST_ENTRY(Test_TileSize4_Abalone),
   TEST_LIST_ENTRY(Test_TileSize8_Abalone),
+  TEST_LIST_ENTRY(Test_TileSize16_Abalone),
+  TEST_LIST_ENTRY(Test_Quantized_Scalar_Abalone),
+  TEST_LIST_ENTRY(Test_Quantized_TileSize4_Abalone),
+  TEST_LIST_ENTRY(Test_Quantized_TileSize8_Airline),
+  TEST_LIST_ENTRY(Test_FastApproximateTransforms_TileSize4_Airline),
+  TEST_LIST_ENTRY(Test_FastApproximateTransforms_TileSize8_Higgs),
+  TEST_LIST_ENTRY(Test_EarlyExit_TileSize4_Airline),
+  TEST_LIST_ENTRY(Test_EarlyExit_TileSize8_Higgs),
+  TEST_LIST_ENTRY(Test_AnytimePrediction_TileSize4_Airline),
+  TEST_LIST_ENTRY(Test_AnytimePrediction_TileSize8_Higgs_ReorderByVariance),
+  TEST_LIST_ENTRY(Test_ForestSimplification_HandcraftedForest),
+  TEST_LIST_ENTRY(Test_SimplifiedForest_Scalar_Abalone),
+  TEST_LIST_ENTRY(Test_SimplifiedForest_TileSize4_Airline),
+  TEST_LIST_ENTRY(Test_CompactFeatures_TileSize4_Airline),
+  TEST_LIST_ENTRY(Test_CompactFeatures_CachedRows_TileSize8_Higgs),
+  TEST_LIST_ENTRY(Test_SparseHotPathLayout_TileSize4_Abalone),
+  TEST_LIST_ENTRY(Test_SparseHotPathLayout_TileSize8_Airline),
+  TEST_LIST_ENTRY(Test_SparseHotPathLayout_ProbabilisticTiling_TileSize8_AirlineOHE),
+  TEST_LIST_ENTRY(Test_AutoTypeWidths_Scalar_Abalone),
+  TEST_LIST_ENTRY(Test_AutoTypeWidths_TileSize8_Airline),
+  TEST_LIST_ENTRY(Test_SparseAutoTypeWidths_TileSize4_Year),
+  TEST_LIST_ENTRY(Test_SparseAutoTypeWidths_TileSize8_Higgs),
+  TEST_LIST_ENTRY(Test_TreeParallelSchedule_TileSize4_Airline),
+  TEST_LIST_ENTRY(Test_UntiledTreeParallelSchedule_Airline),
+  TEST_LIST_ENTRY(Test_ParallelizeTrees_TileSize8_Higgs),
+  TEST_LIST_ENTRY(Test_SingleRowPredict_TileSize4_Airline),
+  TEST_LIST_ENTRY(Test_SingleRowPredict_ReorderTrees_TileSize8_Higgs),
+  TEST_LIST_ENTRY(Test_WorkStealingRuntime_ParallelFor),
+  TEST_LIST_ENTRY(Test_WorkStealingRuntime_ParallelBatch_TileSize8_Airline),
+  TEST_LIST_ENTRY(Test_WorkStealingRuntime_ParallelizeTrees_TileSize8_Higgs),
+  TEST_LIST_ENTRY(Test_ModelReplicas_Runtime),
+  TEST_LIST_ENTRY(Test_ModelReplicas_ParallelBatch_TileSize8_Airline),
+  TEST_LIST_ENTRY(Test_ModelReplicas_TileSize4_Higgs),
+  TEST_LIST_ENTRY(Test_RandomForest_Averaging_HandcraftedForest),
+  TEST_LIST_ENTRY(Test_RandomForest_Voting_HandcraftedForest),
+  TEST_LIST_ENTRY(Test_MultiClass_InterleavedClasses_HandcraftedForest),
+  TEST_LIST_ENTRY(Test_FastApproximateSigmoid_Accuracy),
+  TEST_LIST_ENTRY(Test_LightGBM_MissingValues_Binary),
+  TEST_LIST_ENTRY(Test_LightGBM_Categorical_Multiclass),
+  TEST_LIST_ENTRY(Test_CatBoost_Binary_ObliviousWalk),
+  TEST_LIST_ENTRY(Test_CatBoost_Multiclass_ObliviousWalk),
+  TEST_LIST_ENTRY(Test_CatBoost_Multiclass_SparseObliviousWalk),
+  TEST_LIST_ENTRY(Test_UBJSONModel_RandomForests),
+  TEST_LIST_ENTRY(Test_AirlineInstrumentedProfile),
+  TEST_LIST_ENTRY(Test_CovtypeInstrumentedProfile),
+  TEST_LIST_ENTRY(Test_HiggsInstrumentedProfile),
+  TEST_LIST_ENTRY(Test_AirlineAdaptiveRetiling),
+  TEST_LIST_ENTRY(Test_AirlineAdaptiveRetiling_HybridPeeled),
+  TEST_LIST_ENTRY(Test_StreamingInference_Airline_CSV),
+  TEST_LIST_ENTRY(Test_StreamingInference_Higgs_Binary),
+  TEST_LIST_ENTRY(Test_HalfPrecisionThresholds_Balanced_BatchSize1),
+  TEST_LIST_ENTRY(Test_HalfPrecisionThresholds_BinnedFeatures_BatchSize1),
+  TEST_LIST_ENTRY(Test_BFloat16Thresholds_LeftHeavy_BatchSize1),
   TEST_LIST_ENTRY(Test_Scalar_Airline),
   TEST_LIST_ENTRY(Test_TileSize2_Airline),
   TEST_LIST_ENTRY(Test_TileSize3_Airline),
@@ -1257,6 +1374,8 @@ TestDescriptor testList[] = {
   TEST_LIST_ENTRY(Test_TileSize3_Letters_Int8Type),
   TEST_LIST_ENTRY(Test_TileSize4_Letters_Int8Type),
   TEST_LIST_ENTRY(Test_TileSize8_Letters_Int8Type),
+  TEST_LIST_ENTRY(Test_TileSize4_Letters_ClassScores),
+  TEST_LIST_ENTRY(Test_TileSize8_CovType_OneTreeAtATime_ClassScores),
   TEST_LIST_ENTRY(Test_Scalar_Year),
   TEST_LIST_ENTRY(Test_TileSize2_Year),
   TEST_LIST_ENTRY(Test_TileSize3_Year),
@@ -1310,6 +1429,7 @@ TestDescriptor testList[] = {
   TEST_LIST_ENTRY(Test_SparseTileSize3_Abalone),
   TEST_LIST_ENTRY(Test_SparseTileSize4_Abalone),
   TEST_LIST_ENTRY(Test_SparseTileSize8_Abalone),
+  TEST_LIST_ENTRY(Test_SparseTileSize16_Abalone),
   TEST_LIST_ENTRY(Test_SparseScalar_Airline),
   TEST_LIST_ENTRY(Test_SparseTileSize2_Airline),
   TEST_LIST_ENTRY(Test_SparseTileSize3_Airline),
@@ -1320,6 +1440,8 @@ TestDescriptor testList[] = {
   TEST_LIST_ENTRY(Test_SparseTileSize3_AirlineOHE),
   TEST_LIST_ENTRY(Test_SparseTileSize4_AirlineOHE),
   TEST_LIST_ENTRY(Test_SparseTileSize8_AirlineOHE),
+  TEST_LIST_ENTRY(Test_SparseTileSize8_LeafDictionary_Abalone),
+  TEST_LIST_ENTRY(Test_SparseTileSize4_LeafDictionary_AirlineOHE),
   TEST_LIST_ENTRY(Test_SparseScalar_Bosch),
   TEST_LIST_ENTRY(Test_SparseTileSize2_Bosch),
   TEST_LIST_ENTRY(Test_SparseTileSize3_Bosch),
@@ -1508,6 +1630,8 @@ TestDescriptor testList[] = {
   TEST_LIST_ENTRY(Test_SparseTileSize8_Pipelined_Year),
   TEST_LIST_ENTRY(Test_SparseTileSize8_Pipelined_Higgs),
   TEST_LIST_ENTRY(Test_SparseTileSize8_Pipelined_Epsilon),
+  TEST_LIST_ENTRY(Test_RandomXGBoostJSONs_1Tree_BatchSize8_TileSize2_4Pipelined_Prefetch),
+  TEST_LIST_ENTRY(Test_RandomXGBoostJSONs_4Trees_BatchSize8_TileSize4_4Pipelined_Prefetch),
 
   // Hybrid Tiling
   TEST_LIST_ENTRY(Test_WalkPeeling_BalancedTree_TileSize2),
@@ -1836,6 +1960,8 @@ void RunTestsImpl(TestDescriptor *testsToRun, size_t numberOfTests) {
     
     // Disable sparse code generation by default
     decisionforest::UseSparseTreeRepresentation = false;
+    decisionforest::UseLeafDictionaryCompression = false;
+    decisionforest::UseHotPathSparseLayout = false;
     mlir::decisionforest::ForestJSONReader::GetInstance().SetChildIndexBitWidth(-1);
     
     bool pass = RunTest(testsToRun[i], args, i+1);
@@ -17,6 +17,8 @@ class MLIRContext;
 
 namespace TreeBeard
 {
+struct CompilerOptions;
+
 namespace test 
 {
 
@@ -85,6 +87,9 @@ inline bool FPEqual<int8_t>(int8_t a, int8_t b) {
   return a == b;
 }
 
+// Sets the compiler options a test needs on top of the ones the test helper constructs
+using CompilerOptionsModifier_t = std::function<void(TreeBeard::CompilerOptions&)>;
+
 using RandomIntGenerator = std::function<int32_t()>;
 using RandomRealGenerator = std::function<double()>;
 
@@ -60,7 +60,7 @@ double Test_CodeGenForJSON_ProbabilityBasedTiling(int64_t batchSize, const std::
                                               int32_t tileSize, int32_t tileShapeBitWidth, 
                                               int32_t childIndexBitWidth, mlir::decisionforest::ScheduleManipulator *scheduleManipulator, 
                                               bool probTiling, int32_t numberOfCores,
-                                              int32_t pipelineSize) {
+                                              int32_t pipelineSize, int32_t prefetchDistance) {
   // TODO consider changing this so that you use the smallest possible type possible (need to make it a parameter)
   using FeatureIndexType = int16_t;
   using NodeIndexType = int16_t;
@@ -76,6 +76,7 @@ double Test_CodeGenForJSON_ProbabilityBasedTiling(int64_t batchSize, const std::
 
   options.statsProfileCSVPath = statsProfileCSV;
   options.SetPipelineSize(pipelineSize);
+  options.SetPrefetchDistance(prefetchDistance);
 
   if (numberOfCores != -1)
     options.numberOfCores = numberOfCores;
@@ -132,30 +133,32 @@ double Test_CodeGenForJSON_ProbabilityBasedTiling(int64_t batchSize, const std::
 
 template<typename FPType, typename ReturnType, int32_t TileSize>
 double RunSingleBenchmark_SingleConfig(const std::string& modelName, mlir::decisionforest::ScheduleManipulator *scheduleManipulator,
-                                        bool probTiling, int32_t numCores, int32_t pipelineSize, int32_t BatchSize) {
+                                        bool probTiling, int32_t numCores, int32_t pipelineSize, int32_t BatchSize,
+                                        int32_t prefetchDistance) {
   auto repoPath = GetTreeBeardRepoPath();
   auto testModelsDir = repoPath + "/xgb_models";
   auto modelJSONPath = testModelsDir + "/" + modelName + "_xgb_model_save.json";
   std::string statsProfileCSV = testModelsDir + "/profiles/" + modelName + ".test.csv";
   auto time = Test_CodeGenForJSON_ProbabilityBasedTiling<FPType, ReturnType>(BatchSize, modelJSONPath, statsProfileCSV, 
                                                                             TileSize, 16, 16, scheduleManipulator,
-                                                                            probTiling, numCores, pipelineSize);
+                                                                            probTiling, numCores, pipelineSize, prefetchDistance);
   return time;
 }
 
 template<typename FPType, int32_t TileSize>
 void RunBenchmark_SingleConfig(mlir::decisionforest::ScheduleManipulator *scheduleManipulator, bool probTiling,
-                               const std::string& config, int32_t numCores, int32_t pipelineSize, int32_t BatchSize) {
+                               const std::string& config, int32_t numCores, int32_t pipelineSize, int32_t BatchSize,
+                               int32_t prefetchDistance = -1) {
   std::cout << config << ", ";
   std::cout << GetTypeName(FPType()) << ", " << BatchSize << " , " << TileSize;
-  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("abalone", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize) << std::flush;
-  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("airline", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize) << std::flush;
-  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("airline-ohe", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize) << std::flush;
-  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, int8_t, TileSize>("covtype", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize) << std::flush;
-  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("epsilon", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize) << std::flush;
-  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, int8_t, TileSize>("letters", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize) << std::flush;
-  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("higgs", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize) << std::flush;
-  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("year_prediction_msd", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize) << std::flush;
+  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("abalone", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize, prefetchDistance) << std::flush;
+  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("airline", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize, prefetchDistance) << std::flush;
+  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("airline-ohe", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize, prefetchDistance) << std::flush;
+  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, int8_t, TileSize>("covtype", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize, prefetchDistance) << std::flush;
+  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("epsilon", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize, prefetchDistance) << std::flush;
+  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, int8_t, TileSize>("letters", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize, prefetchDistance) << std::flush;
+  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("higgs", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize, prefetchDistance) << std::flush;
+  std::cout << ", " << RunSingleBenchmark_SingleConfig<FPType, FPType, TileSize>("year_prediction_msd", scheduleManipulator, probTiling, numCores, pipelineSize, BatchSize, prefetchDistance) << std::flush;
   std::cout << std::endl;
 }
 
@@ -170,12 +173,12 @@ void RunAllBenchmarks(mlir::decisionforest::ScheduleManipulator *scheduleManipul
   }
 }
 
-void RunAllPipelinedBenchmarks(int32_t batchSize, const std::string& config, int32_t numCores=-1) {
+void RunAllPipelinedBenchmarks(int32_t batchSize, const std::string& config, int32_t numCores=-1, int32_t prefetchDistance=-1) {
   {
     using FPType = float;
-    RunBenchmark_SingleConfig<FPType, 8>(nullptr, false, config + std::string("-2pipeline"), numCores, 2, batchSize);
-    RunBenchmark_SingleConfig<FPType, 8>(nullptr, false, config + std::string("-4pipeline"), numCores, 4, batchSize);
-    RunBenchmark_SingleConfig<FPType, 8>(nullptr, false, config + std::string("-8pipeline"), numCores, 8, batchSize);
+    RunBenchmark_SingleConfig<FPType, 8>(nullptr, false, config + std::string("-2pipeline"), numCores, 2, batchSize, prefetchDistance);
+    RunBenchmark_SingleConfig<FPType, 8>(nullptr, false, config + std::string("-4pipeline"), numCores, 4, batchSize, prefetchDistance);
+    RunBenchmark_SingleConfig<FPType, 8>(nullptr, false, config + std::string("-8pipeline"), numCores, 8, batchSize, prefetchDistance);
   }
 }
 
@@ -218,6 +221,17 @@ void RunProbabilisticOneTreeAtATimeSchedule_RemoveExtraHop_XGBoostBenchmarks(int
   decisionforest::PeeledCodeGenForProbabiltyBasedTiling = false;
 }
 
+void RunHotPathLayoutXGBoostBenchmarks(int32_t batchSize) {
+  // Compare against "sparse-one_tree", which lays out the tiles of each tree in level order
+  mlir::decisionforest::ScheduleManipulationFunctionWrapper scheduleManipulator(OneTreeAtATimeSchedule);
+
+  decisionforest::UseSparseTreeRepresentation = true;
+  decisionforest::UseHotPathSparseLayout = true;
+  RunAllBenchmarks(&scheduleManipulator, batchSize, false, "sparse_hot_path-one_tree");
+  decisionforest::UseSparseTreeRepresentation = false;
+  decisionforest::UseHotPathSparseLayout = false;
+}
+
 void RunPipeliningBenchmarks(int32_t batchSize) {
   RunAllPipelinedBenchmarks(batchSize, "array-pipelined_sched");
   
@@ -226,6 +240,18 @@ void RunPipeliningBenchmarks(int32_t batchSize) {
   decisionforest::UseSparseTreeRepresentation = false;
 }
 
+void RunPrefetchingBenchmarks(int32_t batchSize) {
+  std::vector<int32_t> prefetchDistances{4, 8, 16};
+  for (auto prefetchDistance : prefetchDistances) {
+    auto config = std::string("-prefetch") + std::to_string(prefetchDistance);
+    RunAllPipelinedBenchmarks(batchSize, "array-pipelined_sched" + config, -1, prefetchDistance);
+    
+    decisionforest::UseSparseTreeRepresentation = true;
+    RunAllPipelinedBenchmarks(batchSize, "sparse-pipelined_sched" + config, -1, prefetchDistance);
+    decisionforest::UseSparseTreeRepresentation = false;
+  }
+}
+
 void RunParallelPipeliningBenchmarks(int32_t batchSize, int32_t numCores) {
   RunAllPipelinedBenchmarks(batchSize, "array-pipelined_sched-par", numCores);
   
@@ -250,8 +276,10 @@ void RunXGBoostBenchmarks() {
   std::vector<int32_t> batchSizes{64, 128, 256, 512, 1024, 2000};
   for (auto batchSize : batchSizes) {
     RunOneTreeAtATimeScheduleXGBoostBenchmarks(batchSize);
+    RunHotPathLayoutXGBoostBenchmarks(batchSize);
     RunProbabilisticOneTreeAtATimeSchedule_RemoveExtraHop_XGBoostBenchmarks(batchSize);
     RunPipeliningBenchmarks(batchSize);
+    RunPrefetchingBenchmarks(batchSize);
     // RunParallelPipeliningBenchmarks(batchSize, 16);
     // RunBenchmarksOverDifferentNumCores(batchSize);
   }
@@ -1,5 +1,10 @@
 #include <vector>
 #include <sstream>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <memory>
 #include "Dialect.h"
 #include "TestUtilsCommon.h"
 
@@ -20,8 +25,11 @@
 #include "TreeTilingUtils.h"
 #include "ForestTestUtils.h"
 #include "CompileUtils.h"
+#include "TaskRuntime.h"
+#include "ModelReplicas.h"
 #include "ModelSerializers.h"
 #include "Representations.h"
+#include "StreamingInference.h"
 
 using namespace mlir;
 using namespace mlir::decisionforest;
@@ -33,6 +41,47 @@ namespace test
 
 bool RunSingleBatchSizeForXGBoostTests = true;
 
+// A model compiled from an XGBoost JSON for a test. The runner executes a module owned by the context and 
+// the options of the context point to the schedule manipulator, so the three are kept together.
+struct XGBoostJSONTestModel {
+  std::unique_ptr<ScheduleManipulationFunctionWrapper> scheduleManipulator;
+  std::unique_ptr<TreeBeard::TreebeardContext> tbContext;
+  std::unique_ptr<decisionforest::InferenceRunner> inferenceRunner;
+};
+
+// Compiles the model with uniform tiling, 16 bit tile shapes and child indices and the widths of the template types.
+// The options modifier sets anything else a test needs. If it asks for auto type widths, the runner is created with 
+// the widths the compiler picked.
+template<typename FloatType, typename FeatureIndexType=int32_t, typename ResultType=FloatType>
+XGBoostJSONTestModel CompileXGBoostJSONForTest(const std::string& modelJsonPath, int64_t batchSize, int32_t tileSize,
+                                               ScheduleManipulator_t scheduleManipulatorFunc=nullptr,
+                                               CompilerOptionsModifier_t optionsModifier=nullptr) {
+  using NodeIndexType = int32_t;
+  int32_t floatTypeBitWidth = sizeof(FloatType)*8;
+  XGBoostJSONTestModel model;
+  model.scheduleManipulator = std::make_unique<ScheduleManipulationFunctionWrapper>(scheduleManipulatorFunc);
+  TreeBeard::CompilerOptions options(floatTypeBitWidth, sizeof(ResultType)*8, IsFloatType(ResultType()), sizeof(FeatureIndexType)*8, sizeof(NodeIndexType)*8,
+                                     floatTypeBitWidth, batchSize, tileSize, 16, 16, TreeBeard::TilingType::kUniform, false, false, 
+                                     scheduleManipulatorFunc ? model.scheduleManipulator.get() : nullptr);
+  if (optionsModifier)
+    optionsModifier(options);
+  auto modelGlobalsJSONFilePath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(modelJsonPath);
+  model.tbContext = std::make_unique<TreeBeard::TreebeardContext>(modelJsonPath, modelGlobalsJSONFilePath, options, 
+                                                                  mlir::decisionforest::ConstructRepresentation(),
+                                                                  mlir::decisionforest::ConstructModelSerializer(modelGlobalsJSONFilePath));
+  mlir::ModuleOp module;
+  if (options.thresholdTypeWidth == TreeBeard::CompilerOptions::kAutoTypeWidth)
+    module = TreeBeard::ConstructLLVMDialectModuleFromXGBoostJSON(*model.tbContext);
+  else
+    module = TreeBeard::ConstructLLVMDialectModuleFromXGBoostJSON<FloatType, ResultType, FeatureIndexType, NodeIndexType>(*model.tbContext);
+
+  auto& selectedOptions = model.tbContext->options;
+  model.inferenceRunner = std::make_unique<decisionforest::InferenceRunner>(model.tbContext->serializer, module, tileSize, 
+                                                                            selectedOptions.thresholdTypeWidth, 
+                                                                            selectedOptions.featureIndexTypeWidth);
+  return model;
+}
+
 // ===---------------------------------------------------=== //
 // XGBoost Scalar Inference Tests
 // ===---------------------------------------------------=== //
@@ -40,29 +89,21 @@ template<typename FloatType, typename FeatureIndexType=int32_t, typename ResultT
 bool Test_CodeGenForJSON_VariableBatchSize(TestArgs_t& args, int64_t batchSize, const std::string& modelJsonPath, const std::string& csvPath, 
                                            int32_t tileSize, int32_t tileShapeBitWidth, int32_t childIndexBitWidth,
                                            bool makeAllLeavesSameDepth, bool reorderTrees, ScheduleManipulator_t scheduleManipulatorFunc=nullptr,
-                                           int32_t pipelineSize = -1) {
-  using NodeIndexType = int32_t;
-  int32_t floatTypeBitWidth = sizeof(FloatType)*8;
-  ScheduleManipulationFunctionWrapper scheduleManipulator(scheduleManipulatorFunc);
-  TreeBeard::CompilerOptions options(floatTypeBitWidth, sizeof(ResultType)*8, IsFloatType(ResultType()), sizeof(FeatureIndexType)*8, sizeof(NodeIndexType)*8,
-                                     floatTypeBitWidth, batchSize, tileSize, tileShapeBitWidth, childIndexBitWidth,
-                                     TreeBeard::TilingType::kUniform, makeAllLeavesSameDepth, reorderTrees, 
-                                     scheduleManipulatorFunc ? &scheduleManipulator : nullptr);
-
-  options.SetPipelineSize(pipelineSize);
-  auto modelGlobalsJSONFilePath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(modelJsonPath);
-  
-  TreeBeard::TreebeardContext tbContext(modelJsonPath, modelGlobalsJSONFilePath, options, 
-                                        mlir::decisionforest::ConstructRepresentation(),
-                                        mlir::decisionforest::ConstructModelSerializer(modelGlobalsJSONFilePath),
-                                        nullptr /*TODO_ForestCreator*/);
-  auto module = TreeBeard::ConstructLLVMDialectModuleFromXGBoostJSON<FloatType, ResultType, FeatureIndexType>(tbContext);
-
-  decisionforest::InferenceRunner inferenceRunner(tbContext.serializer, module, tileSize, sizeof(FloatType)*8, sizeof(FeatureIndexType)*8);
+                                           int32_t pipelineSize = -1, CompilerOptionsModifier_t optionsModifier = nullptr) {
+  auto model = CompileXGBoostJSONForTest<FloatType, FeatureIndexType, ResultType>(modelJsonPath, batchSize, tileSize, scheduleManipulatorFunc,
+    [&](TreeBeard::CompilerOptions& options) {
+      options.tileShapeBitWidth = tileShapeBitWidth;
+      options.childIndexBitWidth = childIndexBitWidth;
+      options.makeAllLeavesSameDepth = makeAllLeavesSameDepth;
+      options.reorderTreesByDepth = reorderTrees;
+      options.SetPipelineSize(pipelineSize);
+      if (optionsModifier)
+        optionsModifier(options);
+    });
   
-  // inferenceRunner.PrintLengthsArray();
-  // inferenceRunner.PrintOffsetsArray();
-  return ValidateModuleOutputAgainstCSVdata<FloatType, ResultType>(inferenceRunner, csvPath, batchSize);
+  // model.inferenceRunner->PrintLengthsArray();
+  // model.inferenceRunner->PrintOffsetsArray();
+  return ValidateModuleOutputAgainstCSVdata<FloatType, ResultType>(*model.inferenceRunner, csvPath, batchSize);
 }
 
 template<typename FloatType>
@@ -138,6 +179,14 @@ bool Test_RandomXGBoostJSONs_4Trees_BatchSize4_4Pipelined(TestArgs_t& args) {
   return Test_RandomXGBoostJSONs_4Trees_VariableBatchSize(args, 8, 4, 32, 3, true, true, nullptr, 4);
 }
 
+bool Test_RandomXGBoostJSONs_1Tree_BatchSize8_TileSize2_4Pipelined_Prefetch(TestArgs_t& args) {
+  return Test_RandomXGBoostJSONs_1Tree_VariableBatchSize(args, 8, 2, 32, 2, true, false, OneTreeAtATimePipelinedPrefetchSchedule<4, 2>);
+}
+
+bool Test_RandomXGBoostJSONs_4Trees_BatchSize8_TileSize4_4Pipelined_Prefetch(TestArgs_t& args) {
+  return Test_RandomXGBoostJSONs_4Trees_VariableBatchSize(args, 8, 4, 32, 3, true, false, OneTreeAtATimePipelinedPrefetchSchedule<4, 4>);
+}
+
 bool Test_RandomXGBoostJSONs_1Tree_BatchSize2(TestArgs_t& args) {
   if (RunSingleBatchSizeForXGBoostTests)
     return true;
@@ -828,6 +877,577 @@ bool Test_TileSize8_Abalone(TestArgs_t &args) {
   return Test_SingleTileSize_SingleModel(args, modelJSONPath, tileSize);
 }
 
+// Tile size 16 is larger than TileShapeToTileIDMap::kMaxTileSizeWithLUT and uses the tile child table
+bool Test_TileSize16_Abalone(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto testModelsDir = repoPath + "/xgb_models";
+  auto modelJSONPath = testModelsDir + "/abalone_xgb_model_save.json";
+  int32_t tileSize = 16;
+  return Test_SingleTileSize_SingleModel(args, modelJSONPath, tileSize);
+}
+
+// Thresholds are replaced by bin indices and the inputs are binned before the trees are walked
+bool Test_QuantizedModel_SingleTileSize(TestArgs_t &args, const std::string& modelJSONPath, int32_t tileSize) {
+  auto csvPath = modelJSONPath + ".csv";
+  auto quantizeModel = [](TreeBeard::CompilerOptions& options) { options.SetQuantizeModel(true); };
+  int32_t tileShapeBitWidth=32, childIndexBitWidth=1;
+  if (!RunSingleBatchSizeForXGBoostTests)
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<double>(args, 1, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, nullptr, -1, quantizeModel));
+  Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<double>(args, 4, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, nullptr, -1, quantizeModel));
+  Test_ASSERT((Test_CodeGenForJSON_VariableBatchSize<double, int16_t>(args, 4, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, nullptr, -1, quantizeModel)));
+  Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, 4, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, nullptr, -1, quantizeModel));
+  return true;
+}
+
+bool Test_Quantized_Scalar_Abalone(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/abalone_xgb_model_save.json";
+  return Test_QuantizedModel_SingleTileSize(args, modelJSONPath, 1);
+}
+
+bool Test_Quantized_TileSize4_Abalone(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/abalone_xgb_model_save.json";
+  return Test_QuantizedModel_SingleTileSize(args, modelJSONPath, 4);
+}
+
+bool Test_Quantized_TileSize8_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  return Test_QuantizedModel_SingleTileSize(args, modelJSONPath, 8);
+}
+
+// The sigmoid is computed with the polynomial exp. The default schedule applies it as the predictions are stored. 
+// With one tree at a time, it's applied to vectors of results after the trees are walked and a batch size of 3 
+// also runs the scalar remainder loop.
+bool Test_FastApproximateTransforms_SingleTileSize(TestArgs_t &args, const std::string& modelJSONPath, int32_t tileSize) {
+  auto csvPath = modelJSONPath + ".csv";
+  auto useFastApproximateTransforms = [](TreeBeard::CompilerOptions& options) { options.SetUseFastApproximateTransforms(true); };
+  for (int64_t batchSize : {1, 3, 8}) {
+    for (auto scheduleManipulator : {(ScheduleManipulator_t)nullptr, OneTreeAtATimeSchedule}) {
+      Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<double>(args, batchSize, modelJSONPath, csvPath, tileSize, 32, 1, false, false, scheduleManipulator,
+                                                                -1, useFastApproximateTransforms));
+      Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, batchSize, modelJSONPath, csvPath, tileSize, 32, 1, false, false, scheduleManipulator,
+                                                               -1, useFastApproximateTransforms));
+    }
+  }
+  return true;
+}
+
+bool Test_FastApproximateTransforms_TileSize4_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  return Test_FastApproximateTransforms_SingleTileSize(args, modelJSONPath, 4);
+}
+
+bool Test_FastApproximateTransforms_TileSize8_Higgs(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/higgs_xgb_model_save.json";
+  return Test_FastApproximateTransforms_SingleTileSize(args, modelJSONPath, 8);
+}
+
+template<int32_t TreeGroupSize>
+void EarlyExitSchedule(decisionforest::Schedule* schedule) {
+  schedule->EarlyExit(schedule->GetTreeIndex(), TreeGroupSize);
+}
+
+enum class EarlyExitOutcome { kExits, kWalksAllTrees, kTooCloseToCall };
+
+// Mirrors the cuts the compiler puts between groups of trees (see GetEarlyExitTreeGroups) for a probability
+// threshold of 0.5. The cuts are rounded in the accumulator type, so rows whose partial margin is close to a
+// cut may go either way.
+static EarlyExitOutcome GetEarlyExitOutcome(decisionforest::DecisionForest& forest, std::vector<float>& row, int32_t treeGroupSize) {
+  const double tolerance = 1e-4;
+  int64_t numTrees = forest.NumTrees();
+  std::vector<double> suffixMin(numTrees + 1, 0.0), suffixMax(numTrees + 1, 0.0);
+  for (int64_t i=numTrees-1 ; i>=0 ; --i) {
+    double minLeaf = std::numeric_limits<double>::infinity();
+    double maxLeaf = -std::numeric_limits<double>::infinity();
+    for (auto& node : forest.GetTree(i).GetNodes()) {
+      if (!node.IsLeaf())
+        continue;
+      minLeaf = std::min(minLeaf, node.threshold);
+      maxLeaf = std::max(maxLeaf, node.threshold);
+    }
+    suffixMin[i] = suffixMin[i+1] + minLeaf;
+    suffixMax[i] = suffixMax[i+1] + maxLeaf;
+  }
+  double marginThreshold = -forest.GetInitialOffset();
+  double partialSum = 0.0;
+  for (int64_t start=0 ; start<numTrees ; start += treeGroupSize) {
+    int64_t end = std::min(start + treeGroupSize, numTrees);
+    for (int64_t i=start ; i<end ; ++i)
+      partialSum += forest.GetTree(i).PredictTree_Float(row);
+    if (end == numTrees)
+      break;
+    double negativeCut = marginThreshold - suffixMax[end];
+    double positiveCut = marginThreshold - suffixMin[end];
+    if (std::abs(partialSum - negativeCut) < tolerance || std::abs(partialSum - positiveCut) < tolerance)
+      return EarlyExitOutcome::kTooCloseToCall;
+    if (partialSum <= negativeCut || partialSum > positiveCut)
+      return EarlyExitOutcome::kExits;
+  }
+  return EarlyExitOutcome::kWalksAllTrees;
+}
+
+// Rows that exit early return a partial probability, so only the predicted class is compared for them. 
+// Rows that never cross a cut walk all the trees and must return the probability of the whole ensemble.
+template<int32_t TreeGroupSize>
+static bool Test_EarlyExit_BinaryClassifier(TestArgs_t &args, const std::string& modelJsonPath, int32_t tileSize) {
+  using FloatType = float;
+  const int64_t batchSize = 4;
+  auto model = CompileXGBoostJSONForTest<FloatType>(modelJsonPath, batchSize, tileSize, EarlyExitSchedule<TreeGroupSize>);
+  auto& inferenceRunner = *model.inferenceRunner;
+
+  mlir::MLIRContext context;
+  TreeBeard::XGBoostJSONParser<> xgBoostParser(context, modelJsonPath, decisionforest::ConstructModelSerializer(""), 1);
+  xgBoostParser.ConstructForest();
+  auto forest = xgBoostParser.GetForest();
+
+  TestCSVReader csvReader(modelJsonPath + ".csv");
+  for (size_t i=batchSize ; i<csvReader.NumberOfRows()-1 ; i += batchSize) {
+    std::vector<FloatType> batch, expectedResults;
+    std::vector<EarlyExitOutcome> outcomes;
+    for (int64_t j=0 ; j<batchSize ; ++j) {
+      auto row = csvReader.GetRowOfType<FloatType>((i-batchSize) + j);
+      expectedResults.push_back(row.back());
+      row.pop_back();
+      outcomes.push_back(GetEarlyExitOutcome(*forest, row, TreeGroupSize));
+      batch.insert(batch.end(), row.begin(), row.end());
+    }
+    std::vector<FloatType> results(batchSize, -1);
+    inferenceRunner.RunInference<FloatType, FloatType>(batch.data(), results.data());
+    for (int64_t rowIdx=0 ; rowIdx<batchSize ; ++rowIdx) {
+      if (outcomes[rowIdx] == EarlyExitOutcome::kWalksAllTrees)
+        Test_ASSERT(FPEqual<FloatType>(results[rowIdx], expectedResults[rowIdx]));
+      if (std::abs(expectedResults[rowIdx] - 0.5) < 1e-6)
+        continue;
+      Test_ASSERT(results[rowIdx] >= 0 && results[rowIdx] <= 1);
+      Test_ASSERT((results[rowIdx] > 0.5) == (expectedResults[rowIdx] > 0.5));
+    }
+  }
+  return true;
+}
+
+bool Test_EarlyExit_TileSize4_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  return Test_EarlyExit_BinaryClassifier<10>(args, modelJSONPath, 4);
+}
+
+bool Test_EarlyExit_TileSize8_Higgs(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/higgs_xgb_model_save.json";
+  return Test_EarlyExit_BinaryClassifier<25>(args, modelJSONPath, 8);
+}
+
+template<bool ReorderTreesByContributionVariance>
+void AnytimePredictionSchedule(decisionforest::Schedule* schedule) {
+  schedule->AnytimePrediction(schedule->GetTreeIndex(), ReorderTreesByContributionVariance);
+}
+
+// The margins of all the trees must match the model. Prefixes of the forest must not depend on how they are 
+// split into groups, and a zero time budget must stop after the first group.
+static bool Test_AnytimePrediction_BinaryClassifier(TestArgs_t &args, const std::string& modelJsonPath, int32_t tileSize,
+                                                    ScheduleManipulator_t scheduleManipulatorFunc) {
+  using FloatType = float;
+  const int64_t batchSize = 4;
+  auto model = CompileXGBoostJSONForTest<FloatType>(modelJsonPath, batchSize, tileSize, scheduleManipulatorFunc);
+  auto& inferenceRunner = *model.inferenceRunner;
+
+  const int64_t prefixLength = 10;
+  TestCSVReader csvReader(modelJsonPath + ".csv");
+  for (size_t i=batchSize ; i<csvReader.NumberOfRows()-1 ; i += batchSize) {
+    std::vector<FloatType> batch, expectedResults;
+    for (int64_t j=0 ; j<batchSize ; ++j) {
+      auto row = csvReader.GetRowOfType<FloatType>((i-batchSize) + j);
+      expectedResults.push_back(row.back());
+      row.pop_back();
+      batch.insert(batch.end(), row.begin(), row.end());
+    }
+    std::vector<FloatType> fullMargins(batchSize), prefixMargins(batchSize), groupedPrefixMargins(batchSize), 
+                           budgetMargins(batchSize), margins(batchSize);
+    auto numTrees = inferenceRunner.RunAnytimeInference<FloatType>(batch.data(), fullMargins.data(), -1, -1, 7);
+    Test_ASSERT(inferenceRunner.RunAnytimeInference<FloatType>(batch.data(), prefixMargins.data(), prefixLength, -1, prefixLength) == prefixLength);
+    Test_ASSERT(inferenceRunner.RunAnytimeInference<FloatType>(batch.data(), groupedPrefixMargins.data(), prefixLength, -1, 3) == prefixLength);
+    Test_ASSERT(inferenceRunner.RunAnytimeInference<FloatType>(batch.data(), budgetMargins.data(), -1, 0, prefixLength) == prefixLength);
+    // Anytime prediction must restore the range of all the trees
+    inferenceRunner.RunInference<FloatType, FloatType>(batch.data(), margins.data());
+    for (int64_t rowIdx=0 ; rowIdx<batchSize ; ++rowIdx) {
+      Test_ASSERT(FPEqual<FloatType>(1.0/(1.0 + std::exp(-fullMargins[rowIdx])), expectedResults[rowIdx]));
+      Test_ASSERT(FPEqual<FloatType>(margins[rowIdx], fullMargins[rowIdx]));
+      Test_ASSERT(FPEqual<FloatType>(groupedPrefixMargins[rowIdx], prefixMargins[rowIdx]));
+      Test_ASSERT(FPEqual<FloatType>(budgetMargins[rowIdx], prefixMargins[rowIdx]));
+    }
+    Test_ASSERT(numTrees > prefixLength);
+  }
+  return true;
+}
+
+bool Test_AnytimePrediction_TileSize4_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  return Test_AnytimePrediction_BinaryClassifier(args, modelJSONPath, 4, AnytimePredictionSchedule<false>);
+}
+
+bool Test_AnytimePrediction_TileSize8_Higgs_ReorderByVariance(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/higgs_xgb_model_save.json";
+  return Test_AnytimePrediction_BinaryClassifier(args, modelJSONPath, 8, AnytimePredictionSchedule<true>);
+}
+
+// Unreachable branches and splits with identical leaves are removed and constant and identical trees are merged before tiling
+bool Test_SimplifiedForest_SingleTileSize(TestArgs_t &args, const std::string& modelJSONPath, int32_t tileSize) {
+  auto csvPath = modelJSONPath + ".csv";
+  auto simplifyForest = [](TreeBeard::CompilerOptions& options) { options.SetSimplifyForest(true); };
+  auto simplifyAndQuantize = [](TreeBeard::CompilerOptions& options) {
+    options.SetSimplifyForest(true);
+    options.SetQuantizeModel(true);
+  };
+  int32_t tileShapeBitWidth=32, childIndexBitWidth=1;
+  if (!RunSingleBatchSizeForXGBoostTests)
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<double>(args, 1, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, nullptr, -1, simplifyForest));
+  Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<double>(args, 4, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, nullptr, -1, simplifyForest));
+  Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, 4, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, nullptr, -1, simplifyForest));
+  // Quantization runs on the simplified forest
+  Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, 4, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, nullptr, -1, simplifyAndQuantize));
+  return true;
+}
+
+bool Test_SimplifiedForest_Scalar_Abalone(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/abalone_xgb_model_save.json";
+  return Test_SimplifiedForest_SingleTileSize(args, modelJSONPath, 1);
+}
+
+bool Test_SimplifiedForest_TileSize4_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  return Test_SimplifiedForest_SingleTileSize(args, modelJSONPath, 4);
+}
+
+// The used features are renumbered densely. Without a cached batch loop, the used columns of all the rows 
+// are copied up front. With one, they are copied when the rows of a batch tile are cached.
+template<int32_t BatchTileSize>
+void CachedBatchTileSchedule(mlir::decisionforest::Schedule* schedule) {
+  auto& batchIndexVar = schedule->GetBatchIndex();
+  auto& b0 = schedule->NewIndexVariable("b0");
+  auto& b1 = schedule->NewIndexVariable("b1");
+  schedule->Tile(batchIndexVar, b0, b1, BatchTileSize);
+  schedule->Cache(b0);
+}
+
+bool Test_CompactFeatures_SingleTileSize(TestArgs_t &args, const std::string& modelJSONPath, int32_t tileSize, ScheduleManipulator_t scheduleManipulatorFunc) {
+  auto csvPath = modelJSONPath + ".csv";
+  auto compactFeatures = [](TreeBeard::CompilerOptions& options) { options.SetCompactFeatures(true); };
+  auto compactAndQuantize = [](TreeBeard::CompilerOptions& options) {
+    options.SetCompactFeatures(true);
+    options.SetQuantizeModel(true);
+  };
+  int32_t tileShapeBitWidth=32, childIndexBitWidth=1;
+  Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<double>(args, 4, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, 
+                                                            scheduleManipulatorFunc, -1, compactFeatures));
+  Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, 4, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, 
+                                                           scheduleManipulatorFunc, -1, compactFeatures));
+  // The compacted rows are binned
+  Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, 4, modelJSONPath, csvPath, tileSize, tileShapeBitWidth, childIndexBitWidth, false, false, 
+                                                           scheduleManipulatorFunc, -1, compactAndQuantize));
+  return true;
+}
+
+bool Test_CompactFeatures_TileSize4_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  return Test_CompactFeatures_SingleTileSize(args, modelJSONPath, 4, nullptr);
+}
+
+bool Test_CompactFeatures_CachedRows_TileSize8_Higgs(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/higgs_xgb_model_save.json";
+  return Test_CompactFeatures_SingleTileSize(args, modelJSONPath, 8, CachedBatchTileSchedule<2>);
+}
+
+// The compiler picks the threshold, feature index, node index, tile shape and child index widths
+template<typename FloatType>
+bool Test_CodeGenForJSON_AutoTypeWidths(TestArgs_t& args, int64_t batchSize, const std::string& modelJsonPath, int32_t tileSize, 
+                                        int32_t expectedFeatureIndexWidth) {
+  const auto autoWidth = TreeBeard::CompilerOptions::kAutoTypeWidth;
+  auto model = CompileXGBoostJSONForTest<FloatType>(modelJsonPath, batchSize, tileSize, nullptr,
+                                                    [](TreeBeard::CompilerOptions& options) { options.SetAutoTypeWidths(); });
+
+  auto& selectedOptions = model.tbContext->options;
+  Test_ASSERT(selectedOptions.thresholdTypeWidth == 32 || selectedOptions.thresholdTypeWidth == 64);
+  Test_ASSERT(selectedOptions.featureIndexTypeWidth == expectedFeatureIndexWidth);
+  Test_ASSERT(selectedOptions.nodeIndexTypeWidth != autoWidth);
+  Test_ASSERT(selectedOptions.tileShapeBitWidth != autoWidth && selectedOptions.childIndexBitWidth != autoWidth);
+  return ValidateModuleOutputAgainstCSVdata<FloatType, FloatType>(*model.inferenceRunner, modelJsonPath + ".csv", batchSize);
+}
+
+bool Test_AutoTypeWidths_Scalar_Abalone(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/abalone_xgb_model_save.json";
+  Test_ASSERT(Test_CodeGenForJSON_AutoTypeWidths<float>(args, 4, modelJSONPath, 1, 8));
+  Test_ASSERT(Test_CodeGenForJSON_AutoTypeWidths<double>(args, 4, modelJSONPath, 1, 8));
+  return true;
+}
+
+bool Test_AutoTypeWidths_TileSize8_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  return Test_CodeGenForJSON_AutoTypeWidths<float>(args, 4, modelJSONPath, 8, 8);
+}
+
+bool Test_SparseAutoTypeWidths_TileSize4_Year(TestArgs_t &args) {
+  decisionforest::UseSparseTreeRepresentation = true;
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/year_prediction_msd_xgb_model_save.json";
+  return Test_CodeGenForJSON_AutoTypeWidths<float>(args, 4, modelJSONPath, 4, 8);
+}
+
+bool Test_SparseAutoTypeWidths_TileSize8_Higgs(TestArgs_t &args) {
+  decisionforest::UseSparseTreeRepresentation = true;
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/higgs_xgb_model_save.json";
+  return Test_CodeGenForJSON_AutoTypeWidths<float>(args, 4, modelJSONPath, 8, 8);
+}
+
+// The trees are walked in NumChunks parallel chunks, each of which loops over all the rows of the batch.
+// The last chunk is shorter if NumChunks doesn't divide the number of trees.
+template<int32_t NumChunks>
+void TreeParallelSchedule(mlir::decisionforest::Schedule* schedule) {
+  auto& treeIndexVar = schedule->GetTreeIndex();
+  auto& batchIndexVar = schedule->GetBatchIndex();
+  auto& t0 = schedule->NewIndexVariable("t0");
+  auto& t1 = schedule->NewIndexVariable("t1");
+  schedule->Tile(treeIndexVar, t0, t1, (schedule->GetForestSize() + NumChunks - 1)/NumChunks, true);
+  schedule->Reorder({&t0, &batchIndexVar, &t1});
+  schedule->Parallel(t0);
+}
+
+bool Test_TreeParallelSchedule_TileSize4_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  auto csvPath = modelJSONPath + ".csv";
+  for (int64_t batchSize : {1, 4}) {
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, batchSize, modelJSONPath, csvPath, 4, 32, 1, false, false, TreeParallelSchedule<4>));
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<double>(args, batchSize, modelJSONPath, csvPath, 4, 32, 1, false, false, TreeParallelSchedule<4>));
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, batchSize, modelJSONPath, csvPath, 4, 32, 1, false, false, TreeParallelSchedule<3>));
+  }
+  return true;
+}
+
+// Without tiling, the tree loop has an iteration per tree. With a batch size of 200, the partial sums of the 
+// 100 trees don't fit the bound on stack allocations and are allocated on the heap.
+bool Test_UntiledTreeParallelSchedule_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  auto csvPath = modelJSONPath + ".test.sampled.csv";
+  auto parallelTrees = [](decisionforest::Schedule* schedule) {
+    auto& treeIndexVar = schedule->GetTreeIndex();
+    schedule->Reorder({&treeIndexVar, &schedule->GetBatchIndex()});
+    schedule->Parallel(treeIndexVar);
+  };
+  for (int64_t batchSize : {4, 200})
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, batchSize, modelJSONPath, csvPath, 4, 32, 1, false, false, parallelTrees));
+  return true;
+}
+
+// The trees are split into cost balanced chunks by the compiler. With 3 and 7 cores, the last chunk has fewer trees.
+bool Test_ParallelizeTrees_TileSize8_Higgs(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/higgs_xgb_model_save.json";
+  auto csvPath = modelJSONPath + ".csv";
+  for (int64_t batchSize : {1, 4}) {
+    for (int32_t numberOfCores : {4, 3, 7}) {
+      auto parallelizeTrees = [numberOfCores](TreeBeard::CompilerOptions& options) {
+        options.numberOfCores = numberOfCores;
+        options.SetParallelizeTrees(true);
+      };
+      Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, batchSize, modelJSONPath, csvPath, 8, 32, 1, false, false, nullptr, 
+                                                               -1, parallelizeTrees));
+    }
+  }
+  return true;
+}
+
+// Every row is predicted with the single row entry point of a model compiled for a batch size of 1
+template<typename FloatType>
+bool Test_CodeGenForJSON_SingleRowPredict(TestArgs_t& args, const std::string& modelJsonPath, int32_t tileSize, bool reorderTrees) {
+  auto model = CompileXGBoostJSONForTest<FloatType>(modelJsonPath, 1, tileSize, nullptr,
+                                                    [reorderTrees](TreeBeard::CompilerOptions& options) { options.reorderTreesByDepth = reorderTrees; });
+  auto& inferenceRunner = *model.inferenceRunner;
+
+  TestCSVReader csvReader(modelJsonPath + ".csv");
+  for (size_t i=0 ; i<csvReader.NumberOfRows()-1 ; ++i) {
+    auto row = csvReader.GetRowOfType<FloatType>(i);
+    FloatType expectedResult = row.back();
+    row.pop_back();
+    FloatType result = -1, batchResult = -1;
+    inferenceRunner.RunSingleRowInference<FloatType, FloatType>(row.data(), &result);
+    inferenceRunner.RunInference<FloatType, FloatType>(row.data(), &batchResult);
+    Test_ASSERT(FPEqual<FloatType>(result, expectedResult));
+    Test_ASSERT(result == batchResult);
+  }
+  return true;
+}
+
+bool Test_SingleRowPredict_TileSize4_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  Test_ASSERT(Test_CodeGenForJSON_SingleRowPredict<float>(args, modelJSONPath, 4, false));
+  Test_ASSERT(Test_CodeGenForJSON_SingleRowPredict<double>(args, modelJSONPath, 4, false));
+  return true;
+}
+
+bool Test_SingleRowPredict_ReorderTrees_TileSize8_Higgs(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/higgs_xgb_model_save.json";
+  return Test_CodeGenForJSON_SingleRowPredict<float>(args, modelJSONPath, 8, true);
+}
+
+// Every iteration of a loop run on the task runtime must run exactly once, including the iterations 
+// of loops nested inside it
+struct ParallelForTestState {
+  std::vector<std::atomic<int32_t>> counts;
+  int64_t innerIterations;
+  ParallelForTestState(int64_t numIterations, int64_t inner) 
+    : counts(numIterations*inner), innerIterations(inner)
+  {
+    for (auto& count : counts)
+      count.store(0);
+  }
+};
+
+void CountIterations(int64_t begin, int64_t end, void *context) {
+  auto counts = reinterpret_cast<std::atomic<int32_t>*>(context);
+  for (auto i=begin ; i<end ; ++i)
+    counts[i].fetch_add(1);
+}
+
+void RunInnerParallelLoops(int64_t begin, int64_t end, void *context) {
+  auto state = reinterpret_cast<ParallelForTestState*>(context);
+  for (auto i=begin ; i<end ; ++i)
+    TreebeardParallelFor(state->innerIterations, CountIterations, state->counts.data() + i*state->innerIterations);
+}
+
+bool Test_WorkStealingRuntime_ParallelFor(TestArgs_t &args) {
+  for (int64_t numIterations : {1, 7, 1000, 100000}) {
+    ParallelForTestState state(numIterations, 1);
+    TreebeardParallelFor(numIterations, CountIterations, state.counts.data());
+    for (auto& count : state.counts)
+      Test_ASSERT(count.load() == 1);
+  }
+  ParallelForTestState nestedState(64, 100);
+  TreebeardParallelFor(64, RunInnerParallelLoops, &nestedState);
+  for (auto& count : nestedState.counts)
+    Test_ASSERT(count.load() == 1);
+  return true;
+}
+
+bool Test_WorkStealingRuntime_ParallelBatch_TileSize8_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  auto csvPath = modelJSONPath + ".test.sampled.csv";
+  auto parallelBatch = [](decisionforest::Schedule* schedule) { schedule->Parallel(schedule->GetBatchIndex()); };
+  auto useWorkStealingRuntime = [](TreeBeard::CompilerOptions& options) { options.SetUseWorkStealingRuntime(true); };
+  for (int64_t batchSize : {1, 7, 200}) {
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, batchSize, modelJSONPath, csvPath, 8, 16, 1, false, false, parallelBatch,
+                                                             -1, useWorkStealingRuntime));
+  }
+  return true;
+}
+
+bool Test_WorkStealingRuntime_ParallelizeTrees_TileSize8_Higgs(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/higgs_xgb_model_save.json";
+  auto csvPath = modelJSONPath + ".csv";
+  auto parallelizeTreesWithWorkStealing = [](TreeBeard::CompilerOptions& options) {
+    options.numberOfCores = 4;
+    options.SetParallelizeTrees(true);
+    options.SetUseWorkStealingRuntime(true);
+  };
+  for (int64_t batchSize : {1, 4}) {
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, batchSize, modelJSONPath, csvPath, 8, 32, 1, false, false, nullptr, 
+                                                             -1, parallelizeTreesWithWorkStealing));
+  }
+  return true;
+}
+
+bool Test_ModelReplicas_Runtime(TestArgs_t &args) {
+  std::vector<double> buffer(1000);
+  for (size_t i=0 ; i<buffer.size() ; ++i)
+    buffer[i] = static_cast<double>(i) * 0.5;
+  auto bufferSize = static_cast<int64_t>(buffer.size() * sizeof(double));
+  for (int32_t hugePages : {runtime::kRegularPages, runtime::kTransparentHugePages, runtime::kExplicitHugePages}) {
+    TreebeardReplicateBuffer(buffer.data(), bufferSize, hugePages);
+    auto replica = reinterpret_cast<double*>(TreebeardGetLocalReplica(buffer.data()));
+    Test_ASSERT(replica != buffer.data());
+    Test_ASSERT(std::equal(buffer.begin(), buffer.end(), replica));
+    
+    std::vector<int64_t> bytesPerNode(runtime::GetNumberOfNUMANodes());
+    auto numNodes = TreebeardGetReplicaMemoryUsage(bytesPerNode.data(), bytesPerNode.size());
+    Test_ASSERT(numNodes == runtime::GetNumberOfNUMANodes());
+    for (auto bytes : bytesPerNode)
+      Test_ASSERT(bytes >= bufferSize);
+
+    // A second registration shares the replicas, which stay valid until both registrations are released
+    TreebeardReplicateBuffer(buffer.data(), bufferSize, hugePages);
+    Test_ASSERT(TreebeardGetLocalReplica(buffer.data()) == replica);
+    TreebeardReleaseReplicas(buffer.data());
+    Test_ASSERT(TreebeardGetLocalReplica(buffer.data()) == replica);
+    Test_ASSERT(std::equal(buffer.begin(), buffer.end(), replica));
+
+    TreebeardReleaseReplicas(buffer.data());
+    Test_ASSERT(TreebeardGetLocalReplica(buffer.data()) == buffer.data());
+  }
+  return true;
+}
+
+bool Test_ModelReplicas_ParallelBatch_TileSize8_Airline(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline_xgb_model_save.json";
+  auto csvPath = modelJSONPath + ".test.sampled.csv";
+  auto parallelBatch = [](decisionforest::Schedule* schedule) { schedule->Parallel(schedule->GetBatchIndex()); };
+  for (int32_t hugePages : {runtime::kRegularPages, runtime::kTransparentHugePages}) {
+    auto replicateModelWithWorkStealing = [hugePages](TreeBeard::CompilerOptions& options) {
+      options.SetUseWorkStealingRuntime(true);
+      options.SetReplicateModelPerNUMANode(true, hugePages);
+    };
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, 200, modelJSONPath, csvPath, 8, 16, 1, false, false, parallelBatch,
+                                                             -1, replicateModelWithWorkStealing));
+  }
+  return true;
+}
+
+bool Test_ModelReplicas_TileSize4_Higgs(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/higgs_xgb_model_save.json";
+  auto csvPath = modelJSONPath + ".csv";
+  auto replicateModel = [](TreeBeard::CompilerOptions& options) { options.SetReplicateModelPerNUMANode(true, runtime::kRegularPages); };
+  Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<float>(args, 4, modelJSONPath, csvPath, 4, 16, 1, false, false, nullptr,
+                                                           -1, replicateModel));
+  return true;
+}
+
+// The UBJSON models are the JSON models of the random forests converted to UBJSON with XGBoost's 
+// typed arrays and so have the same expected outputs.
+bool Test_UBJSONModel_RandomForests(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto testModelsDir = repoPath + "/xgb_models/test";
+  std::vector<std::pair<std::string, std::string>> models = {
+    { "UBJSON/TestModel_Size2_1.ubj", "Random_2Tree/TestModel_Size2_1.json.csv" },
+    { "UBJSON/TestModel_Size2_12.ubj", "Random_2Tree/TestModel_Size2_12.json.csv" },
+    { "UBJSON/TestModel_Size4_23.ubj", "Random_4Tree/TestModel_Size4_23.json.csv" },
+  };
+  for (auto& model : models) {
+    auto modelPath = testModelsDir + "/" + model.first;
+    auto csvPath = testModelsDir + "/" + model.second;
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<double>(args, 4, modelPath, csvPath, 1, 16, 1, false, false));
+    Test_ASSERT(Test_CodeGenForJSON_VariableBatchSize<double>(args, 4, modelPath, csvPath, 4, 16, 1, false, false));
+  }
+  return true;
+}
+
 bool Test_Scalar_Airline(TestArgs_t &args) {
   auto repoPath = GetTreeBeardRepoPath();
   auto testModelsDir = repoPath + "/xgb_models";
@@ -1144,6 +1764,68 @@ bool Test_TileSize8_Letters_5Pipelined_Int8Type(TestArgs_t &args) {
   return Test_TileSizeVariable_Letters_Pipelined_Int8Type(args, 8, 5);
 }
 
+// The margins and probabilities of a multi-class model are selected per call on the same compiled module
+static bool Test_ClassScores_MultiClass(TestArgs_t &args, const std::string& modelJsonPath, const std::string& csvPath, int32_t tileSize,
+                                        ScheduleManipulator_t scheduleManipulatorFunc) {
+  using FloatType = float;
+  using ResultType = int8_t;
+  const int64_t batchSize = 4;
+  auto model = CompileXGBoostJSONForTest<FloatType, int32_t, ResultType>(modelJsonPath, batchSize, tileSize, scheduleManipulatorFunc);
+  auto& inferenceRunner = *model.inferenceRunner;
+
+  auto numClasses = inferenceRunner.GetNumberOfClasses();
+  Test_ASSERT(numClasses > 1);
+  TestCSVReader csvReader(csvPath);
+  for (size_t i=batchSize ; i<csvReader.NumberOfRows()-1 ; i += batchSize) {
+    std::vector<FloatType> batch;
+    std::vector<ResultType> expectedClasses;
+    for (int64_t j=0 ; j<batchSize ; ++j) {
+      auto row = csvReader.GetRowOfType<FloatType>((i-batchSize) + j);
+      expectedClasses.push_back(static_cast<ResultType>(row.back()));
+      row.pop_back();
+      batch.insert(batch.end(), row.begin(), row.end());
+    }
+    std::vector<ResultType> classes(batchSize, -1);
+    std::vector<FloatType> margins(batchSize*numClasses), probabilities(batchSize*numClasses);
+    inferenceRunner.RunInference<FloatType, ResultType>(batch.data(), classes.data(), decisionforest::PredictionOutputMode::kPrediction);
+    inferenceRunner.RunInference<FloatType, ResultType>(batch.data(), margins.data(), decisionforest::PredictionOutputMode::kMargins);
+    inferenceRunner.RunInference<FloatType, ResultType>(batch.data(), probabilities.data(), decisionforest::PredictionOutputMode::kProbabilities);
+    for (int64_t rowIdx=0 ; rowIdx<batchSize ; ++rowIdx) {
+      Test_ASSERT(classes[rowIdx] == expectedClasses[rowIdx]);
+      auto rowMargins = margins.begin() + rowIdx*numClasses;
+      auto rowProbabilities = probabilities.begin() + rowIdx*numClasses;
+      Test_ASSERT(std::max_element(rowMargins, rowMargins + numClasses) - rowMargins == classes[rowIdx]);
+      Test_ASSERT(std::max_element(rowProbabilities, rowProbabilities + numClasses) - rowProbabilities == classes[rowIdx]);
+      // The probabilities are the softmax of the margins
+      auto maxMargin = *std::max_element(rowMargins, rowMargins + numClasses);
+      double sumOfExponentials = 0;
+      for (int32_t k=0 ; k<numClasses ; ++k)
+        sumOfExponentials += std::exp(static_cast<double>(rowMargins[k] - maxMargin));
+      FloatType sumOfProbabilities = 0;
+      for (int32_t k=0 ; k<numClasses ; ++k) {
+        Test_ASSERT(rowProbabilities[k] >= 0 && rowProbabilities[k] <= 1);
+        auto expectedProbability = std::exp(static_cast<double>(rowMargins[k] - maxMargin)) / sumOfExponentials;
+        Test_ASSERT(FPEqual<FloatType>(rowProbabilities[k], static_cast<FloatType>(expectedProbability)));
+        sumOfProbabilities += rowProbabilities[k];
+      }
+      Test_ASSERT(std::abs(sumOfProbabilities - 1) < 1e-5);
+    }
+  }
+  return true;
+}
+
+bool Test_TileSize4_Letters_ClassScores(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/letters_xgb_model_save.json";
+  return Test_ClassScores_MultiClass(args, modelJSONPath, modelJSONPath + ".test.sampled.csv", 4, nullptr);
+}
+
+bool Test_TileSize8_CovType_OneTreeAtATime_ClassScores(TestArgs_t &args) {
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/covtype_xgb_model_save.json";
+  return Test_ClassScores_MultiClass(args, modelJSONPath, modelJSONPath + ".csv", 8, OneTreeAtATimeSchedule);
+}
+
 // ===----------------------------------------------------------------=== //
 // XGBoost Benchmark Code Gen Correctness Tests With XGBoost Schedule
 // ===----------------------------------------------------------------=== //
@@ -1495,6 +2177,15 @@ bool Test_SparseTileSize8_Abalone(TestArgs_t &args) {
   return Test_SingleTileSize_SingleModel(args, modelJSONPath, tileSize, false, 32, 32);
 }
 
+bool Test_SparseTileSize16_Abalone(TestArgs_t &args) {
+  decisionforest::UseSparseTreeRepresentation = true;
+  auto repoPath = GetTreeBeardRepoPath();
+  auto testModelsDir = repoPath + "/xgb_models";
+  auto modelJSONPath = testModelsDir + "/abalone_xgb_model_save.json";
+  int32_t tileSize = 16;
+  return Test_SingleTileSize_SingleModel(args, modelJSONPath, tileSize, false, 32, 32);
+}
+
 bool Test_SparseScalar_Airline(TestArgs_t &args) {
   decisionforest::UseSparseTreeRepresentation = true;
   auto repoPath = GetTreeBeardRepoPath();
@@ -1540,6 +2231,25 @@ bool Test_SparseTileSize8_Airline(TestArgs_t &args) {
   return Test_SingleTileSize_SingleModel(args, modelJSONPath, tileSize, false, 32, 32);
 }
 
+// Child indices of tiles point into a dictionary of the unique sibling groups of leaves of the forest
+bool Test_SparseTileSize8_LeafDictionary_Abalone(TestArgs_t &args) {
+  decisionforest::UseSparseTreeRepresentation = true;
+  decisionforest::UseLeafDictionaryCompression = true;
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/abalone_xgb_model_save.json";
+  int32_t tileSize = 8;
+  return Test_SingleTileSize_SingleModel(args, modelJSONPath, tileSize, false, 32, 32);
+}
+
+bool Test_SparseTileSize4_LeafDictionary_AirlineOHE(TestArgs_t &args) {
+  decisionforest::UseSparseTreeRepresentation = true;
+  decisionforest::UseLeafDictionaryCompression = true;
+  auto repoPath = GetTreeBeardRepoPath();
+  auto modelJSONPath = repoPath + "/xgb_models/airline-ohe_xgb_model_save.json";
+  int32_t tileSize = 4;
+  return Test_SingleTileSize_SingleModel(args, modelJSONPath, tileSize, true, 32, 32);
+}
+
 bool Test_SparseTileSize8_Pipeline4_Airline(TestArgs_t &args) {
   decisionforest::UseSparseTreeRepresentation = true;
   auto repoPath = GetTreeBeardRepoPath();
@@ -2262,7 +2972,8 @@ template<typename FloatType, typename FeatureIndexType=int32_t, typename ResultT
 bool Test_CodeGenForJSON_VariableBatchSize(TestArgs_t& args, int64_t batchSize, const std::string& modelJsonPath, const std::string& csvPath,
                                            const std::string& statsProfileCSV,
                                            int32_t tileSize, int32_t tileShapeBitWidth, int32_t childIndexBitWidth,
-                                           ScheduleManipulator_t scheduleManipulatorFunc=nullptr) {
+                                           ScheduleManipulator_t scheduleManipulatorFunc=nullptr,
+                                           TreeBeard::TilingType tilingType=TreeBeard::TilingType::kHybrid) {
   TestCSVReader csvReader(csvPath);
 
   using NodeIndexType = int32_t;
@@ -2270,7 +2981,8 @@ bool Test_CodeGenForJSON_VariableBatchSize(TestArgs_t& args, int64_t batchSize,
   ScheduleManipulationFunctionWrapper scheduleManipulator(scheduleManipulatorFunc);
   TreeBeard::CompilerOptions options(floatTypeBitWidth, sizeof(ResultType)*8, IsFloatType(ResultType()), sizeof(FeatureIndexType)*8, sizeof(NodeIndexType)*8,
                                      floatTypeBitWidth, batchSize, tileSize, tileShapeBitWidth, childIndexBitWidth,
-                                     TreeBeard::TilingType::kHybrid, false, false, scheduleManipulatorFunc ? &scheduleManipulator : nullptr);
+                                     tilingType, false, false, scheduleManipulatorFunc ? &scheduleManipulator : nullptr);
+  options.statsProfileCSVPath = statsProfileCSV;
 
   auto modelGlobalsJSONFilePath = TreeBeard::ForestCreator::ModelGlobalJSONFilePathFromJSONFilePath(modelJsonPath);
 
@@ -2499,6 +3211,47 @@ bool Test_SparseProbabilisticTiling_TileSize8_Year(TestArgs_t &args) {
   return Test_SingleTileSize_SingleModel_FloatOnly(args, modelJSONPath, statsProfileCSV, tileSize, false, 16, 16);
 }
 
+// ===-------------------------------------------------------------=== //
+// XGBoost Hot Path Sparse Layout Tests
+// ===-------------------------------------------------------------=== //
+
+// The tiles of each tree are laid out so that the most frequently hit child (per the profile) follows its parent
+bool Test_SparseHotPathLayout_SingleTileSize(TestArgs_t &args, const std::string& modelName, int32_t tileSize) {
+  decisionforest::UseSparseTreeRepresentation = true;
+  decisionforest::UseHotPathSparseLayout = true;
+  auto repoPath = GetTreeBeardRepoPath();
+  auto testModelsDir = repoPath + "/xgb_models";
+  auto modelJSONPath = testModelsDir + "/" + modelName + "_xgb_model_save.json";
+  auto statsProfileCSV = testModelsDir + "/profiles/" + modelName + ".test.csv";
+  auto csvPath = modelJSONPath + ".csv";
+  Test_ASSERT((Test_CodeGenForJSON_VariableBatchSize<float>(args, 4, modelJSONPath, csvPath, statsProfileCSV, tileSize, 16, 16, nullptr, TreeBeard::TilingType::kUniform)));
+  Test_ASSERT((Test_CodeGenForJSON_VariableBatchSize<float, int16_t>(args, 4, modelJSONPath, csvPath, statsProfileCSV, tileSize, 16, 16, 
+                                                                    OneTreeAtATimeSchedule, TreeBeard::TilingType::kUniform)));
+  // Without a profile, children are laid out depth first in child order
+  Test_ASSERT((Test_CodeGenForJSON_VariableBatchSize<float>(args, 4, modelJSONPath, csvPath, "", tileSize, 16, 16, nullptr, TreeBeard::TilingType::kUniform)));
+  return true;
+}
+
+bool Test_SparseHotPathLayout_TileSize4_Abalone(TestArgs_t &args) {
+  return Test_SparseHotPathLayout_SingleTileSize(args, "abalone", 4);
+}
+
+bool Test_SparseHotPathLayout_TileSize8_Airline(TestArgs_t &args) {
+  return Test_SparseHotPathLayout_SingleTileSize(args, "airline", 8);
+}
+
+// Probabilistically tiled trees keep the level order layout and the rest of the trees use the hot path layout
+bool Test_SparseHotPathLayout_ProbabilisticTiling_TileSize8_AirlineOHE(TestArgs_t &args) {
+  decisionforest::UseSparseTreeRepresentation = true;
+  decisionforest::UseHotPathSparseLayout = true;
+  auto repoPath = GetTreeBeardRepoPath();
+  auto testModelsDir = repoPath + "/xgb_models";
+  auto modelJSONPath = testModelsDir + "/airline-ohe_xgb_model_save.json";
+  auto statsProfileCSV = testModelsDir + "/profiles/airline-ohe.test.csv";
+  int32_t tileSize = 8;
+  return Test_SingleTileSize_SingleModel_FloatOnly(args, modelJSONPath, statsProfileCSV, tileSize, true, 16, 16);
+}
+
 // ===-------------------------------------------------------------=== //
 // Random XGBoost Tiled Tree Padding Tests 
 // ===-------------------------------------------------------------=== //
@@ -2839,5 +3592,71 @@ bool Test_TileSize8_Year_TestInputs_ParallelBatch(TestArgs_t &args) {
   return true;
 }
 
+// ===---------------------------------------------------=== //
+// Streaming Inference Tests
+// ===---------------------------------------------------=== //
+
+// Streams the test inputs through the model in chunks of three batches with two workers, so that chunks 
+// are predicted out of order and the last batch may be partial, and checks the predictions written out.
+bool Test_XGBoostModel_StreamingInference(const std::string& modelJSONPath, const std::string& csvPath, StreamingFileFormat fileFormat) {
+  using FloatType = float;
+  const int32_t batchSize = 4, tileSize = 4;
+  auto model = CompileXGBoostJSONForTest<FloatType>(modelJSONPath, batchSize, tileSize);
+
+  TreeBeard::StreamingInferenceOptions streamingOptions;
+  streamingOptions.inputFormat = streamingOptions.outputFormat = fileFormat;
+  streamingOptions.batchesPerChunk = 3;
+  streamingOptions.numberOfChunks = 2;
+  streamingOptions.numberOfWorkers = 2;
+
+  TestCSVReader csvReader(csvPath);
+  std::vector<FloatType> expectedPredictions;
+  auto inputPath = csvPath;
+  if (fileFormat == StreamingFileFormat::kBinary) {
+    inputPath = GetTempFilePath();
+    std::ofstream fout(inputPath, std::ios::binary);
+    for (size_t i=0 ; i<csvReader.NumberOfRows()-1 ; ++i) {
+      auto row = csvReader.GetRowOfType<FloatType>(i);
+      expectedPredictions.push_back(row.back());
+      fout.write(reinterpret_cast<char*>(row.data()), (row.size() - 1)*sizeof(FloatType));
+    }
+  }
+  else {
+    streamingOptions.csvHasPredictionColumn = true;
+    for (size_t i=0 ; i<csvReader.NumberOfRows()-1 ; ++i)
+      expectedPredictions.push_back(csvReader.GetRowOfType<FloatType>(i).back());
+  }
+
+  auto outputPath = GetTempFilePath();
+  auto numRows = TreeBeard::RunStreamingInference(*model.inferenceRunner, true, inputPath, outputPath, streamingOptions);
+  Test_ASSERT(numRows == static_cast<int64_t>(expectedPredictions.size()));
+
+  std::vector<FloatType> predictions;
+  std::ifstream fin(outputPath, std::ios::binary);
+  if (fileFormat == StreamingFileFormat::kBinary) {
+    predictions.resize(numRows);
+    fin.read(reinterpret_cast<char*>(predictions.data()), numRows*sizeof(FloatType));
+  }
+  else {
+    std::string line;
+    while (std::getline(fin, line))
+      predictions.push_back(std::stof(line));
+  }
+  Test_ASSERT(predictions.size() == expectedPredictions.size());
+  for (size_t i=0 ; i<predictions.size() ; ++i)
+    Test_ASSERT(FPEqual<FloatType>(predictions[i], expectedPredictions[i]));
+  return true;
+}
+
+bool Test_StreamingInference_Airline_CSV(TestArgs_t &args) {
+  auto modelJSONPath = GetTreeBeardRepoPath() + "/xgb_models/airline_xgb_model_save.json";
+  return Test_XGBoostModel_StreamingInference(modelJSONPath, modelJSONPath + ".test.sampled.csv", StreamingFileFormat::kCSV);
+}
+
+bool Test_StreamingInference_Higgs_Binary(TestArgs_t &args) {
+  auto modelJSONPath = GetTreeBeardRepoPath() + "/xgb_models/higgs_xgb_model_save.json";
+  return Test_XGBoostModel_StreamingInference(modelJSONPath, modelJSONPath + ".test.sampled.csv", StreamingFileFormat::kBinary);
+}
+
 } // test
 } // TreeBeard
\ No newline at end of file
@@ -83,7 +83,7 @@ mlir::ModuleOp SpecializeNodeIndexType(TreebeardContext& tbContext) {
   else if (options.nodeIndexTypeWidth == 16) {
     return SpecializeInputElementType<ThresholdType, ReturnType, FeatureIndexType, int16_t>(tbContext);
   } 
-  else if (options.nodeIndexTypeWidth == 32) {
+  else if (options.nodeIndexTypeWidth == 32 || options.nodeIndexTypeWidth == CompilerOptions::kAutoTypeWidth) {
     return SpecializeInputElementType<ThresholdType, ReturnType, FeatureIndexType, int32_t>(tbContext);
   }
   else if (options.nodeIndexTypeWidth == 64) {
@@ -104,7 +104,7 @@ mlir::ModuleOp SpecializeFeatureIndexType(TreebeardContext& tbContext) {
   else if (options.featureIndexTypeWidth == 16) {
     return SpecializeNodeIndexType<ThresholdType, ReturnType, int16_t>(tbContext);
   } 
-  else if (options.featureIndexTypeWidth == 32) {
+  else if (options.featureIndexTypeWidth == 32 || options.featureIndexTypeWidth == CompilerOptions::kAutoTypeWidth) {
     return SpecializeNodeIndexType<ThresholdType, ReturnType, int32_t>(tbContext);
   }
   else if (options.featureIndexTypeWidth == 64) {
@@ -147,9 +147,15 @@ mlir::ModuleOp ConstructLLVMDialectModuleFromXGBoostJSON(TreebeardContext& tbCon
   if (options.thresholdTypeWidth == 32) {
     return SpecializeReturnType<float>(tbContext);
   }
-  else if (options.thresholdTypeWidth == 64) {
+  else if (options.thresholdTypeWidth == 64 || options.thresholdTypeWidth == CompilerOptions::kAutoTypeWidth) {
+    // Auto widths are parsed at full precision and narrowed once the forest has been analyzed
     return SpecializeReturnType<double>(tbContext);
   }
+  else if (options.thresholdTypeWidth == 16) {
+    if (options.thresholdTypeIsBFloat16)
+      return SpecializeReturnType<BFloat16>(tbContext);
+    return SpecializeReturnType<Float16>(tbContext);
+  }
   else {
     assert (false && "Unknown threshold type");
   }
@@ -182,6 +188,18 @@ void ConvertXGBoostJSONToLLVMIR(TreebeardContext& tbContext, const std::string&
   mlir::decisionforest::dumpLLVMIRToFile(module, llvmIRFilePath);
 }
 
+void ConvertLightGBMTextToLLVMIR(TreebeardContext& tbContext, const std::string& llvmIRFilePath) {
+  tbContext.SetForestCreatorType("lightgbm_text");
+  mlir::ModuleOp module = TreeBeard::ConstructLLVMDialectModuleFromForestCreator(tbContext, *tbContext.forestConstructor);
+  mlir::decisionforest::dumpLLVMIRToFile(module, llvmIRFilePath);
+}
+
+void ConvertCatBoostJSONToLLVMIR(TreebeardContext& tbContext, const std::string& llvmIRFilePath) {
+  tbContext.SetForestCreatorType("catboost_json");
+  mlir::ModuleOp module = TreeBeard::ConstructLLVMDialectModuleFromForestCreator(tbContext, *tbContext.forestConstructor);
+  mlir::decisionforest::dumpLLVMIRToFile(module, llvmIRFilePath);
+}
+
 template<typename FloatType, typename ReturnType=FloatType>
 int64_t RunXGBoostInferenceOnCSVInput(const std::string& csvPath, mlir::decisionforest::SharedObjectInferenceRunner& inferenceRunner, int32_t batchSize) {
   TreeBeard::test::TestCSVReader csvReader(csvPath);
@@ -283,6 +301,8 @@ CompilerOptions::CompilerOptions(const std::string& configJSONFilePath)
   SetFieldFromJSONIfPresent(configJSON, "featureIndexTypeWidth", featureIndexTypeWidth);
   SetFieldFromJSONIfPresent(configJSON, "nodeIndexTypeWidth", nodeIndexTypeWidth);
   SetFieldFromJSONIfPresent(configJSON, "inputElementTypeWidth", inputElementTypeWidth);
+  SetFieldFromJSONIfPresent(configJSON, "thresholdTypeIsBFloat16", thresholdTypeIsBFloat16);
+  SetFieldFromJSONIfPresent(configJSON, "fallbackTo32BitThresholds", fallbackTo32BitThresholds);
   SetFieldFromJSONIfPresent(configJSON, "tileShapeBitWidth", tileShapeBitWidth);
   SetFieldFromJSONIfPresent(configJSON, "childIndexBitWidth", childIndexBitWidth);
   SetTilingTypeFromConfigJSON(configJSON, tilingType);
@@ -291,6 +311,18 @@ CompilerOptions::CompilerOptions(const std::string& configJSONFilePath)
   SetFieldFromJSONIfPresent(configJSON, "pipelineSize", pipelineSize);
   SetFieldFromJSONIfPresent(configJSON, "statsProfileCSVPath", statsProfileCSVPath);
   SetFieldFromJSONIfPresent(configJSON, "numberOfCores", numberOfCores);
+  SetFieldFromJSONIfPresent(configJSON, "prefetchDistance", prefetchDistance);
+  SetFieldFromJSONIfPresent(configJSON, "quantizeModel", quantizeModel);
+  SetFieldFromJSONIfPresent(configJSON, "simplifyForest", simplifyForest);
+  SetFieldFromJSONIfPresent(configJSON, "compactFeatures", compactFeatures);
+  SetFieldFromJSONIfPresent(configJSON, "parallelizeTrees", parallelizeTrees);
+  SetFieldFromJSONIfPresent(configJSON, "useWorkStealingRuntime", useWorkStealingRuntime);
+  SetFieldFromJSONIfPresent(configJSON, "replicateModelPerNUMANode", replicateModelPerNUMANode);
+  SetFieldFromJSONIfPresent(configJSON, "modelHugePages", modelHugePages);
+  SetFieldFromJSONIfPresent(configJSON, "specializeObliviousTrees", specializeObliviousTrees);
+  SetFieldFromJSONIfPresent(configJSON, "instrumentLeafHitCounts", instrumentLeafHitCounts);
+  SetFieldFromJSONIfPresent(configJSON, "useFastApproximateTransforms", useFastApproximateTransforms);
+  SetFieldFromJSONIfPresent(configJSON, "peelProbabilisticallyTiledWalks", peelProbabilisticallyTiledWalks);
 }
 
 } // TreeBeard
\ No newline at end of file
@@ -1,17 +1,53 @@
 #ifndef _COMPILEUTILS_H_
 #define _COMPILEUTILS_H_
 
+#include <limits>
 #include "Dialect.h"
 #include "forestcreator.h"
 #include "xgboostparser.h"
 #include "TreebeardContext.h"
+#include "TiledTree.h"
 
 namespace TreeBeard
 {
+// Replace the widths set to CompilerOptions::kAutoTypeWidth with the narrowest widths that are safe 
+// for the constructed forest. The selected widths are written back into the options.
+inline void SelectAutoTypeWidths(CompilerOptions& options, ForestCreator &forestCreator) {
+  const auto autoWidth = CompilerOptions::kAutoTypeWidth;
+  if (options.thresholdTypeWidth == autoWidth)
+    options.thresholdTypeWidth = forestCreator.SelectThresholdType();
+  if (options.featureIndexTypeWidth == autoWidth)
+    options.featureIndexTypeWidth = forestCreator.SelectFeatureIndexType();
+  if (options.nodeIndexTypeWidth == autoWidth)
+    options.nodeIndexTypeWidth = forestCreator.SelectNodeIndexType();
+  if (options.childIndexBitWidth == autoWidth) {
+    // Padding all leaves to the same depth adds tiles that aren't accounted for by the number of nodes and
+    // child indices that point into the leaf dictionary are bounded by the size of the whole dictionary
+    bool unboundedChildIndices = options.makeAllLeavesSameDepth || 
+                                 (mlir::decisionforest::UseLeafDictionaryCompression && options.tileSize > 1);
+    options.childIndexBitWidth = unboundedChildIndices ? 32 : forestCreator.SelectChildIndexBitWidth(options.tileSize);
+  }
+  if (options.tileShapeBitWidth == autoWidth) {
+    // Shape IDs of large tiles are handed out as shapes are encountered, so their number isn't known up front
+    using TileShapeMap = mlir::decisionforest::TileShapeToTileIDMap;
+    int64_t maxTileShapeID = TileShapeMap::UseTileChildTable(options.tileSize) ? std::numeric_limits<int32_t>::max() :
+                                                                                 TileShapeMap::NumberOfTileShapes(options.tileSize) - 1;
+    options.tileShapeBitWidth = ForestCreator::GetNarrowestIntegerWidth(maxTileShapeID);
+  }
+  if (TreeBeard::Logging::loggingOptions.logGenCodeStats) {
+    TreeBeard::Logging::Log("Type widths (threshold, feature index, node index, tile shape, child index) : " + 
+                            std::to_string(options.thresholdTypeWidth) + ", " + std::to_string(options.featureIndexTypeWidth) + ", " +
+                            std::to_string(options.nodeIndexTypeWidth) + ", " + std::to_string(options.tileShapeBitWidth) + ", " +
+                            std::to_string(options.childIndexBitWidth));
+  }
+}
+
 inline mlir::ModuleOp BuildHIRModule(TreebeardContext &tbContext, ForestCreator &forestCreator) {
   const CompilerOptions& options=tbContext.options;
   
   forestCreator.ConstructForest();
+  SelectAutoTypeWidths(tbContext.options, forestCreator);
+  forestCreator.CheckHalfPrecisionThresholds(options.quantizeModel, options.fallbackTo32BitThresholds);
   forestCreator.SetChildIndexBitWidth(options.childIndexBitWidth);
   auto module = forestCreator.GetEvaluationFunction();
   
@@ -23,13 +59,25 @@ inline void DoTilingTransformation(mlir::ModuleOp module,
   const CompilerOptions& options=tbContext.options;
   auto& context = tbContext.context;
 
+  // Simplification removes nodes and trees and so needs to happen before the forest is quantized and tiled
+  if (options.simplifyForest)
+    mlir::decisionforest::DoForestSimplification(context, module);
+
+  // Quantization and tiling need to see the renumbered features
+  if (options.compactFeatures)
+    mlir::decisionforest::DoFeatureCompaction(context, module);
+
+  // Quantization rewrites the thresholds of the trees and so needs to happen before they are tiled
+  if (options.quantizeModel)
+    mlir::decisionforest::DoThresholdQuantization(context, module);
+
   // TODO maybe all the manipulation before the lowering to mid-level IR can be a single custom function?
   if (options.tilingType==TilingType::kUniform)
     mlir::decisionforest::DoUniformTiling(context, module, options.tileSize, options.tileShapeBitWidth, options.makeAllLeavesSameDepth);
+  else if (options.tilingType==TilingType::kProbabilistic)
+    mlir::decisionforest::DoProbabilityBasedTiling(context, module, options.tileSize, options.tileShapeBitWidth, options.peelProbabilisticallyTiledWalks);
   else if (options.tilingType==TilingType::kHybrid)
-    mlir::decisionforest::DoProbabilityBasedTiling(context, module, options.tileSize, options.tileShapeBitWidth);
-  else if (options.tilingType==TilingType::kHybrid)
-    mlir::decisionforest::DoHybridTiling(context, module, options.tileSize, options.tileShapeBitWidth);
+    mlir::decisionforest::DoHybridTiling(context, module, options.tileSize, options.tileShapeBitWidth, options.peelProbabilisticallyTiledWalks);
   else
     assert (false && "Unknown tiling type");
 }
@@ -41,15 +89,25 @@ inline void LowerHIRModuleToLLVM(mlir::ModuleOp module, TreebeardContext &tbCont
   // TODO this needs to change to something that knows how to do all schedule manipulation
   if (options.reorderTreesByDepth) {
     assert(options.pipelineSize == -1 || (options.pipelineSize <= options.batchSize));
-    mlir::decisionforest::DoReorderTreesByDepth(context, module, options.pipelineSize, options.numberOfCores);
+    mlir::decisionforest::DoReorderTreesByDepth(context, module, options.pipelineSize, options.numberOfCores, options.prefetchDistance);
     assert (!options.scheduleManipulator && "Cannot have a custom schedule manipulator and the inbuilt one together");
   }
-  mlir::decisionforest::LowerFromHighLevelToMidLevelIR(context, module);
+  // The leaf hit counts are written in the order of the trees and leaves of the model as it was read. Trees reordered 
+  // by class or across cores keep their index in the model, but simplified trees don't have the leaves of the model.
+  assert ((!options.instrumentLeafHitCounts || (options.tileSize == 1 && !options.reorderTreesByDepth && !options.simplifyForest)) &&
+          "Trees can't be tiled, sorted by depth or simplified when leaf hit counts are collected");
+  if (options.parallelizeTrees) {
+    assert (options.numberOfCores > 1 && "Trees can only be parallelized across more than one core");
+    assert (!options.reorderTreesByDepth && !options.scheduleManipulator && "Tree parallelization builds its own schedule");
+    mlir::decisionforest::DoTreeParallelization(context, module, options.numberOfCores);
+  }
+  mlir::decisionforest::LowerFromHighLevelToMidLevelIR(context, module, options.specializeObliviousTrees, options.useFastApproximateTransforms);
   // module->dump();
-  mlir::decisionforest::LowerEnsembleToMemrefs(context, module, tbContext.serializer, tbContext.representation);
+  mlir::decisionforest::LowerEnsembleToMemrefs(context, module, tbContext.serializer, tbContext.representation, options.instrumentLeafHitCounts);
   mlir::decisionforest::ConvertNodeTypeToIndexType(context, module);
   // module->dump();
-  mlir::decisionforest::LowerToLLVM(context, module, tbContext.representation);
+  mlir::decisionforest::LowerToLLVM(context, module, tbContext.representation, options.useWorkStealingRuntime,
+                                    options.replicateModelPerNUMANode, options.modelHugePages);
   // mlir::decisionforest::dumpLLVMIR(module, false);
 }
 
@@ -89,6 +147,8 @@ void InitializeMLIRContext(mlir::MLIRContext& context);
 mlir::ModuleOp ConstructLLVMDialectModuleFromXGBoostJSON(TreebeardContext& tbContext);
 void ConvertONNXModelToLLVMIR(TreebeardContext& tbContext, const std::string& llvmIRFilePath);
 void ConvertXGBoostJSONToLLVMIR(TreebeardContext& tbContext, const std::string& llvmIRFilePath);
+void ConvertLightGBMTextToLLVMIR(TreebeardContext& tbContext, const std::string& llvmIRFilePath);
+void ConvertCatBoostJSONToLLVMIR(TreebeardContext& tbContext, const std::string& llvmIRFilePath);
 
 void RunInferenceUsingSO(const std::string& soPath, const std::string& modelGlobalsJSONPath, 
                          const std::string& csvPath, const CompilerOptions& options);
@@ -0,0 +1,305 @@
+#include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "StreamingInference.h"
+#include "ModelSerializers.h"
+#include "Logger.h"
+
+namespace
+{
+using namespace TreeBeard;
+using mlir::decisionforest::InferenceRunnerBase;
+
+// Size of the buffers of the input and output file streams
+const int64_t kStreamBufferSize = 1 << 22;
+
+template<typename T>
+class BlockingQueue {
+  std::deque<T> m_queue;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_closed = false;
+public:
+  void Push(T value) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_queue.push_back(value);
+    }
+    m_condition.notify_one();
+  }
+
+  // Waits for a value. Returns false once the queue is closed and empty.
+  bool Pop(T& value) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return !m_queue.empty() || m_closed; });
+    if (m_queue.empty())
+      return false;
+    value = m_queue.front();
+    m_queue.pop_front();
+    return true;
+  }
+
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_closed = true;
+    }
+    m_condition.notify_all();
+  }
+};
+
+struct FreeDeleter {
+  void operator()(char *ptr) { std::free(ptr); }
+};
+using AlignedBuffer = std::unique_ptr<char, FreeDeleter>;
+
+int64_t RoundUp(int64_t value, int64_t multiple) {
+  return ((value + multiple - 1) / multiple) * multiple;
+}
+
+AlignedBuffer AllocateAlignedBuffer(int64_t size, int32_t alignment) {
+  // aligned_alloc needs the size to be a multiple of the alignment
+  auto ptr = reinterpret_cast<char*>(std::aligned_alloc(alignment, RoundUp(size, alignment)));
+  assert (ptr && "Could not allocate a chunk buffer");
+  return AlignedBuffer(ptr);
+}
+
+struct Chunk {
+  AlignedBuffer inputs;
+  AlignedBuffer results;
+  int64_t numRows = 0;
+  int64_t sequenceNumber = 0;
+};
+
+// Chunks go from the reader to the workers to the writer and back to the reader through the queues
+class StreamingInferencePipeline {
+  InferenceRunnerBase& m_inferenceRunner;
+  bool m_returnTypeFloatType;
+  StreamingInferenceOptions m_options;
+  int64_t m_batchSize;
+  int64_t m_rowSize;
+  int64_t m_rowBytes;
+  // Every batch of a chunk starts at an aligned address
+  int64_t m_inputBatchBytes;
+  int64_t m_returnTypeSize;
+  int64_t m_rowsPerChunk;
+  int64_t m_numRowsWritten = 0;
+  std::vector<Chunk> m_chunks;
+  BlockingQueue<Chunk*> m_freeChunks;
+  BlockingQueue<Chunk*> m_filledChunks;
+  BlockingQueue<Chunk*> m_predictedChunks;
+
+  char* GetRow(Chunk& chunk, int64_t row) {
+    return chunk.inputs.get() + (row / m_batchSize) * m_inputBatchBytes + (row % m_batchSize) * m_rowBytes;
+  }
+
+  template<typename InputElementType>
+  void ParseCSVRow(const std::string& line, InputElementType *row) {
+    const char *ptr = line.c_str();
+    int64_t numColumns = m_rowSize + (m_options.csvHasPredictionColumn ? 1 : 0);
+    for (int64_t i=0 ; i<m_rowSize ; ++i) {
+      char *end;
+      double value = std::strtod(ptr, &end);
+      // Empty cells are missing values
+      row[i] = static_cast<InputElementType>(end == ptr ? NAN : value);
+      ptr = end;
+      if (i < numColumns - 1) {
+        assert (*ptr == ',' && "The input has fewer columns than the model has features");
+        ++ptr;
+      }
+    }
+  }
+
+  template<typename InputElementType>
+  void ReadCSVRows(std::istream& fin, Chunk& chunk) {
+    std::string line;
+    while (chunk.numRows < m_rowsPerChunk && std::getline(fin, line)) {
+      if (line.empty() || line == "\r")
+        continue;
+      ParseCSVRow(line, reinterpret_cast<InputElementType*>(GetRow(chunk, chunk.numRows)));
+      ++chunk.numRows;
+    }
+  }
+
+  void ReadBinaryRows(std::istream& fin, Chunk& chunk) {
+    while (chunk.numRows < m_rowsPerChunk) {
+      fin.read(GetRow(chunk, chunk.numRows), m_batchSize * m_rowBytes);
+      auto bytesRead = fin.gcount();
+      assert (bytesRead % m_rowBytes == 0 && "The binary input ends with a partial row");
+      chunk.numRows += bytesRead / m_rowBytes;
+      if (bytesRead < m_batchSize * m_rowBytes)
+        break;
+    }
+  }
+
+  void ReadInput(std::istream& fin) {
+    int64_t sequenceNumber = 0;
+    Chunk *chunk;
+    while (m_freeChunks.Pop(chunk)) {
+      chunk->numRows = 0;
+      if (m_options.inputFormat == StreamingFileFormat::kBinary)
+        ReadBinaryRows(fin, *chunk);
+      else if (m_inferenceRunner.GetInputElementBitWidth() == 32)
+        ReadCSVRows<float>(fin, *chunk);
+      else if (m_inferenceRunner.GetInputElementBitWidth() == 64)
+        ReadCSVRows<double>(fin, *chunk);
+      else
+        assert (false && "Unsupported input element type");
+      if (chunk->numRows == 0)
+        break;
+      // Pad the last batch with zeros
+      auto numPaddingRows = RoundUp(chunk->numRows, m_batchSize) - chunk->numRows;
+      std::memset(GetRow(*chunk, chunk->numRows), 0, numPaddingRows * m_rowBytes);
+      chunk->sequenceNumber = sequenceNumber++;
+      bool lastChunk = chunk->numRows < m_rowsPerChunk;
+      m_filledChunks.Push(chunk);
+      if (lastChunk)
+        break;
+    }
+    m_filledChunks.Close();
+  }
+
+  void PredictChunks() {
+    Chunk *chunk;
+    while (m_filledChunks.Pop(chunk)) {
+      auto numBatches = RoundUp(chunk->numRows, m_batchSize) / m_batchSize;
+      for (int64_t batch=0 ; batch<numBatches ; ++batch) {
+        auto batchPtr = chunk->inputs.get() + batch * m_inputBatchBytes;
+        auto resultsPtr = chunk->results.get() + batch * m_batchSize * m_returnTypeSize;
+        // TODO The types in this template don't really matter. Maybe we should get rid of them?
+        m_inferenceRunner.RunInference<double, double>(reinterpret_cast<double*>(batchPtr), reinterpret_cast<double*>(resultsPtr));
+      }
+      m_predictedChunks.Push(chunk);
+    }
+  }
+
+  template<typename ReturnType>
+  void WriteCSVRows(std::ostream& fout, Chunk& chunk) {
+    auto results = reinterpret_cast<ReturnType*>(chunk.results.get());
+    fout << std::setprecision(std::numeric_limits<ReturnType>::max_digits10);
+    // Unary + prints 8-bit classes as numbers
+    for (int64_t i=0 ; i<chunk.numRows ; ++i)
+      fout << +results[i] << '\n';
+  }
+
+  void WriteChunk(std::ostream& fout, Chunk& chunk) {
+    if (m_options.outputFormat == StreamingFileFormat::kBinary)
+      fout.write(chunk.results.get(), chunk.numRows * m_returnTypeSize);
+    else if (m_returnTypeFloatType && m_returnTypeSize == 4)
+      WriteCSVRows<float>(fout, chunk);
+    else if (m_returnTypeFloatType && m_returnTypeSize == 8)
+      WriteCSVRows<double>(fout, chunk);
+    else if (!m_returnTypeFloatType && m_returnTypeSize == 1)
+      WriteCSVRows<int8_t>(fout, chunk);
+    else if (!m_returnTypeFloatType && m_returnTypeSize == 2)
+      WriteCSVRows<int16_t>(fout, chunk);
+    else if (!m_returnTypeFloatType && m_returnTypeSize == 4)
+      WriteCSVRows<int32_t>(fout, chunk);
+    else if (!m_returnTypeFloatType && m_returnTypeSize == 8)
+      WriteCSVRows<int64_t>(fout, chunk);
+    else
+      assert (false && "Unsupported return type");
+    assert (fout && "Could not write the predictions");
+  }
+
+  void WriteOutput(std::ostream& fout) {
+    // Chunks are predicted out of order when there is more than one worker
+    std::map<int64_t, Chunk*> pendingChunks;
+    int64_t nextSequenceNumber = 0;
+    Chunk *chunk;
+    while (m_predictedChunks.Pop(chunk)) {
+      pendingChunks[chunk->sequenceNumber] = chunk;
+      for (auto iter = pendingChunks.find(nextSequenceNumber) ; iter != pendingChunks.end() ; iter = pendingChunks.find(nextSequenceNumber)) {
+        WriteChunk(fout, *iter->second);
+        m_numRowsWritten += iter->second->numRows;
+        m_freeChunks.Push(iter->second);
+        pendingChunks.erase(iter);
+        ++nextSequenceNumber;
+      }
+    }
+    assert (pendingChunks.empty());
+  }
+
+public:
+  StreamingInferencePipeline(InferenceRunnerBase& inferenceRunner, bool returnTypeFloatType, const StreamingInferenceOptions& options)
+    : m_inferenceRunner(inferenceRunner), m_returnTypeFloatType(returnTypeFloatType), m_options(options)
+  {
+    assert (options.numberOfChunks >= 2 && options.numberOfWorkers >= 1 && options.batchesPerChunk >= 1);
+    m_batchSize = inferenceRunner.GetBatchSize();
+    m_rowSize = inferenceRunner.GetRowSize();
+    m_rowBytes = m_rowSize * inferenceRunner.GetInputElementBitWidth()/8;
+    m_inputBatchBytes = RoundUp(m_batchSize * m_rowBytes, options.bufferAlignment);
+    m_returnTypeSize = inferenceRunner.GetReturnTypeBitWidth()/8;
+    m_rowsPerChunk = m_batchSize * options.batchesPerChunk;
+    m_chunks.resize(options.numberOfChunks);
+    for (auto& chunk : m_chunks) {
+      chunk.inputs = AllocateAlignedBuffer(options.batchesPerChunk * m_inputBatchBytes, options.bufferAlignment);
+      chunk.results = AllocateAlignedBuffer(m_rowsPerChunk * m_returnTypeSize, options.bufferAlignment);
+    }
+  }
+
+  int64_t Run(const std::string& inputPath, const std::string& outputPath) {
+    std::vector<char> inputStreamBuffer(kStreamBufferSize), outputStreamBuffer(kStreamBufferSize);
+    std::ifstream fin;
+    fin.rdbuf()->pubsetbuf(inputStreamBuffer.data(), inputStreamBuffer.size());
+    fin.open(inputPath, std::ios::in | std::ios::binary);
+    assert (fin && "Could not open the input file");
+    std::ofstream fout;
+    fout.rdbuf()->pubsetbuf(outputStreamBuffer.data(), outputStreamBuffer.size());
+    fout.open(outputPath, std::ios::out | std::ios::binary);
+    assert (fout && "Could not open the output file");
+
+    for (auto& chunk : m_chunks)
+      m_freeChunks.Push(&chunk);
+    std::thread reader([this, &fin]() { ReadInput(fin); });
+    std::vector<std::thread> workers;
+    for (int32_t i=0 ; i<m_options.numberOfWorkers ; ++i)
+      workers.emplace_back([this]() { PredictChunks(); });
+    std::thread writer([this, &fout]() { WriteOutput(fout); });
+
+    reader.join();
+    for (auto& worker : workers)
+      worker.join();
+    m_predictedChunks.Close();
+    writer.join();
+    return m_numRowsWritten;
+  }
+};
+
+} // anonymous namespace
+
+namespace TreeBeard
+{
+
+int64_t RunStreamingInference(mlir::decisionforest::InferenceRunnerBase& inferenceRunner, bool returnTypeFloatType,
+                              const std::string& inputPath, const std::string& outputPath,
+                              const StreamingInferenceOptions& streamingOptions) {
+  StreamingInferencePipeline pipeline(inferenceRunner, returnTypeFloatType, streamingOptions);
+  return pipeline.Run(inputPath, outputPath);
+}
+
+void RunStreamingInferenceUsingSO(const std::string& soPath, const std::string& modelGlobalsJSONPath,
+                                  const std::string& inputPath, const std::string& outputPath,
+                                  const CompilerOptions& options, const StreamingInferenceOptions& streamingOptions) {
+  auto serializer = mlir::decisionforest::ConstructModelSerializer(modelGlobalsJSONPath);
+  mlir::decisionforest::SharedObjectInferenceRunner inferenceRunner(serializer, soPath, options.tileSize, options.thresholdTypeWidth, options.featureIndexTypeWidth);
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  auto numRows = RunStreamingInference(inferenceRunner, options.returnTypeFloatType, inputPath, outputPath, streamingOptions);
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  auto time = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+  TreeBeard::Logging::Log("Rows predicted : " + std::to_string(numRows) + " Execution time (us) : " + std::to_string(time));
+}
+
+} // TreeBeard
@@ -0,0 +1,48 @@
+#ifndef _STREAMINGINFERENCE_H_
+#define _STREAMINGINFERENCE_H_
+
+#include <cstdint>
+#include <string>
+#include "ExecutionHelpers.h"
+#include "TreebeardContext.h"
+
+// Scores input files that don't fit in memory. A reader thread parses the input into chunks of
+// batchesPerChunk batches, inference workers predict the batches of each chunk and a writer thread
+// writes the predictions of the chunks in the order of the input. numberOfChunks chunk buffers are
+// allocated up front and recycled, so the memory used doesn't depend on the size of the input and
+// reading, predicting and writing the chunks overlap.
+
+namespace TreeBeard
+{
+
+// kCSV is comma separated text with one row per line. kBinary is rows of the input element type
+// (predictions of the return type) stored back to back without any header.
+enum class StreamingFileFormat { kCSV, kBinary };
+
+struct StreamingInferenceOptions {
+  StreamingFileFormat inputFormat = StreamingFileFormat::kCSV;
+  StreamingFileFormat outputFormat = StreamingFileFormat::kCSV;
+  // Ignore the last column of every CSV row (the test inputs end with the expected prediction)
+  bool csvHasPredictionColumn = false;
+  int32_t batchesPerChunk = 1024;
+  // At least two so that a chunk can be read while another one is predicted. With three, a chunk can
+  // also be written at the same time.
+  int32_t numberOfChunks = 3;
+  int32_t numberOfWorkers = 1;
+  // Alignment of the batches in the chunk buffers in bytes
+  int32_t bufferAlignment = 64;
+};
+
+// Predicts every row of inputPath and writes the predictions to outputPath. The last batch is padded
+// with zeros if the number of rows isn't a multiple of the batch size. Returns the number of rows predicted.
+int64_t RunStreamingInference(mlir::decisionforest::InferenceRunnerBase& inferenceRunner, bool returnTypeFloatType,
+                              const std::string& inputPath, const std::string& outputPath,
+                              const StreamingInferenceOptions& streamingOptions);
+
+void RunStreamingInferenceUsingSO(const std::string& soPath, const std::string& modelGlobalsJSONPath,
+                                  const std::string& inputPath, const std::string& outputPath,
+                                  const CompilerOptions& options, const StreamingInferenceOptions& streamingOptions);
+
+} // TreeBeard
+
+#endif // _STREAMINGINFERENCE_H_
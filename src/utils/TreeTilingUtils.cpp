@@ -469,8 +469,10 @@ void ForestJSONReader::InitializeLengthBuffer(void* bufPtr, int32_t tileSize, in
 
 void ForestJSONReader::InitializeLookUpTable(void* bufPtr, int32_t tileSize, int32_t entryBitWidth) {
     assert (entryBitWidth == 8 && "LUT entry must be i8");
+    assert (!TileShapeToTileIDMap::UseTileChildTable(tileSize) && "Large tiles don't have a LUT");
     int8_t* lutBufferPtr = reinterpret_cast<int8_t*>(bufPtr);
-    TileShapeToTileIDMap& tileShapeToTileIDMap = *TileShapeToTileIDMap::Get(tileSize);
+    // All shapes of small tiles are enumerated up front in the same order, so any map assigns them the same IDs
+    TileShapeToTileIDMap tileShapeToTileIDMap(tileSize);
     auto lut = tileShapeToTileIDMap.ComputeTileLookUpTable();
     for (size_t tileShapeID=0 ; tileShapeID<lut.size() ; ++tileShapeID) {
         for (size_t outcome=0 ; outcome<lut.at(tileShapeID).size() ; ++outcome) {
@@ -822,6 +824,25 @@ std::string TiledTreeNode::GetTileShapeString() {
     return tileShapeStr;
 }
 
+void TiledTreeNode::ComputeTileShapeKey(std::string& str, int32_t tileNodeIndex) {
+    str.push_back('1');
+    auto& node = GetNode(tileNodeIndex);
+    if (node.leftChild!=DecisionTree::INVALID_NODE_INDEX && AreNodesInSameTile(tileNodeIndex, node.leftChild))
+        ComputeTileShapeKey(str, node.leftChild);
+    else
+        str.push_back('0');
+    if (node.rightChild!=DecisionTree::INVALID_NODE_INDEX && AreNodesInSameTile(tileNodeIndex, node.rightChild))
+        ComputeTileShapeKey(str, node.rightChild);
+    else
+        str.push_back('0');
+}
+
+std::string TiledTreeNode::GetTileShapeKey() {
+    std::string tileShapeKey;
+    ComputeTileShapeKey(tileShapeKey, GetEntryNode());
+    return tileShapeKey;
+}
+
 void TiledTreeNode::WriteDOTSubGraph(std::ofstream& fout) {
     std::vector<std::string> colors = { "aquamarine3", "darkolivegreen4", "deepskyblue", "firebrick", "grey80", "teal"};
     std::string& color = colors[m_tileID % colors.size()];
@@ -851,7 +872,7 @@ void TiledTreeNode::WriteDOTSubGraph(std::ofstream& fout) {
 
 TiledTree::TiledTree(DecisionTree& owningTree)
  : m_numberOfDummyTiles(0), m_owningTree(owningTree), m_modifiedTree(owningTree), 
-   m_tileShapeToTileIDMap(*TileShapeToTileIDMap::Get(m_owningTree.TilingDescriptor().MaxTileSize())), m_probabilisticallyTiled(false),
+   m_tileShapeToTileIDMap(owningTree.GetTileShapeToTileIDMap()), m_probabilisticallyTiled(false),
    m_levelsToUnroll(-1)
 {
     ConstructTiledTree();
@@ -919,16 +940,20 @@ void TiledTree::ConstructTiledTree() {
         SetChildrenForTile(tile);
     }
     
+    m_numTilesThatAreNotSubsets=0;
+    // The shape strings have 2^tileSize characters. Don't compute these stats for large tiles.
+    bool computeSubsetStats = !TileShapeToTileIDMap::UseTileChildTable(m_modifiedTree.TilingDescriptor().MaxTileSize());
     std::set<std::string> tileShapeStrings;
     for (auto& tile : m_tiles) {
-        if (tile.IsLeafTile() || (int32_t)tile.m_nodeIndices.size() != m_modifiedTree.TilingDescriptor().MaxTileSize())
+        if (!computeSubsetStats || tile.IsLeafTile() || (int32_t)tile.m_nodeIndices.size() != m_modifiedTree.TilingDescriptor().MaxTileSize())
             continue;
         std::string tileString = tile.GetTileShapeString();
         tileShapeStrings.insert(tileString);
     }
 
-    m_numTilesThatAreNotSubsets=0;
     for (auto& tile : m_tiles) {
+        if (!computeSubsetStats)
+            break;
         // Only iterate through incomplete tiles
         if (tile.IsLeafTile() || (int32_t)tile.m_nodeIndices.size() == m_modifiedTree.TilingDescriptor().MaxTileSize())
             continue;
@@ -1255,14 +1280,18 @@ void TiledTree::ExploreTreeSplits() {
 
 void TiledTree::GetSparseSerialization(std::vector<double>& thresholds, std::vector<int32_t>& featureIndices, 
                                        std::vector<int32_t>& tileShapeIDs, std::vector<int32_t>& childIndices,
-                                       std::vector<double>& leaves) {
+                                       std::vector<double>& leaves, bool hotPathLayout) {
+    // Probabilistically tiled trees already put the likely paths into the peeled levels. They are always
+    // serialized in level order.
     if (m_probabilisticallyTiled) {
         GetSparseSerializationPeeled(thresholds, featureIndices, tileShapeIDs, childIndices, leaves);
         return;
     }
     thresholds.clear(); featureIndices.clear(); tileShapeIDs.clear(); childIndices.clear(); leaves.clear();
 
-    TiledTree::LevelOrderTraversal levelOrder(m_tiles);
+    // The children of a tile are always laid out contiguously, so the leaf tiles whose siblings are all 
+    // leaves are still contiguous in the leaves array with the hot path layout.
+    TiledTree::LevelOrderTraversal levelOrder(m_tiles, hotPathLayout);
     auto& sortedTiles = levelOrder.LevelOrderNodes();
     std::map<int32_t, int32_t> tileIndexMap;
     int32_t numberOfTilesInLeafArray=0, currentTileIndex=0;
@@ -1747,6 +1776,9 @@ int32_t TiledTree::NumberOfLevelsNeededToCoverInputs(double inputFraction) {
 // -----------------------------------------------
 
 void TileShapeToTileIDMap::InitMap() {
+    // Shapes of large tiles are assigned IDs lazily in GetTileID
+    if (UseTileChildTable(m_tileSize))
+        return;
     TileStringGenerator(m_tileSize);
 }
 
@@ -1856,34 +1888,24 @@ void TileShapeToTileIDMap::TileStringGenerator(int32_t numNodes) {
     assert (static_cast<int32_t>(m_tileStringToTileIDMap.size()) == (TileShapeToTileIDMap::NumberOfTileShapes(m_tileSize)+1));
 }
 
-std::map<int32_t, int32_t> TileShapeToTileIDMap::tileSizeToNumberOfShapesMap;
-std::map<int32_t, TileShapeToTileIDMap*> TileShapeToTileIDMap::tileSizeToTileShapeMapMap;
-
 int32_t TileShapeToTileIDMap::NumberOfTileShapes(int32_t tileSize) {
     assert(tileSize >= 0);
-    if (tileSize==0 || tileSize == 1) return 1;
-    if (tileSize == 2) return 2;
-    
-    auto iter = tileSizeToNumberOfShapesMap.find(tileSize);
-    if (iter != tileSizeToNumberOfShapesMap.end())
-        return iter->second;
-    
-    int32_t numShapes=0;
-    for (int32_t leftSubTreeSize=0 ; leftSubTreeSize<tileSize ; ++leftSubTreeSize) {
-        numShapes += NumberOfTileShapes(leftSubTreeSize)*NumberOfTileShapes(tileSize-1-leftSubTreeSize);
+    // numShapes[n] is the number of binary trees with n nodes
+    std::vector<int32_t> numShapes(tileSize+1, 0);
+    numShapes[0] = 1;
+    for (int32_t numNodes=1 ; numNodes<=tileSize ; ++numNodes) {
+        for (int32_t leftSubTreeSize=0 ; leftSubTreeSize<numNodes ; ++leftSubTreeSize) {
+            numShapes[numNodes] += numShapes[leftSubTreeSize]*numShapes[numNodes-1-leftSubTreeSize];
+        }
     }
-    tileSizeToNumberOfShapesMap[tileSize] = numShapes;
-    return numShapes;
+    return numShapes[tileSize];
 }
 
-TileShapeToTileIDMap* TileShapeToTileIDMap::Get(int32_t tileSize) {
-    auto iter = tileSizeToTileShapeMapMap.find(tileSize);
-    if (iter == tileSizeToTileShapeMapMap.end()) {
-        tileSizeToTileShapeMapMap[tileSize] = new TileShapeToTileIDMap(tileSize);
-        iter = tileSizeToTileShapeMapMap.find(tileSize);
-    }
-    assert (iter != tileSizeToTileShapeMapMap.end());
-    return iter->second;
+TileShapeToTileIDMap& TileShapeToTileIDMaps::Get(int32_t tileSize) {
+    auto& tileShapeToTileIDMap = m_tileSizeToTileShapeMap[tileSize];
+    if (tileShapeToTileIDMap.get() == nullptr)
+        tileShapeToTileIDMap = std::make_shared<TileShapeToTileIDMap>(tileSize);
+    return *tileShapeToTileIDMap;
 }
 
 int32_t ConstructTreeForTile(const std::string& tileStr, int32_t root, DecisionTree& tree) {
@@ -1906,6 +1928,25 @@ int32_t ConstructTreeForTile(const std::string& tileStr, int32_t root, DecisionT
     return node;
 }
 
+int32_t ConstructTreeForTileKey(const std::string& tileKey, size_t& position, DecisionTree& tree) {
+    assert (position < tileKey.size());
+    if (tileKey.at(position++) == '0')
+        return -1;
+    auto node = tree.NewNode(-1, -static_cast<int32_t>(position)); // Tile nodes have negative feature indices
+    auto leftChild = ConstructTreeForTileKey(tileKey, position, tree);
+    auto rightChild = ConstructTreeForTileKey(tileKey, position, tree);
+
+    if (rightChild != -1) {
+        tree.SetNodeParent(rightChild, node);
+        tree.SetNodeRightChild(node, rightChild);
+    }
+    if (leftChild != -1) {
+        tree.SetNodeParent(leftChild, node);
+        tree.SetNodeLeftChild(node, leftChild);
+    }
+    return node;
+}
+
 void AddTileChildren(DecisionTree& tree, int32_t nodeNumber, int32_t& childNumber) {
     if (nodeNumber == -1)
         return;
@@ -2017,7 +2058,68 @@ std::vector<std::vector<int32_t>> TileShapeToTileIDMap::ComputeTileLookUpTable()
     return tileLUT;
 }
 
+void AddTileChildPaths(DecisionTree& tree, int64_t nodeIndex, int64_t pathMask, int64_t pathOutcomes, std::vector<std::pair<int64_t, int64_t>>& childPaths) {
+    auto& node = tree.GetNodes().at(nodeIndex);
+    // AddTileChildren sets the feature index of the children of the tile to the child number
+    if (node.featureIndex >= 0) {
+        childPaths.at(node.featureIndex) = std::make_pair(pathMask, pathOutcomes);
+        return;
+    }
+    auto nodeBit = int64_t(1) << nodeIndex;
+    AddTileChildPaths(tree, node.leftChild, pathMask | nodeBit, pathOutcomes | nodeBit, childPaths);
+    AddTileChildPaths(tree, node.rightChild, pathMask | nodeBit, pathOutcomes, childPaths);
+}
+
+int64_t ReverseTileBits(int64_t bits, int32_t tileSize) {
+    int64_t reversedBits = 0;
+    for (int32_t i=0 ; i<tileSize ; ++i)
+        if (bits & (int64_t(1) << i))
+            reversedBits |= int64_t(1) << (tileSize - 1 - i);
+    return reversedBits;
+}
+
+// Assume that the children of the tile are stored left to right
+std::vector<std::vector<int64_t>> TileShapeToTileIDMap::ComputeTileChildTable(bool nodeZeroIsMostSignificantBit) {
+    assert (UseTileChildTable(m_tileSize));
+    auto tableWidth = TileChildTableWidth(m_tileSize);
+    std::vector<std::vector<int64_t>> childTable(m_currentTileID);
+    for (int32_t tileShapeID=0 ; tileShapeID<m_currentTileID ; ++tileShapeID) {
+        DecisionTree tree;
+        size_t position = 0;
+        ConstructTreeForTileKey(m_tileIDToTileKey.at(tileShapeID), position, tree);
+
+        LevelOrderTraversal levelOrderTraversal(tree.GetNodes());
+        tree.SetNodes(levelOrderTraversal.LevelOrderNodes());
+
+        int32_t childNumber = 0;
+        AddTileChildren(tree, 0, childNumber);
+
+        // Nodes of the tile are at indices [0, numNodes) in level order. A comparison outcome of 1 means
+        // the walk moves to the left child. Entries of missing children never match any outcomes.
+        std::vector<std::pair<int64_t, int64_t>> childPaths(tableWidth, std::make_pair(int64_t(0), int64_t(1)));
+        AddTileChildPaths(tree, 0, 0, 0, childPaths);
+        std::vector<int64_t> entries(2*tableWidth);
+        for (int32_t child=0 ; child<tableWidth ; ++child) {
+            auto& childPath = childPaths.at(child);
+            bool isTileChild = child < childNumber;
+            entries.at(child) = nodeZeroIsMostSignificantBit && isTileChild ? ReverseTileBits(childPath.first, m_tileSize) : childPath.first;
+            entries.at(tableWidth + child) = nodeZeroIsMostSignificantBit && isTileChild ? ReverseTileBits(childPath.second, m_tileSize) : childPath.second;
+        }
+        childTable.at(tileShapeID) = entries;
+    }
+    return childTable;
+}
+
 int32_t TileShapeToTileIDMap::GetTileID(TiledTreeNode& tile) {
+    if (UseTileChildTable(m_tileSize)) {
+        auto shapeKey = tile.GetTileShapeKey();
+        auto mapIter = m_tileStringToTileIDMap.find(shapeKey);
+        if (mapIter != std::end(m_tileStringToTileIDMap))
+            return mapIter->second;
+        m_tileStringToTileIDMap[shapeKey] = m_currentTileID;
+        m_tileIDToTileKey.push_back(shapeKey);
+        return m_currentTileID++;
+    }
     auto shapeString = tile.GetTileShapeString();
     auto mapIter = m_tileStringToTileIDMap.find(shapeString);
     assert (mapIter != std::end(m_tileStringToTileIDMap));
@@ -50,7 +50,7 @@ std::shared_ptr<ForestCreator> SpecializeNodeIndexType(mlir::MLIRContext& contex
   else if (options.nodeIndexTypeWidth == 16) {
     return SpecializeInputElementType<ThresholdType, ReturnType, FeatureIndexType, int16_t>(context, tbContext);
   } 
-  else if (options.nodeIndexTypeWidth == 32) {
+  else if (options.nodeIndexTypeWidth == 32 || options.nodeIndexTypeWidth == CompilerOptions::kAutoTypeWidth) {
     return SpecializeInputElementType<ThresholdType, ReturnType, FeatureIndexType, int32_t>(context, tbContext);
   }
   else if (options.nodeIndexTypeWidth == 64) {
@@ -71,7 +71,7 @@ std::shared_ptr<ForestCreator> SpecializeFeatureIndexType(mlir::MLIRContext& con
   else if (options.featureIndexTypeWidth == 16) {
     return SpecializeNodeIndexType<ThresholdType, ReturnType, int16_t>(context, tbContext);
   } 
-  else if (options.featureIndexTypeWidth == 32) {
+  else if (options.featureIndexTypeWidth == 32 || options.featureIndexTypeWidth == CompilerOptions::kAutoTypeWidth) {
     return SpecializeNodeIndexType<ThresholdType, ReturnType, int32_t>(context, tbContext);
   }
   else if (options.featureIndexTypeWidth == 64) {
@@ -119,9 +119,15 @@ std::shared_ptr<ForestCreator> ConstructXGBoostJSONParser(TreebeardContext& tbCo
   if (options.thresholdTypeWidth == 32) {
     return SpecializeReturnType<float>(context, tbContext);
   }
-  else if (options.thresholdTypeWidth == 64) {
+  else if (options.thresholdTypeWidth == 64 || options.thresholdTypeWidth == CompilerOptions::kAutoTypeWidth) {
+    // Auto widths are parsed at full precision and narrowed once the forest has been analyzed
     return SpecializeReturnType<double>(context, tbContext);
   }
+  else if (options.thresholdTypeWidth == 16) {
+    if (options.thresholdTypeIsBFloat16)
+      return SpecializeReturnType<BFloat16>(context, tbContext);
+    return SpecializeReturnType<Float16>(context, tbContext);
+  }
   else {
     assert (false && "Unknown threshold type");
   }